@@ -48,6 +48,11 @@ enum adc_channel {
 	ADC_CH_COUNT
 };
 
+/* Number of register writes received by the mock charger */
+int charger_mock_get_write_count(void);
+/* Number of status reads received by the mock charger */
+int charger_mock_get_status_reads(void);
+
 /* Fake test charge suppliers */
 enum {
 	CHARGE_SUPPLIER_TEST1,
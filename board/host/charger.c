@@ -31,6 +31,18 @@ static uint32_t mock_mode;
 static uint32_t mock_current;
 static uint32_t mock_voltage;
 static uint32_t mock_input_current;
+static int mock_write_count;
+static int mock_status_reads;
+
+int charger_mock_get_write_count(void)
+{
+	return mock_write_count;
+}
+
+int charger_mock_get_status_reads(void)
+{
+	return mock_status_reads;
+}
 
 static const struct charger_info *mock_get_info(int chgnum)
 {
@@ -40,6 +52,7 @@ static const struct charger_info *mock_get_info(int chgnum)
 
 static enum ec_error_list mock_get_status(int chgnum, int *status)
 {
+	mock_status_reads++;
 	*status = CHARGER_LEVEL_2;
 	if (mock_mode & CHARGE_FLAG_INHIBIT_CHARGE)
 		*status |= CHARGER_CHARGE_INHIBITED;
@@ -50,6 +63,7 @@ static enum ec_error_list mock_get_status(int chgnum, int *status)
 
 static enum ec_error_list mock_set_mode(int chgnum, int mode)
 {
+	mock_write_count++;
 	if (mode & CHARGE_FLAG_INHIBIT_CHARGE)
 		mock_mode |= OPTION_CHARGE_INHIBIT;
 	else
@@ -69,6 +83,8 @@ static enum ec_error_list mock_set_current(int chgnum, int current)
 {
 	const struct charger_info *info = mock_get_info(chgnum);
 
+	mock_write_count++;
+
 	if (current > 0 && current < info->current_min)
 		current = info->current_min;
 	if (current > info->current_max)
@@ -89,6 +105,7 @@ static enum ec_error_list mock_get_voltage(int chgnum, int *voltage)
 
 static enum ec_error_list mock_set_voltage(int chgnum, int voltage)
 {
+	mock_write_count++;
 	mock_voltage = voltage;
 	ccprintf("Charger set voltage: %d\n", voltage);
 	return EC_SUCCESS;
@@ -104,6 +121,7 @@ static enum ec_error_list mock_get_option(int chgnum, int *option)
 
 static enum ec_error_list mock_set_option(int chgnum, int option)
 {
+	mock_write_count++;
 	mock_option = option;
 	return EC_SUCCESS;
 }
@@ -132,6 +150,8 @@ static enum ec_error_list mock_set_input_current(int chgnum, int current)
 {
 	const struct charger_info *info = mock_get_info(chgnum);
 
+	mock_write_count++;
+
 	if (current < info->input_current_min)
 		current = info->input_current_min;
 	if (current > info->input_current_max)
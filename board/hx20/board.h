@@ -164,6 +164,9 @@
 #define CONFIG_BATTERY_PRESENT_CUSTOM
 #define CONFIG_BOARD_VERSION_CUSTOM
 #define CONFIG_CHARGE_MANAGER
+/* Coalesce the per-supplier updates seeded by the CYPD task on attach */
+#undef CONFIG_CHARGE_MANAGER_REFRESH_DELAY
+#define CONFIG_CHARGE_MANAGER_REFRESH_DELAY (5 * MSEC)
 /* #define CONFIG_CHARGE_RAMP_SW */
 
 #undef CONFIG_HOSTCMD_LOCATE_CHIP
@@ -322,6 +325,8 @@
  */
 #define CONFIG_SPI_FLASH_PORT 0
 #define CONFIG_SPI_FLASH
+/* Read flash with QMSPI DMA while hashing */
+#define CONFIG_FLASH_READ_ASYNC
 
 /*
  * MB use W25Q80 SPI ROM
@@ -395,6 +400,14 @@
 #undef CONFIG_FAN_INIT_SPEED
 #define CONFIG_FAN_INIT_SPEED 15
 #define FAN_HARDARE_MAX 7100
+/* Smooth out sensor noise and ramp the fan ahead of rising temperatures */
+#define CONFIG_THERMAL_FILTER_MEDIAN
+#undef CONFIG_THERMAL_FILTER_EMA_SHIFT
+#define CONFIG_THERMAL_FILTER_EMA_SHIFT 1
+#undef CONFIG_THERMAL_PREDICT_SEC
+#define CONFIG_THERMAL_PREDICT_SEC 5
+#undef CONFIG_THERMAL_TRACE_SIZE
+#define CONFIG_THERMAL_TRACE_SIZE 32
 #define CONFIG_TEMP_SENSOR
 #define CONFIG_DPTF
 #define CONFIG_TEMP_SENSOR_F75303
@@ -410,6 +423,11 @@
 #define CONFIG_PECI
 #define CONFIG_PECI_COMMON
 #define CONFIG_PECI_TJMAX 100
+#define CONFIG_PECI_QUEUE
+/* thermal.c, dptf.c and temp_sensor.c each read the CPU temp every second */
+#undef CONFIG_PECI_TEMP_CACHE_US
+#define CONFIG_PECI_TEMP_CACHE_US (300 * MSEC)
+#define CONFIG_SOC_POWER_LIMIT
 
 /* SPI Accelerometer
  * CONFIG_SPI_FLASH_PORT is the index into
@@ -569,6 +587,9 @@
 	 EC_HOST_EVENT_MASK(EC_HOST_EVENT_BATT_BTP)	|			\
 	 EC_HOST_EVENT_MASK(EC_HOST_EVENT_KEY_PRESSED))
 
+/* Track peak stack usage of the tasks, to size them in ec.tasklist */
+#define CONFIG_STACK_WATCH
+
 /* Ambient Light Sensor address */
 #define OPT3001_I2C_ADDR_FLAGS	OPT3001_I2C_ADDR1_FLAGS
 
@@ -11,6 +11,7 @@
 #include "host_command.h"
 #include "peci.h"
 #include "peci_customization.h"
+#include "soc_power_limit.h"
 #include "cypress5525.h"
 #include "math_util.h"
 #include "util.h"
@@ -21,18 +22,110 @@
 
 #define POWER_LIMIT_1_W	28
 
-static int pl1_watt;
-static int pl2_watt;
-static int pl4_watt;
-static int psys_watt;
-bool manual_ctl;
+#define PL_CONST(w)	{ .base = SOC_PL_BASE_NONE, .offset_w = (w) }
+
+static const struct soc_pl_rule pl_rules[] = {
+	/* Battery only or ADP < 55W */
+	{
+		.adapter_max_w = 55,
+		.limit = {
+			[SOC_PL1] = PL_CONST(POWER_LIMIT_1_W),
+			[SOC_PL2] = PL_CONST(POWER_LIMIT_1_W),
+			[SOC_PL4] = {
+				.base = SOC_PL_BASE_NONE,
+				.offset_w = 70,
+				.minus_pps = 1,
+			},
+			[SOC_PSYS_PL2] = {
+				.base = SOC_PL_BASE_NONE,
+				.offset_w = 52,
+				.minus_pps = 1,
+			},
+		},
+	},
+	/* ADP > 55W and Battery percentage < 30% */
+	{
+		.adapter_min_w = 55,
+		.battery_max_pct = 30,
+		.limit = {
+			[SOC_PL1] = PL_CONST(POWER_LIMIT_1_W),
+			/* pl2 = MIN(pl4 * 0.9, 64) */
+			[SOC_PL2] = {
+				.base = SOC_PL4,
+				.pct = 90,
+				.max_w = 64,
+			},
+			/* pl4 = adp watt - 15 - pps power budget */
+			[SOC_PL4] = {
+				.base = SOC_PL_BASE_ADAPTER,
+				.pct = 100,
+				.offset_w = -15,
+				.minus_pps = 1,
+			},
+			/* psys = adp watt * 0.95 - pps power budget */
+			[SOC_PSYS_PL2] = {
+				.base = SOC_PL_BASE_ADAPTER,
+				.pct = 95,
+				.minus_pps = 1,
+			},
+		},
+	},
+	/* ADP > 55W and Battery percentage >= 30% */
+	{
+		.adapter_min_w = 55,
+		.limit = {
+			[SOC_PL1] = PL_CONST(POWER_LIMIT_1_W),
+			[SOC_PL2] = PL_CONST(64),
+			[SOC_PL4] = PL_CONST(121),
+			/*
+			 * psys watt = adp watt * 0.95 + battery watt(55 W) * 0.7
+			 * - pps power budget
+			 */
+			[SOC_PSYS_PL2] = {
+				.base = SOC_PL_BASE_ADAPTER,
+				.pct = 95,
+				.offset_w = 39,
+				.minus_pps = 1,
+			},
+		},
+	},
+};
+
+const struct soc_pl_policy soc_pl_policy = {
+	.rules = pl_rules,
+	.rule_count = ARRAY_SIZE(pl_rules),
+	/* Don't flip limits while the battery hovers around 30% */
+	.battery_hyst_pct = 2,
+	/* Limits only drop right away; raise them at most once a second */
+	.min_interval_us = SECOND,
+};
+
+static void pl_write_done(int rv, const uint8_t *r_buf, void *priv)
+{
+	enum soc_pl pl = (enum soc_pl)(uintptr_t)priv;
+
+	if (rv != EC_SUCCESS) {
+		CPRINTS("SoC power limit %d write failed: %d", pl, rv);
+		soc_pl_write_failed(pl);
+	}
+}
 
-void set_pl_limits(int pl1, int pl2, int pl4, int psys)
+int board_soc_pl_write(enum soc_pl pl, int watts)
 {
-		peci_update_PL1(pl1);
-		peci_update_PL2(pl2);
-		peci_update_PL4(pl4);
-		peci_update_PsysPL2(psys);
+	void *priv = (void *)(uintptr_t)pl;
+
+	switch (pl) {
+	case SOC_PL1:
+		return peci_update_PL1(watts, pl_write_done, priv);
+	case SOC_PL2:
+		return peci_update_PL2(watts, pl_write_done, priv);
+	case SOC_PL4:
+		return peci_update_PL4(watts, pl_write_done, priv);
+	case SOC_PSYS_PL2:
+		return peci_update_PsysPL2(watts, pl_write_done, priv);
+	default:
+		return EC_ERROR_INVAL;
+	}
 }
 
 void update_soc_power_limit(bool force_update, bool force_no_adapter)
@@ -40,54 +133,16 @@ void update_soc_power_limit(bool force_update, bool force_no_adapter)
 	/*
 	 * power limit is related to AC state, battery percentage, and power budget
 	 */
+	struct soc_pl_inputs in;
 
-	int active_power;
-	int pps_power_budget;
-	int battery_percent;
-
-	static int old_pl2_watt = -1;
-	static int old_pl4_watt = -1;
-	static int old_psys_watt = -1;
+	in.battery_pct = charge_get_percent();
+	in.adapter_w = charge_manager_get_power_limit_uw()/1000000;
+	in.pps_budget_w = cypd_get_pps_power_budget();
 
-	/* TODO: get the power and pps_power_budget */
-	battery_percent = charge_get_percent();
-	active_power = charge_manager_get_power_limit_uw()/1000000;
-	pps_power_budget = cypd_get_pps_power_budget();
+	if (force_no_adapter || !extpower_is_present())
+		in.adapter_w = 0;
 
-	if (force_no_adapter) {
-		active_power = 0;
-	}
-
-	if (!extpower_is_present() || (active_power < 55)) {
-		/* Battery only or ADP < 55W */
-		pl2_watt = POWER_LIMIT_1_W;
-		pl4_watt = 70 - pps_power_budget;
-		psys_watt = 52 - pps_power_budget;
-	} else if (battery_percent < 30) {
-		/* ADP > 55W and Battery percentage < 30% */
-		pl4_watt = active_power - 15 - pps_power_budget;
-		pl2_watt = MIN((pl4_watt * 90) / 100, 64);
-		psys_watt = ((active_power * 95) / 100) - pps_power_budget;
-	} else {
-		/* ADP > 55W and Battery percentage >= 30% */
-		pl2_watt = 64;
-		pl4_watt = 121;
-		/* psys watt = adp watt * 0.95 + battery watt(55 W) * 0.7 - pps power budget */
-		psys_watt = ((active_power * 95) / 100) + 39 - pps_power_budget;
-	}
-	if (pl2_watt != old_pl2_watt || pl4_watt != old_pl4_watt ||
-			psys_watt != old_psys_watt || force_update) {
-		old_psys_watt = psys_watt;
-		old_pl4_watt = pl4_watt;
-		old_pl2_watt = pl2_watt;
-
-		pl1_watt = POWER_LIMIT_1_W;
-		if (manual_ctl == false) {
-			CPRINTS("Updating SOC Power Limits: PL2 %d, PL4 %d, Psys %d, Adapter %d",
-				pl2_watt, pl4_watt, psys_watt, active_power);
-			set_pl_limits(pl1_watt, pl2_watt, pl4_watt, psys_watt);
-		}
-	}
+	soc_pl_update(&in, force_update);
 }
 
 void update_soc_power_limit_hook(void)
@@ -102,43 +157,36 @@ DECLARE_HOOK(HOOK_BATTERY_SOC_CHANGE, update_soc_power_limit_hook, HOOK_PRIO_DEF
 
 static int cmd_cpupower(int argc, char **argv)
 {
-	uint32_t pl1, pl2, pl4, psys;
+	int limit[SOC_PL_COUNT];
 	char *e;
+	int i;
 
+	soc_pl_get_applied(limit);
 	CPRINTF("SOC Power Limit: PL1 %d, PL2 %d, PL4 %d, Psys %d\n",
-		pl1_watt, pl2_watt, pl4_watt, psys_watt);
+		limit[SOC_PL1], limit[SOC_PL2], limit[SOC_PL4],
+		limit[SOC_PSYS_PL2]);
 	if (argc >= 2) {
 		if (!strncmp(argv[1], "auto", 4)) {
-			manual_ctl = false;
 			CPRINTF("Auto Control");
-			update_soc_power_limit(false, false);
+			soc_pl_set_manual(NULL);
 		}
 		if (!strncmp(argv[1], "manual", 6)) {
-			manual_ctl = true;
 			CPRINTF("Manual Control");
-			set_pl_limits(pl1_watt, pl2_watt, pl4_watt, psys_watt);
+			/* Hold the limits currently in effect */
+			for (i = 0; i < SOC_PL_COUNT; i++)
+				if (limit[i] < 0)
+					return EC_ERROR_NOT_POWERED;
+			soc_pl_set_manual(limit);
 		}
 	}
 
 	if (argc >= 5) {
-		pl1 = strtoi(argv[1], &e, 0);
-		if (*e)
-			return EC_ERROR_PARAM1;
-		pl2 = strtoi(argv[2], &e, 0);
-		if (*e)
-			return EC_ERROR_PARAM2;
-		pl4 = strtoi(argv[3], &e, 0);
-		if (*e)
-			return EC_ERROR_PARAM3;
-		psys = strtoi(argv[4], &e, 0);
-		if (*e)
-			return EC_ERROR_PARAM4;
-		pl1_watt = pl1;
-		pl2_watt = pl2;
-		pl4_watt = pl4;
-		psys_watt = psys;
-		set_pl_limits(pl1_watt, pl2_watt, pl4_watt, psys_watt);
-
+		for (i = 0; i < SOC_PL_COUNT; i++) {
+			limit[i] = strtoi(argv[i + 1], &e, 0);
+			if (*e)
+				return EC_ERROR_PARAM1 + i;
+		}
+		soc_pl_set_manual(limit);
 	}
 	return EC_SUCCESS;
 
@@ -47,9 +47,19 @@
 
 #define STABLE_RPM 2200
 
+/*
+ * Integral only: the duty for a target comes from fan_rpm_to_percent(), the
+ * integral trims out the fan to fan spread. Integral gain is 1/FAN_PID_I_INV
+ * duty percent per rpm of error per step.
+ */
+static const struct fan_pid_params fan_pid = {
+	.ki = FAN_PID_SCALE / FAN_PID_I_INV,
+	.i_max = FAN_PID_I_MAX,
+};
+
 static int rpm_setting[FAN_CH_COUNT];
 static int duty_setting[FAN_CH_COUNT];
-static int integral_factor[FAN_CH_COUNT];
+static struct fan_pid_state pid_state[FAN_CH_COUNT];
 
 static int in_rpm_mode = 1;
 
@@ -60,7 +70,7 @@ void fan_set_enabled(int ch, int enabled)
 			fan_set_rpm_target(ch, rpm_setting[ch]);
 			pwm_enable(ch, enabled);
 		} else {
-			integral_factor[ch] = 0;
+			memset(&pid_state[ch], 0, sizeof(pid_state[ch]));
 		}
 	} else {
 		if (enabled) {
@@ -170,9 +180,7 @@ timestamp_t fan_spindown_time;
  */
 void fan_set_rpm_target(int ch, int rpm)
 {
-	int delta;
 	int pct = 0;
-	bool requested_rpm_same = rpm_setting[ch] == rpm;
 
 	if (ch < 0 || ch > MCHP_TACH_ID_MAX || ch > FAN_CH_COUNT)
 		return;
@@ -189,7 +197,9 @@ void fan_set_rpm_target(int ch, int rpm)
 	}
 
 	pct = fan_rpm_to_percent(ch, rpm);
-	delta = rpm - fan_get_rpm_actual(ch);
+
+	duty_setting[ch] = pct;
+
 	/**
 	 * Only integrate in steady state
 	 * allow the fan to ramp naturally in response to a step
@@ -197,26 +207,8 @@ void fan_set_rpm_target(int ch, int rpm)
 	 * we will integrate during the fan ramp up/ramp down time
 	 * also do not integrate when the fan is off
 	 */
-	if (requested_rpm_same && rpm > 0)
-		integral_factor[ch] += delta;
-
-	duty_setting[ch] = pct;
-
-	/*Cap integral factor at FAN_PID_I_MAX, to prevent runaway conditions */
-	integral_factor[ch] = MIN(MAX(integral_factor[ch], -FAN_PID_I_MAX),
-							FAN_PID_I_MAX);
-
-#if 0
-	CPRINTS(" Fan delta : %drpm %dintegral, commanded %d",
-			delta, integral_factor[ch],
-			pct +
-			integral_factor[ch]/FAN_PID_I_INV);
-#endif
-
-	if (rpm == 0)
-		integral_factor[ch] = 0;
-	
-	fan_set_duty(ch, pct + integral_factor[ch]/FAN_PID_I_INV);
+	fan_set_duty(ch, fan_pid_update(&fan_pid, &pid_state[ch], pct, rpm,
+					fan_get_rpm_actual(ch)));
 }
 
 enum fan_status fan_get_status(int ch)
@@ -224,7 +216,7 @@ enum fan_status fan_get_status(int ch)
 	/* TODO */
 	if (fan_get_rpm_actual(ch) == 0)
 		return FAN_STATUS_STOPPED;
-	if (ABS(integral_factor[ch]) >= FAN_PID_I_MAX)
+	if (ABS(pid_state[ch].integral) >= FAN_PID_I_MAX)
 		return FAN_STATUS_FRUSTRATED;
 	if (ABS(fan_get_rpm_actual(ch)-fan_get_rpm_target(ch)) > 200)
 		return FAN_STATUS_CHANGING;
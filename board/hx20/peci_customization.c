@@ -37,29 +37,25 @@ int peci_Rd_Pkg_Config(uint8_t index, uint16_t parameter, int rlen, uint8_t *in)
 	out[2] = (parameter & 0xff);
 	out[3] = ((parameter >> 8) & 0xff);
 
-	rv = peci_transaction(&peci);
+	rv = peci_queue_transaction(&peci, 0);
 	if (rv)
 		return rv;
 
 	return EC_SUCCESS;
 }
 
-int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wlen)
+/* Fill in a WrPkgConfig transaction; out must hold wlen bytes */
+static void peci_wr_pkg_config_prepare(struct peci_data *peci, uint8_t *out,
+	uint8_t index, uint16_t parameter, uint32_t data, int wlen)
 {
-	int rv;
 	int clen;
-	uint8_t in[PECI_WR_PKG_CONFIG_READ_LENGTH] = {0};
-	uint8_t out[PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD] = {0};
 
-	struct peci_data peci = {
-		.cmd_code = PECI_CMD_WR_PKG_CFG,
-		.addr = PECI_TARGET_ADDRESS,
-		.w_len = wlen,
-		.r_len = PECI_WR_PKG_CONFIG_READ_LENGTH,
-		.w_buf = out,
-		.r_buf = in,
-		.timeout_us = PECI_WR_PKG_CONFIG_TIMEOUT_US,
-	};
+	peci->cmd_code = PECI_CMD_WR_PKG_CFG;
+	peci->addr = PECI_TARGET_ADDRESS;
+	peci->w_len = wlen;
+	peci->r_len = PECI_WR_PKG_CONFIG_READ_LENGTH;
+	peci->w_buf = out;
+	peci->timeout_us = PECI_WR_PKG_CONFIG_TIMEOUT_US;
 
 	out[0] = 0x00; /* host ID */
 	out[1] = index;
@@ -68,20 +64,42 @@ int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wle
 
 	for (clen = 4; clen < wlen - 1; clen++)
 		out[clen] = ((data >> ((clen - 4) * 8)) & 0xFF);
+}
 
-	rv = peci_transaction(&peci);
+int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wlen)
+{
+	int rv;
+	uint8_t in[PECI_WR_PKG_CONFIG_READ_LENGTH] = {0};
+	uint8_t out[PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD] = {0};
+	struct peci_data peci = {
+		.r_buf = in,
+	};
+
+	peci_wr_pkg_config_prepare(&peci, out, index, parameter, data, wlen);
+
+	rv = peci_queue_transaction(&peci, 0);
 	if (rv)
 		return rv;
 
 	return EC_SUCCESS;
 }
 
+int peci_Wr_Pkg_Config_async(uint8_t index, uint16_t parameter, uint32_t data,
+	int wlen, peci_done_cb done, void *priv)
+{
+	uint8_t out[PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD] = {0};
+	struct peci_data peci = { 0 };
+
+	peci_wr_pkg_config_prepare(&peci, out, index, parameter, data, wlen);
+
+	return peci_queue_submit(&peci, PECI_WR_PKG_CONFIG_RETRIES, done, priv);
+}
+
 /*****************************************************************************/
 /* External functions */
 
-int peci_update_PL1(int watt)
+int peci_update_PL1(int watt, peci_done_cb done, void *priv)
 {
-	int rv;
 	uint32_t data;
 
 	if (!chipset_in_state(CHIPSET_STATE_ON))
@@ -90,18 +108,13 @@ int peci_update_PL1(int watt)
 	data = PECI_PL1_CONTROL_TIME_WINDOWS | PECI_PL1_POWER_LIMIT_ENABLE |
 		PECI_PL1_POWER_LIMIT(watt);
 
-	rv = peci_Wr_Pkg_Config(PECI_INDEX_POWER_LIMITS_PL1, PECI_PARAMS_POWER_LIMITS_PL1,
-		data, PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD);
-
-	if (rv)
-		return rv;
-
-	return EC_SUCCESS;
+	return peci_Wr_Pkg_Config_async(PECI_INDEX_POWER_LIMITS_PL1,
+		PECI_PARAMS_POWER_LIMITS_PL1, data,
+		PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD, done, priv);
 }
 
-int peci_update_PL2(int watt)
+int peci_update_PL2(int watt, peci_done_cb done, void *priv)
 {
-	int rv;
 	uint32_t data;
 
 	if (!chipset_in_state(CHIPSET_STATE_ON))
@@ -110,18 +123,13 @@ int peci_update_PL2(int watt)
 	data = PECI_PL2_CONTROL_TIME_WINDOWS | PECI_PL2_POWER_LIMIT_ENABLE |
 		PECI_PL2_POWER_LIMIT(watt);
 
-	rv = peci_Wr_Pkg_Config(PECI_INDEX_POWER_LIMITS_PL2, PECI_PARAMS_POWER_LIMITS_PL2,
-		data, PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD);
-
-	if (rv)
-		return rv;
-
-	return EC_SUCCESS;
+	return peci_Wr_Pkg_Config_async(PECI_INDEX_POWER_LIMITS_PL2,
+		PECI_PARAMS_POWER_LIMITS_PL2, data,
+		PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD, done, priv);
 }
 
-int peci_update_PL4(int watt)
+int peci_update_PL4(int watt, peci_done_cb done, void *priv)
 {
-	int rv;
 	uint32_t data;
 
 	if (!chipset_in_state(CHIPSET_STATE_ON))
@@ -129,18 +137,13 @@ int peci_update_PL4(int watt)
 
 	data = PECI_PL4_POWER_LIMIT(watt);
 
-	rv = peci_Wr_Pkg_Config(PECI_INDEX_POWER_LIMITS_PL4, PECI_PARAMS_POWER_LIMITS_PL4,
-		data, PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD);
-
-	if (rv)
-		return rv;
-
-	return EC_SUCCESS;
+	return peci_Wr_Pkg_Config_async(PECI_INDEX_POWER_LIMITS_PL4,
+		PECI_PARAMS_POWER_LIMITS_PL4, data,
+		PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD, done, priv);
 }
 
-int peci_update_PsysPL2(int watt)
+int peci_update_PsysPL2(int watt, peci_done_cb done, void *priv)
 {
-	int rv;
 	uint32_t data;
 
 	if (!chipset_in_state(CHIPSET_STATE_ON))
@@ -149,13 +152,9 @@ int peci_update_PsysPL2(int watt)
 	data = PECI_PSYS_PL2_CONTROL_TIME_WINDOWS | PECI_PSYS_PL2_POWER_LIMIT_ENABLE |
 		PECI_PSYS_PL2_POWER_LIMIT(watt);
 
-	rv = peci_Wr_Pkg_Config(PECI_INDEX_POWER_LIMITS_PSYS_PL2,
-		PECI_PARAMS_POWER_LIMITS_PSYS_PL2, data, PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD);
-
-	if (rv)
-		return rv;
-
-	return EC_SUCCESS;
+	return peci_Wr_Pkg_Config_async(PECI_INDEX_POWER_LIMITS_PSYS_PL2,
+		PECI_PARAMS_POWER_LIMITS_PSYS_PL2, data,
+		PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD, done, priv);
 }
 
 __override int stop_read_peci_temp(void)
@@ -14,6 +14,8 @@
 #define PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD   9
 #define PECI_WR_PKG_CONFIG_READ_LENGTH          1
 #define PECI_WR_PKG_CONFIG_TIMEOUT_US           200
+/* Queued writes are retried by the PECI task, without blocking the caller */
+#define PECI_WR_PKG_CONFIG_RETRIES              1
 
 
 /* RdPkgConfig and WrPkgConfig CPU Thermal and Power Optimiztion Services */
@@ -53,8 +55,14 @@
 
 int peci_Rd_Pkg_Config(uint8_t index, uint16_t parameter, int rlen, uint8_t *in);
 int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wlen);
+int peci_Wr_Pkg_Config_async(uint8_t index, uint16_t parameter, uint32_t data,
+	int wlen, peci_done_cb done, void *priv);
 
-int peci_update_PL1(int watt);
-int peci_update_PL2(int watt);
-int peci_update_PL4(int watt);
-int peci_update_PsysPL2(int watt);
+/*
+ * Power limit updates are queued; done is called from the PECI task once the
+ * write has completed.
+ */
+int peci_update_PL1(int watt, peci_done_cb done, void *priv);
+int peci_update_PL2(int watt, peci_done_cb done, void *priv);
+int peci_update_PL4(int watt, peci_done_cb done, void *priv);
+int peci_update_PsysPL2(int watt, peci_done_cb done, void *priv);
@@ -5,6 +5,7 @@
 
 /* Flash module for emulator */
 
+#include <pthread.h>
 #include <stdio.h>
 
 #include "common.h"
@@ -81,6 +82,54 @@ int flash_physical_write(int offset, int size, const char *data)
 	return EC_SUCCESS;
 }
 
+#ifdef CONFIG_FLASH_READ_ASYNC
+/*
+ * A thread reads the flash in the background, as the SPI controller's DMA
+ * would on a device.
+ */
+static pthread_t read_thread;
+static int read_pending;
+static struct {
+	int offset;
+	int size;
+	char *data;
+} read_req;
+
+static void *flash_read_thread(void *arg)
+{
+	memcpy(read_req.data, __host_flash + read_req.offset, read_req.size);
+	return NULL;
+}
+
+int flash_physical_read_async(int offset, int size, char *data)
+{
+	if (read_pending)
+		return EC_ERROR_BUSY;
+	if (offset < 0 || size < 0 || offset + size > CONFIG_FLASH_SIZE)
+		return EC_ERROR_INVAL;
+
+	read_req.offset = offset;
+	read_req.size = size;
+	read_req.data = data;
+	if (pthread_create(&read_thread, NULL, flash_read_thread, NULL))
+		return EC_ERROR_UNKNOWN;
+	read_pending = 1;
+
+	return EC_SUCCESS;
+}
+
+int flash_physical_read_wait(void)
+{
+	if (!read_pending)
+		return EC_SUCCESS;
+
+	pthread_join(read_thread, NULL);
+	read_pending = 0;
+
+	return EC_SUCCESS;
+}
+#endif
+
 int flash_physical_erase(int offset, int size)
 {
 	ASSERT((size & (CONFIG_FLASH_ERASE_SIZE - 1)) == 0);
@@ -8,10 +8,21 @@
 #ifndef __CROS_EC_HOST_TEST_H
 #define __CROS_EC_HOST_TEST_H
 
+#include <stdint.h>
+
 /* Emulator exit codes */
 #define EXIT_CODE_HIBERNATE BIT(7)
 
 /* Get emulator executable name */
 const char *__get_prog_name(void);
 
+/*
+ * Emulated ACPI EC0 port, with CONFIG_HOSTCMD_X86: the AP writing a command
+ * or data byte, handled as the chips' IBF interrupts handle it, reading the
+ * EC's reply, which returns 0 if there is none, and reading the status.
+ */
+void lpc_acpi_host_write(int is_cmd, uint8_t value);
+int lpc_acpi_host_read(uint8_t *value);
+uint8_t lpc_acpi_host_status(void);
+
 #endif  /* __CROS_EC_HOST_TEST_H */
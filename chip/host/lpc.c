@@ -5,6 +5,10 @@
 
 /* LPC module for Chrome EC emulator */
 
+#include "acpi.h"
+#include "common.h"
+#include "ec_commands.h"
+#include "host_test.h"
 #include "lpc.h"
 
 test_mockable int lpc_keyboard_has_char(void)
@@ -31,3 +35,67 @@ test_mockable void lpc_keyboard_resume_irq(void)
 {
 	/* Do nothing */
 }
+
+#ifdef CONFIG_HOSTCMD_X86
+/*
+ * ACPI EC0 port, driven by tests through the lpc_acpi_host_*() functions as
+ * the AP would drive the real one.
+ */
+static uint8_t memmap[EC_MEMMAP_SIZE];
+static uint8_t acpi_status;
+static uint8_t acpi_output;
+
+test_mockable uint8_t *lpc_get_memmap_range(void)
+{
+	return memmap;
+}
+
+test_mockable void lpc_set_acpi_status_mask(uint8_t mask)
+{
+	acpi_status |= mask;
+}
+
+test_mockable void lpc_clear_acpi_status_mask(uint8_t mask)
+{
+	acpi_status &= ~mask;
+}
+
+test_mockable void lpc_update_host_event_status(void)
+{
+	/* No SCI or SMI to raise */
+}
+
+void lpc_acpi_host_write(int is_cmd, uint8_t value)
+{
+	uint8_t result = 0;
+
+	/* As the chips' IBF interrupt handlers do */
+	acpi_status |= EC_LPC_STATUS_PROCESSING;
+	if (is_cmd)
+		acpi_status |= EC_LPC_STATUS_LAST_CMD;
+	else
+		acpi_status &= ~EC_LPC_STATUS_LAST_CMD;
+
+	if (acpi_ap_to_ec(is_cmd, value, &result)) {
+		acpi_output = result;
+		acpi_status |= EC_LPC_STATUS_TO_HOST;
+	}
+
+	acpi_status &= ~EC_LPC_STATUS_PROCESSING;
+}
+
+int lpc_acpi_host_read(uint8_t *value)
+{
+	if (!(acpi_status & EC_LPC_STATUS_TO_HOST))
+		return 0;
+
+	*value = acpi_output;
+	acpi_status &= ~EC_LPC_STATUS_TO_HOST;
+	return 1;
+}
+
+uint8_t lpc_acpi_host_status(void)
+{
+	return acpi_status;
+}
+#endif /* CONFIG_HOSTCMD_X86 */
@@ -0,0 +1,94 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Mock PECI bus for unit tests.
+ */
+
+#ifndef TEST_BUILD
+#error "This fake PECI driver must not be used in non-test builds."
+#endif
+
+#include "common.h"
+#include "mock/peci_mock.h"
+#include "peci.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+/* Completion code of a successful package config access */
+#define PECI_CC_SUCCESS 0x40
+
+struct mock_peci_ctrl mock_peci;
+
+void mock_peci_reset(void)
+{
+	memset(&mock_peci, 0, sizeof(mock_peci));
+	mock_peci.cpu_temp_c = 50;
+}
+
+/* Spend latency_us like an interrupt driven transaction would. */
+static void bus_wait(void)
+{
+	timestamp_t deadline;
+
+	deadline.val = get_time().val + mock_peci.latency_us;
+	while (!timestamp_expired(deadline, NULL))
+		task_wait_event(deadline.val - get_time().val);
+}
+
+static int pkg_config(struct peci_data *peci)
+{
+	uint8_t index = peci->w_buf[1];
+	uint32_t data = 0;
+	int i;
+
+	if (peci->w_len < 4 || index >= MOCK_PECI_PKG_CONFIG_COUNT)
+		return EC_ERROR_INVAL;
+
+	if (peci->cmd_code == PECI_CMD_WR_PKG_CFG) {
+		for (i = 4; i < peci->w_len - 1; i++)
+			data |= peci->w_buf[i] << ((i - 4) * 8);
+		mock_peci.pkg_config[index] = data;
+		if (mock_peci.wr_log_count < MOCK_PECI_LOG_SIZE)
+			mock_peci.wr_log[mock_peci.wr_log_count++] = index;
+		if (peci->r_len)
+			peci->r_buf[0] = PECI_CC_SUCCESS;
+	} else {
+		data = mock_peci.pkg_config[index];
+		if (peci->r_len)
+			peci->r_buf[0] = PECI_CC_SUCCESS;
+		for (i = 1; i < peci->r_len; i++)
+			peci->r_buf[i] = data >> ((i - 1) * 8);
+	}
+
+	return EC_SUCCESS;
+}
+
+int peci_transaction(struct peci_data *peci)
+{
+	uint16_t raw;
+	int rv = EC_SUCCESS;
+
+	mock_peci.transactions[peci->cmd_code]++;
+	if (++mock_peci.busy > mock_peci.max_busy)
+		mock_peci.max_busy = mock_peci.busy;
+
+	bus_wait();
+
+	if (mock_peci.fail_count) {
+		mock_peci.fail_count--;
+		rv = EC_ERROR_TIMEOUT;
+	} else if (peci->cmd_code == PECI_CMD_GET_TEMP) {
+		/* Relative to Tjmax, in 1/64 degrees C */
+		raw = -((CONFIG_PECI_TJMAX - mock_peci.cpu_temp_c) << 6);
+		peci->r_buf[0] = raw & 0xff;
+		peci->r_buf[1] = raw >> 8;
+	} else if (peci->cmd_code == PECI_CMD_RD_PKG_CFG ||
+		   peci->cmd_code == PECI_CMD_WR_PKG_CFG) {
+		rv = pkg_config(peci);
+	}
+
+	mock_peci.busy--;
+	return rv;
+}
@@ -15,6 +15,7 @@
 #include "pwm_chip.h"
 #include "registers.h"
 #include "shared_mem.h"
+#include "stack_watch.h"
 #include "system.h"
 #include "task.h"
 #include "timer.h"
@@ -528,6 +529,9 @@ void __idle(void)
 	CPRINTS("MEC1701 low power idle task started");
 
 	while (1) {
+#ifdef CONFIG_STACK_WATCH
+		stack_watch_idle();
+#endif
 		/* Disable interrupts */
 		interrupt_disable();
 
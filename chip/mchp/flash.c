@@ -9,6 +9,7 @@
 #include "host_command.h"
 #include "shared_mem.h"
 #include "spi.h"
+#include "spi_chip.h"
 #include "spi_flash.h"
 #include "system.h"
 #include "util.h"
@@ -43,6 +44,43 @@ int flash_physical_read(int offset, int size, char *data)
 	return spi_flash_read(data, offset, size);
 }
 
+#ifdef CONFIG_FLASH_READ_ASYNC
+/* The command stays in use until the end of the transaction */
+static uint8_t read_cmd[4];
+static int read_pending;
+
+int flash_physical_read_async(int offset, int size, char *data)
+{
+	int rv;
+
+	if (read_pending)
+		return EC_ERROR_BUSY;
+	if (offset < 0 || size < 0 || offset + size > CONFIG_FLASH_SIZE)
+		return EC_ERROR_INVAL;
+
+	/* One transaction for all of it, with DMA from the QMSPI RX FIFO */
+	read_cmd[0] = SPI_FLASH_READ;
+	read_cmd[1] = (offset >> 16) & 0xFF;
+	read_cmd[2] = (offset >> 8) & 0xFF;
+	read_cmd[3] = offset & 0xFF;
+	rv = spi_transaction_start(SPI_FLASH_DEVICE, read_cmd,
+				   sizeof(read_cmd), (uint8_t *)data, size);
+	if (rv == EC_SUCCESS)
+		read_pending = 1;
+
+	return rv;
+}
+
+int flash_physical_read_wait(void)
+{
+	if (!read_pending)
+		return EC_SUCCESS;
+
+	read_pending = 0;
+	return spi_transaction_end(SPI_FLASH_DEVICE);
+}
+#endif
+
 /**
  * Write to physical flash.
  *
@@ -264,6 +264,38 @@ int spi_transaction(const struct spi_device_t *spi_device,
 	return rc;
 }
 
+#ifndef LFW
+int spi_transaction_start(const struct spi_device_t *spi_device,
+			  const uint8_t *txdata, int txlen,
+			  uint8_t *rxdata, int rxlen)
+{
+	int rc;
+
+	if (spi_device == NULL)
+		return EC_ERROR_PARAM1;
+
+	spi_mutex_lock(spi_device->port);
+	rc = spi_transaction_async(spi_device, txdata, txlen, rxdata, rxlen);
+	if (rc != EC_SUCCESS)
+		spi_mutex_unlock(spi_device->port);
+
+	return rc;
+}
+
+int spi_transaction_end(const struct spi_device_t *spi_device)
+{
+	int rc;
+
+	if (spi_device == NULL)
+		return EC_ERROR_PARAM1;
+
+	rc = spi_transaction_flush(spi_device);
+	spi_mutex_unlock(spi_device->port);
+
+	return rc;
+}
+#endif /* #ifndef LFW */
+
 /**
  * Enable SPI port and associated controller
  *
@@ -54,6 +54,18 @@
 const void *spi_dma_option(const struct spi_device_t *spi_device,
 				int is_tx);
 
+/*
+ * spi_transaction() in two halves: the first one starts the transaction, and
+ * DMA moves the data while the caller does something else, until the second
+ * one waits for it. The controller stays locked in between, so both must be
+ * called by the same task. spi_transaction_end() must not be called if
+ * spi_transaction_start() failed.
+ */
+int spi_transaction_start(const struct spi_device_t *spi_device,
+			  const uint8_t *txdata, int txlen,
+			  uint8_t *rxdata, int rxlen);
+int spi_transaction_end(const struct spi_device_t *spi_device);
+
 #endif /* #ifndef _QMSPI_CHIP_H */
 /**   @}
  */
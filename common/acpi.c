@@ -16,6 +16,7 @@
 #include "ec_commands.h"
 #include "tablet_mode.h"
 #include "pwm.h"
+#include "task.h"
 #include "timer.h"
 #include "usb_charge.h"
 #include "util.h"
@@ -51,18 +52,29 @@ static int current_dptf_profile = DPTF_PROFILE_DEFAULT;
 #endif
 
 /*
- * Keep a read cache of four bytes when burst mode is enabled, which is the
- * size of the largest non-string memmap data type.
+ * Keep a read cache when burst mode is enabled, of at least four bytes, which
+ * is the size of the largest non-string memmap data type.
  */
-#define ACPI_READ_CACHE_SIZE 4
+#define ACPI_READ_CACHE_MIN 4
+#ifdef CONFIG_ACPI_PREFETCH
+#define ACPI_READ_CACHE_SIZE CONFIG_ACPI_PREFETCH_SIZE
+#else
+#define ACPI_READ_CACHE_SIZE ACPI_READ_CACHE_MIN
+#endif
+BUILD_ASSERT(ACPI_READ_CACHE_SIZE >= ACPI_READ_CACHE_MIN &&
+	     ACPI_READ_CACHE_SIZE <= UINT8_MAX);
 
 /* Start address that indicates read cache is flushed. */
 #define ACPI_READ_CACHE_FLUSHED (EC_ACPI_MEM_MAPPED_BEGIN - 1)
 
 /* Calculate size of valid cache based upon end of memmap data. */
-#define ACPI_VALID_CACHE_SIZE(addr) (MIN( \
+#define ACPI_VALID_CACHE_SIZE(addr, size) (MIN( \
 	EC_ACPI_MEM_MAPPED_SIZE + EC_ACPI_MEM_MAPPED_BEGIN - (addr), \
-	ACPI_READ_CACHE_SIZE))
+	(size)))
+
+/* Whether a memmap offset is one of the generation bytes */
+#define ACPI_IS_MEMMAP_GEN(offset) ((offset) == EC_MEMMAP_THERMAL_GEN || \
+				    (offset) == EC_MEMMAP_BATTERY_GEN)
 
 /*
  * In burst mode, read the requested memmap data and the data immediately
@@ -73,9 +85,141 @@ static int current_dptf_profile = DPTF_PROFILE_DEFAULT;
 static struct {
 	int enabled;
 	uint8_t start_addr;
+	uint8_t size;			/* Bytes valid from start_addr */
 	uint8_t data[ACPI_READ_CACHE_SIZE];
 } acpi_read_cache;
 
+#ifdef CONFIG_ACPI_STATS
+/* Totals; next and count are unused */
+static struct ec_response_acpi_stats __bss_slow acpi_stats;
+static uint16_t __bss_slow acpi_addr_reads[EC_ACPI_MEM_MAPPED_BEGIN +
+					   EC_ACPI_MEM_MAPPED_SIZE];
+static uint16_t __bss_slow acpi_addr_writes[EC_ACPI_MEM_MAPPED_BEGIN +
+					    EC_ACPI_MEM_MAPPED_SIZE];
+/* When the last command byte was written */
+static uint32_t __bss_slow acpi_cmd_time;
+
+static uint32_t acpi_stats_now(void)
+{
+	return get_time().le.lo;
+}
+
+static void acpi_stats_begin(uint32_t now)
+{
+	acpi_cmd_time = now;
+}
+
+static void acpi_stats_count(uint16_t *count)
+{
+	if (*count < UINT16_MAX)
+		(*count)++;
+}
+
+/* A read or write transaction completed */
+static void acpi_stats_transaction(int write, uint8_t addr)
+{
+	uint32_t us = get_time().le.lo - acpi_cmd_time;
+
+	if (write) {
+		acpi_stats.writes++;
+		acpi_stats.write_total_us += us;
+		acpi_stats.write_max_us = MAX(acpi_stats.write_max_us, us);
+		acpi_stats_count(&acpi_addr_writes[addr]);
+	} else {
+		acpi_stats.reads++;
+		acpi_stats.read_total_us += us;
+		acpi_stats.read_max_us = MAX(acpi_stats.read_max_us, us);
+		acpi_stats_count(&acpi_addr_reads[addr]);
+	}
+}
+
+static void acpi_stats_handled(uint32_t start)
+{
+	uint32_t us = get_time().le.lo - start;
+
+	acpi_stats.handler_max_us = MAX(acpi_stats.handler_max_us, us);
+}
+
+static void acpi_stats_clear(void)
+{
+	/* The ACPI port interrupt may update them */
+	interrupt_disable();
+	memset(&acpi_stats, 0, sizeof(acpi_stats));
+	memset(acpi_addr_reads, 0, sizeof(acpi_addr_reads));
+	memset(acpi_addr_writes, 0, sizeof(acpi_addr_writes));
+	interrupt_enable();
+}
+#define ACPI_STATS_INC(field) (acpi_stats.field++)
+#define ACPI_STATS_ADD(field, n) (acpi_stats.field += (n))
+#else
+static inline uint32_t acpi_stats_now(void) { return 0; }
+static inline void acpi_stats_begin(uint32_t now) {}
+static inline void acpi_stats_transaction(int write, uint8_t addr) {}
+static inline void acpi_stats_handled(uint32_t start) {}
+#define ACPI_STATS_INC(field)
+#define ACPI_STATS_ADD(field, n)
+#endif
+
+#ifdef CONFIG_ACPI_PREFETCH
+/*
+ * For each memmap address the AP starts reading at in burst mode, the most
+ * bytes it has read from there, up to the cache size, before starting
+ * elsewhere or reading a generation byte. A cache miss copies that many, so
+ * the fields the AP reads together come from one copy.
+ */
+static uint8_t __bss_slow acpi_prefetch_span[EC_ACPI_MEM_MAPPED_SIZE];
+/* Where the AP started reading, and one past the highest address since */
+static uint8_t acpi_prefetch_start = ACPI_READ_CACHE_FLUSHED;
+static int __bss_slow acpi_prefetch_end;
+
+static void acpi_prefetch_learn(void)
+{
+	uint8_t start = acpi_prefetch_start;
+	uint8_t *span;
+
+	if (start == ACPI_READ_CACHE_FLUSHED)
+		return;
+
+	span = &acpi_prefetch_span[start - EC_ACPI_MEM_MAPPED_BEGIN];
+	*span = MAX(*span, acpi_prefetch_end - start);
+	acpi_prefetch_start = ACPI_READ_CACHE_FLUSHED;
+}
+
+/* Note a burst read, before it is looked up in the cache */
+static void acpi_prefetch_note(uint8_t addr)
+{
+	uint8_t start = acpi_prefetch_start;
+
+	if (start == ACPI_READ_CACHE_FLUSHED || addr < start ||
+	    addr - start >= ACPI_READ_CACHE_SIZE) {
+		acpi_prefetch_learn();
+		acpi_prefetch_start = addr;
+		acpi_prefetch_end = addr + 1;
+	} else {
+		acpi_prefetch_end = MAX(acpi_prefetch_end, addr + 1);
+	}
+}
+
+static int acpi_prefetch_size(uint8_t addr)
+{
+	return MAX(acpi_prefetch_span[addr - EC_ACPI_MEM_MAPPED_BEGIN],
+		   ACPI_READ_CACHE_MIN);
+}
+#else
+static inline void acpi_prefetch_note(uint8_t addr) {}
+static inline void acpi_prefetch_learn(void) {}
+static inline int acpi_prefetch_size(uint8_t addr)
+{
+	return ACPI_READ_CACHE_SIZE;
+}
+#endif
+
+static void acpi_read_cache_flush(void)
+{
+	acpi_prefetch_learn();
+	acpi_read_cache.start_addr = ACPI_READ_CACHE_FLUSHED;
+}
+
 /*
  * Deferred function to ensure that ACPI burst mode doesn't remain enabled
  * indefinitely.
@@ -83,6 +227,7 @@ static struct {
 static void acpi_disable_burst_deferred(void)
 {
 	acpi_read_cache.enabled = 0;
+	acpi_read_cache_flush();
 	lpc_clear_acpi_status_mask(EC_LPC_STATUS_BURST_MODE);
 	CPUTS("ACPI missed burst disable?");
 }
@@ -139,24 +284,36 @@ static int acpi_read(uint8_t addr)
 		return 0xff;
 	}
 
-	/* Read from cache if enabled (burst mode). */
-	if (acpi_read_cache.enabled) {
-		/* Fetch to cache on miss. */
-		if (acpi_read_cache.start_addr == ACPI_READ_CACHE_FLUSHED ||
-		    acpi_read_cache.start_addr > addr ||
-		    addr - acpi_read_cache.start_addr >=
-		    ACPI_READ_CACHE_SIZE) {
-			memcpy(acpi_read_cache.data,
-			       memmap_addr,
-			       ACPI_VALID_CACHE_SIZE(addr));
-			acpi_read_cache.start_addr = addr;
-		}
-		/* Return data from cache. */
-		return acpi_read_cache.data[addr - acpi_read_cache.start_addr];
-	} else {
-		/* Read directly from memmap data. */
+	if (!acpi_read_cache.enabled)
 		return *memmap_addr;
+
+	/*
+	 * The generation bytes are read directly, before and after the data
+	 * they cover. Data cached before the first read may be older than it,
+	 * so the cache is flushed too.
+	 */
+	if (ACPI_IS_MEMMAP_GEN(addr - EC_ACPI_MEM_MAPPED_BEGIN)) {
+		acpi_read_cache_flush();
+		return *memmap_addr;
+	}
+
+	/* Read from cache in burst mode, fetching to it on a miss. */
+	acpi_prefetch_note(addr);
+	if (acpi_read_cache.start_addr == ACPI_READ_CACHE_FLUSHED ||
+	    acpi_read_cache.start_addr > addr ||
+	    addr - acpi_read_cache.start_addr >= acpi_read_cache.size) {
+		acpi_read_cache.size = ACPI_VALID_CACHE_SIZE(addr,
+						acpi_prefetch_size(addr));
+		memcpy(acpi_read_cache.data, memmap_addr,
+		       acpi_read_cache.size);
+		acpi_read_cache.start_addr = addr;
+		ACPI_STATS_INC(cache_fills);
+		ACPI_STATS_ADD(cache_bytes, acpi_read_cache.size);
+	} else {
+		ACPI_STATS_INC(cache_hits);
 	}
+
+	return acpi_read_cache.data[addr - acpi_read_cache.start_addr];
 }
 
 /*
@@ -168,11 +325,13 @@ int acpi_ap_to_ec(int is_cmd, uint8_t value, uint8_t *resultptr)
 	int data = 0;
 	int retval = 0;
 	int result = 0xff;			/* value for bogus read */
+	uint32_t start = acpi_stats_now();
 
 	/* Read command/data; this clears the FRMH status bit. */
 	if (is_cmd) {
 		acpi_cmd = value;
 		acpi_data_count = 0;
+		acpi_stats_begin(start);
 	} else {
 		data = value;
 		/*
@@ -289,6 +448,7 @@ int acpi_ap_to_ec(int is_cmd, uint8_t value, uint8_t *resultptr)
 		/* Send the result byte */
 		*resultptr = result;
 		retval = 1;
+		acpi_stats_transaction(0, acpi_addr);
 
 	} else if (acpi_cmd == EC_CMD_ACPI_WRITE && acpi_data_count == 2) {
 		/* ACPI write cmd + addr + data */
@@ -382,6 +542,7 @@ int acpi_ap_to_ec(int is_cmd, uint8_t value, uint8_t *resultptr)
 				acpi_addr, data);
 			break;
 		}
+		acpi_stats_transaction(1, acpi_addr);
 	} else if (acpi_cmd == EC_CMD_ACPI_QUERY_EVENT && !acpi_data_count) {
 		/* Clear and return the lowest host event */
 		int evt_index = lpc_get_next_host_event();
@@ -398,6 +559,7 @@ int acpi_ap_to_ec(int is_cmd, uint8_t value, uint8_t *resultptr)
 		 */
 		acpi_read_cache.enabled = 1;
 		acpi_read_cache.start_addr = ACPI_READ_CACHE_FLUSHED;
+		ACPI_STATS_INC(bursts);
 
 		/* Enter burst mode */
 		lpc_set_acpi_status_mask(EC_LPC_STATUS_BURST_MODE);
@@ -413,11 +575,110 @@ int acpi_ap_to_ec(int is_cmd, uint8_t value, uint8_t *resultptr)
 		retval = 1;
 	} else if (acpi_cmd == EC_CMD_ACPI_BURST_DISABLE && !acpi_data_count) {
 		acpi_read_cache.enabled = 0;
+		acpi_read_cache_flush();
 
 		/* Leave burst mode */
 		hook_call_deferred(&acpi_disable_burst_deferred_data, -1);
 		lpc_clear_acpi_status_mask(EC_LPC_STATUS_BURST_MODE);
 	}
 
+	acpi_stats_handled(start);
+
 	return retval;
 }
+
+#ifdef CONFIG_ACPI_STATS
+/*****************************************************************************/
+/* Host command */
+
+/*
+ * Copy the counts of the addresses read or written, from addr on. Returns the
+ * number copied, and the address to continue from in *next.
+ */
+static int acpi_stats_read_addrs(int addr, struct ec_acpi_stats_entry *out,
+				 int max, uint16_t *next)
+{
+	int n = 0;
+
+	for (; addr < ARRAY_SIZE(acpi_addr_reads) && n < max; addr++) {
+		if (!acpi_addr_reads[addr] && !acpi_addr_writes[addr])
+			continue;
+		out[n].addr = addr;
+		out[n].reserved = 0;
+		out[n].reads = acpi_addr_reads[addr];
+		out[n].writes = acpi_addr_writes[addr];
+		n++;
+	}
+	/* 0x100 once all have been copied */
+	*next = addr;
+
+	return n;
+}
+
+static enum ec_status acpi_stats_command(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_acpi_stats *p = args->params;
+	struct ec_response_acpi_stats *r = args->response;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->entry[0]);
+
+	switch (p->cmd) {
+	case EC_ACPI_STATS_READ:
+		break;
+	case EC_ACPI_STATS_CLEAR:
+		acpi_stats_clear();
+		break;
+	default:
+		return EC_RES_INVALID_PARAM;
+	}
+
+	memcpy(r, &acpi_stats, sizeof(*r));
+	r->next = 0x100;
+	r->count = 0;
+	r->reserved = 0;
+	if (p->cmd == EC_ACPI_STATS_READ)
+		r->count = acpi_stats_read_addrs(p->addr, r->entry,
+						 MIN(max, UINT8_MAX), &r->next);
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entry[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_ACPI_STATS,
+		     acpi_stats_command,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console command */
+
+static int command_acpi_stats(int argc, char **argv)
+{
+	int addr;
+
+	if (argc >= 2) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		acpi_stats_clear();
+		return EC_SUCCESS;
+	}
+
+	ccprintf("reads  %u, %u us total, %u us max\n", acpi_stats.reads,
+		 acpi_stats.read_total_us, acpi_stats.read_max_us);
+	ccprintf("writes %u, %u us total, %u us max\n", acpi_stats.writes,
+		 acpi_stats.write_total_us, acpi_stats.write_max_us);
+	ccprintf("handler %u us max\n", acpi_stats.handler_max_us);
+	ccprintf("bursts %u, cache %u hits, %u fills of %u bytes\n",
+		 acpi_stats.bursts, acpi_stats.cache_hits,
+		 acpi_stats.cache_fills, acpi_stats.cache_bytes);
+	for (addr = 0; addr < ARRAY_SIZE(acpi_addr_reads); addr++) {
+		if (!acpi_addr_reads[addr] && !acpi_addr_writes[addr])
+			continue;
+		ccprintf("0x%02x %5u reads %5u writes\n", addr,
+			 acpi_addr_reads[addr], acpi_addr_writes[addr]);
+		cflush();
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(acpistats, command_acpi_stats,
+			"[clear]",
+			"Print or clear the ACPI EC port statistics");
+#endif /* CONFIG_ACPI_STATS */
@@ -14,6 +14,7 @@
 #include "gpio.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "memmap.h"
 #include "timer.h"
 #include "util.h"
 #include "watchdog.h"
@@ -503,46 +504,42 @@ DECLARE_HOST_COMMAND(EC_CMD_BATTERY_GET_DYNAMIC,
 #ifdef HAS_TASK_HOSTCMD
 static void battery_update(enum battery_index i)
 {
-	char *batt_str;
-	int *memmap_dcap = (int *)host_get_memmap(EC_MEMMAP_BATT_DCAP);
-	int *memmap_dvlt = (int *)host_get_memmap(EC_MEMMAP_BATT_DVLT);
-	int *memmap_ccnt = (int *)host_get_memmap(EC_MEMMAP_BATT_CCNT);
-	int *memmap_volt = (int *)host_get_memmap(EC_MEMMAP_BATT_VOLT);
-	int *memmap_rate = (int *)host_get_memmap(EC_MEMMAP_BATT_RATE);
-	int *memmap_cap = (int *)host_get_memmap(EC_MEMMAP_BATT_CAP);
-	int *memmap_lfcc = (int *)host_get_memmap(EC_MEMMAP_BATT_LFCC);
-	uint8_t *memmap_flags = host_get_memmap(EC_MEMMAP_BATT_FLAG);
+	struct memmap_battery batt;
 
 	/* Smart battery serial number is 16 bits */
-	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_SERIAL);
-	memcpy(batt_str, battery_static[i].serial, EC_MEMMAP_TEXT_MAX);
+	memcpy(batt.serial, battery_static[i].serial, EC_MEMMAP_TEXT_MAX);
 
 	/* Design Capacity of Full */
-	*memmap_dcap = battery_static[i].design_capacity;
+	batt.dcap = battery_static[i].design_capacity;
 
 	/* Design Voltage */
-	*memmap_dvlt = battery_static[i].design_voltage;
+	batt.dvlt = battery_static[i].design_voltage;
 
 	/* Cycle Count */
-	*memmap_ccnt = battery_static[i].cycle_count;
+	batt.ccnt = battery_static[i].cycle_count;
 
 	/* Battery Manufacturer string */
-	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_MFGR);
-	memcpy(batt_str, battery_static[i].manufacturer, EC_MEMMAP_TEXT_MAX);
+	memcpy(batt.mfgr, battery_static[i].manufacturer, EC_MEMMAP_TEXT_MAX);
 
 	/* Battery Model string */
-	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_MODEL);
-	memcpy(batt_str, battery_static[i].model, EC_MEMMAP_TEXT_MAX);
+	memcpy(batt.model, battery_static[i].model, EC_MEMMAP_TEXT_MAX);
 
 	/* Battery Type string */
-	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_TYPE);
-	memcpy(batt_str, battery_static[i].type, EC_MEMMAP_TEXT_MAX);
-
-	*memmap_volt = battery_dynamic[i].actual_voltage;
-	*memmap_rate = battery_dynamic[i].actual_current;
-	*memmap_cap = battery_dynamic[i].remaining_capacity;
-	*memmap_lfcc = battery_dynamic[i].full_capacity;
-	*memmap_flags = battery_dynamic[i].flags;
+	memcpy(batt.type, battery_static[i].type, EC_MEMMAP_TEXT_MAX);
+
+	batt.volt = battery_dynamic[i].actual_voltage;
+	batt.rate = battery_dynamic[i].actual_current;
+	batt.cap = battery_dynamic[i].remaining_capacity;
+	batt.lfcc = battery_dynamic[i].full_capacity;
+	batt.flag = battery_dynamic[i].flags;
+
+	/* Publish it all at once, but leave the count and index alone */
+	memmap_write_begin(MEMMAP_BLOCK_BATTERY);
+	memcpy(host_get_memmap(EC_MEMMAP_BATT_VOLT), &batt,
+	       offsetof(struct memmap_battery, count));
+	memcpy(host_get_memmap(EC_MEMMAP_BATT_DCAP), &batt.dcap,
+	       sizeof(batt) - offsetof(struct memmap_battery, dcap));
+	memmap_write_end(MEMMAP_BLOCK_BATTERY);
 }
 
 void battery_memmap_refresh(enum battery_index index)
@@ -553,15 +550,20 @@ void battery_memmap_refresh(enum battery_index index)
 
 void battery_memmap_set_index(enum battery_index index)
 {
+	uint8_t batt_index = BATT_IDX_INVALID;
+
 	if (*host_get_memmap(EC_MEMMAP_BATT_INDEX) == index)
 		return;
 
-	*host_get_memmap(EC_MEMMAP_BATT_INDEX) = BATT_IDX_INVALID;
+	memmap_publish(MEMMAP_BLOCK_BATTERY, EC_MEMMAP_BATT_INDEX, &batt_index,
+		       1);
 	if (index < 0 || index >= CONFIG_BATTERY_COUNT)
 		return;
 
 	battery_update(index);
-	*host_get_memmap(EC_MEMMAP_BATT_INDEX) = index;
+	batt_index = index;
+	memmap_publish(MEMMAP_BLOCK_BATTERY, EC_MEMMAP_BATT_INDEX, &batt_index,
+		       1);
 }
 
 static void battery_init(void)
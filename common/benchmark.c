@@ -0,0 +1,141 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Microbenchmark harness for tests */
+
+#ifdef CHIP_HOST
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+#include "benchmark.h"
+#include "console.h"
+#include "hwtimer.h"
+#include "timer.h"
+#include "util.h"
+
+static uint32_t time_ns[BENCHMARK_MAX_RUNS];
+static uint32_t cycles[BENCHMARK_MAX_RUNS];
+
+#ifdef CHIP_HOST
+static uint64_t clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t clock_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+#else
+static uint64_t clock_ns(void)
+{
+	/* Extend the 32-bit microsecond counter, which wraps every 71 min */
+	static uint32_t last;
+	static uint64_t high;
+	uint32_t now = __hw_clock_source_read();
+
+	if (now < last)
+		high += 1ULL << 32;
+	last = now;
+	return (high + now) * 1000;
+}
+
+static uint64_t clock_cycles(void)
+{
+	return 0;
+}
+#endif
+
+static void sort_u32(uint32_t *v, int n)
+{
+	int i, j;
+	uint32_t x;
+
+	for (i = 1; i < n; i++) {
+		x = v[i];
+		for (j = i; j > 0 && v[j - 1] > x; j--)
+			v[j] = v[j - 1];
+		v[j] = x;
+	}
+}
+
+int benchmark_run(const char *name, void (*fn)(void *), void *arg,
+		  const struct benchmark_options *opts,
+		  struct benchmark_result *result)
+{
+	static const struct benchmark_options defaults =
+		BENCHMARK_DEFAULT_OPTIONS;
+	uint64_t t0, c0, sum = 0;
+	int i, j;
+
+	if (!opts)
+		opts = &defaults;
+	if (opts->runs < 1 || opts->runs > BENCHMARK_MAX_RUNS ||
+	    opts->batch < 1 || opts->warmup < 0)
+		return EC_ERROR_INVAL;
+
+	for (i = 0; i < opts->warmup; i++)
+		fn(arg);
+
+	for (i = 0; i < opts->runs; i++) {
+		c0 = clock_cycles();
+		t0 = clock_ns();
+		for (j = 0; j < opts->batch; j++)
+			fn(arg);
+		time_ns[i] = (clock_ns() - t0) / opts->batch;
+		cycles[i] = (clock_cycles() - c0) / opts->batch;
+		sum += time_ns[i];
+	}
+
+	sort_u32(time_ns, opts->runs);
+	sort_u32(cycles, opts->runs);
+
+	result->name = name;
+	result->runs = opts->runs;
+	result->batch = opts->batch;
+	result->min_ns = time_ns[0];
+	result->median_ns = time_ns[opts->runs / 2];
+	/* Nearest rank */
+	result->p99_ns = time_ns[DIV_ROUND_UP(opts->runs * 99, 100) - 1];
+	result->max_ns = time_ns[opts->runs - 1];
+	result->mean_ns = sum / opts->runs;
+	result->median_cycles = cycles[opts->runs / 2];
+
+	return EC_SUCCESS;
+}
+
+void benchmark_print(const struct benchmark_result *result)
+{
+	ccprintf("BENCH name=%s runs=%d batch=%d min_ns=%u median_ns=%u "
+		 "p99_ns=%u max_ns=%u mean_ns=%u median_cycles=%u\n",
+		 result->name, result->runs, result->batch, result->min_ns,
+		 result->median_ns, result->p99_ns, result->max_ns,
+		 result->mean_ns, result->median_cycles);
+	cflush();
+}
+
+int benchmark_check(const struct benchmark_result *result)
+{
+	benchmark_print(result);
+
+	if (result->min_ns > result->median_ns ||
+	    result->median_ns > result->p99_ns ||
+	    result->p99_ns > result->max_ns ||
+	    result->mean_ns < result->min_ns ||
+	    result->mean_ns > result->max_ns)
+		return EC_ERROR_UNKNOWN;
+
+	return EC_SUCCESS;
+}
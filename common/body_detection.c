@@ -11,6 +11,7 @@
 #include "math_util.h"
 #include "motion_sense_fifo.h"
 #include "timer.h"
+#include "util.h"
 
 /* Console output macros */
 #define CPUTS(outstr) cputs(CC_ACCEL, outstr)
@@ -20,10 +21,31 @@
 static struct motion_sensor_t *body_sensor =
 	&motion_sensors[CONFIG_BODY_DETECTION_SENSOR];
 
-static int window_size = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE;
-static uint64_t var_threshold_scaled, confidence_delta_scaled;
+/* Samples in one second, for the stationary duration */
+static int samples_per_sec = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE;
+/* The variance is taken over the last 2^window_shift samples */
+static int window_shift;
 static int stationary_timeframe;
 
+/* Curve from the variance to the motion confidence */
+static struct body_detect_params params = {
+	.var_threshold = CONFIG_BODY_DETECTION_VAR_THRESHOLD,
+	.confidence_delta = CONFIG_BODY_DETECTION_CONFIDENCE_DELTA,
+	.on_body_con = CONFIG_BODY_DETECTION_ON_BODY_CON,
+	.off_body_con = CONFIG_BODY_DETECTION_OFF_BODY_CON,
+};
+
+/* LSB^2 per (mm/s^2)^2 of the sensor, and its noise in (mm/s^2)^2 */
+static int var_multiplier = 1;
+static int var_noise;
+
+/* The curve, scaled to the sensor data */
+static uint64_t var_threshold_scaled, confidence_delta_scaled;
+/* Variance from which the confidence is above on_body_con */
+static uint64_t var_on_body;
+/* Variance from which the confidence is at least off_body_con */
+static uint64_t var_off_body;
+
 static int history_idx;
 static enum body_detect_states motion_state = BODY_DETECTION_OFF_BODY;
 
@@ -34,13 +56,17 @@ static struct body_detect_motion_data
 {
 	int history[CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE]; /* acceleration */
 	int sum;              /* sum(history) */
-	uint64_t n2_variance; /* n^2 * var(history) */
 } data[2]; /* motion data for X-axis and Y-axis */
 
+/* n^2 * (var(X) + var(Y)) over the window */
+static int64_t n2_variance;
+
 /*
- * This function will update new variance and new sum according to incoming
- * value, previous value, previous sum and previous variance.
- * In order to prevent inaccuracy, we use integer to calculate instead of float
+ * This function will update the sum and the variance of one axis according
+ * to the incoming value, in the way of Welford's algorithm over a sliding
+ * window. In order to prevent inaccuracy, we use integer to calculate instead
+ * of float; the result is exact, and as n is a power of two, there is no
+ * division.
  *
  * n: window size
  * x: data in the old window
@@ -48,45 +74,83 @@ static struct body_detect_motion_data
  * x_0: oldest value in the window, will be replaced by x_n
  * x_n: new coming value
  *
- * n^2 * var(x') = n^2 * var(x) + (sum(x') - sum(x))^2 +
- *                 (n * x_n - sum(x'))^2 / n - (n * x_0 - sum(x'))^2 / n
+ * As n^2 * var(x) = n * sum(x^2) - sum(x)^2,
+ *
+ * n^2 * var(x') = n^2 * var(x) +
+ *                 (x_n - x_0) * (n * (x_n + x_0) - sum(x) - sum(x'))
  */
 static void update_motion_data(struct body_detect_motion_data *x, int x_n)
 {
-	const int n = window_size;
 	const int x_0 = x->history[history_idx];
-	const int new_sum = x->sum + (x_n - x->history[history_idx]);
+	const int new_sum = x->sum + (x_n - x_0);
 
-	x->n2_variance = x->n2_variance + POW2((int64_t)new_sum - x->sum) +
-			 (POW2((int64_t)x_n * n - new_sum) -
-			  POW2((int64_t)x_0 * n - new_sum)) / n;
+	n2_variance += (int64_t)(x_n - x_0) *
+		       ((((int64_t)x_n + x_0) << window_shift) -
+			x->sum - new_sum);
 	x->sum = new_sum;
 	x->history[history_idx] = x_n;
 }
 
 /* Update motion data of X, Y with new sensor data. */
-static void update_motion_variance(void)
+static void update_motion_variance(int x, int y)
 {
-	update_motion_data(&data[X], body_sensor->xyz[X]);
-	update_motion_data(&data[Y], body_sensor->xyz[Y]);
-	history_idx = (history_idx + 1 >= window_size) ? 0 : history_idx + 1;
+	update_motion_data(&data[X], x);
+	update_motion_data(&data[Y], y);
+	history_idx = (history_idx + 1) & (BIT(window_shift) - 1);
 }
 
 /* return Var(X) + Var(Y) */
 static uint64_t get_motion_variance(void)
 {
-	return (data[X].n2_variance + data[Y].n2_variance)
-		/ window_size / window_size;
+	return (uint64_t)n2_variance >> (2 * window_shift);
+}
+
+/* Lowest variance of the confidence ramp */
+static uint64_t confidence_floor(void)
+{
+	if (var_threshold_scaled < confidence_delta_scaled)
+		return 0;
+	return var_threshold_scaled - confidence_delta_scaled;
 }
 
 static int calculate_motion_confidence(uint64_t var)
 {
-	if (var < var_threshold_scaled - confidence_delta_scaled)
+	const uint64_t floor = confidence_floor();
+
+	if (var < floor)
 		return 0;
-	if (var > var_threshold_scaled + confidence_delta_scaled)
+	if (var >= floor + 2 * confidence_delta_scaled)
 		return 100;
-	return 100 * (var - var_threshold_scaled + confidence_delta_scaled) /
-		(2 * confidence_delta_scaled);
+	return 100 * (var - floor) / (2 * confidence_delta_scaled);
+}
+
+/*
+ * Lowest variance with a confidence of at least con, so that the detection
+ * compares the variance to it instead of dividing for each sample.
+ */
+static uint64_t confidence_to_variance(int con)
+{
+	if (con <= 0)
+		return 0;
+	if (con > 100)
+		return UINT64_MAX;
+	return confidence_floor() +
+		DIV_ROUND_UP(2 * confidence_delta_scaled * con, 100);
+}
+
+/* Scale the curve to the sensor data. */
+static void update_threshold_scale(void)
+{
+	const int divisor = POW2(9800);
+
+	var_threshold_scaled = (uint64_t)
+		(params.var_threshold + var_noise) *
+		var_multiplier / divisor;
+	confidence_delta_scaled = (uint64_t)
+		params.confidence_delta *
+		var_multiplier / divisor;
+	var_on_body = confidence_to_variance(params.on_body_con + 1);
+	var_off_body = confidence_to_variance(params.off_body_con);
 }
 
 /* Change the motion state and commit the change to AP. */
@@ -119,16 +183,20 @@ enum body_detect_states body_detect_get_state(void)
 	return motion_state;
 }
 
-/* Determine window size for 1 second by sensor data rate. */
+/*
+ * Determine window size by sensor data rate: the largest power of two which
+ * fits in 1 second.
+ */
 static void determine_window_size(int odr)
 {
-	window_size = odr / 1000;
-	/* Normally, window_size should not exceed MAX_WINDOW_SIZE. */
-	if (window_size > CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE) {
+	samples_per_sec = odr / 1000;
+	/* Normally, samples_per_sec should not exceed MAX_WINDOW_SIZE. */
+	if (samples_per_sec > CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE) {
 		/* This will cause window size not enough for 1 second */
 		CPRINTS("ODR exceeds CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE");
-		window_size = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE;
+		samples_per_sec = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE;
 	}
+	window_shift = samples_per_sec > 1 ? __fls(samples_per_sec) : 0;
 }
 
 /* Determine variance threshold scale by range and resolution. */
@@ -145,8 +213,6 @@ static void determine_threshold_scale(int range, int resolution, int rms_noise)
 	 * var_noise:          mm^2/s^4
 	 */
 	const int data_1g = BIT(resolution - 1) / range;
-	const int multiplier = POW2(data_1g);
-	const int divisor = POW2(9800);
 	/*
 	 * We are measuring the var(X) + var(Y), so theoretically, the
 	 * var(noise) should be 2 * rms_noise^2. However, in most case, on a
@@ -154,16 +220,11 @@ static void determine_threshold_scale(int range, int resolution, int rms_noise)
 	 * rms_noise^2. We can multiply the rms_noise^2 with the
 	 * CONFIG_BODY_DETECTION_VAR_NOISE_FACTOR / 100.
 	 */
-	const int var_noise = POW2((uint64_t)rms_noise) *
-			      CONFIG_BODY_DETECTION_VAR_NOISE_FACTOR * POW2(98)
-			      / 100 / POW2(10000);
-
-	var_threshold_scaled = (uint64_t)
-		(CONFIG_BODY_DETECTION_VAR_THRESHOLD + var_noise) *
-		multiplier / divisor;
-	confidence_delta_scaled = (uint64_t)
-		CONFIG_BODY_DETECTION_CONFIDENCE_DELTA *
-		multiplier / divisor;
+	var_noise = POW2((uint64_t)rms_noise) *
+		    CONFIG_BODY_DETECTION_VAR_NOISE_FACTOR * POW2(98)
+		    / 100 / POW2(10000);
+	var_multiplier = POW2(data_1g);
+	update_threshold_scale();
 }
 
 void body_detect_reset(void)
@@ -184,45 +245,68 @@ void body_detect_reset(void)
 	determine_threshold_scale(range, resolution, rms_noise);
 	/* initialize motion data and state */
 	memset(data, 0, sizeof(data));
+	n2_variance = 0;
 	history_idx = 0;
 	history_initialized = 0;
 }
 
-void body_detect(void)
+/* Run the detection on one sample */
+static void body_detect_sample(int x, int y)
 {
 	uint64_t motion_var;
-	int motion_confidence;
 
-	if (!body_detect_enable)
-		return;
-
-	update_motion_variance();
+	update_motion_variance(x, y);
 	if (!history_initialized) {
-		if (history_idx == window_size - 1)
+		if (history_idx == BIT(window_shift) - 1)
 			history_initialized = 1;
 		return;
 	}
 
 	motion_var = get_motion_variance();
-	motion_confidence = calculate_motion_confidence(motion_var);
 	switch (motion_state) {
 	case BODY_DETECTION_OFF_BODY:
-		if (motion_confidence > CONFIG_BODY_DETECTION_ON_BODY_CON)
+		/* confidence above on_body_con */
+		if (motion_var >= var_on_body)
 			body_detect_change_state(BODY_DETECTION_ON_BODY);
 		break;
 	case BODY_DETECTION_ON_BODY:
 		stationary_timeframe += 1;
 		/* confidence exceeds the limit, reset time counting */
-		if (motion_confidence >= CONFIG_BODY_DETECTION_OFF_BODY_CON)
+		if (motion_var >= var_off_body)
 			stationary_timeframe = 0;
 		/* if no motion for enough time, change state to off_body */
 		if (stationary_timeframe >=
-		    CONFIG_BODY_DETECTION_STATIONARY_DURATION * window_size)
+		    CONFIG_BODY_DETECTION_STATIONARY_DURATION * samples_per_sec)
 			body_detect_change_state(BODY_DETECTION_OFF_BODY);
 		break;
 	}
 }
 
+void body_detect_batch(const int *x, const int *y, int n)
+{
+	int i;
+
+	if (!body_detect_enable)
+		return;
+
+	for (i = 0; i < n; i++)
+		body_detect_sample(x[i], y[i]);
+}
+
+void body_detect(void)
+{
+#ifdef CONFIG_ACCEL_FIFO
+	/* Every sample the FIFO got since the last time, not just the last */
+	int x[BODY_DETECTION_BATCH_SIZE], y[BODY_DETECTION_BATCH_SIZE];
+	int n;
+
+	n = motion_sense_fifo_get_body_samples(x, y, ARRAY_SIZE(x));
+	body_detect_batch(x, y, n);
+#else
+	body_detect_batch(&body_sensor->xyz[X], &body_sensor->xyz[Y], 1);
+#endif
+}
+
 void body_detect_set_enable(int enable)
 {
 	body_detect_enable = enable;
@@ -233,3 +317,65 @@ int body_detect_get_enable(void)
 {
 	return body_detect_enable;
 }
+
+uint64_t body_detect_get_variance(void)
+{
+	return get_motion_variance();
+}
+
+void body_detect_get_params(struct body_detect_params *p)
+{
+	*p = params;
+}
+
+int body_detect_set_params(const struct body_detect_params *p)
+{
+	if (p->var_threshold <= 0 || p->confidence_delta <= 0 ||
+	    p->on_body_con < 0 || p->on_body_con > 100 ||
+	    p->off_body_con < 0 || p->off_body_con > 100)
+		return EC_ERROR_INVAL;
+
+	params = *p;
+	update_threshold_scale();
+	return EC_SUCCESS;
+}
+
+static int command_body_detect(int argc, char **argv)
+{
+	struct body_detect_params p = params;
+	uint64_t var = get_motion_variance();
+	char *e;
+
+	if (argc > 1) {
+		if (argc != 5)
+			return EC_ERROR_PARAM_COUNT;
+		p.var_threshold = strtoi(argv[1], &e, 0);
+		if (*e)
+			return EC_ERROR_PARAM1;
+		p.confidence_delta = strtoi(argv[2], &e, 0);
+		if (*e)
+			return EC_ERROR_PARAM2;
+		p.on_body_con = strtoi(argv[3], &e, 0);
+		if (*e)
+			return EC_ERROR_PARAM3;
+		p.off_body_con = strtoi(argv[4], &e, 0);
+		if (*e)
+			return EC_ERROR_PARAM4;
+		if (body_detect_set_params(&p))
+			return EC_ERROR_INVAL;
+	}
+
+	ccprintf("%s, %s body\n", body_detect_enable ? "enabled" : "disabled",
+		 motion_state ? "on" : "off");
+	ccprintf("window: %d samples\n", BIT(window_shift));
+	ccprintf("threshold: %d (mm/s^2)^2, delta: %d (mm/s^2)^2\n",
+		 params.var_threshold, params.confidence_delta);
+	ccprintf("on body: >%d%%, off body: <%d%%\n",
+		 params.on_body_con, params.off_body_con);
+	ccprintf("variance: %d LSB^2, confidence: %d%%\n", (int)var,
+		 calculate_motion_confidence(var));
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(bodydetect, command_body_detect,
+			"[threshold delta on_con off_con]",
+			"Print or set the body detection confidence curve");
@@ -15,6 +15,7 @@
 #include "hooks.h"
 #include "host_command.h"
 #include "system.h"
+#include "task.h"
 #include "tcpm.h"
 #include "timer.h"
 #include "usb_pd.h"
@@ -74,6 +75,31 @@ BUILD_ASSERT(ARRAY_SIZE(supplier_priority) == CHARGE_SUPPLIER_COUNT);
 static struct charge_port_info available_charge[CHARGE_SUPPLIER_COUNT]
 					       [CHARGE_PORT_COUNT];
 
+/*
+ * Per-port binary max-heap of the suppliers which have a non-zero charge
+ * available, ordered by supplier priority and then by power. The root of
+ * each heap is the best supplier on that port, so port selection only needs
+ * to look at one candidate per port instead of every supplier x port pair.
+ * Entries are 1-based so that a zeroed heap is a valid empty heap; pos[] holds
+ * the heap index of each supplier, or 0 if it is not in the heap.
+ */
+struct supplier_heap {
+	uint8_t count;
+	uint8_t entry[CHARGE_SUPPLIER_COUNT + 1];
+	uint8_t pos[CHARGE_SUPPLIER_COUNT];
+};
+static struct supplier_heap supplier_heap[CHARGE_PORT_COUNT];
+
+/*
+ * Set when a refresh has been scheduled but has not started yet. Further
+ * updates arriving in that window are picked up by the pending refresh
+ * instead of re-arming the deferred call.
+ */
+static int refresh_pending;
+
+/* Counters of received updates vs. refresh requests vs. actual refreshes. */
+static struct charge_manager_stats refresh_stats;
+
 /* Keep track of when the supplier on each port is registered. */
 static timestamp_t registration_time[CHARGE_PORT_COUNT];
 
@@ -201,6 +227,107 @@ static int charge_manager_spoof_dualrole_capability(void)
 }
 #endif /* !CONFIG_CHARGE_MANAGER_DRP_CHARGING */
 
+/**
+ * Compare two suppliers available on a port.
+ *
+ * @param port	Charge port.
+ * @param a	First supplier.
+ * @param b	Second supplier.
+ * @return	1 if supplier a is a better choice than supplier b, 0 otherwise.
+ */
+static int supplier_is_better(int port, int a, int b)
+{
+	int power_a, power_b;
+
+	if (supplier_priority[a] != supplier_priority[b])
+		return supplier_priority[a] < supplier_priority[b];
+
+	power_a = POWER(available_charge[a][port]);
+	power_b = POWER(available_charge[b][port]);
+	if (power_a != power_b)
+		return power_a > power_b;
+
+	/* Complete tie, prefer the lower supplier index. */
+	return a < b;
+}
+
+static void supplier_heap_swap(struct supplier_heap *h, int i, int j)
+{
+	uint8_t tmp = h->entry[i];
+
+	h->entry[i] = h->entry[j];
+	h->entry[j] = tmp;
+	h->pos[h->entry[i]] = i;
+	h->pos[h->entry[j]] = j;
+}
+
+static void supplier_heap_sift(int port, int i)
+{
+	struct supplier_heap *h = &supplier_heap[port];
+	int child;
+
+	/* Move up while better than the parent. */
+	while (i > 1 && supplier_is_better(port, h->entry[i],
+					   h->entry[i / 2])) {
+		supplier_heap_swap(h, i, i / 2);
+		i /= 2;
+	}
+
+	/* Move down while a child is better. */
+	while ((child = 2 * i) <= h->count) {
+		if (child < h->count &&
+		    supplier_is_better(port, h->entry[child + 1],
+				       h->entry[child]))
+			child++;
+		if (!supplier_is_better(port, h->entry[child], h->entry[i]))
+			break;
+		supplier_heap_swap(h, i, child);
+		i = child;
+	}
+}
+
+/**
+ * Update the available charge for a supplier on a port, and reposition the
+ * supplier in the port's heap accordingly.
+ *
+ * @param supplier	Charge supplier.
+ * @param port		Charge port.
+ * @param current	Available current (mA).
+ * @param voltage	Available voltage (mV).
+ */
+static void set_available_charge(int supplier, int port, int current,
+				 int voltage)
+{
+	struct supplier_heap *h = &supplier_heap[port];
+	int i;
+
+	/* Updates may come from several tasks, keep the heap consistent. */
+	interrupt_disable();
+
+	available_charge[supplier][port].current = current;
+	available_charge[supplier][port].voltage = voltage;
+
+	i = h->pos[supplier];
+
+	if (current != 0 && voltage != 0) {
+		if (!i) {
+			i = ++h->count;
+			h->entry[i] = supplier;
+			h->pos[supplier] = i;
+		}
+		supplier_heap_sift(port, i);
+	} else if (i) {
+		/* No charge left, remove the supplier from the heap. */
+		supplier_heap_swap(h, i, h->count);
+		h->pos[supplier] = 0;
+		h->count--;
+		if (i <= h->count)
+			supplier_heap_sift(port, i);
+	}
+
+	interrupt_enable();
+}
+
 /**
  * Initialize available charge. Run before board init, so board init can
  * initialize data, if needed.
@@ -212,12 +339,10 @@ static void charge_manager_init(void)
 	for (i = 0; i < CHARGE_PORT_COUNT; ++i) {
 		if (!is_valid_port(i))
 			continue;
-		for (j = 0; j < CHARGE_SUPPLIER_COUNT; ++j) {
-			available_charge[j][i].current =
-				CHARGE_CURRENT_UNINITIALIZED;
-			available_charge[j][i].voltage =
-				CHARGE_VOLTAGE_UNINITIALIZED;
-		}
+		for (j = 0; j < CHARGE_SUPPLIER_COUNT; ++j)
+			set_available_charge(j, i,
+					     CHARGE_CURRENT_UNINITIALIZED,
+					     CHARGE_VOLTAGE_UNINITIALIZED);
 		for (j = 0; j < CEIL_REQUESTOR_COUNT; ++j)
 			charge_ceil[i][j] = CHARGE_CEIL_NONE;
 		if (!is_pd_port(i))
@@ -583,71 +708,68 @@ static void charge_manager_get_best_charge_port(int *new_port,
 		 * 2. Prefer higher power over lower in case priority is tied.
 		 * 3. Prefer current charge port over new port in case (1)
 		 *    and (2) are tied.
+		 * The best supplier of each port is the root of its heap, so
+		 * only that one needs to be considered per port.
 		 * available_charge can be changed at any time by other tasks,
 		 * so make no assumptions about its consistency.
 		 */
-		for (i = 0; i < CHARGE_SUPPLIER_COUNT; ++i)
-			for (j = 0; j < CHARGE_PORT_COUNT; ++j) {
-				/* Skip this port if it is not valid. */
-				if (!is_valid_port(j))
-					continue;
-
-				/*
-				 * Skip this supplier if there is no
-				 * available charge.
-				 */
-				if (available_charge[i][j].current == 0 ||
-				    available_charge[i][j].voltage == 0)
-					continue;
-
-				/*
-				 * Don't select this port if we have a
-				 * charge on another override port.
-				 */
-				if (override_port != OVERRIDE_OFF &&
-				    override_port == port &&
-				    override_port != j)
-					continue;
+		for (j = 0; j < CHARGE_PORT_COUNT; ++j) {
+			/* Skip this port if it is not valid. */
+			if (!is_valid_port(j))
+				continue;
+
+			/* Skip this port if there is no available charge. */
+			if (!supplier_heap[j].count)
+				continue;
+			i = supplier_heap[j].entry[1];
+
+			/*
+			 * Don't select this port if we have a charge on
+			 * another override port.
+			 */
+			if (override_port != OVERRIDE_OFF &&
+			    override_port == port &&
+			    override_port != j)
+				continue;
 
 #ifndef CONFIG_CHARGE_MANAGER_DRP_CHARGING
-				/*
-				 * Don't charge from a dual-role port unless
-				 * it is our override port.
-				 */
-				if (dualrole_capability[j] != CAP_DEDICATED &&
-				    override_port != j &&
-				    !charge_manager_spoof_dualrole_capability())
-					continue;
+			/*
+			 * Don't charge from a dual-role port unless it is our
+			 * override port.
+			 */
+			if (dualrole_capability[j] != CAP_DEDICATED &&
+			    override_port != j &&
+			    !charge_manager_spoof_dualrole_capability())
+				continue;
 #endif
 
-				candidate_port_power =
-					POWER(available_charge[i][j]);
-
-				/* Select if no supplier chosen yet. */
-				if (supplier == CHARGE_SUPPLIER_NONE ||
-				/* ..or if supplier priority is higher. */
-				    supplier_priority[i] <
-				    supplier_priority[supplier] ||
-				/* ..or if this is our override port. */
-				   (j == override_port &&
-				    port != override_port) ||
-				/* ..or if priority is tied and.. */
-				   (supplier_priority[i] ==
-				    supplier_priority[supplier] &&
-				/* candidate port can supply more power or.. */
-				   (candidate_port_power > best_port_power ||
-				/*
-				 * candidate port is the active port and can
-				 * supply the same amount of power.
-				 */
-				   (candidate_port_power == best_port_power &&
-				    charge_port == j)))) {
-					supplier = i;
-					port = j;
-					best_port_power = candidate_port_power;
-				}
+			candidate_port_power = POWER(available_charge[i][j]);
+
+			/* Select if no supplier chosen yet. */
+			if (supplier == CHARGE_SUPPLIER_NONE ||
+			/* ..or if supplier priority is higher. */
+			    supplier_priority[i] <
+			    supplier_priority[supplier] ||
+			/* ..or if this is our override port. */
+			   (j == override_port && port != override_port) ||
+			/* ..or if priority is tied and.. */
+			   (supplier_priority[i] ==
+			    supplier_priority[supplier] &&
+			/* candidate port can supply more power or.. */
+			   (candidate_port_power > best_port_power ||
+			/*
+			 * candidate port is the active port and can supply the
+			 * same amount of power, or neither is the active port
+			 * and the candidate is a lower numbered supplier.
+			 */
+			   (candidate_port_power == best_port_power &&
+			   (charge_port == j ||
+			   (charge_port != port && i < supplier)))))) {
+				supplier = i;
+				port = j;
+				best_port_power = candidate_port_power;
 			}
-
+		}
 	}
 
 #ifdef CONFIG_BATTERY
@@ -685,6 +807,13 @@ static void charge_manager_refresh(void)
 	int ceil;
 	int power_changed = 0;
 
+	/*
+	 * Clear the pending flag before looking at any state, so that an
+	 * update racing with this refresh schedules another one.
+	 */
+	refresh_pending = 0;
+	refresh_stats.refreshes++;
+
 	/* Hunt for an acceptable charge port */
 	while (1) {
 		charge_manager_get_best_charge_port(&new_port, &new_supplier);
@@ -712,10 +841,8 @@ static void charge_manager_refresh(void)
 		 * Zero the available charge on the rejected port so that
 		 * it is no longer chosen.
 		 */
-		for (i = 0; i < CHARGE_SUPPLIER_COUNT; ++i) {
-			available_charge[i][new_port].current = 0;
-			available_charge[i][new_port].voltage = 0;
-		}
+		for (i = 0; i < CHARGE_SUPPLIER_COUNT; ++i)
+			set_available_charge(i, new_port, 0, 0);
 	}
 
 	active_charge_port_initialized = 1;
@@ -845,6 +972,22 @@ static void charge_manager_refresh(void)
 }
 DECLARE_DEFERRED(charge_manager_refresh);
 
+/**
+ * Request a charge_manager_refresh(). Requests made while a refresh is
+ * already pending are coalesced into it.
+ */
+static void charge_manager_schedule_refresh(void)
+{
+	refresh_stats.refresh_requests++;
+
+	if (refresh_pending)
+		return;
+
+	refresh_pending = 1;
+	hook_call_deferred(&charge_manager_refresh_data,
+			   CONFIG_CHARGE_MANAGER_REFRESH_DELAY);
+}
+
 /**
  * Called when charge override times out waiting for power swap.
  */
@@ -886,6 +1029,8 @@ static void charge_manager_make_change(enum charge_manager_change_type change,
 		return;
 	}
 
+	refresh_stats.updates++;
+
 	/* Determine if this is a change which can affect charge status */
 	switch (change) {
 	case CHANGE_CHARGE:
@@ -941,8 +1086,8 @@ static void charge_manager_make_change(enum charge_manager_change_type change,
 	}
 
 	if (change == CHANGE_CHARGE) {
-		available_charge[supplier][port].current = charge->current;
-		available_charge[supplier][port].voltage = charge->voltage;
+		set_available_charge(supplier, port, charge->current,
+				     charge->voltage);
 		registration_time[port] = get_time();
 
 		/*
@@ -977,7 +1122,7 @@ static void charge_manager_make_change(enum charge_manager_change_type change,
 	 * attached.
 	 */
 	if (charge_manager_is_seeded())
-		hook_call_deferred(&charge_manager_refresh_data, 0);
+		charge_manager_schedule_refresh();
 }
 
 void pd_set_input_current_limit(int port, uint32_t max_ma,
@@ -1077,7 +1222,7 @@ void charge_manager_leave_safe_mode(void)
 	cflush();
 	left_safe_mode = 1;
 	if (charge_manager_is_seeded())
-		hook_call_deferred(&charge_manager_refresh_data, 0);
+		charge_manager_schedule_refresh();
 }
 #endif
 
@@ -1089,7 +1234,7 @@ void charge_manager_set_ceil(int port, enum ceil_requestor requestor, int ceil)
 	if (charge_ceil[port][requestor] != ceil) {
 		charge_ceil[port][requestor] = ceil;
 		if (port == charge_port && charge_manager_is_seeded())
-			hook_call_deferred(&charge_manager_refresh_data, 0);
+			charge_manager_schedule_refresh();
 	}
 }
 
@@ -1131,8 +1276,7 @@ int charge_manager_set_override(int port)
 		if (override_port != port) {
 			override_port = port;
 			if (charge_manager_is_seeded())
-				hook_call_deferred(
-					&charge_manager_refresh_data, 0);
+				charge_manager_schedule_refresh();
 		}
 	}
 	/*
@@ -1186,6 +1330,11 @@ enum charge_supplier charge_manager_get_supplier(void)
 	return charge_supplier;
 }
 
+void charge_manager_get_stats(struct charge_manager_stats *stats)
+{
+	*stats = refresh_stats;
+}
+
 int charge_manager_get_power_limit_uw(void)
 {
 	int current_ma = charge_current;
@@ -1479,6 +1628,10 @@ static int charge_supplier_info(int argc, char **argv)
 			charge_current,
 			charge_voltage,
 			left_safe_mode);
+	ccprintf("updates=%d, refresh req=%d, refreshes=%d\n",
+			refresh_stats.updates,
+			refresh_stats.refresh_requests,
+			refresh_stats.refreshes);
 
 	return 0;
 }
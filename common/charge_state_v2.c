@@ -5,6 +5,7 @@
  * Battery charging task and state machine.
  */
 
+#include "atomic.h"
 #include "battery.h"
 #include "battery_smart.h"
 #include "charge_manager.h"
@@ -22,6 +23,7 @@
 #include "host_command.h"
 #include "i2c.h"
 #include "math_util.h"
+#include "memmap.h"
 #include "printf.h"
 #include "system.h"
 #include "task.h"
@@ -89,6 +91,21 @@ static enum ec_charge_control_mode chg_ctl_mode;
 static int manual_voltage;  /* Manual voltage override (-1 = no override) */
 static int manual_current;  /* Manual current override (-1 = no override) */
 static unsigned int user_current_limit = -1U;
+
+/*
+ * Inputs of charger_task() which changed since its previous pass. A pass with
+ * no dirty input only polls the battery and charger; the charger registers are
+ * left alone unless the requested values change.
+ */
+#define CHARGE_DIRTY_AC		BIT(0)	/* External power came or went */
+#define CHARGE_DIRTY_BATTERY	BIT(1)	/* Battery presence or requests */
+#define CHARGE_DIRTY_INPUT	BIT(2)	/* Input current limit (PD contract) */
+#define CHARGE_DIRTY_LIMIT	BIT(3)	/* Throttle, manual or control mode */
+static uint32_t charge_dirty;
+/* Charger voltage/current/mode must be written even if unchanged */
+static int charge_force_write = 1;
+/* Consecutive passes of charger_task() without a dirty input */
+static int stable_passes;
 test_export_static timestamp_t shutdown_target_time;
 static timestamp_t precharge_start_time;
 
@@ -734,59 +751,59 @@ static void charge_allocate_input_current_limit(void)
 /* Returns zero if every item was updated. */
 static int update_static_battery_info(void)
 {
-	char *batt_str;
+	struct memmap_battery batt;
 	int batt_serial;
 	uint8_t batt_flags = 0;
+	uint8_t staged_flag;
 	/*
 	 * The return values have type enum ec_error_list, but EC_SUCCESS is
 	 * zero. We'll just look for any failures so we can try them all again.
 	 */
 	int rv;
 
+	/* Stage the whole block, then publish it at once */
+	memmap_stage_battery(&batt);
+	staged_flag = batt.flag;
+
 	/* Smart battery serial number is 16 bits */
-	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_SERIAL);
-	memset(batt_str, 0, EC_MEMMAP_TEXT_MAX);
+	memset(batt.serial, 0, EC_MEMMAP_TEXT_MAX);
 	rv = battery_serial_number(&batt_serial);
 	if (!rv)
-		snprintf(batt_str, EC_MEMMAP_TEXT_MAX, "%04X", batt_serial);
+		snprintf(batt.serial, EC_MEMMAP_TEXT_MAX, "%04X", batt_serial);
 
 	/* Design Capacity of Full */
-	rv |= battery_design_capacity(
-		(int *)host_get_memmap(EC_MEMMAP_BATT_DCAP));
+	rv |= battery_design_capacity(&batt.dcap);
 
 	/* Design Voltage */
-	rv |= battery_design_voltage(
-		(int *)host_get_memmap(EC_MEMMAP_BATT_DVLT));
+	rv |= battery_design_voltage(&batt.dvlt);
 
 	/* Last Full Charge Capacity (this is only mostly static) */
-	rv |= battery_full_charge_capacity(
-		(int *)host_get_memmap(EC_MEMMAP_BATT_LFCC));
+	rv |= battery_full_charge_capacity(&batt.lfcc);
 
 	/* Cycle Count */
-	rv |= battery_cycle_count((int *)host_get_memmap(EC_MEMMAP_BATT_CCNT));
+	rv |= battery_cycle_count(&batt.ccnt);
 
 	/* Battery Manufacturer string */
-	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_MFGR);
-	memset(batt_str, 0, EC_MEMMAP_TEXT_MAX);
-	rv |= battery_manufacturer_name(batt_str, EC_MEMMAP_TEXT_MAX);
+	memset(batt.mfgr, 0, EC_MEMMAP_TEXT_MAX);
+	rv |= battery_manufacturer_name(batt.mfgr, EC_MEMMAP_TEXT_MAX);
 
 	/* Battery Model string */
-	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_MODEL);
-	memset(batt_str, 0, EC_MEMMAP_TEXT_MAX);
-	rv |= battery_device_name(batt_str, EC_MEMMAP_TEXT_MAX);
+	memset(batt.model, 0, EC_MEMMAP_TEXT_MAX);
+	rv |= battery_device_name(batt.model, EC_MEMMAP_TEXT_MAX);
 
 	/* Battery Type string */
-	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_TYPE);
-	rv |= battery_device_chemistry(batt_str, EC_MEMMAP_TEXT_MAX);
+	rv |= battery_device_chemistry(batt.type, EC_MEMMAP_TEXT_MAX);
 
 	/* Zero the dynamic entries. They'll come next. */
-	*(int *)host_get_memmap(EC_MEMMAP_BATT_VOLT) = 0;
-	*(int *)host_get_memmap(EC_MEMMAP_BATT_RATE) = 0;
-	*(int *)host_get_memmap(EC_MEMMAP_BATT_CAP) = 0;
-	*(int *)host_get_memmap(EC_MEMMAP_BATT_LFCC) = 0;
+	batt.volt = 0;
+	batt.rate = 0;
+	batt.cap = 0;
+	batt.lfcc = 0;
 	if (extpower_is_present())
 		batt_flags |= EC_BATT_FLAG_AC_PRESENT;
-	*host_get_memmap(EC_MEMMAP_BATT_FLAG) = batt_flags;
+	batt.flag = batt_flags;
+
+	memmap_publish_battery(&batt, staged_flag);
 
 	if (rv)
 		problem(PR_STATIC_UPDATE, rv);
@@ -799,17 +816,18 @@ static int update_static_battery_info(void)
 
 static void update_dynamic_battery_info(void)
 {
-	/* The memmap address is constant. We should fix these calls somehow. */
-	int *memmap_volt = (int *)host_get_memmap(EC_MEMMAP_BATT_VOLT);
-	int *memmap_rate = (int *)host_get_memmap(EC_MEMMAP_BATT_RATE);
-	int *memmap_cap = (int *)host_get_memmap(EC_MEMMAP_BATT_CAP);
-	int *memmap_lfcc = (int *)host_get_memmap(EC_MEMMAP_BATT_LFCC);
-	uint8_t *memmap_flags = host_get_memmap(EC_MEMMAP_BATT_FLAG);
-	uint8_t tmp;
+	/* Staged, then published at once after the events are decided */
+	struct memmap_battery batt;
+	uint8_t tmp, staged_flag;
 	int send_batt_status_event = 0;
 	int send_batt_info_event = 0;
 	static int __bss_slow batt_present;
+#ifdef CONFIG_EMI_REGION1
 	static int batt_os_percentage;
+#endif
+
+	memmap_stage_battery(&batt);
+	staged_flag = batt.flag;
 
 	tmp = 0;
 #ifdef CONFIG_EXTPOWER_GPIO
@@ -825,7 +843,7 @@ static void update_dynamic_battery_info(void)
 		tmp |= EC_BATT_FLAG_BATT_PRESENT;
 		batt_present = 1;
 		/* Tell the AP to read battery info if it is newly present. */
-		if (!(*memmap_flags & EC_BATT_FLAG_BATT_PRESENT))
+		if (!(batt.flag & EC_BATT_FLAG_BATT_PRESENT))
 			send_batt_info_event++;
 	} else {
 		/*
@@ -834,7 +852,7 @@ static void update_dynamic_battery_info(void)
 		 */
 		if (batt_present)
 			tmp |= EC_BATT_FLAG_BATT_PRESENT;
-		else if (*memmap_flags & EC_BATT_FLAG_BATT_PRESENT)
+		else if (batt.flag & EC_BATT_FLAG_BATT_PRESENT)
 			send_batt_info_event++;
 		batt_present = 0;
 	}
@@ -843,15 +861,15 @@ static void update_dynamic_battery_info(void)
 		tmp |= EC_BATT_FLAG_INVALID_DATA;
 
 	if (!(curr.batt.flags & BATT_FLAG_BAD_VOLTAGE))
-		*memmap_volt = curr.batt.voltage;
+		batt.volt = curr.batt.voltage;
 
 #ifdef CONFIG_EMI_REGION1
 	/* let the OS battery remaining time both empty and full time more smooth */
 	if (!(curr.batt.flags & BATT_FLAG_BAD_CURRENT))
-		*memmap_rate = ABS(battery_get_avg_current());
+		batt.rate = ABS(battery_get_avg_current());
 #else
 	if (!(curr.batt.flags & BATT_FLAG_BAD_CURRENT))	
-		*memmap_rate = ABS(curr.batt.current);
+		batt.rate = ABS(curr.batt.current);
 #endif
 
 	if (!(curr.batt.flags & BATT_FLAG_BAD_REMAINING_CAPACITY)
@@ -865,20 +883,20 @@ static void update_dynamic_battery_info(void)
 		 * to Chrome OS powerd.
 		 */
 		if (curr.batt.remaining_capacity == 0 && !curr.batt_is_charging)
-			*memmap_cap = 1;
+			batt.cap = 1;
 #ifdef CONFIG_EMI_REGION1
 		/* Avoid to show the percentage when battery fully charge */
 		else if (curr.ac && (curr.batt.status & STATUS_FULLY_CHARGED))
-			*memmap_cap = curr.batt.full_capacity;
+			batt.cap = curr.batt.full_capacity;
 #endif
 		else
-			*memmap_cap = curr.batt.remaining_capacity;
+			batt.cap = curr.batt.remaining_capacity;
 	}
 
 	if (!(curr.batt.flags & BATT_FLAG_BAD_FULL_CAPACITY) &&
-	    (curr.batt.full_capacity <= (*memmap_lfcc - LFCC_EVENT_THRESH) ||
-	     curr.batt.full_capacity >= (*memmap_lfcc + LFCC_EVENT_THRESH))) {
-		*memmap_lfcc = curr.batt.full_capacity;
+	    (curr.batt.full_capacity <= (batt.lfcc - LFCC_EVENT_THRESH) ||
+	     curr.batt.full_capacity >= (batt.lfcc + LFCC_EVENT_THRESH))) {
+		batt.lfcc = curr.batt.full_capacity;
 		/* Poke the AP if the full_capacity changes. */
 		send_batt_info_event++;
 	}
@@ -889,7 +907,7 @@ static void update_dynamic_battery_info(void)
 		tmp |= EC_BATT_FLAG_LEVEL_CRITICAL;
 
 #ifdef CONFIG_EMI_REGION1
-	batt_os_percentage = (*memmap_cap * 1000) / (curr.batt.full_capacity + 1);
+	batt_os_percentage = (batt.cap * 1000) / (curr.batt.full_capacity + 1);
 	/*
 	 * sync with OS battery percentage to avoid battery show charging icon at 100%
 	 * os battery display formula: rounding (remainig / full capacity)*100
@@ -905,11 +923,12 @@ static void update_dynamic_battery_info(void)
 					EC_BATT_FLAG_DISCHARGING;
 #endif
 	/* Tell the AP to re-read battery status if charge state changes */
-	if (*memmap_flags != tmp)
+	if (batt.flag != tmp)
 		send_batt_status_event++;
 
-	/* Update flags before sending host events. */
-	*memmap_flags = tmp;
+	/* Publish before sending host events. */
+	batt.flag = tmp;
+	memmap_publish_battery(&batt, staged_flag);
 
 	battery_charger_notify(tmp);
 
@@ -1253,7 +1272,9 @@ static int calc_is_full(void)
 static int charge_request(int voltage, int current)
 {
 	int r1 = EC_SUCCESS, r2 = EC_SUCCESS, r3 = EC_SUCCESS, r4 = EC_SUCCESS;
-	static int __bss_slow prev_volt, prev_curr;
+	static int __bss_slow prev_volt, prev_curr, prev_inhibit;
+	static timestamp_t __bss_slow last_write;
+	int inhibit, refresh;
 
 	if (!voltage || !current) {
 #ifdef CONFIG_CHARGER_NARROW_VDC
@@ -1275,6 +1296,18 @@ static int charge_request(int voltage, int current)
 #endif
 	}
 
+	/*
+	 * Only the registers whose value changed are written, unless the
+	 * whole charger has to be refreshed. OCPC runs its control loop on
+	 * every request so it always refreshes.
+	 */
+	inhibit = !(voltage > 0 || current > 0);
+	refresh = IS_ENABLED(CONFIG_OCPC) || charge_force_write ||
+		  get_time().val >= last_write.val + CHARGE_REWRITE_PERIOD_USEC;
+	if (!refresh && voltage == prev_volt && current == prev_curr &&
+	    inhibit == prev_inhibit)
+		return EC_SUCCESS;
+
 	if (curr.ac) {
 		if (prev_volt != voltage || prev_curr != current)
 			CPRINTS("%s(%dmV, %dmA)", __func__, voltage, current);
@@ -1287,12 +1320,12 @@ static int charge_request(int voltage, int current)
 	 * up. This helps avoid large current spikes when connecting
 	 * battery.
 	 */
-	if (current >= 0)
+	if (current >= 0 && (refresh || current != prev_curr))
 		r2 = charger_set_current(0, current);
 	if (r2 != EC_SUCCESS)
 		problem(PR_SET_CURRENT, r2);
 
-	if (voltage >= 0)
+	if (voltage >= 0 && (refresh || voltage != prev_volt))
 		r1 = charger_set_voltage(0, voltage);
 	if (r1 != EC_SUCCESS)
 		problem(PR_SET_VOLTAGE, r1);
@@ -1320,12 +1353,17 @@ static int charge_request(int voltage, int current)
 	 * Set the charge inhibit bit when possible as it appears to save
 	 * power in some cases (e.g. Nyan with BQ24735).
 	 */
-	if (voltage > 0 || current > 0)
-		r4 = charger_set_mode(0);
-	else
-		r4 = charger_set_mode(CHARGE_FLAG_INHIBIT_CHARGE);
+	if (refresh || inhibit != prev_inhibit)
+		r4 = charger_set_mode(inhibit ? CHARGE_FLAG_INHIBIT_CHARGE : 0);
 	if (r4 != EC_SUCCESS)
 		problem(PR_SET_MODE, r4);
+	else
+		prev_inhibit = inhibit;
+
+	/* Keep writing until all of the charger registers have been set. */
+	charge_force_write = r1 || r2 || r3 || r4;
+	if (refresh && !charge_force_write)
+		last_write = get_time();
 
 	/*
 	 * Only update if the request worked, so we'll keep trying on failures.
@@ -1345,17 +1383,26 @@ static int charge_request(int voltage, int current)
 	return EC_SUCCESS;
 }
 
+/* Flag charger_task() inputs as changed and have the task look at them. */
+static void charge_set_dirty(uint32_t bits)
+{
+	deprecated_atomic_or(&charge_dirty, bits);
+	task_wake(TASK_ID_CHARGER);
+}
+
 void chgstate_set_manual_current(int curr_ma)
 {
 	if (curr_ma < 0)
 		manual_current = -1;
 	else
 		manual_current = charger_closest_current(curr_ma);
+	charge_set_dirty(CHARGE_DIRTY_LIMIT);
 }
 
 void chgstate_set_manual_voltage(int volt_mv)
 {
 	manual_voltage = charger_closest_voltage(volt_mv);
+	charge_set_dirty(CHARGE_DIRTY_LIMIT);
 }
 
 /* Force charging off before the battery is full. */
@@ -1377,6 +1424,7 @@ int set_chg_ctrl_mode(enum ec_charge_control_mode mode)
 		manual_current = 0;
 		manual_voltage = 0;
 	}
+	charge_set_dirty(CHARGE_DIRTY_LIMIT);
 
 	return EC_SUCCESS;
 }
@@ -1699,6 +1747,8 @@ void charger_task(void *u)
 	const struct charger_info * const info = charger_get_info();
 	int prev_plt_and_desired_mw;
 	int chgnum = 0;
+	uint32_t dirty;
+	struct batt_params prev_batt = { 0 };
 
 	/* Get the battery-specific values */
 	batt_info = battery_get_info();
@@ -1745,6 +1795,7 @@ void charger_task(void *u)
 
 		/* Let's see what's going on... */
 		curr.ts = get_time();
+		dirty = deprecated_atomic_read_clear(&charge_dirty);
 		sleep_usec = 0;
 		problems_exist = 0;
 		battery_critical = 0;
@@ -1764,6 +1815,12 @@ void charger_task(void *u)
 			board_base_reset();
 #endif
 		if (curr.ac != prev_ac) {
+			/*
+			 * The charger may have lost or been reset to its
+			 * defaults, so rewrite all of it.
+			 */
+			dirty |= CHARGE_DIRTY_AC;
+			charge_force_write = 1;
 			if (curr.ac) {
 				/*
 				 * Some chargers are unpowered when the AC is
@@ -1822,8 +1879,22 @@ void charger_task(void *u)
 				charger_set_input_current(chgnum,
 					curr.desired_input_current);
 			hook_notify(HOOK_BATTERY_SOC_CHANGE);
+			charge_force_write = 1;
 		}
 
+		if (curr.batt.is_present != prev_batt.is_present ||
+		    curr.batt.flags != prev_batt.flags ||
+		    curr.batt.state_of_charge != prev_batt.state_of_charge ||
+		    curr.batt.desired_voltage != prev_batt.desired_voltage ||
+		    curr.batt.desired_current != prev_batt.desired_current)
+			dirty |= CHARGE_DIRTY_BATTERY;
+		prev_batt = curr.batt;
+
+		if (dirty)
+			stable_passes = 0;
+		else if (stable_passes < CHARGE_STABLE_PASSES)
+			stable_passes++;
+
 		/*
 		 * TODO(crosbug.com/p/27527). Sometimes the battery thinks its
 		 * temperature is 6280C, which seems a bit high. Let's ignore
@@ -2158,6 +2229,14 @@ wait_for_it:
 				else
 					/* Discharging, not too urgent */
 					sleep_usec = CHARGE_POLL_PERIOD_LONG;
+			} else if (stable_passes >= CHARGE_STABLE_PASSES &&
+				   (curr.state == ST_CHARGE ||
+				    curr.state == ST_IDLE)) {
+				/*
+				 * AC present but nothing changed for a while;
+				 * any external change wakes us up anyway.
+				 */
+				sleep_usec = CHARGE_POLL_PERIOD_CHARGE_STABLE;
 			} else {
 				/* AC present, so pay closer attention */
 				sleep_usec = CHARGE_POLL_PERIOD_CHARGE;
@@ -2526,9 +2605,12 @@ int charge_set_input_current_limit(int ma, int mv)
 	ma = MIN(ma, CONFIG_CHARGER_MAX_INPUT_CURRENT);
 #endif
 	curr.desired_input_current = ma;
+	/*
+	 * Wake up the charger task so a new contract is acted on right away
+	 * (and, with a base, to allocate current between lid and base).
+	 */
+	charge_set_dirty(CHARGE_DIRTY_INPUT);
 #ifdef CONFIG_EC_EC_COMM_BATTERY_MASTER
-	/* Wake up charger task to allocate current between lid and base. */
-	charge_wakeup();
 	return EC_SUCCESS;
 #else
 	return charger_set_input_current(chgnum, ma);
@@ -2637,6 +2719,7 @@ DECLARE_HOST_COMMAND(EC_CMD_CHARGE_CONTROL, charge_command_charge_control,
 static void reset_current_limit(void)
 {
 	user_current_limit = -1U;
+	charge_set_dirty(CHARGE_DIRTY_LIMIT);
 }
 DECLARE_HOOK(HOOK_CHIPSET_SUSPEND, reset_current_limit, HOOK_PRIO_DEFAULT);
 DECLARE_HOOK(HOOK_CHIPSET_SHUTDOWN, reset_current_limit, HOOK_PRIO_DEFAULT);
@@ -2647,6 +2730,7 @@ charge_command_current_limit(struct host_cmd_handler_args *args)
 	const struct ec_params_current_limit *p = args->params;
 
 	user_current_limit = p->limit;
+	charge_set_dirty(CHARGE_DIRTY_LIMIT);
 
 	return EC_RES_SUCCESS;
 }
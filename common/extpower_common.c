@@ -6,6 +6,7 @@
 #include "extpower.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "memmap.h"
 
 void extpower_handle_update(int is_present)
 {
@@ -15,11 +16,15 @@ void extpower_handle_update(int is_present)
 	memmap_batt_flags = host_get_memmap(EC_MEMMAP_BATT_FLAG);
 
 	/* Forward notification to host */
-	if (is_present) {
+	memmap_write_begin(MEMMAP_BLOCK_BATTERY);
+	if (is_present)
 		*memmap_batt_flags |= EC_BATT_FLAG_AC_PRESENT;
-		host_set_single_event(EC_HOST_EVENT_AC_CONNECTED);
-	} else {
+	else
 		*memmap_batt_flags &= ~EC_BATT_FLAG_AC_PRESENT;
+	memmap_write_end(MEMMAP_BLOCK_BATTERY);
+
+	if (is_present)
+		host_set_single_event(EC_HOST_EVENT_AC_CONNECTED);
+	else
 		host_set_single_event(EC_HOST_EVENT_AC_DISCONNECTED);
-	}
 }
@@ -10,6 +10,7 @@
 #include "gpio.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "memmap.h"
 #include "timer.h"
 
 static int debounced_extpower_presence;
@@ -49,10 +50,12 @@ static void extpower_init(void)
 	debounced_extpower_presence = gpio_get_level(GPIO_AC_PRESENT);
 
 	/* Initialize the memory-mapped AC_PRESENT flag */
+	memmap_write_begin(MEMMAP_BLOCK_BATTERY);
 	if (debounced_extpower_presence)
 		*memmap_batt_flags |= EC_BATT_FLAG_AC_PRESENT;
 	else
 		*memmap_batt_flags &= ~EC_BATT_FLAG_AC_PRESENT;
+	memmap_write_end(MEMMAP_BLOCK_BATTERY);
 
 	/* Enable interrupts, now that we've initialized */
 	gpio_enable_interrupt(GPIO_AC_PRESENT);
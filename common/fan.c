@@ -75,6 +75,46 @@ int fan_percent_to_rpm(int fan, int pct)
 }
 #endif	/* CONFIG_FAN_RPM_CUSTOM */
 
+static int fan_pid_output(const struct fan_pid_params *p,
+			  const struct fan_pid_state *s, int ff_duty,
+			  int error, int integral, int actual_rpm)
+{
+	return ff_duty + (p->kp * error + p->ki * integral -
+			  p->kd * (actual_rpm - s->prev_rpm)) / FAN_PID_SCALE;
+}
+
+int fan_pid_update(const struct fan_pid_params *p, struct fan_pid_state *s,
+		   int ff_duty, int target_rpm, int actual_rpm)
+{
+	int error = target_rpm - actual_rpm;
+	int integral = s->integral;
+	int out;
+
+	if (!target_rpm) {
+		memset(s, 0, sizeof(*s));
+		return CLAMP(ff_duty, 0, 100);
+	}
+
+	/* Let the fan ramp to a new target before integrating */
+	if (target_rpm == s->prev_target)
+		integral = CLAMP(integral + error, -p->i_max, p->i_max);
+
+	out = fan_pid_output(p, s, ff_duty, error, integral, actual_rpm);
+
+	/* Don't wind up pushing against a saturated output */
+	if ((out > 100 && error > 0) || (out < 0 && error < 0)) {
+		integral = s->integral;
+		out = fan_pid_output(p, s, ff_duty, error, integral,
+				     actual_rpm);
+	}
+
+	s->integral = integral;
+	s->prev_rpm = actual_rpm;
+	s->prev_target = target_rpm;
+
+	return CLAMP(out, 0, 100);
+}
+
 /* The thermal task will only call this function with pct in [0,100]. */
 test_mockable void fan_set_percent_needed(int fan, int pct)
 {
@@ -601,9 +641,11 @@ static void pwm_fan_stop(void)
 	 * continuing to run CPU heavy tasks for value added features
 	 * causing excessive heat.
 	 */
+#ifdef CONFIG_POWER_S0IX
 	if (power_get_state() == POWER_S0ix ||
 		power_get_state() == POWER_S0S0ix)
 		return;
+#endif
 
 	pwm_fan_control(0); /* crosbug.com/p/8097 */
 }
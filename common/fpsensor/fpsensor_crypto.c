@@ -11,6 +11,7 @@
 #include "fpsensor_private.h"
 #include "fpsensor_state.h"
 #include "rollback.h"
+#include "shared_mem.h"
 
 #if !defined(CONFIG_AES) || !defined(CONFIG_AES_GCM) || \
 	!defined(CONFIG_ROLLBACK_SECRET_SIZE)
@@ -216,6 +217,48 @@ int derive_encryption_key(uint8_t *out_key, const uint8_t *salt)
 	return ret;
 }
 
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+/*
+ * With 8-bit GHASH tables the context is over 4 KiB, too much for the stacks
+ * of the tasks handling templates, so it is borrowed from shared memory.
+ */
+static int gcm_ctx_acquire(GCM128_CONTEXT **ctx)
+{
+	int res = shared_mem_acquire(sizeof(**ctx), (char **)ctx);
+
+	if (res)
+		CPRINTS("No memory for GCM context: %d", res);
+	return res;
+}
+
+static void gcm_ctx_release(GCM128_CONTEXT *ctx)
+{
+	shared_mem_release(ctx);
+}
+#endif
+
+static int gcm_encrypt(GCM128_CONTEXT *ctx, const AES_KEY *aes_key,
+		       const uint8_t *in, uint8_t *out, int len)
+{
+#ifdef CONFIG_AES_GCM_CTR32
+	return CRYPTO_gcm128_encrypt_ctr32(ctx, aes_key, in, out, len,
+					   (ctr128_f)AES_ctr32_encrypt_blocks);
+#else
+	return CRYPTO_gcm128_encrypt(ctx, aes_key, in, out, len);
+#endif
+}
+
+static int gcm_decrypt(GCM128_CONTEXT *ctx, const AES_KEY *aes_key,
+		       const uint8_t *in, uint8_t *out, int len)
+{
+#ifdef CONFIG_AES_GCM_CTR32
+	return CRYPTO_gcm128_decrypt_ctr32(ctx, aes_key, in, out, len,
+					   (ctr128_f)AES_ctr32_encrypt_blocks);
+#else
+	return CRYPTO_gcm128_decrypt(ctx, aes_key, in, out, len);
+#endif
+}
+
 int aes_gcm_encrypt(const uint8_t *key, int key_size,
 		    const uint8_t *plaintext,
 		    uint8_t *ciphertext, int text_size,
@@ -224,7 +267,11 @@ int aes_gcm_encrypt(const uint8_t *key, int key_size,
 {
 	int res;
 	AES_KEY aes_key;
-	GCM128_CONTEXT ctx;
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+	GCM128_CONTEXT *ctx;
+#else
+	GCM128_CONTEXT ctx_buf, *ctx = &ctx_buf;
+#endif
 
 	if (nonce_size != FP_CONTEXT_NONCE_BYTES) {
 		CPRINTS("Invalid nonce size %d bytes", nonce_size);
@@ -236,16 +283,24 @@ int aes_gcm_encrypt(const uint8_t *key, int key_size,
 		CPRINTS("Failed to set encryption key: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
-	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
-	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+	res = gcm_ctx_acquire(&ctx);
+	if (res)
+		return res;
+#endif
+	CRYPTO_gcm128_init(ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(ctx, &aes_key, nonce, nonce_size);
 	/* CRYPTO functions return 1 on success, 0 on error. */
-	res = CRYPTO_gcm128_encrypt(&ctx, &aes_key, plaintext, ciphertext,
-				    text_size);
+	res = gcm_encrypt(ctx, &aes_key, plaintext, ciphertext, text_size);
+	if (res)
+		CRYPTO_gcm128_tag(ctx, tag, tag_size);
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+	gcm_ctx_release(ctx);
+#endif
 	if (!res) {
 		CPRINTS("Failed to encrypt: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
-	CRYPTO_gcm128_tag(&ctx, tag, tag_size);
 	return EC_SUCCESS;
 }
 
@@ -256,7 +311,11 @@ int aes_gcm_decrypt(const uint8_t *key, int key_size, uint8_t *plaintext,
 {
 	int res;
 	AES_KEY aes_key;
-	GCM128_CONTEXT ctx;
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+	GCM128_CONTEXT *ctx;
+#else
+	GCM128_CONTEXT ctx_buf, *ctx = &ctx_buf;
+#endif
 
 	if (nonce_size != FP_CONTEXT_NONCE_BYTES) {
 		CPRINTS("Invalid nonce size %d bytes", nonce_size);
@@ -268,19 +327,26 @@ int aes_gcm_decrypt(const uint8_t *key, int key_size, uint8_t *plaintext,
 		CPRINTS("Failed to set decryption key: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
-	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
-	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+	res = gcm_ctx_acquire(&ctx);
+	if (res)
+		return res;
+#endif
+	CRYPTO_gcm128_init(ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(ctx, &aes_key, nonce, nonce_size);
 	/* CRYPTO functions return 1 on success, 0 on error. */
-	res = CRYPTO_gcm128_decrypt(&ctx, &aes_key, ciphertext, plaintext,
-				    text_size);
+	res = gcm_decrypt(ctx, &aes_key, ciphertext, plaintext, text_size);
 	if (!res) {
 		CPRINTS("Failed to decrypt: %d", res);
-		return EC_ERROR_UNKNOWN;
+		res = EC_ERROR_UNKNOWN;
+	} else if (!CRYPTO_gcm128_finish(ctx, tag, tag_size)) {
+		CPRINTS("Found incorrect tag");
+		res = EC_ERROR_UNKNOWN;
+	} else {
+		res = EC_SUCCESS;
 	}
-	res = CRYPTO_gcm128_finish(&ctx, tag, tag_size);
-	if (!res) {
-		CPRINTS("Found incorrect tag: %d", res);
-		return EC_ERROR_UNKNOWN;
-	}
-	return EC_SUCCESS;
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+	gcm_ctx_release(ctx);
+#endif
+	return res;
 }
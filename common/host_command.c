@@ -10,6 +10,7 @@
 #include "console.h"
 #include "ec_commands.h"
 #include "host_command.h"
+#include "memmap.h"
 #include "link_defs.h"
 #include "lpc.h"
 #include "lpc_chip.h"
@@ -421,7 +422,7 @@ static void host_command_init(void)
 	/* Initialize memory map ID area */
 	host_get_memmap(EC_MEMMAP_ID)[0] = 'E';
 	host_get_memmap(EC_MEMMAP_ID)[1] = 'C';
-	*host_get_memmap(EC_MEMMAP_ID_VERSION) = 1;
+	*host_get_memmap(EC_MEMMAP_ID_VERSION) = 2;
 	*host_get_memmap(EC_MEMMAP_EVENTS_VERSION) = 1;
 #ifdef CONFIG_EMI_REGION1
 	*host_get_customer_memmap(0x20) = 'A'; /* for testing */
@@ -551,7 +552,7 @@ host_command_read_memmap(struct host_cmd_handler_args *args)
 	    *host_get_memmap(EC_MEMMAP_SWITCHES_VERSION) == 0)
 		return EC_RES_UNAVAILABLE;
 
-	memcpy(args->response, host_get_memmap(offset), size);
+	memmap_read(offset, args->response, size);
 	args->response_size = size;
 
 	return EC_RES_SUCCESS;
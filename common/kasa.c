@@ -37,6 +37,41 @@ void kasa_accumulate(struct kasa_fit *kasa, fp_t x, fp_t y, fp_t z)
 	kasa->nsamples += 1;
 }
 
+void kasa_accumulate_batch(struct kasa_fit *kasa, const fp_t *x,
+			   const fp_t *y, const fp_t *z, int n)
+{
+	/* Sum in locals, so they stay in registers across the batch */
+	struct kasa_fit acc = *kasa;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		const fp_t xx = fp_sq(x[i]);
+		const fp_t yy = fp_sq(y[i]);
+		const fp_t zz = fp_sq(z[i]);
+		const fp_t w = xx + yy + zz;
+
+		acc.acc_x += x[i];
+		acc.acc_y += y[i];
+		acc.acc_z += z[i];
+		acc.acc_w += w;
+
+		acc.acc_xx += xx;
+		acc.acc_xy += fp_mul(x[i], y[i]);
+		acc.acc_xz += fp_mul(x[i], z[i]);
+		acc.acc_xw += fp_mul(x[i], w);
+
+		acc.acc_yy += yy;
+		acc.acc_yz += fp_mul(y[i], z[i]);
+		acc.acc_yw += fp_mul(y[i], w);
+
+		acc.acc_zz += zz;
+		acc.acc_zw += fp_mul(z[i], w);
+	}
+	acc.nsamples += n;
+
+	*kasa = acc;
+}
+
 void kasa_compute(struct kasa_fit *kasa, fpv3_t bias, fp_t *radius)
 {
 	/*    A    *   out   =    b
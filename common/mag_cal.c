@@ -114,14 +114,14 @@ void init_mag_cal(struct mag_cal_t *moc)
 	kasa_reset(&moc->kasa_fit);
 }
 
-int mag_cal_update(struct mag_cal_t *moc, const intv3_t v)
+/*
+ * Once the batch has enough samples, try to compute a new bias from it and
+ * start the next batch.
+ */
+static int mag_cal_end_batch(struct mag_cal_t *moc)
 {
 	int new_bias = 0;
 
-	/* 1. run accumulators */
-	kasa_accumulate(&moc->kasa_fit, INT_TO_FP(v[X]), INT_TO_FP(v[Y]),
-			INT_TO_FP(v[Z]));
-
 	/* 2. batch has enough samples? */
 	if (moc->batch_size > 0 && moc->kasa_fit.nsamples >= moc->batch_size) {
 		/* 3. eigen test */
@@ -147,3 +147,46 @@ int mag_cal_update(struct mag_cal_t *moc, const intv3_t v)
 
 	return new_bias;
 }
+
+int mag_cal_update(struct mag_cal_t *moc, const intv3_t v)
+{
+	/* 1. run accumulators */
+	kasa_accumulate(&moc->kasa_fit, INT_TO_FP(v[X]), INT_TO_FP(v[Y]),
+			INT_TO_FP(v[Z]));
+
+	return mag_cal_end_batch(moc);
+}
+
+/* Samples converted to fixed-point at a time by mag_cal_update_batch() */
+#define MAG_CAL_CHUNK 16
+
+int mag_cal_update_batch(struct mag_cal_t *moc, const int *x, const int *y,
+			 const int *z, int n)
+{
+	fp_t fx[MAG_CAL_CHUNK], fy[MAG_CAL_CHUNK], fz[MAG_CAL_CHUNK];
+	int new_bias = 0;
+	int i, count;
+
+	while (n > 0) {
+		count = MIN(n, MAG_CAL_CHUNK);
+		/* Stop where the batch is complete, like mag_cal_update() */
+		if (moc->batch_size > 0)
+			count = CLAMP((int)moc->batch_size -
+				      (int)moc->kasa_fit.nsamples, 1, count);
+
+		for (i = 0; i < count; i++) {
+			fx[i] = INT_TO_FP(x[i]);
+			fy[i] = INT_TO_FP(y[i]);
+			fz[i] = INT_TO_FP(z[i]);
+		}
+		kasa_accumulate_batch(&moc->kasa_fit, fx, fy, fz, count);
+		new_bias |= mag_cal_end_batch(moc);
+
+		x += count;
+		y += count;
+		z += count;
+		n -= count;
+	}
+
+	return new_bias;
+}
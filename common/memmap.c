@@ -0,0 +1,130 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Publishing data in the host memory map.
+ *
+ * The host reads the memory map without telling the EC, a byte or a word at
+ * a time, so data written piecemeal may be read half updated. The thermal
+ * and battery blocks are instead staged and copied in with one update, which
+ * makes their generation byte odd for the length of the copy. The host reads
+ * a block's generation before and after the data, and reads again if they
+ * differ or are odd (see EC_MEMMAP_THERMAL_GEN). Interrupts are disabled for
+ * the copy, unless it is made by one, so readers on the EC, such as the ACPI
+ * port, never see it half done.
+ */
+
+#include "common.h"
+#include "host_command.h"
+#include "memmap.h"
+#include "task.h"
+#include "util.h"
+
+BUILD_ASSERT(sizeof(struct memmap_battery) ==
+	     EC_MEMMAP_BATT_TYPE + EC_MEMMAP_TEXT_MAX - EC_MEMMAP_BATT_VOLT);
+BUILD_ASSERT(offsetof(struct memmap_battery, flag) ==
+	     EC_MEMMAP_BATT_FLAG - EC_MEMMAP_BATT_VOLT);
+BUILD_ASSERT(offsetof(struct memmap_battery, index) ==
+	     EC_MEMMAP_BATT_INDEX - EC_MEMMAP_BATT_VOLT);
+BUILD_ASSERT(offsetof(struct memmap_battery, dcap) ==
+	     EC_MEMMAP_BATT_DCAP - EC_MEMMAP_BATT_VOLT);
+BUILD_ASSERT(offsetof(struct memmap_battery, mfgr) ==
+	     EC_MEMMAP_BATT_MFGR - EC_MEMMAP_BATT_VOLT);
+BUILD_ASSERT(offsetof(struct memmap_battery, serial) ==
+	     EC_MEMMAP_BATT_SERIAL - EC_MEMMAP_BATT_VOLT);
+
+static const uint8_t gen_offset[] = {
+	[MEMMAP_BLOCK_THERMAL] = EC_MEMMAP_THERMAL_GEN,
+	[MEMMAP_BLOCK_BATTERY] = EC_MEMMAP_BATTERY_GEN,
+};
+BUILD_ASSERT(ARRAY_SIZE(gen_offset) == MEMMAP_BLOCK_COUNT);
+
+/* Whether interrupts were enabled when a task started updating a block */
+static uint8_t irq_was_enabled[MEMMAP_BLOCK_COUNT];
+
+static volatile uint8_t *gen_byte(enum memmap_block block)
+{
+	return host_get_memmap(gen_offset[block]);
+}
+
+void memmap_write_begin(enum memmap_block block)
+{
+	if (!in_interrupt_context()) {
+		irq_was_enabled[block] = is_interrupt_enabled();
+		interrupt_disable();
+	}
+	(*gen_byte(block))++;
+	/* The host must see the odd generation before any of the data */
+	__sync_synchronize();
+}
+
+void memmap_write_end(enum memmap_block block)
+{
+	__sync_synchronize();
+	(*gen_byte(block))++;
+	if (!in_interrupt_context() && irq_was_enabled[block])
+		interrupt_enable();
+}
+
+void memmap_publish(enum memmap_block block, int offset, const void *data,
+		    int size)
+{
+	memmap_write_begin(block);
+	memcpy(host_get_memmap(offset), data, size);
+	memmap_write_end(block);
+}
+
+void memmap_publish_battery(const struct memmap_battery *batt,
+			    uint8_t staged_flag)
+{
+	volatile uint8_t *flag = host_get_memmap(EC_MEMMAP_BATT_FLAG);
+	uint8_t changed;
+
+	memmap_write_begin(MEMMAP_BLOCK_BATTERY);
+	/* Leave the count and index to battery.c */
+	memcpy(host_get_memmap(EC_MEMMAP_BATT_VOLT), batt,
+	       offsetof(struct memmap_battery, flag));
+	memcpy(host_get_memmap(EC_MEMMAP_BATT_DCAP), &batt->dcap,
+	       sizeof(*batt) - offsetof(struct memmap_battery, dcap));
+	/* Keep the flags updated by others since the block was staged */
+	changed = *flag ^ staged_flag;
+	*flag = (batt->flag & ~changed) | (*flag & changed);
+	memmap_write_end(MEMMAP_BLOCK_BATTERY);
+}
+
+void memmap_stage_battery(struct memmap_battery *batt)
+{
+	memcpy(batt, host_get_memmap(EC_MEMMAP_BATT_VOLT), sizeof(*batt));
+}
+
+int memmap_read(int offset, void *data, int size)
+{
+	uint8_t gen[MEMMAP_BLOCK_COUNT];
+	int retries = 0;
+	int i;
+
+	/*
+	 * Updates can't be interrupted, so the generations are never odd
+	 * here, but one may preempt the copy. Retry until none came between.
+	 */
+	while (1) {
+		for (i = 0; i < MEMMAP_BLOCK_COUNT; i++)
+			gen[i] = *gen_byte(i);
+		__sync_synchronize();
+		memcpy(data, host_get_memmap(offset), size);
+		__sync_synchronize();
+		for (i = 0; i < MEMMAP_BLOCK_COUNT; i++)
+			if (gen[i] != *gen_byte(i))
+				break;
+		if (i == MEMMAP_BLOCK_COUNT)
+			return retries;
+		retries++;
+	}
+}
+
+uint8_t memmap_generation(enum memmap_block block)
+{
+	return *gen_byte(block);
+}
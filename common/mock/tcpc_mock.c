@@ -140,6 +140,8 @@ static int mock_get_message_raw(int port, uint32_t *payload, int *head)
 static int mock_transmit(int port, enum tcpm_transmit_type type,
 			 uint16_t header, const uint32_t *data)
 {
+	mock_tcpc.last.tx_header = header;
+	mock_tcpc.last.tx_data = data;
 	return EC_SUCCESS;
 }
 
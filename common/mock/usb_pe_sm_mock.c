@@ -79,7 +79,6 @@ void pe_got_soft_reset(int port)
 
 bool pe_in_local_ams(int port)
 {
-	/* We will probably want to change this in the future */
-	return false;
+	return mock_pe_port[port].mock_in_local_ams;
 }
 
@@ -7,6 +7,7 @@
 #include <string.h>
 #include "common.h"
 #include "usb_emsg.h"
+#include "usb_pd_timing.h"
 #include "usb_pe_sm.h"
 #include "usb_prl_sm.h"
 #include "mock/usb_prl_mock.h"
@@ -73,12 +74,14 @@ void prl_send_ctrl_msg(int port, enum tcpm_transmit_type type,
 	enum pd_ctrl_msg_type msg)
 {
 	mock_prl_port[port].last_ctrl_msg = msg;
+	pd_timing_tx(port, PD_HEADER(msg, 0, 0, 0, 0, PD_REV30, 0));
 }
 
 void prl_send_data_msg(int port, enum tcpm_transmit_type type,
 	enum pd_data_msg_type msg)
 {
 	mock_prl_port[port].last_data_msg_type = msg;
+	pd_timing_tx(port, PD_HEADER(msg, 0, 0, 0, 1, PD_REV30, 0));
 }
 
 void prl_send_ext_data_msg(int port, enum tcpm_transmit_type type,
@@ -123,6 +126,8 @@ void fake_prl_message_sent(int port)
 
 void fake_prl_message_received(int port)
 {
+	/* The TCPC would raise an alert for it */
+	pd_timing_alert(port);
 	mock_prl_port[port].message_received = 1;
 }
 
@@ -135,11 +140,13 @@ void prl_run(int port, int evt, int en)
 {
 	if (mock_prl_port[port].message_sent) {
 		ccprints("message_sent");
+		pd_timing_tx_done(port, TCPC_TX_COMPLETE_SUCCESS);
 		pe_message_sent(port);
 		mock_prl_port[port].message_sent = 0;
 	}
 	if (mock_prl_port[port].message_received) {
 		ccprints("message_received");
+		pd_timing_rx(port, rx_emsg[port].header);
 		pe_message_received(port);
 		mock_prl_port[port].message_received = 0;
 	}
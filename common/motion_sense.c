@@ -527,32 +527,32 @@ static inline void set_present(uint8_t *lpc_status)
 static inline void update_sense_data(uint8_t *lpc_status, int *psample_id)
 {
 	int s, d, i;
+	/* Lid angle, then two accelerometers and a gyroscope */
+	int16_t data[1 + 3 * 3];
 	int16_t *lpc_data = (int16_t *)host_get_memmap(EC_MEMMAP_ACC_DATA);
 #if (!defined HAS_TASK_ALS) && (defined CONFIG_ALS)
+	uint16_t als[EC_ALS_ENTRIES];
 	uint16_t *lpc_als = (uint16_t *)host_get_memmap(EC_MEMMAP_ALS);
 #endif
 	struct motion_sensor_t *sensor;
+
 	/*
-	 * Set the busy bit before writing the sensor data. Increment
-	 * the counter and clear the busy bit after writing the sensor
-	 * data. On the host side, the host needs to make sure the busy
-	 * bit is not set and that the counter remains the same before
-	 * and after reading the data.
+	 * Stage the data first, so the busy bit below is only set for
+	 * the copy. Entries without a sensor keep their last value.
 	 */
-	*lpc_status |= EC_MEMMAP_ACC_STATUS_BUSY_BIT;
+	memcpy(data, lpc_data, sizeof(data));
 
 	/*
-	 * Copy sensor data to shared memory. Note that this code
-	 * assumes little endian, which is what the host expects. Also,
-	 * note that we share the lid angle calculation with host only
-	 * for debugging purposes. The EC lid angle is an approximation
-	 * with uncalibrated accelerometers. The AP calculates a separate,
-	 * more accurate lid angle.
+	 * Note that this code assumes little endian, which is what the
+	 * host expects. Also, note that we share the lid angle
+	 * calculation with host only for debugging purposes. The EC lid
+	 * angle is an approximation with uncalibrated accelerometers. The
+	 * AP calculates a separate, more accurate lid angle.
 	 */
 #ifdef CONFIG_LID_ANGLE
-	lpc_data[0] = motion_lid_get_angle();
+	data[0] = motion_lid_get_angle();
 #else
-	lpc_data[0] = LID_ANGLE_UNRELIABLE;
+	data[0] = LID_ANGLE_UNRELIABLE;
 #endif
 	/*
 	 * The first 2 entries must be accelerometers, then gyroscope.
@@ -567,16 +567,30 @@ static inline void update_sense_data(uint8_t *lpc_status, int *psample_id)
 			d = 2;
 
 		for (i = X; i <= Z; i++)
-			lpc_data[1 + i + 3 * d] =
+			data[1 + i + 3 * d] =
 				ec_motion_sensor_clamp_i16(sensor->xyz[i]);
 	}
 
 #if (!defined HAS_TASK_ALS) && (defined CONFIG_ALS)
+	memcpy(als, lpc_als, sizeof(als));
 	for (i = 0; i < EC_ALS_ENTRIES && i < ALS_COUNT; i++)
-		lpc_als[i] = ec_motion_sensor_clamp_u16(
+		als[i] = ec_motion_sensor_clamp_u16(
 				motion_als_sensors[i]->xyz[X]);
 #endif
 
+	/*
+	 * Set the busy bit before copying the sensor data. Increment
+	 * the counter and clear the busy bit after copying the sensor
+	 * data. On the host side, the host needs to make sure the busy
+	 * bit is not set and that the counter remains the same before
+	 * and after reading the data.
+	 */
+	*lpc_status |= EC_MEMMAP_ACC_STATUS_BUSY_BIT;
+	memcpy(lpc_data, data, sizeof(data));
+#if (!defined HAS_TASK_ALS) && (defined CONFIG_ALS)
+	memcpy(lpc_als, als, sizeof(als));
+#endif
+
 	/*
 	 * Increment sample id and clear busy bit to signal we finished
 	 * updating data.
@@ -1411,8 +1425,24 @@ static enum ec_status host_cmd_motion_sense(struct host_cmd_handler_args *args)
 		}
 #ifdef CONFIG_BODY_DETECTION
 		if (in->set_activity.activity ==
-		    MOTIONSENSE_ACTIVITY_BODY_DETECTION)
+		    MOTIONSENSE_ACTIVITY_BODY_DETECTION) {
+			const uint16_t *p = in->set_activity.parameters;
+			struct body_detect_params params = {
+				.var_threshold =
+				p[MOTIONSENSE_BODY_DETECTION_VAR_THRESHOLD],
+				.confidence_delta =
+				p[MOTIONSENSE_BODY_DETECTION_CONFIDENCE_DELTA],
+				.on_body_con =
+				p[MOTIONSENSE_BODY_DETECTION_CONFIDENCE] & 0xff,
+				.off_body_con =
+				p[MOTIONSENSE_BODY_DETECTION_CONFIDENCE] >> 8,
+			};
+
+			if ((p[0] || p[1] || p[2]) &&
+			    body_detect_set_params(&params))
+				return EC_RES_INVALID_PARAM;
 			body_detect_set_enable(in->set_activity.enable);
+		}
 #endif
 		if (ret != EC_RES_SUCCESS)
 			return ret;
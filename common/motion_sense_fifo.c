@@ -4,12 +4,14 @@
  */
 
 #include "accelgyro.h"
+#include "body_detection.h"
 #include "console.h"
 #include "hwtimer.h"
 #include "mkbp_event.h"
 #include "motion_sense_fifo.h"
 #include "tablet_mode.h"
 #include "task.h"
+#include "timer.h"
 #include "util.h"
 #include "math_util.h"
 #include "online_calibration.h"
@@ -218,6 +220,110 @@ static inline bool is_new_timestamp(uint8_t sensor_num)
 	       !(next_timestamp_initialized & BIT(sensor_num));
 }
 
+#ifdef CONFIG_BODY_DETECTION
+/** Last samples of the body detection sensor, for body_detect(). */
+static struct {
+	int x[BODY_DETECTION_BATCH_SIZE];
+	int y[BODY_DETECTION_BATCH_SIZE];
+	int head;
+	int count;
+} body_samples;
+
+static void body_samples_add(const struct motion_sensor_t *sensor,
+			     const struct ec_response_motion_sensor_data *data)
+{
+	if (sensor != &motion_sensors[CONFIG_BODY_DETECTION_SENSOR])
+		return;
+
+	body_samples.x[body_samples.head] = data->data[X];
+	body_samples.y[body_samples.head] = data->data[Y];
+	body_samples.head = (body_samples.head + 1) % BODY_DETECTION_BATCH_SIZE;
+	body_samples.count = MIN(body_samples.count + 1,
+				 BODY_DETECTION_BATCH_SIZE);
+}
+
+int motion_sense_fifo_get_body_samples(int *x, int *y, int max)
+{
+	int i, n, first;
+
+	mutex_lock(&g_sensor_mutex);
+	n = MIN(body_samples.count, max);
+	first = body_samples.head - n + BODY_DETECTION_BATCH_SIZE;
+	for (i = 0; i < n; i++) {
+		x[i] = body_samples.x[(first + i) % BODY_DETECTION_BATCH_SIZE];
+		y[i] = body_samples.y[(first + i) % BODY_DETECTION_BATCH_SIZE];
+	}
+	body_samples.count = 0;
+	mutex_unlock(&g_sensor_mutex);
+
+	return n;
+}
+#else
+static inline void body_samples_add(
+	const struct motion_sensor_t *sensor,
+	const struct ec_response_motion_sensor_data *data)
+{
+}
+#endif
+
+#ifdef CONFIG_ONLINE_CALIB
+/**
+ * Committed samples of one sensor, waiting to be passed to the online
+ * calibration together.
+ */
+static struct {
+	struct motion_sensor_t *sensor;
+	int x[ONLINE_CALIB_BATCH_SIZE];
+	int y[ONLINE_CALIB_BATCH_SIZE];
+	int z[ONLINE_CALIB_BATCH_SIZE];
+	uint32_t timestamp[ONLINE_CALIB_BATCH_SIZE];
+	int count;
+} calib_batch;
+
+static void calib_batch_flush(void)
+{
+	if (calib_batch.count)
+		online_calibration_process_batch(
+			calib_batch.sensor, calib_batch.x, calib_batch.y,
+			calib_batch.z, calib_batch.timestamp,
+			calib_batch.count);
+	calib_batch.count = 0;
+}
+
+/*
+ * Add a sample to the batch. The batch holds a single sensor, so the samples
+ * are still calibrated in the order they came in.
+ */
+static void calib_batch_add(const struct ec_response_motion_sensor_data *data,
+			    struct motion_sensor_t *sensor, uint32_t timestamp)
+{
+	int i = calib_batch.count;
+
+	if (i && (sensor != calib_batch.sensor ||
+		  i == ONLINE_CALIB_BATCH_SIZE)) {
+		calib_batch_flush();
+		i = 0;
+	}
+
+	calib_batch.sensor = sensor;
+	calib_batch.x[i] = data->data[X];
+	calib_batch.y[i] = data->data[Y];
+	calib_batch.z[i] = data->data[Z];
+	calib_batch.timestamp[i] = timestamp;
+	calib_batch.count = i + 1;
+}
+#else
+static inline void calib_batch_flush(void)
+{
+}
+
+static inline void calib_batch_add(
+	const struct ec_response_motion_sensor_data *data,
+	struct motion_sensor_t *sensor, uint32_t timestamp)
+{
+}
+#endif
+
 /**
  * Stage a single data unit to the motion sense fifo. Note that for the AP to
  * see this data, it must be committed.
@@ -238,6 +344,8 @@ static void fifo_stage_unit(
 
 	for (i = 0; i < valid_data; i++)
 		sensor->xyz[i] = data->data[i];
+	if (valid_data >= 2)
+		body_samples_add(sensor, data);
 
 	/*
 	 * For timestamps, update the next value of the sensor's timestamp
@@ -521,11 +629,10 @@ commit_data_end:
 
 		/* Update online calibration if enabled. */
 		data = peek_fifo_staged(i);
-		if (IS_ENABLED(CONFIG_ONLINE_CALIB))
-			online_calibration_process_data(
-				data, &motion_sensors[sensor_num],
+		calib_batch_add(data, &motion_sensors[sensor_num],
 				next_timestamp[sensor_num].prev);
 	}
+	calib_batch_flush();
 
 	/* Advance the tail and clear the staged metadata. */
 	queue_advance_tail(&fifo, fifo_staged.count);
@@ -590,6 +697,130 @@ int motion_sense_fifo_read(int capacity_bytes, int max_count, void *out,
 	return count;
 }
 
+#ifdef CONFIG_ACCEL_FIFO_DRAIN_STATS
+static void drain_stats_add(struct motion_sensor_t *s, int bursts, int bytes,
+			    int frames, uint32_t read_us, uint32_t decode_us)
+{
+	struct motion_sense_fifo_drain_stats *stats = &s->drain_stats[0];
+
+	stats->drains++;
+	stats->bursts += bursts;
+	stats->bytes += bytes;
+	stats->frames += frames;
+	stats->read_us_total += read_us;
+	stats->read_us_max = MAX(stats->read_us_max, read_us);
+	stats->decode_us_total += decode_us;
+	stats->decode_us_max = MAX(stats->decode_us_max, decode_us);
+}
+
+static int command_fifo_drain(int argc, char **argv)
+{
+	struct motion_sense_fifo_drain_stats *stats;
+	int i;
+
+	for (i = 0; i < motion_sensor_count; i++) {
+		stats = &motion_sensors[i].drain_stats[0];
+		if (argc > 1 && !strcasecmp(argv[1], "clear")) {
+			memset(stats, 0, sizeof(*stats));
+			continue;
+		}
+		if (!stats->drains)
+			continue;
+		ccprintf("%d: %u drains, %u bursts, %u bytes, %u frames\n", i,
+			 stats->drains, stats->bursts, stats->bytes,
+			 stats->frames);
+		ccprintf("   read %u us avg, %u us max; "
+			 "decode %u us avg, %u us max\n",
+			 stats->read_us_total / stats->drains,
+			 stats->read_us_max,
+			 stats->decode_us_total / stats->drains,
+			 stats->decode_us_max);
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(fifodrain, command_fifo_drain,
+			"[clear]",
+			"Print/clear hardware FIFO drain counters");
+#else
+static inline void drain_stats_add(struct motion_sensor_t *s, int bursts,
+				   int bytes, int frames, uint32_t read_us,
+				   uint32_t decode_us)
+{
+}
+#endif
+
+int motion_sense_fifo_drain(struct motion_sensor_t *s,
+			    const struct motion_sense_fifo_layout *layout,
+			    uint32_t last_ts)
+{
+	static uint8_t buf[CONFIG_ACCEL_FIFO_DRAIN_SIZE];
+	int max = sizeof(buf);
+	int remaining, kept = 0, end, pos, n, ret;
+	int bursts = 0, bytes = 0, frames = 0;
+	uint32_t read_us = 0, decode_us = 0, start;
+
+	ret = layout->get_length(s, &remaining);
+	if (ret || !remaining)
+		return ret;
+
+	remaining += layout->extra;
+	if (layout->max_burst)
+		max = MIN(max, layout->max_burst);
+
+	while (remaining > 0) {
+		/* Read as much as fits after the start of a cut frame */
+		n = MIN(remaining, max - kept);
+		start = get_time().le.lo;
+		ret = layout->read(s, buf + kept, n);
+		read_us += get_time().le.lo - start;
+		if (ret)
+			break;
+		bursts++;
+		bytes += n;
+		remaining -= n;
+		end = kept + n;
+
+		if (bursts == 1 && layout->check && layout->check(s, buf, end))
+			break;
+
+		/* Decode the whole frames it holds */
+		start = get_time().le.lo;
+		for (pos = 0; pos < end; pos += n) {
+			n = layout->decode(s, buf + pos, end - pos, last_ts);
+			if (n <= 0)
+				break;
+			frames++;
+		}
+		decode_us += get_time().le.lo - start;
+		if (n < 0) {
+			if (n != -1)
+				ret = -n;
+			break;
+		}
+
+		/*
+		 * A frame was cut by the end of the read, unless it is a frame
+		 * which doesn't fit in the buffer at all.
+		 */
+		kept = end - pos;
+		if (kept == max)
+			break;
+		if (layout->resends_partial) {
+			/* Read it again, unless the FIFO has no more of it */
+			if (!remaining)
+				break;
+			remaining += kept;
+			kept = 0;
+		} else {
+			memmove(buf, buf + pos, kept);
+		}
+	}
+
+	drain_stats_add(s, bursts, bytes, frames, read_us, decode_us);
+	return ret;
+}
+
 void motion_sense_fifo_reset(void)
 {
 	next_timestamp_initialized = 0;
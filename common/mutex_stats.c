@@ -0,0 +1,94 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Mutex contention statistics */
+
+#include "common.h"
+#include "console.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+/*
+ * Mutexes locked so far. Not a list through the mutexes themselves, so that
+ * a mutex which is re-initialized while listed can't be listed twice.
+ */
+static struct mutex *mutexes[CONFIG_MUTEX_STATS_COUNT];
+static int mutex_count;
+/* Mutexes which didn't fit in the table, re-initialized ones maybe twice */
+static uint32_t untracked;
+
+static void list_mutex(struct mutex *mtx)
+{
+	int i;
+
+	interrupt_disable();
+	for (i = 0; i < mutex_count; i++)
+		if (mutexes[i] == mtx)
+			break;
+	/* Else it was re-initialized since it was listed */
+	if (i == mutex_count) {
+		if (mutex_count < ARRAY_SIZE(mutexes))
+			mutexes[mutex_count++] = mtx;
+		else
+			untracked++;
+	}
+	mtx->stats.listed = 1;
+	interrupt_enable();
+}
+
+void mutex_stats_locked(struct mutex *mtx, uint32_t wait_start,
+			int contended)
+{
+	struct mutex_stats *s = &mtx->stats;
+	uint32_t now = get_time().le.lo;
+	uint32_t wait = now - wait_start;
+
+	if (!s->listed)
+		list_mutex(mtx);
+
+	/*
+	 * Only the task holding the lock updates the statistics, from here
+	 * until mutex_unlock() releases it, so no need for atomics. Don't go
+	 * by mtx->owner, which the core sets only after taking the lock.
+	 */
+	s->locks++;
+	if (contended) {
+		s->contended++;
+		s->wait_us_total += wait;
+		s->wait_us_max = MAX(s->wait_us_max, wait);
+	}
+	s->hold_start = now;
+}
+
+void mutex_stats_unlocked(struct mutex *mtx)
+{
+	struct mutex_stats *s = &mtx->stats;
+	uint32_t hold = get_time().le.lo - s->hold_start;
+
+	s->hold_us_total += hold;
+	s->hold_us_max = MAX(s->hold_us_max, hold);
+}
+
+void mutex_stats_print(void)
+{
+	int i;
+
+	ccputs("Mutex       Locks  Waited  Wait avg/max (us)  Hold avg/max (us)\n");
+	for (i = 0; i < mutex_count; i++) {
+		const struct mutex *mtx = mutexes[i];
+		const struct mutex_stats *s = &mtx->stats;
+
+		ccprintf("%08x %8u %7u %8u %8u %8u %8u\n",
+			 (uint32_t)(uintptr_t)mtx, s->locks, s->contended,
+			 s->contended ? s->wait_us_total / s->contended : 0,
+			 s->wait_us_max,
+			 s->locks ? s->hold_us_total / s->locks : 0,
+			 s->hold_us_max);
+		cflush();
+	}
+	if (untracked)
+		ccprintf("%u more not tracked\n", untracked);
+}
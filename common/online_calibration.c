@@ -57,22 +57,33 @@ static int get_temperature(struct motion_sensor_t *sensor, int *temp)
 	return EC_SUCCESS;
 }
 
-static void data_int16_to_fp(const struct motion_sensor_t *s,
-			     const int16_t *data, fpv3_t out)
+/* Convert one axis of a batch of samples to fp, for the given range */
+static void data_int_to_fp_batch(fp_t range, const int *in, fp_t *out, int n)
 {
 	int i;
-	fp_t range = INT_TO_FP(s->drv->get_range(s));
 
-	for (i = 0; i < 3; ++i) {
-		fp_t v = INT_TO_FP((int32_t)data[i]);
+	for (i = 0; i < n; ++i) {
+		fp_t v = INT_TO_FP(in[i]);
 
-		out[i] = fp_div(v, INT_TO_FP((data[i] >= 0) ? 0x7fff : 0x8000));
+		out[i] = fp_div(v, INT_TO_FP((in[i] >= 0) ? 0x7fff : 0x8000));
 		out[i] = fp_mul(out[i], range);
 		/* Check for overflow */
 		out[i] = CLAMP(out[i], -range, range);
 	}
 }
 
+/* Convert a batch of samples to fp */
+static void data_to_fp_batch(const struct motion_sensor_t *s,
+			     const int *x, const int *y, const int *z,
+			     fp_t *fx, fp_t *fy, fp_t *fz, int n)
+{
+	fp_t range = INT_TO_FP(s->drv->get_range(s));
+
+	data_int_to_fp_batch(range, x, fx, n);
+	data_int_to_fp_batch(range, y, fy, n);
+	data_int_to_fp_batch(range, z, fz, n);
+}
+
 static void data_fp_to_int16(const struct motion_sensor_t *s, const fpv3_t data,
 			     int16_t *out)
 {
@@ -246,35 +257,48 @@ bool online_calibration_read(int sensor_num, int16_t out[3])
 	return has_valid;
 }
 
-int online_calibration_process_data(struct ec_response_motion_sensor_data *data,
-				    struct motion_sensor_t *sensor,
-				    uint32_t timestamp)
+/* Process a batch of at most ONLINE_CALIB_BATCH_SIZE samples */
+static int process_chunk(struct motion_sensor_t *sensor,
+			 const int *x, const int *y, const int *z,
+			 const uint32_t *timestamps, int n)
 {
 	size_t sensor_num = motion_sensors - sensor;
 	int rc;
 	int temperature;
 	struct online_calib_data *calib_data;
+	fp_t fx[ONLINE_CALIB_BATCH_SIZE];
+	fp_t fy[ONLINE_CALIB_BATCH_SIZE];
+	fp_t fz[ONLINE_CALIB_BATCH_SIZE];
+	int i;
 
 	calib_data = sensor->online_calib_data;
 	switch (sensor->type) {
 	case MOTIONSENSE_TYPE_ACCEL: {
 		struct accel_cal *cal =
 			(struct accel_cal *)(calib_data->type_specific_data);
-		fpv3_t fdata;
+		bool new_bias = false;
 
 		/* Convert data to fp. */
-		data_int16_to_fp(sensor, data->data, fdata);
-
-		/* Possibly update the gyroscope calibration. */
-		update_gyro_cal(sensor, fdata, timestamp);
+		data_to_fp_batch(sensor, x, y, z, fx, fy, fz, n);
 
 		/* Temperature is required for accelerometer calibration. */
 		rc = get_temperature(sensor, &temperature);
+
+		for (i = 0; i < n; i++) {
+			fpv3_t fdata = { fx[i], fy[i], fz[i] };
+
+			/* Possibly update the gyroscope calibration. */
+			update_gyro_cal(sensor, fdata, timestamps[i]);
+
+			if (rc == EC_SUCCESS &&
+			    accel_cal_accumulate(cal, timestamps[i], fx[i],
+						 fy[i], fz[i], temperature))
+				new_bias = true;
+		}
 		if (rc != EC_SUCCESS)
 			return rc;
 
-		if (accel_cal_accumulate(cal, timestamp, fdata[X], fdata[Y],
-					 fdata[Z], temperature)) {
+		if (new_bias) {
 			mutex_lock(&g_calib_cache_mutex);
 			/* Convert result to the right scale. */
 			data_fp_to_int16(sensor, cal->bias, calib_data->cache);
@@ -290,20 +314,18 @@ int online_calibration_process_data(struct ec_response_motion_sensor_data *data,
 	case MOTIONSENSE_TYPE_MAG: {
 		struct mag_cal_t *cal =
 			(struct mag_cal_t *)(calib_data->type_specific_data);
-		int idata[] = {
-			(int)data->data[X],
-			(int)data->data[Y],
-			(int)data->data[Z],
-		};
-		fpv3_t fdata;
 
 		/* Convert data to fp. */
-		data_int16_to_fp(sensor, data->data, fdata);
+		data_to_fp_batch(sensor, x, y, z, fx, fy, fz, n);
 
 		/* Possibly update the gyroscope calibration. */
-		update_gyro_cal(sensor, fdata, timestamp);
+		for (i = 0; i < n; i++) {
+			fpv3_t fdata = { fx[i], fy[i], fz[i] };
+
+			update_gyro_cal(sensor, fdata, timestamps[i]);
+		}
 
-		if (mag_cal_update(cal, idata)) {
+		if (mag_cal_update_batch(cal, x, y, z, n)) {
 			mutex_lock(&g_calib_cache_mutex);
 			/* Copy the values */
 			calib_data->cache[X] = cal->bias[X];
@@ -319,7 +341,8 @@ int online_calibration_process_data(struct ec_response_motion_sensor_data *data,
 		break;
 	}
 	case MOTIONSENSE_TYPE_GYRO: {
-		fpv3_t fdata;
+		struct gyro_cal *cal = &((struct gyro_cal_data *)
+			calib_data->type_specific_data)->gyro_cal;
 
 		/* Temperature is required for gyro calibration. */
 		rc = get_temperature(sensor, &temperature);
@@ -327,13 +350,14 @@ int online_calibration_process_data(struct ec_response_motion_sensor_data *data,
 			return rc;
 
 		/* Convert data to fp. */
-		data_int16_to_fp(sensor, data->data, fdata);
+		data_to_fp_batch(sensor, x, y, z, fx, fy, fz, n);
 
 		/* Update gyroscope calibration. */
-		gyro_cal_update_gyro(
-			&((struct gyro_cal_data *)calib_data->type_specific_data)->gyro_cal,
-			timestamp, fdata[X], fdata[Y], fdata[Z], temperature);
-		check_gyro_cal_new_bias(sensor);
+		for (i = 0; i < n; i++) {
+			gyro_cal_update_gyro(cal, timestamps[i], fx[i], fy[i],
+					     fz[i], temperature);
+			check_gyro_cal_new_bias(sensor);
+		}
 		break;
 	}
 	default:
@@ -342,3 +366,33 @@ int online_calibration_process_data(struct ec_response_motion_sensor_data *data,
 
 	return EC_SUCCESS;
 }
+
+int online_calibration_process_batch(struct motion_sensor_t *sensor,
+				     const int *x, const int *y, const int *z,
+				     const uint32_t *timestamps, int n)
+{
+	int count, rc = EC_SUCCESS;
+
+	for (; n > 0; n -= count) {
+		count = MIN(n, ONLINE_CALIB_BATCH_SIZE);
+		rc = process_chunk(sensor, x, y, z, timestamps, count);
+		x += count;
+		y += count;
+		z += count;
+		timestamps += count;
+	}
+
+	return rc;
+}
+
+int online_calibration_process_data(struct ec_response_motion_sensor_data *data,
+				    struct motion_sensor_t *sensor,
+				    uint32_t timestamp)
+{
+	const int x = data->data[X];
+	const int y = data->data[Y];
+	const int z = data->data[Z];
+
+	return online_calibration_process_batch(sensor, &x, &y, &z,
+						&timestamp, 1);
+}
@@ -8,8 +8,260 @@
 #include "chipset.h"
 #include "console.h"
 #include "peci.h"
+#include "task.h"
+#include "timer.h"
 #include "util.h"
 
+static struct peci_stats stats;
+
+static enum peci_stat_class stat_class(enum peci_command_code cmd)
+{
+	switch (cmd) {
+	case PECI_CMD_GET_TEMP:
+		return PECI_STAT_GET_TEMP;
+	case PECI_CMD_RD_PKG_CFG:
+		return PECI_STAT_RD_PKG_CFG;
+	case PECI_CMD_WR_PKG_CFG:
+		return PECI_STAT_WR_PKG_CFG;
+	default:
+		return PECI_STAT_OTHER;
+	}
+}
+
+/* Run a transaction on the bus, retrying on failure, and account for it. */
+static int peci_run(struct peci_data *peci, int retries)
+{
+	struct peci_cmd_stats *s = &stats.cmd[stat_class(peci->cmd_code)];
+	timestamp_t start = get_time();
+	uint32_t elapsed;
+	int rv;
+
+	while ((rv = peci_transaction(peci)) != EC_SUCCESS && retries-- > 0)
+		s->retries++;
+
+	elapsed = time_since32(start);
+	s->count++;
+	if (rv)
+		s->errors++;
+	s->total_us += elapsed;
+	if (elapsed > s->max_us)
+		s->max_us = elapsed;
+
+	return rv;
+}
+
+#ifdef CONFIG_PECI_QUEUE
+
+#define QUEUE_DEPTH CONFIG_PECI_QUEUE_DEPTH
+
+/* How long a caller waits for a queued transaction before giving up */
+#define PECI_QUEUE_WAIT_US (100 * MSEC)
+
+/* Caller blocked in peci_queue_transaction() */
+struct peci_waiter {
+	task_id_t task;
+	int done;
+	int rv;
+	uint8_t *r_buf;
+};
+
+struct peci_request {
+	struct peci_data peci;
+	uint8_t w_buf[PECI_WRITE_DATA_FIFO_SIZE];
+	uint8_t r_buf[PECI_READ_DATA_FIFO_SIZE];
+	int retries;
+	peci_done_cb done;
+	void *priv;
+	struct peci_waiter *waiter;
+	timestamp_t queued;
+};
+
+/*
+ * Requests are serviced in order from queue_head. The request at the head
+ * stays in the queue until it has completed, so that its buffers stay valid
+ * while the transaction and the callback run.
+ */
+static struct peci_request queue[QUEUE_DEPTH];
+static int queue_head;
+static int queue_count;
+static struct mutex queue_lock;
+
+/* Add a request to the queue. Call with queue_lock held. */
+static struct peci_request *queue_add(const struct peci_data *peci,
+				      int retries)
+{
+	struct peci_request *req;
+
+	if (peci->w_len > PECI_WRITE_DATA_FIFO_SIZE ||
+	    peci->r_len > PECI_READ_DATA_FIFO_SIZE)
+		return NULL;
+
+	if (queue_count == QUEUE_DEPTH) {
+		stats.queue_full++;
+		return NULL;
+	}
+
+	req = &queue[(queue_head + queue_count) % QUEUE_DEPTH];
+	queue_count++;
+	if (queue_count > stats.max_depth)
+		stats.max_depth = queue_count;
+
+	req->peci = *peci;
+	if (peci->w_len)
+		memcpy(req->w_buf, peci->w_buf, peci->w_len);
+	req->peci.w_buf = req->w_buf;
+	req->peci.r_buf = req->r_buf;
+	req->retries = retries;
+	req->done = NULL;
+	req->priv = NULL;
+	req->waiter = NULL;
+	req->queued = get_time();
+
+	return req;
+}
+
+int peci_queue_submit(const struct peci_data *peci, int retries,
+		      peci_done_cb done, void *priv)
+{
+	struct peci_request *req;
+
+	mutex_lock(&queue_lock);
+	req = queue_add(peci, retries);
+	if (req) {
+		req->done = done;
+		req->priv = priv;
+	}
+	mutex_unlock(&queue_lock);
+
+	if (!req)
+		return EC_ERROR_BUSY;
+
+	task_wake(TASK_ID_PECI);
+	return EC_SUCCESS;
+}
+
+int peci_queue_transaction(struct peci_data *peci, int retries)
+{
+	struct peci_waiter waiter = {
+		.task = task_get_current(),
+		.r_buf = peci->r_buf,
+	};
+	struct peci_request *req;
+	timestamp_t deadline;
+
+	/* Nothing to wait on before tasks run, or in the PECI task itself. */
+	if (!task_start_called() || waiter.task == TASK_ID_PECI)
+		return peci_run(peci, retries);
+
+	mutex_lock(&queue_lock);
+	req = queue_add(peci, retries);
+	if (req)
+		req->waiter = &waiter;
+	mutex_unlock(&queue_lock);
+
+	if (!req)
+		return EC_ERROR_BUSY;
+
+	task_wake(TASK_ID_PECI);
+
+	deadline.val = get_time().val + PECI_QUEUE_WAIT_US;
+	while (!waiter.done) {
+		int remaining = deadline.val - get_time().val;
+
+		if (remaining <= 0)
+			break;
+		task_wait_event_mask(TASK_EVENT_PECI_DONE, remaining);
+	}
+
+	mutex_lock(&queue_lock);
+	if (!waiter.done) {
+		/* Gave up. Don't let the PECI task touch our stack later. */
+		req->waiter = NULL;
+		waiter.rv = EC_ERROR_TIMEOUT;
+	}
+	mutex_unlock(&queue_lock);
+
+	return waiter.rv;
+}
+
+void peci_task(void *u)
+{
+	struct peci_request *req;
+	struct peci_waiter *w;
+	uint32_t wait;
+	int rv;
+
+	while (1) {
+		mutex_lock(&queue_lock);
+		req = queue_count ? &queue[queue_head] : NULL;
+		mutex_unlock(&queue_lock);
+
+		if (!req) {
+			task_wait_event(-1);
+			continue;
+		}
+
+		wait = time_since32(req->queued);
+		if (wait > stats.max_wait_us)
+			stats.max_wait_us = wait;
+
+		rv = peci_run(&req->peci, req->retries);
+
+		if (req->done)
+			req->done(rv, req->r_buf, req->priv);
+
+		mutex_lock(&queue_lock);
+		w = req->waiter;
+		if (w) {
+			if (req->peci.r_len)
+				memcpy(w->r_buf, req->r_buf, req->peci.r_len);
+			w->rv = rv;
+			w->done = 1;
+			task_set_event(w->task, TASK_EVENT_PECI_DONE, 0);
+		}
+		queue_head = (queue_head + 1) % QUEUE_DEPTH;
+		queue_count--;
+		mutex_unlock(&queue_lock);
+	}
+}
+
+#else /* !CONFIG_PECI_QUEUE */
+
+int peci_queue_submit(const struct peci_data *peci, int retries,
+		      peci_done_cb done, void *priv)
+{
+	struct peci_data p = *peci;
+	uint8_t r_buf[PECI_READ_DATA_FIFO_SIZE];
+	int rv;
+
+	if (p.r_len > PECI_READ_DATA_FIFO_SIZE)
+		return EC_ERROR_INVAL;
+
+	p.r_buf = r_buf;
+	rv = peci_run(&p, retries);
+	if (done)
+		done(rv, r_buf, priv);
+
+	return EC_SUCCESS;
+}
+
+int peci_queue_transaction(struct peci_data *peci, int retries)
+{
+	return peci_run(peci, retries);
+}
+
+#endif /* CONFIG_PECI_QUEUE */
+
+void peci_get_stats(struct peci_stats *out)
+{
+	*out = stats;
+}
+
+void peci_clear_stats(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
 static int peci_get_cpu_temp(int *cpu_temp)
 {
 	int rv;
@@ -24,7 +276,7 @@ static int peci_get_cpu_temp(int *cpu_temp)
 		.timeout_us = PECI_GET_TEMP_TIMEOUT_US,
 	};
 
-	rv = peci_transaction(&peci);
+	rv = peci_queue_transaction(&peci, 0);
 	if (rv)
 		return rv;
 
@@ -57,14 +309,28 @@ __overridable int stop_read_peci_temp(void)
 		return EC_SUCCESS;
 }
 
+/* Last good CPU temperature, reused for CONFIG_PECI_TEMP_CACHE_US */
+static int temp_cache;
+static int temp_cache_valid;
+static timestamp_t temp_cache_time;
+
 int peci_temp_sensor_get_val(int idx, int *temp_ptr)
 {
 	int i, rv;
 
 	rv = stop_read_peci_temp();
 
-	if (rv != EC_SUCCESS)
+	if (rv != EC_SUCCESS) {
+		temp_cache_valid = 0;
 		return rv;
+	}
+
+	if (CONFIG_PECI_TEMP_CACHE_US && temp_cache_valid &&
+	    time_since32(temp_cache_time) < CONFIG_PECI_TEMP_CACHE_US) {
+		stats.cmd[PECI_STAT_GET_TEMP].cache_hits++;
+		*temp_ptr = temp_cache;
+		return EC_SUCCESS;
+	}
 
 	/*
 	 * Retry reading PECI CPU temperature if the first sample is
@@ -76,6 +342,12 @@ int peci_temp_sensor_get_val(int idx, int *temp_ptr)
 			break;
 	}
 
+	temp_cache_valid = (rv == EC_SUCCESS);
+	if (temp_cache_valid) {
+		temp_cache = *temp_ptr;
+		temp_cache_time = get_time();
+	}
+
 	return rv;
 }
 
@@ -146,7 +418,7 @@ static int peci_cmd(int argc, char **argv)
 		peci.w_len = 0x00;
 	}
 
-	if (peci_transaction(&peci)) {
+	if (peci_queue_transaction(&peci, 0)) {
 		ccprintf("PECI transaction error\n");
 		return EC_ERROR_UNKNOWN;
 	}
@@ -172,4 +444,38 @@ static int command_peci_temp(int argc, char **argv)
 DECLARE_CONSOLE_COMMAND(pecitemp, command_peci_temp,
 			NULL,
 			"Print CPU temperature");
+
+static int command_peci_stats(int argc, char **argv)
+{
+	static const char * const name[PECI_STAT_COUNT] = {
+		[PECI_STAT_GET_TEMP] = "GetTemp",
+		[PECI_STAT_RD_PKG_CFG] = "RdPkgCfg",
+		[PECI_STAT_WR_PKG_CFG] = "WrPkgCfg",
+		[PECI_STAT_OTHER] = "Other",
+	};
+	struct peci_stats s;
+	int i;
+
+	if (argc > 1 && !strcasecmp(argv[1], "clear")) {
+		peci_clear_stats();
+		return EC_SUCCESS;
+	}
+
+	peci_get_stats(&s);
+	ccprintf("cmd       count  err  retry  cached  avg_us  max_us\n");
+	for (i = 0; i < PECI_STAT_COUNT; i++) {
+		const struct peci_cmd_stats *c = &s.cmd[i];
+
+		ccprintf("%-8s %6d %4d %6d %7d %7d %7d\n", name[i],
+			 c->count, c->errors, c->retries, c->cache_hits,
+			 c->count ? c->total_us / c->count : 0, c->max_us);
+	}
+	ccprintf("queue: max depth %d, full %d, max wait %d us\n",
+		 s.max_depth, s.queue_full, s.max_wait_us);
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(pecistats, command_peci_stats,
+			"[clear]",
+			"Print PECI transaction statistics");
 #endif /* CONFIG_CMD_PECI */
@@ -0,0 +1,245 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Statistical PC-sampling profiler.
+ *
+ * A periodic timer interrupt counts the interrupted (PC, task) pair in a
+ * small open-addressing hash table, so that the cost of a sample doesn't
+ * depend on how much code is being profiled. The table is read with the
+ * "profile" console command or EC_CMD_PROFILER, and the PCs mapped to
+ * functions offline by util/profiler_symbolize.py.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "profiler.h"
+#include "system.h"
+#include "util.h"
+
+#define CPRINTS(format, args...) cprints(CC_SYSTEM, format, ## args)
+
+/* Slots to try before dropping a sample, when the table is nearly full */
+#define PROFILER_MAX_PROBES 8
+
+/* Entries printed by the console command */
+#define PROFILER_TOP_COUNT 16
+
+BUILD_ASSERT(CONFIG_PROFILER_ENTRIES <= UINT16_MAX);
+
+struct profiler_bucket {
+	uint32_t pc;
+	uint32_t count;		/* 0 if the bucket is free */
+	uint8_t task;
+};
+
+static struct profiler_bucket buckets[CONFIG_PROFILER_ENTRIES];
+static uint32_t samples;
+static uint32_t dropped;
+static uint16_t used;
+static uint32_t period_us;
+static int running;
+
+void profiler_sample(uintptr_t pc, int task)
+{
+	/* Thumb and x86 instructions are at least 2-byte aligned */
+	uint32_t h = ((uint32_t)pc >> 1) * 2654435761u + task;
+	struct profiler_bucket *b;
+	int i;
+
+	samples++;
+
+	for (i = 0; i < PROFILER_MAX_PROBES; i++) {
+		b = &buckets[(h + i) % CONFIG_PROFILER_ENTRIES];
+		if (!b->count) {
+			b->pc = pc;
+			b->task = task;
+			b->count = 1;
+			used++;
+			return;
+		}
+		if (b->pc == (uint32_t)pc && b->task == task) {
+			b->count++;
+			return;
+		}
+	}
+
+	dropped++;
+}
+
+int profiler_start(uint32_t period)
+{
+	int rv;
+
+	if (period < PROFILER_MIN_PERIOD_US)
+		return EC_ERROR_INVAL;
+
+	if (running)
+		profiler_timer_stop();
+
+	rv = profiler_timer_start(period);
+	running = (rv == EC_SUCCESS);
+	if (running) {
+		period_us = period;
+		/*
+		 * Deep sleep may stop the sampling timer and not restart it
+		 * (MCHP clears SysTick), so stay out of it while sampling.
+		 */
+		disable_sleep(SLEEP_MASK_PROFILER);
+	} else {
+		enable_sleep(SLEEP_MASK_PROFILER);
+	}
+
+	return rv;
+}
+
+void profiler_stop(void)
+{
+	if (!running)
+		return;
+
+	profiler_timer_stop();
+	running = 0;
+	enable_sleep(SLEEP_MASK_PROFILER);
+}
+
+void profiler_clear(void)
+{
+	/* Don't let a sample land in a half-cleared table */
+	if (running)
+		profiler_timer_stop();
+
+	memset(buckets, 0, sizeof(buckets));
+	samples = 0;
+	dropped = 0;
+	used = 0;
+
+	if (running)
+		profiler_timer_start(period_us);
+}
+
+/*****************************************************************************/
+/* Host command */
+
+static enum ec_status profiler_command(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_profiler *p = args->params;
+	struct ec_response_profiler *r = args->response;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->entry[0]);
+	int i, n = 0;
+
+	switch (p->cmd) {
+	case EC_PROFILER_START:
+		if (profiler_start(p->period_us ? p->period_us :
+				   PROFILER_DEFAULT_PERIOD_US))
+			return EC_RES_INVALID_PARAM;
+		break;
+	case EC_PROFILER_STOP:
+		profiler_stop();
+		break;
+	case EC_PROFILER_CLEAR:
+		profiler_clear();
+		break;
+	case EC_PROFILER_READ:
+		break;
+	default:
+		return EC_RES_INVALID_PARAM;
+	}
+
+	r->samples = samples;
+	r->dropped = dropped;
+	r->period_us = period_us;
+	r->entries = used;
+	r->flags = (running ? EC_PROFILER_FLAG_RUNNING : 0) |
+		   (IS_ENABLED(CHIP_HOST) ? EC_PROFILER_FLAG_RELATIVE_PC : 0);
+	r->count = 0;
+
+	/* Entries are numbered in table order, skipping the free buckets */
+	for (i = 0; p->cmd == EC_PROFILER_READ &&
+		    i < CONFIG_PROFILER_ENTRIES && r->count < max; i++) {
+		if (!buckets[i].count || n++ < p->offset)
+			continue;
+		r->entry[r->count].pc = buckets[i].pc;
+		r->entry[r->count].count = buckets[i].count;
+		r->entry[r->count].task = buckets[i].task;
+		memset(r->entry[r->count].reserved, 0,
+		       sizeof(r->entry[0].reserved));
+		r->count++;
+	}
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entry[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_PROFILER,
+		     profiler_command,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console command */
+
+static void print_top(void)
+{
+	int top[PROFILER_TOP_COUNT];
+	int n = 0;
+	int i, j;
+
+	/* Insertion into a short list sorted by decreasing count */
+	for (i = 0; i < CONFIG_PROFILER_ENTRIES; i++) {
+		if (!buckets[i].count)
+			continue;
+		for (j = n; j > 0 && buckets[top[j - 1]].count <
+				     buckets[i].count; j--)
+			if (j < PROFILER_TOP_COUNT)
+				top[j] = top[j - 1];
+		if (j < PROFILER_TOP_COUNT) {
+			top[j] = i;
+			n = MIN(n + 1, PROFILER_TOP_COUNT);
+		}
+	}
+
+	ccprintf("pc         task count\n");
+	for (i = 0; i < n; i++) {
+		const struct profiler_bucket *b = &buckets[top[i]];
+
+		ccprintf("0x%08x %4d %u\n", b->pc, b->task, b->count);
+		cflush();
+	}
+}
+
+static int command_profile(int argc, char **argv)
+{
+	uint32_t period = PROFILER_DEFAULT_PERIOD_US;
+	char *e;
+
+	if (argc >= 2) {
+		if (!strcasecmp(argv[1], "start")) {
+			if (argc >= 3) {
+				period = strtoi(argv[2], &e, 0);
+				if (*e)
+					return EC_ERROR_PARAM2;
+			}
+			return profiler_start(period);
+		} else if (!strcasecmp(argv[1], "stop")) {
+			profiler_stop();
+		} else if (!strcasecmp(argv[1], "clear")) {
+			profiler_clear();
+		} else {
+			return EC_ERROR_PARAM1;
+		}
+		return EC_SUCCESS;
+	}
+
+	ccprintf("%s, %u samples every %u us, %u dropped, %u entries%s\n",
+		 running ? "Running" : "Stopped", samples, period_us, dropped,
+		 used, IS_ENABLED(CHIP_HOST) ? ", PCs relative" : "");
+	print_top();
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(profile, command_profile,
+			"[start [period_us] | stop | clear]",
+			"Sample the interrupted PC and task periodically");
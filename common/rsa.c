@@ -12,95 +12,146 @@
 #include "sha256.h"
 #include "util.h"
 
+/* Modulus, R^2 and -1 / n[0] of a key, as limbs */
+struct mont_key {
+	const rsa_limb_t *n;
+	const rsa_limb_t *rr;
+	rsa_limb_t n0inv;
+};
+
+#if RSA_LIMB_BITS == 64
+typedef unsigned __int128 rsa_dlimb_t;
+#else
+typedef uint64_t rsa_dlimb_t;
+#endif
+
 /**
- * a[] -= mod
+ * Return (a * b) + c + d, which can't overflow.
  */
-static void sub_mod(const struct rsa_public_key *key, uint32_t *a)
+static inline rsa_dlimb_t mulaa(rsa_limb_t a, rsa_limb_t b, rsa_limb_t c,
+				rsa_limb_t d)
 {
-	int64_t A = 0;
+#if RSA_LIMB_BITS == 64
+	return (rsa_dlimb_t)a * b + c + d;
+#elif defined(__ARM_FEATURE_DSP)
+	/* Cortex-M4: one UMAAL instead of UMLAL and two adds */
+	__asm__("umaal %0, %1, %2, %3" : "+r"(c), "+r"(d) : "r"(a), "r"(b));
+	return ((uint64_t)d << 32) | c;
+#else
+	return mulaa32(a, b, c, d);
+#endif
+}
+
+/**
+ * a[] -= mod if mask is all ones, a[] is left as it is if mask is 0.
+ *
+ * This takes the same time either way.
+ */
+static void sub_mod(const struct mont_key *key, rsa_limb_t *a,
+		    rsa_limb_t mask)
+{
+	rsa_limb_t borrow = 0;
 	uint32_t i;
-	for (i = 0; i < RSANUMWORDS; ++i) {
-		A += (uint64_t)a[i] - key->n[i];
-		a[i] = (uint32_t)A;
-		A >>= 32;
+
+	for (i = 0; i < RSANUMLIMBS; ++i) {
+		rsa_dlimb_t A = (rsa_dlimb_t)a[i] - (key->n[i] & mask) - borrow;
+
+		a[i] = (rsa_limb_t)A;
+		borrow = (rsa_limb_t)(A >> RSA_LIMB_BITS) & 1;
 	}
 }
 
 /**
- * Return a[] >= mod
+ * Return all ones if a[] >= mod, 0 otherwise, in constant time.
  */
-static int ge_mod(const struct rsa_public_key *key, const uint32_t *a)
+static rsa_limb_t ge_mod(const struct mont_key *key, const rsa_limb_t *a)
 {
+	rsa_limb_t borrow = 0;
 	uint32_t i;
-	for (i = RSANUMWORDS; i;) {
-		--i;
-		if (a[i] < key->n[i])
-			return 0;
-		if (a[i] > key->n[i])
-			return 1;
+
+	for (i = 0; i < RSANUMLIMBS; ++i) {
+		rsa_dlimb_t A = (rsa_dlimb_t)a[i] - key->n[i] - borrow;
+
+		borrow = (rsa_limb_t)(A >> RSA_LIMB_BITS) & 1;
 	}
-	return 1;  /* equal */
+	return borrow - 1;
 }
 
+/*
+ * One limb of Montgomery c[] += a * b[] / R, and the running carries A and B.
+ */
+#define MONT_STEP(i)							\
+	do {								\
+		A = mulaa(a, b[i], c[i], A >> RSA_LIMB_BITS);		\
+		B = mulaa(d0, key->n[i], (rsa_limb_t)A,			\
+			  B >> RSA_LIMB_BITS);				\
+		c[(i) - 1] = (rsa_limb_t)B;				\
+	} while (0)
+
 /**
  * Montgomery c[] += a * b[] / R % mod
  */
-static void mont_mul_add(const struct rsa_public_key *key,
-			 uint32_t *c,
-			 const uint32_t a,
-			 const uint32_t *b)
+static void mont_mul_add(const struct mont_key *key,
+			 rsa_limb_t *c,
+			 const rsa_limb_t a,
+			 const rsa_limb_t *b)
 {
-	uint64_t A = mula32(a, b[0], c[0]);
-	uint32_t d0 = (uint32_t)A * key->n0inv;
-	uint64_t B = mula32(d0, key->n[0], A);
+	rsa_dlimb_t A = mulaa(a, b[0], c[0], 0);
+	rsa_limb_t d0 = (rsa_limb_t)A * key->n0inv;
+	rsa_dlimb_t B = mulaa(d0, key->n[0], (rsa_limb_t)A, 0);
 	uint32_t i;
 
-	for (i = 1; i < RSANUMWORDS; ++i) {
-		A = mulaa32(a, b[i], c[i], A >> 32);
-		B = mulaa32(d0, key->n[i], A, B >> 32);
-		c[i - 1] = (uint32_t)B;
+	/* RSANUMLIMBS is a multiple of 4: limbs 1 to 3, then 4 at a time */
+	MONT_STEP(1);
+	MONT_STEP(2);
+	MONT_STEP(3);
+	for (i = 4; i < RSANUMLIMBS; i += 4) {
+		MONT_STEP(i);
+		MONT_STEP(i + 1);
+		MONT_STEP(i + 2);
+		MONT_STEP(i + 3);
 	}
 
-	A = (A >> 32) + (B >> 32);
+	A = (A >> RSA_LIMB_BITS) + (B >> RSA_LIMB_BITS);
 
-	c[i - 1] = (uint32_t)A;
+	c[i - 1] = (rsa_limb_t)A;
 
-	if (A >> 32)
-		sub_mod(key, c);
+	sub_mod(key, c, -(rsa_limb_t)(A >> RSA_LIMB_BITS));
 }
+BUILD_ASSERT(RSANUMLIMBS % 4 == 0);
 
 #ifdef CONFIG_RSA_EXPONENT_3
 /**
  * Montgomery c[] += 0 * b[] / R % mod
  */
-static void mont_mul_add_0(const struct rsa_public_key *key,
-			 uint32_t *c,
-			 const uint32_t *b)
+static void mont_mul_add_0(const struct mont_key *key,
+			 rsa_limb_t *c,
+			 const rsa_limb_t *b)
 {
-	uint32_t d0 = c[0] * key->n0inv;
-	uint64_t B = mula32(d0, key->n[0], c[0]);
+	rsa_limb_t d0 = c[0] * key->n0inv;
+	rsa_dlimb_t B = mulaa(d0, key->n[0], c[0], 0);
 	uint32_t i;
 
-	for (i = 1; i < RSANUMWORDS; ++i) {
-		B = mulaa32(d0, key->n[i], c[i], B >> 32);
-		c[i - 1] = (uint32_t)B;
+	for (i = 1; i < RSANUMLIMBS; ++i) {
+		B = mulaa(d0, key->n[i], c[i], B >> RSA_LIMB_BITS);
+		c[i - 1] = (rsa_limb_t)B;
 	}
 
-	c[i - 1] = B >> 32;
+	c[i - 1] = B >> RSA_LIMB_BITS;
 }
 
 /* Montgomery c[] = a[] * 1 / R % key. */
-static void mont_mul_1(const struct rsa_public_key *key,
-		       uint32_t *c,
-		       const uint32_t *a)
+static void mont_mul_1(const struct mont_key *key,
+		       rsa_limb_t *c,
+		       const rsa_limb_t *a)
 {
 	int i;
 
-	for (i = 0; i < RSANUMWORDS; ++i)
+	for (i = 0; i < RSANUMLIMBS; ++i)
 		c[i] = 0;
 
 	mont_mul_add(key, c, 1, a);
-	for (i = 1; i < RSANUMWORDS; ++i)
+	for (i = 1; i < RSANUMLIMBS; ++i)
 		mont_mul_add_0(key, c, a);
 }
 #endif
@@ -108,16 +159,16 @@ static void mont_mul_1(const struct rsa_public_key *key,
 /**
  * Montgomery c[] = a[] * b[] / R % mod
  */
-static void mont_mul(const struct rsa_public_key *key,
-		     uint32_t *c,
-		     const uint32_t *a,
-		     const uint32_t *b)
+static void mont_mul(const struct mont_key *key,
+		     rsa_limb_t *c,
+		     const rsa_limb_t *a,
+		     const rsa_limb_t *b)
 {
 	uint32_t i;
-	for (i = 0; i < RSANUMWORDS; ++i)
+	for (i = 0; i < RSANUMLIMBS; ++i)
 		c[i] = 0;
 
-	for (i = 0; i < RSANUMWORDS; ++i)
+	for (i = 0; i < RSANUMLIMBS; ++i)
 		mont_mul_add(key, c, a[i], b);
 }
 
@@ -130,26 +181,32 @@ static void mont_mul(const struct rsa_public_key *key,
  * @param workbuf32	Work buffer; caller must verify this is
  *			3 x RSANUMWORDS elements long.
  */
-static void mod_pow(const struct rsa_public_key *key, uint8_t *inout,
+static void mod_pow(const struct mont_key *key, uint8_t *inout,
 		    uint32_t *workbuf32)
 {
-	uint32_t *a = workbuf32;
-	uint32_t *a_r = a + RSANUMWORDS;
-	uint32_t *aa_r = a_r + RSANUMWORDS;
-	uint32_t *aaa = aa_r;  /* Re-use location. */
-	int i;
-
-	/* Convert from big endian byte array to little endian word array. */
-	for (i = 0; i < RSANUMWORDS; ++i) {
-		uint32_t tmp =
-			(inout[((RSANUMWORDS - 1 - i) * 4) + 0] << 24) |
-			(inout[((RSANUMWORDS - 1 - i) * 4) + 1] << 16) |
-			(inout[((RSANUMWORDS - 1 - i) * 4) + 2] << 8) |
-			(inout[((RSANUMWORDS - 1 - i) * 4) + 3] << 0);
+#if RSA_LIMB_BITS == 64
+	/* workbuf32 may not be aligned for 64-bit limbs, use the stack */
+	rsa_limb_t limbs[3 * RSANUMLIMBS];
+	rsa_limb_t *a = limbs;
+#else
+	rsa_limb_t *a = (rsa_limb_t *)workbuf32;
+#endif
+	rsa_limb_t *a_r = a + RSANUMLIMBS;
+	rsa_limb_t *aa_r = a_r + RSANUMLIMBS;
+	rsa_limb_t *aaa = aa_r;  /* Re-use location. */
+	const uint8_t *in;
+	int i, j;
+
+	/* Convert from big endian byte array to little endian limb array. */
+	for (i = 0; i < RSANUMLIMBS; ++i) {
+		rsa_limb_t tmp = 0;
+
+		in = inout + (RSANUMLIMBS - 1 - i) * sizeof(rsa_limb_t);
+		for (j = 0; j < sizeof(rsa_limb_t); ++j)
+			tmp = (tmp << 8) | in[j];
 		a[i] = tmp;
 	}
 
-	/* TODO(drinkcat): This operation could be precomputed to save time. */
 	mont_mul(key, a_r, a, key->rr);  /* a_r = a * RR / R mod M */
 #ifdef CONFIG_RSA_EXPONENT_3
 	mont_mul(key, aa_r, a_r, a_r);
@@ -165,16 +222,14 @@ static void mod_pow(const struct rsa_public_key *key, uint8_t *inout,
 #endif
 
 	/* Make sure aaa < mod; aaa is at most 1x mod too large. */
-	if (ge_mod(key, aaa))
-		sub_mod(key, aaa);
+	sub_mod(key, aaa, ge_mod(key, aaa));
 
 	/* Convert to bigendian byte array */
-	for (i = RSANUMWORDS - 1; i >= 0; --i) {
-		uint32_t tmp = aaa[i];
-		*inout++ = (uint8_t)(tmp >> 24);
-		*inout++ = (uint8_t)(tmp >> 16);
-		*inout++ = (uint8_t)(tmp >>  8);
-		*inout++ = (uint8_t)(tmp >>  0);
+	for (i = RSANUMLIMBS - 1; i >= 0; --i) {
+		rsa_limb_t tmp = aaa[i];
+
+		for (j = sizeof(rsa_limb_t) - 1; j >= 0; --j)
+			*inout++ = (uint8_t)(tmp >> (8 * j));
 	}
 }
 
@@ -226,6 +281,20 @@ static int check_padding(const uint8_t *sig)
 	return !!result;
 }
 
+/* Check the result of the exponentiation against the digest. */
+static int check_signature(const uint8_t *buf, const uint8_t *sha)
+{
+	/* Check the PKCS#1 padding */
+	if (check_padding(buf) != 0)
+		return 0;
+
+	/* Check the digest. */
+	if (memcmp(buf + PKCS_PAD_SIZE, sha, SHA256_DIGEST_SIZE) != 0)
+		return 0;
+
+	return 1;  /* All checked out OK. */
+}
+
 /*
  * Verify a SHA256WithRSA PKCS#1 v1.5 signature against an expected
  * SHA256 hash.
@@ -240,20 +309,79 @@ static int check_padding(const uint8_t *sig)
 int rsa_verify(const struct rsa_public_key *key, const uint8_t *signature,
 	       const uint8_t *sha, uint32_t *workbuf32)
 {
+#if RSA_LIMB_BITS == 64
+	struct rsa_key_ctx ctx;
+
+	/* The key is in 32-bit words; convert it */
+	if (rsa_key_ctx_init(&ctx, key) != EC_SUCCESS)
+		return 0;
+	return rsa_verify_ctx(&ctx, signature, sha, workbuf32);
+#else
+	const struct mont_key mkey = {
+		.n = key->n,
+		.rr = key->rr,
+		.n0inv = key->n0inv,
+	};
 	uint8_t buf[RSANUMBYTES];
 
 	/* Copy input to local workspace. */
 	memcpy(buf, signature, RSANUMBYTES);
 
-	mod_pow(key, buf, workbuf32); /* In-place exponentiation. */
+	mod_pow(&mkey, buf, workbuf32); /* In-place exponentiation. */
 
-	/* Check the PKCS#1 padding */
-	if (check_padding(buf) != 0)
-		return 0;
+	return check_signature(buf, sha);
+#endif
+}
 
-	/* Check the digest. */
-	if (memcmp(buf + PKCS_PAD_SIZE, sha, SHA256_DIGEST_SIZE) != 0)
-		return 0;
+/* Limb i of a little endian array of 32-bit words */
+static rsa_limb_t get_limb(const uint32_t *words, int i)
+{
+#if RSA_LIMB_BITS == 64
+	return words[2 * i] | (uint64_t)words[2 * i + 1] << 32;
+#else
+	return words[i];
+#endif
+}
 
-	return 1;  /* All checked out OK. */
+int rsa_key_ctx_init(struct rsa_key_ctx *ctx,
+		     const struct rsa_public_key *key)
+{
+	rsa_limb_t inv;
+	int i;
+
+	for (i = 0; i < RSANUMLIMBS; ++i) {
+		ctx->n[i] = get_limb(key->n, i);
+		ctx->rr[i] = get_limb(key->rr, i);
+	}
+
+	/*
+	 * -1 / n[0] mod 2^RSA_LIMB_BITS, from the key's mod 2^32: each Newton
+	 * step inv = inv * (2 - n[0] * inv) doubles the bits which are right.
+	 */
+	inv = -(rsa_limb_t)key->n0inv;
+	for (i = 32; i < RSA_LIMB_BITS; i *= 2)
+		inv *= 2 - ctx->n[0] * inv;
+	ctx->n0inv = -inv;
+
+	if (ctx->n[0] * ctx->n0inv != (rsa_limb_t)-1)
+		return EC_ERROR_INVAL;
+	return EC_SUCCESS;
+}
+
+int rsa_verify_ctx(const struct rsa_key_ctx *ctx, const uint8_t *signature,
+		   const uint8_t *sha, uint32_t *workbuf32)
+{
+	const struct mont_key mkey = {
+		.n = ctx->n,
+		.rr = ctx->rr,
+		.n0inv = ctx->n0inv,
+	};
+	uint8_t buf[RSANUMBYTES];
+
+	/* Copy input to local workspace. */
+	memcpy(buf, signature, RSANUMBYTES);
+
+	mod_pow(&mkey, buf, workbuf32); /* In-place exponentiation. */
+
+	return check_signature(buf, sha);
 }
@@ -30,6 +30,11 @@ int shared_mem_acquire(int size, char **dest_ptr)
 	if (size > shared_mem_size() || size <= 0)
 		return EC_ERROR_INVAL;
 
+#ifdef CONFIG_SHAREDMEM_SLAB
+	if (shared_mem_slab_acquire(size, dest_ptr) == EC_SUCCESS)
+		return EC_SUCCESS;
+#endif
+
 	if (buf_in_use)
 		return EC_ERROR_BUSY;
 
@@ -49,6 +54,10 @@ int shared_mem_acquire(int size, char **dest_ptr)
 
 void shared_mem_release(void *ptr)
 {
+#ifdef CONFIG_SHAREDMEM_SLAB
+	if (shared_mem_slab_release(ptr))
+		return;
+#endif
 	buf_in_use = 0;
 }
 
@@ -58,6 +67,9 @@ static int command_shmem(int argc, char **argv)
 	ccprintf("Size:%6d\n", shared_mem_size());
 	ccprintf("Used:%6d\n", buf_in_use);
 	ccprintf("Max: %6d\n", max_used);
+#ifdef CONFIG_SHAREDMEM_SLAB
+	shared_mem_slab_print();
+#endif
 	return EC_SUCCESS;
 }
 DECLARE_SAFE_CONSOLE_COMMAND(shmem, command_shmem,
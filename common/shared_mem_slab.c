@@ -0,0 +1,152 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Fixed-size buffer pools in front of shared memory.
+ *
+ * Each pool is a static array of equal buffers with a bitmap of the free
+ * ones, so acquiring and releasing a buffer take constant time, and buffers
+ * of the common small sizes never fragment shared memory. The pools are
+ * declared with CONFIG_SHAREDMEM_SLAB_CLASSES.
+ *
+ * Only acquiring clears bits of the free bitmaps, under slab_lock, and only
+ * releasing sets them, with atomics and without the lock, so that buffers
+ * can be released from interrupt context.
+ */
+
+#include "atomic.h"
+#include "common.h"
+#include "console.h"
+#include "shared_mem.h"
+#include "task.h"
+#include "util.h"
+
+struct slab_pool {
+	uint8_t *base;
+	uint16_t size;
+	uint8_t count;
+};
+
+struct slab_state {
+	uint32_t free;			/* Bitmap of free buffers */
+	uint32_t in_use;
+	uint8_t high_water;
+	uint16_t failures;
+};
+
+/* Buffers of each pool, aligned for any type */
+#define SHARED_MEM_SLAB(size, count)					\
+	BUILD_ASSERT((size) % 4 == 0 && (size) <= UINT16_MAX);		\
+	BUILD_ASSERT((count) > 0 && (count) <= 32);			\
+	static uint8_t slab_buf_##size[(size) * (count)] __aligned(8);
+CONFIG_SHAREDMEM_SLAB_CLASSES
+#undef SHARED_MEM_SLAB
+
+#define SHARED_MEM_SLAB(size, count) { slab_buf_##size, size, count },
+static const struct slab_pool pools[] = {
+	CONFIG_SHAREDMEM_SLAB_CLASSES
+};
+#undef SHARED_MEM_SLAB
+
+#define SHARED_MEM_SLAB(size, count) \
+	{ .free = (uint32_t)((1ULL << (count)) - 1) },
+static struct slab_state state[] = {
+	CONFIG_SHAREDMEM_SLAB_CLASSES
+};
+#undef SHARED_MEM_SLAB
+
+static struct mutex slab_lock;
+
+int shared_mem_slab_acquire(int size, char **dest_ptr)
+{
+	int i, fit = -1, best = -1;
+	struct slab_state *s;
+	int n;
+
+	*dest_ptr = NULL;
+
+	if (size <= 0 || in_interrupt_context())
+		return EC_ERROR_INVAL;
+
+	mutex_lock(&slab_lock);
+
+	/* The smallest pool which fits, and the smallest with a buffer free */
+	for (i = 0; i < ARRAY_SIZE(pools); i++) {
+		if (size > pools[i].size)
+			continue;
+		if (fit < 0 || pools[i].size < pools[fit].size)
+			fit = i;
+		if (state[i].free &&
+		    (best < 0 || pools[i].size < pools[best].size))
+			best = i;
+	}
+
+	if (best < 0) {
+		if (fit >= 0 && state[fit].failures < UINT16_MAX)
+			state[fit].failures++;
+		mutex_unlock(&slab_lock);
+		return fit < 0 ? EC_ERROR_OVERFLOW : EC_ERROR_BUSY;
+	}
+
+	s = &state[best];
+	n = __builtin_ctz(s->free);
+	deprecated_atomic_clear_bits(&s->free, BIT(n));
+	deprecated_atomic_add(&s->in_use, 1);
+	if (s->in_use > s->high_water)
+		s->high_water = s->in_use;
+
+	mutex_unlock(&slab_lock);
+
+	*dest_ptr = (char *)pools[best].base + n * pools[best].size;
+	return EC_SUCCESS;
+}
+
+int shared_mem_slab_release(void *ptr)
+{
+	const struct slab_pool *p;
+	uintptr_t offset;
+	int i, n;
+
+	for (i = 0; i < ARRAY_SIZE(pools); i++) {
+		p = &pools[i];
+		offset = (uintptr_t)ptr - (uintptr_t)p->base;
+		if (offset >= p->size * p->count)
+			continue;
+
+		n = offset / p->size;
+		/* Ignore pointers into a buffer, and buffers already free */
+		if (!(offset % p->size) && !(state[i].free & BIT(n))) {
+			deprecated_atomic_sub(&state[i].in_use, 1);
+			deprecated_atomic_or(&state[i].free, BIT(n));
+		}
+		return 1;
+	}
+
+	return 0;
+}
+
+int shared_mem_slab_get_stats(int pool, struct shared_mem_slab_stats *stats)
+{
+	if (pool < 0 || pool >= ARRAY_SIZE(pools))
+		return EC_ERROR_INVAL;
+
+	stats->size = pools[pool].size;
+	stats->count = pools[pool].count;
+	stats->in_use = state[pool].in_use;
+	stats->high_water = state[pool].high_water;
+	stats->failures = state[pool].failures;
+	return EC_SUCCESS;
+}
+
+void shared_mem_slab_print(void)
+{
+	int i;
+
+	ccprintf("Pool  size  bufs  used   max  fails\n");
+	for (i = 0; i < ARRAY_SIZE(pools); i++)
+		ccprintf("%4d %5d %5d %5d %5d %6d\n", i, pools[i].size,
+			 pools[i].count, state[i].in_use, state[i].high_water,
+			 state[i].failures);
+}
@@ -17,7 +17,7 @@
 
 static struct mutex shmem_lock;
 
-#ifndef TEST_SHMALLOC
+#if !defined(TEST_SHMALLOC) && !defined(TEST_SHMALLOC_SLAB)
 #define set_map_bit(x)
 #define TEST_GLOBAL static
 #else
@@ -317,6 +317,11 @@ int shared_mem_acquire(int size, char **dest_ptr)
 	if (in_interrupt_context())
 		return EC_ERROR_INVAL;
 
+#ifdef CONFIG_SHAREDMEM_SLAB
+	if (shared_mem_slab_acquire(size, dest_ptr) == EC_SUCCESS)
+		return EC_SUCCESS;
+#endif
+
 	if (!free_buf_chain)
 		return EC_ERROR_BUSY;
 
@@ -342,6 +347,12 @@ int shared_mem_acquire(int size, char **dest_ptr)
 
 void shared_mem_release(void *ptr)
 {
+#ifdef CONFIG_SHAREDMEM_SLAB
+	/* Pool buffers can be released from interrupts */
+	if (shared_mem_slab_release(ptr))
+		return;
+#endif
+
 	if (in_interrupt_context())
 		return;
 
@@ -384,6 +395,9 @@ static int command_shmem(int argc, char **argv)
 	ccprintf("Free:          %6zd\n", free_size);
 	ccprintf("Max free buf:  %6zd\n", max_free);
 	ccprintf("Max allocated: %6d\n", max_allocated_size);
+#ifdef CONFIG_SHAREDMEM_SLAB
+	shared_mem_slab_print();
+#endif
 	return EC_SUCCESS;
 }
 DECLARE_SAFE_CONSOLE_COMMAND(shmem, command_shmem,
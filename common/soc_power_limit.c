@@ -0,0 +1,320 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Table-driven SoC power limit policy.
+ *
+ * The board describes its power limits as an ordered list of rules keyed on
+ * adapter power and battery charge, each with one linear curve per limit.
+ * Only limits whose value changed are written to the SoC, in one batch.
+ * Increases can be slew and rate limited; decreases are always applied
+ * right away.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "hooks.h"
+#include "soc_power_limit.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+#define CPRINTS(format, args...) cprints(CC_THERMAL, format, ## args)
+
+#define HISTORY_SIZE CONFIG_SOC_POWER_LIMIT_HISTORY
+
+static const char * const pl_name[] = {
+	[SOC_PL1] = "PL1",
+	[SOC_PL2] = "PL2",
+	[SOC_PL4] = "PL4",
+	[SOC_PSYS_PL2] = "Psys",
+};
+BUILD_ASSERT(ARRAY_SIZE(pl_name) == SOC_PL_COUNT);
+
+static struct mutex pl_lock;
+static struct soc_pl_inputs inputs;
+static int have_inputs;
+static int manual;
+static int active_rule = -1;
+/* Limits last written to the SoC, -1 if unknown */
+static int applied[SOC_PL_COUNT] = { -1, -1, -1, -1 };
+static timestamp_t last_batch;
+
+static struct soc_pl_history history[HISTORY_SIZE];
+static int history_head;
+static int history_count;
+
+static void soc_pl_deferred(void);
+DECLARE_DEFERRED(soc_pl_deferred);
+
+static int rule_matches(const struct soc_pl_rule *r, int adapter_w,
+			int battery_pct)
+{
+	return adapter_w >= r->adapter_min_w &&
+	       (!r->adapter_max_w || adapter_w < r->adapter_max_w) &&
+	       battery_pct >= r->battery_min_pct &&
+	       (!r->battery_max_pct || battery_pct < r->battery_max_pct);
+}
+
+static int first_matching_rule(int adapter_w, int battery_pct)
+{
+	int i;
+
+	for (i = 0; i < soc_pl_policy.rule_count; i++)
+		if (rule_matches(&soc_pl_policy.rules[i], adapter_w,
+				 battery_pct))
+			return i;
+	return -1;
+}
+
+/*
+ * Pick the rule for the inputs. Moving away from the active rule requires
+ * the new rule to also win with the inputs moved by the hysteresis margins,
+ * so that inputs hovering around a threshold don't flip the limits. The
+ * active rule is only kept if it still wins somewhere in that band though,
+ * not when the inputs left it altogether (e.g. an adapter was plugged in).
+ */
+static int select_rule(const struct soc_pl_inputs *in)
+{
+	const int ha = soc_pl_policy.adapter_hyst_w;
+	const int hb = soc_pl_policy.battery_hyst_pct;
+	int rule = first_matching_rule(in->adapter_w, in->battery_pct);
+	int stable = 1, active_nearby = 0;
+	int i, corner;
+
+	if (active_rule < 0 || rule == active_rule)
+		return rule;
+
+	for (i = 0; i < 4; i++) {
+		corner = first_matching_rule(in->adapter_w + (i & 1 ? ha : -ha),
+					     in->battery_pct +
+					     (i & 2 ? hb : -hb));
+		if (corner != rule)
+			stable = 0;
+		if (corner == active_rule)
+			active_nearby = 1;
+	}
+
+	return !stable && active_nearby ? active_rule : rule;
+}
+
+static int eval_curve(const struct soc_pl_curve *c,
+		      const struct soc_pl_inputs *in, const int *limit)
+{
+	int base, val;
+
+	if (c->base == SOC_PL_BASE_NONE)
+		base = 0;
+	else if (c->base == SOC_PL_BASE_ADAPTER)
+		base = in->adapter_w;
+	else
+		base = limit[c->base];
+
+	val = base * c->pct / 100 + c->offset_w;
+	if (c->minus_pps)
+		val -= in->pps_budget_w;
+	if (c->max_w && val > c->max_w)
+		val = c->max_w;
+	if (val < c->min_w)
+		val = c->min_w;
+
+	return val;
+}
+
+static void compute_limits(int rule, const struct soc_pl_inputs *in,
+			   int *limit)
+{
+	const struct soc_pl_curve *c = soc_pl_policy.rules[rule].limit;
+	int i;
+
+	/* Curves based on other limits go last. */
+	for (i = 0; i < SOC_PL_COUNT; i++)
+		if (c[i].base < 0)
+			limit[i] = eval_curve(&c[i], in, limit);
+	for (i = 0; i < SOC_PL_COUNT; i++)
+		if (c[i].base >= 0)
+			limit[i] = eval_curve(&c[i], in, limit);
+}
+
+/* Write the limits in mask, and record the batch. Call with pl_lock held. */
+static void write_batch(uint8_t mask, const int *limit, int rule)
+{
+	struct soc_pl_history *h = &history[history_head];
+	int i;
+
+	h->time = get_time();
+	h->rule = rule;
+	h->written = mask;
+	h->failed = 0;
+
+	for (i = 0; i < SOC_PL_COUNT; i++) {
+		h->limit[i] = limit[i];
+		if (!(mask & BIT(i)))
+			continue;
+		if (board_soc_pl_write(i, limit[i]) == EC_SUCCESS) {
+			applied[i] = limit[i];
+		} else {
+			/* Unknown now, so it's rewritten on the next update */
+			applied[i] = -1;
+			h->failed |= BIT(i);
+		}
+	}
+
+	history_head = (history_head + 1) % HISTORY_SIZE;
+	if (history_count < HISTORY_SIZE)
+		history_count++;
+	last_batch = h->time;
+
+	CPRINTS("SoC PL: rule %d PL1 %d PL2 %d PL4 %d Psys %d (wr 0x%x fail 0x%x)",
+		rule, limit[SOC_PL1], limit[SOC_PL2], limit[SOC_PL4],
+		limit[SOC_PSYS_PL2], mask, h->failed);
+}
+
+/* Evaluate the policy on the stored inputs. Call with pl_lock held. */
+static void soc_pl_apply(int force)
+{
+	int limit[SOC_PL_COUNT];
+	uint8_t pending = 0, decreasing = 0, mask;
+	int slewing = 0;
+	int rule, i;
+	uint64_t now, next_batch;
+
+	if (!have_inputs)
+		return;
+
+	rule = select_rule(&inputs);
+	if (rule < 0)
+		return;
+	active_rule = rule;
+	compute_limits(rule, &inputs, limit);
+
+	for (i = 0; i < SOC_PL_COUNT; i++) {
+		if (soc_pl_policy.max_rise_w && applied[i] >= 0 &&
+		    limit[i] > applied[i] + soc_pl_policy.max_rise_w) {
+			limit[i] = applied[i] + soc_pl_policy.max_rise_w;
+			slewing = 1;
+		}
+		if (force || limit[i] != applied[i])
+			pending |= BIT(i);
+		if (applied[i] < 0 || limit[i] < applied[i])
+			decreasing |= BIT(i);
+	}
+
+	if (!pending || manual)
+		return;
+
+	/* Within the rate limit, only decreases go out now. */
+	now = get_time().val;
+	next_batch = last_batch.val + soc_pl_policy.min_interval_us;
+	mask = pending;
+	if (!force && last_batch.val && now < next_batch) {
+		mask &= decreasing;
+		if (pending & ~decreasing)
+			hook_call_deferred(&soc_pl_deferred_data,
+					   next_batch - now);
+	}
+
+	if (!mask)
+		return;
+
+	write_batch(mask, limit, rule);
+
+	/* Keep stepping towards the target. */
+	if (slewing)
+		hook_call_deferred(&soc_pl_deferred_data,
+				   soc_pl_policy.min_interval_us);
+}
+
+static void soc_pl_deferred(void)
+{
+	mutex_lock(&pl_lock);
+	soc_pl_apply(0);
+	mutex_unlock(&pl_lock);
+}
+
+void soc_pl_update(const struct soc_pl_inputs *in, int force)
+{
+	mutex_lock(&pl_lock);
+	inputs = *in;
+	have_inputs = 1;
+	soc_pl_apply(force);
+	mutex_unlock(&pl_lock);
+}
+
+void soc_pl_set_manual(const int *limits)
+{
+	mutex_lock(&pl_lock);
+	if (limits) {
+		manual = 1;
+		write_batch(BIT(SOC_PL_COUNT) - 1, limits, -1);
+	} else {
+		manual = 0;
+		soc_pl_apply(1);
+	}
+	mutex_unlock(&pl_lock);
+}
+
+void soc_pl_write_failed(enum soc_pl pl)
+{
+	mutex_lock(&pl_lock);
+	applied[pl] = -1;
+	mutex_unlock(&pl_lock);
+}
+
+int soc_pl_get_applied(int *limits)
+{
+	int i;
+
+	for (i = 0; i < SOC_PL_COUNT; i++)
+		limits[i] = applied[i];
+
+	return manual ? -1 : active_rule;
+}
+
+int soc_pl_get_history(int age, struct soc_pl_history *entry)
+{
+	if (age < 0 || age >= history_count)
+		return EC_ERROR_UNKNOWN;
+
+	mutex_lock(&pl_lock);
+	*entry = history[(history_head + HISTORY_SIZE - 1 - age) %
+			 HISTORY_SIZE];
+	mutex_unlock(&pl_lock);
+
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* Console commands */
+
+static int command_socpl(int argc, char **argv)
+{
+	struct soc_pl_history h;
+	int limit[SOC_PL_COUNT];
+	int rule, i, age;
+
+	rule = soc_pl_get_applied(limit);
+	ccprintf("%s, rule %d, in: adp %dW batt %d%% pps %dW\n",
+		 manual ? "manual" : "auto", rule, inputs.adapter_w,
+		 inputs.battery_pct, inputs.pps_budget_w);
+	for (i = 0; i < SOC_PL_COUNT; i++)
+		ccprintf("  %-4s %3dW\n", pl_name[i], limit[i]);
+
+	ccprintf("History (newest first):\n");
+	for (age = 0; soc_pl_get_history(age, &h) == EC_SUCCESS; age++) {
+		ccprintf("  %pT r%2d", &h.time.val, h.rule);
+		for (i = 0; i < SOC_PL_COUNT; i++)
+			ccprintf(" %s%c%3d", pl_name[i],
+				 (h.failed & BIT(i)) ? '!' :
+				 (h.written & BIT(i)) ? '=' : ':',
+				 h.limit[i]);
+		ccprintf("\n");
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(socpl, command_socpl,
+			NULL,
+			"Show SoC power limits and write history");
@@ -0,0 +1,142 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Task stack high-water tracker.
+ *
+ * The cores fill unused stack with STACK_UNUSED_VALUE, so the peak usage of a
+ * stack is found by looking for the lowest word which doesn't hold it any
+ * more. Instead of scanning whole stacks on demand like "taskinfo", the idle
+ * task checks a few words on each pass, from the bottom of one stack up to
+ * the peak already known, then moves on to the next stack.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "host_command.h"
+#include "panic.h"
+#include "stack_watch.h"
+#include "task.h"
+#include "util.h"
+
+/* Most bytes used by each task */
+static int peak[TASK_ID_COUNT];
+
+/* Task the idle task is scanning, and the next word of it to check */
+static task_id_t scan_task;
+static int scan_word;
+
+/*
+ * Check up to n words of the stack of a task, starting at a word, stopping at
+ * the peak already known.
+ *
+ * @return the word to continue from, or -1 when the task is done.
+ */
+static int scan(task_id_t id, int from, int n)
+{
+	uint32_t *stack;
+	int size, end, i;
+
+	stack = task_get_stack(id, &size);
+	if (!stack)
+		return -1;
+
+	end = (size - peak[id]) / sizeof(uint32_t);
+	for (i = from; i < end; i++) {
+		if (i == from + n)
+			return i;
+		if (stack[i] == STACK_UNUSED_VALUE)
+			continue;
+
+		/* The idle task and a full scan may race, so keep the max */
+		peak[id] = MAX(peak[id], size - i * (int)sizeof(uint32_t));
+#if defined(CONFIG_DEBUG_STACK_OVERFLOW) && defined(CONFIG_SOFTWARE_PANIC)
+		if (i == 0) {
+			panic_printf("\n\nStack overflow in %s task!\n",
+				     task_get_name(id));
+			software_panic(PANIC_SW_STACK_OVERFLOW, id);
+		}
+#endif
+		break;
+	}
+
+	return -1;
+}
+
+void stack_watch_idle(void)
+{
+	scan_word = scan(scan_task, scan_word, CONFIG_STACK_WATCH_WORDS);
+	if (scan_word < 0) {
+		scan_word = 0;
+		scan_task = (scan_task + 1) % TASK_ID_COUNT;
+	}
+}
+
+void stack_watch_scan(void)
+{
+	task_id_t id;
+
+	for (id = 0; id < TASK_ID_COUNT; id++)
+		scan(id, 0, INT32_MAX);
+}
+
+int stack_watch_get(task_id_t tskid, int *size, int *peak_used)
+{
+	if (tskid >= TASK_ID_COUNT || !task_get_stack(tskid, size))
+		return EC_ERROR_INVAL;
+
+	*peak_used = peak[tskid];
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* Host command */
+
+static enum ec_status stack_info_command(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_stack_info *p = args->params;
+	struct ec_response_stack_info *r = args->response;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->entry[0]);
+	int id, size, used;
+
+	r->tasks = TASK_ID_COUNT;
+	r->count = 0;
+	r->reserved = 0;
+	for (id = p->first; id < TASK_ID_COUNT && r->count < max; id++) {
+		if (stack_watch_get(id, &size, &used))
+			size = used = 0;
+		r->entry[r->count].size = size;
+		r->entry[r->count].peak = used;
+		r->count++;
+	}
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entry[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_STACK_INFO,
+		     stack_info_command,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console command */
+
+static int command_stack_peak(int argc, char **argv)
+{
+	int id, size, used;
+
+	ccputs("Task Name             Peak/Size\n");
+	for (id = 0; id < TASK_ID_COUNT; id++) {
+		if (stack_watch_get(id, &size, &used))
+			continue;
+		ccprintf("%4d %-16s %5d/%5d\n", id, task_get_name(id), used,
+			 size);
+		cflush();
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(stackpeak, command_stack_peak,
+			     NULL,
+			     "Print peak stack usage of tasks");
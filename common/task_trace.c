@@ -0,0 +1,209 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Task switch and interrupt trace.
+ *
+ * The scheduler and the interrupt entry/exit paths append 8-byte records to
+ * a ring buffer, which keeps the last CONFIG_TASK_TRACE_SIZE of them. The
+ * buffer is read with the "tasktrace" console command or EC_CMD_TASK_TRACE,
+ * and util/task_trace_to_chrome.py turns it into a Chrome/Perfetto trace.
+ */
+
+#include "atomic.h"
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "hwtimer.h"
+#include "task_trace.h"
+#include "util.h"
+
+BUILD_ASSERT(POWER_OF_TWO(CONFIG_TASK_TRACE_SIZE));
+BUILD_ASSERT(CONFIG_TASK_TRACE_SIZE <= UINT16_MAX);
+
+#define TRACE_MASK (CONFIG_TASK_TRACE_SIZE - 1)
+
+static volatile struct ec_task_trace_entry trace[CONFIG_TASK_TRACE_SIZE];
+/*
+ * Commit marker of each slot: 1 + the number of the record in it, written
+ * once the record is complete. Records may be interrupted by other records,
+ * so a slot can be claimed but not filled yet.
+ */
+static volatile uint32_t trace_seq[CONFIG_TASK_TRACE_SIZE];
+/* Records since boot; the next one goes to trace[trace_next & mask] */
+static uint32_t trace_next;
+/* Value of trace_next when the trace was last cleared */
+static uint32_t trace_cleared;
+static int trace_running = 1;
+
+void task_trace_record(uint8_t event, uint16_t id)
+{
+	uint32_t n;
+	volatile struct ec_task_trace_entry *e;
+
+	if (!trace_running)
+		return;
+
+	/* An interrupt may record in between, so claim the slot atomically */
+	n = deprecated_atomic_read_add(&trace_next, 1);
+	e = &trace[n & TRACE_MASK];
+	trace_seq[n & TRACE_MASK] = 0;
+	e->time_us = __hw_clock_source_read();
+	e->event = event;
+	e->id = id;
+	trace_seq[n & TRACE_MASK] = n + 1;
+}
+
+void task_trace_start(void)
+{
+	trace_running = 1;
+}
+
+void task_trace_stop(void)
+{
+	trace_running = 0;
+}
+
+void task_trace_clear(void)
+{
+	/*
+	 * Keep counting from where we are, so that the commit markers of the
+	 * old records can't pass for those of new ones.
+	 */
+	trace_cleared = trace_next;
+}
+
+uint32_t task_trace_total(void)
+{
+	return trace_next - trace_cleared;
+}
+
+int task_trace_kept(void)
+{
+	return MIN(task_trace_total(), CONFIG_TASK_TRACE_SIZE);
+}
+
+int task_trace_read(int offset, struct ec_task_trace_entry *out, int max)
+{
+	uint32_t next = trace_next;
+	uint32_t oldest = next - MIN(next - trace_cleared,
+				     CONFIG_TASK_TRACE_SIZE);
+	int kept = next - oldest;
+	int n;
+
+	for (n = 0; offset + n < kept && n < max; n++) {
+		uint32_t i = oldest + offset + n;
+		volatile struct ec_task_trace_entry *e = &trace[i & TRACE_MASK];
+
+		/*
+		 * Stop at a record that is still being written, or that was
+		 * overwritten by a newer one while we copied it.
+		 */
+		if (trace_seq[i & TRACE_MASK] != i + 1)
+			break;
+		out[n].time_us = e->time_us;
+		out[n].event = e->event;
+		out[n].reserved = 0;
+		out[n].id = e->id;
+		if (trace_seq[i & TRACE_MASK] != i + 1)
+			break;
+	}
+
+	return n;
+}
+
+const char *task_trace_event_name(uint8_t event)
+{
+	static const char * const names[] = {
+		[EC_TASK_TRACE_SWITCH] = "switch",
+		[EC_TASK_TRACE_IRQ_ENTER] = "irq_enter",
+		[EC_TASK_TRACE_IRQ_EXIT] = "irq_exit",
+	};
+
+	return event < ARRAY_SIZE(names) ? names[event] : "?";
+}
+
+/*****************************************************************************/
+/* Host command */
+
+static enum ec_status task_trace_command(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_task_trace *p = args->params;
+	struct ec_response_task_trace *r = args->response;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->entry[0]);
+
+	switch (p->cmd) {
+	case EC_TASK_TRACE_READ:
+		break;
+	case EC_TASK_TRACE_CLEAR:
+		task_trace_clear();
+		break;
+	case EC_TASK_TRACE_START:
+		task_trace_start();
+		break;
+	case EC_TASK_TRACE_STOP:
+		task_trace_stop();
+		break;
+	default:
+		return EC_RES_INVALID_PARAM;
+	}
+
+	r->total = task_trace_total();
+	r->size = CONFIG_TASK_TRACE_SIZE;
+	r->kept = task_trace_kept();
+	r->flags = trace_running ? EC_TASK_TRACE_FLAG_RUNNING : 0;
+	r->reserved = 0;
+	r->count = 0;
+	if (p->cmd == EC_TASK_TRACE_READ)
+		r->count = task_trace_read(p->offset, r->entry, max);
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entry[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_TASK_TRACE,
+		     task_trace_command,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console command */
+
+static int command_task_trace(int argc, char **argv)
+{
+	struct ec_task_trace_entry e;
+	int was_running = trace_running;
+	int i, kept;
+
+	if (argc >= 2) {
+		if (!strcasecmp(argv[1], "start"))
+			task_trace_start();
+		else if (!strcasecmp(argv[1], "stop"))
+			task_trace_stop();
+		else if (!strcasecmp(argv[1], "clear"))
+			task_trace_clear();
+		else
+			return EC_ERROR_PARAM1;
+		return EC_SUCCESS;
+	}
+
+	/* Don't trace the printing itself */
+	task_trace_stop();
+	kept = task_trace_kept();
+	ccprintf("%u records, %d kept\n", task_trace_total(), kept);
+	for (i = 0; i < kept; i++) {
+		if (!task_trace_read(i, &e, 1))
+			break;
+		ccprintf("%10u %-9s %d\n", e.time_us,
+			 task_trace_event_name(e.event), e.id);
+		if (!(i % 16))
+			cflush();
+	}
+	trace_running = was_running;
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(tasktrace, command_task_trace,
+			"[start | stop | clear]",
+			"Print or control the task switch and IRQ trace");
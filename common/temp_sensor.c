@@ -9,6 +9,7 @@
 #include "console.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "memmap.h"
 #include "task.h"
 #include "temp_sensor.h"
 #include "thermal.h"
@@ -28,34 +29,39 @@ int temp_sensor_read(enum temp_sensor_id id, int *temp_ptr)
 
 static void update_mapped_memory(void)
 {
+	uint8_t temps[EC_TEMP_SENSOR_ENTRIES + EC_TEMP_SENSOR_B_ENTRIES];
 	int i, t;
-	uint8_t *mptr = host_get_memmap(EC_MEMMAP_TEMP_SENSOR);
-
-	for (i = 0; i < TEMP_SENSOR_COUNT; i++, mptr++) {
-		/*
-		 * Switch to second range if first one is full, or stop if
-		 * second range is also full.
-		 */
-		if (i == EC_TEMP_SENSOR_ENTRIES)
-			mptr = host_get_memmap(EC_MEMMAP_TEMP_SENSOR_B);
-		else if (i >= EC_TEMP_SENSOR_ENTRIES +
-			 EC_TEMP_SENSOR_B_ENTRIES)
-			break;
 
+	/* Stage every reading, so the host never sees half of an update */
+	memcpy(temps, host_get_memmap(EC_MEMMAP_TEMP_SENSOR),
+	       EC_TEMP_SENSOR_ENTRIES);
+	memcpy(temps + EC_TEMP_SENSOR_ENTRIES,
+	       host_get_memmap(EC_MEMMAP_TEMP_SENSOR_B),
+	       EC_TEMP_SENSOR_B_ENTRIES);
+
+	for (i = 0; i < TEMP_SENSOR_COUNT && i < ARRAY_SIZE(temps); i++) {
 		switch (temp_sensor_read(i, &t)) {
 		case EC_ERROR_NOT_POWERED:
-			*mptr = EC_TEMP_SENSOR_NOT_POWERED;
+			temps[i] = EC_TEMP_SENSOR_NOT_POWERED;
 			break;
 		case EC_ERROR_NOT_CALIBRATED:
-			*mptr = EC_TEMP_SENSOR_NOT_CALIBRATED;
+			temps[i] = EC_TEMP_SENSOR_NOT_CALIBRATED;
 			break;
 		case EC_SUCCESS:
-			*mptr = t - EC_TEMP_SENSOR_OFFSET;
+			temps[i] = t - EC_TEMP_SENSOR_OFFSET;
 			break;
 		default:
-			*mptr = EC_TEMP_SENSOR_ERROR;
+			temps[i] = EC_TEMP_SENSOR_ERROR;
 		}
 	}
+
+	/* The fan speeds in between aren't part of the update */
+	memmap_write_begin(MEMMAP_BLOCK_THERMAL);
+	memcpy(host_get_memmap(EC_MEMMAP_TEMP_SENSOR), temps,
+	       EC_TEMP_SENSOR_ENTRIES);
+	memcpy(host_get_memmap(EC_MEMMAP_TEMP_SENSOR_B),
+	       temps + EC_TEMP_SENSOR_ENTRIES, EC_TEMP_SENSOR_B_ENTRIES);
+	memmap_write_end(MEMMAP_BLOCK_THERMAL);
 }
 /* Run after other TEMP tasks, so sensors will have updated first. */
 DECLARE_HOOK(HOOK_SECOND, update_mapped_memory, HOOK_PRIO_TEMP_SENSOR_DONE);
@@ -13,6 +13,7 @@
 #include "fan.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "task.h"
 #include "temp_sensor.h"
 #include "thermal.h"
 #include "throttle_ap.h"
@@ -41,6 +42,132 @@ int thermal_fan_percent(int low, int high, int cur)
 	return 100 * (cur - low) / (high - low);
 }
 
+/*****************************************************************************/
+/* Fan demand filtering */
+
+/* Filtered temperatures are kept in 1/TEMP_FRAC K */
+#define TEMP_FRAC 16
+/* Slopes are kept in 1/(TEMP_FRAC * SLOPE_FRAC) K per pass */
+#define SLOPE_FRAC 16
+/* Weight of a new sample in the slope estimate is 1/2^SLOPE_SHIFT */
+#define SLOPE_SHIFT 2
+
+struct sensor_filter {
+	int valid;
+	int hist[3];	/* Last raw readings (K), newest first */
+	int temp;	/* Filtered temperature (1/TEMP_FRAC K) */
+	int slope;	/* 1/(TEMP_FRAC * SLOPE_FRAC) K per pass */
+};
+
+static struct sensor_filter filters[TEMP_SENSOR_COUNT];
+
+static struct thermal_filter_params filter_params = {
+#ifdef CONFIG_THERMAL_FILTER_MEDIAN
+	.median = 1,
+#endif
+	.ema_shift = CONFIG_THERMAL_FILTER_EMA_SHIFT,
+	.predict_sec = CONFIG_THERMAL_PREDICT_SEC,
+};
+
+void thermal_get_filter_params(struct thermal_filter_params *p)
+{
+	*p = filter_params;
+}
+
+void thermal_set_filter_params(const struct thermal_filter_params *p)
+{
+	filter_params = *p;
+}
+
+static int median3(int a, int b, int c)
+{
+	if (a > b)
+		return b > c ? b : MIN(a, c);
+	return a > c ? a : MIN(b, c);
+}
+
+/*
+ * Feed one reading to a sensor filter. Returns the temperature (1/TEMP_FRAC K)
+ * fan demand should be based on: the filtered temperature, pushed ahead
+ * along the slope while the temperature is rising.
+ */
+static int filter_update(struct sensor_filter *f, int t)
+{
+	const struct thermal_filter_params *p = &filter_params;
+	int sample, prev, ctrl;
+
+	if (!f->valid) {
+		f->hist[1] = f->hist[2] = t;
+		f->temp = t * TEMP_FRAC;
+		f->slope = 0;
+		f->valid = 1;
+	}
+
+	f->hist[2] = f->hist[1];
+	f->hist[1] = f->hist[0];
+	f->hist[0] = t;
+
+	sample = p->median ? median3(f->hist[0], f->hist[1], f->hist[2]) : t;
+
+	prev = f->temp;
+	f->temp += (sample * TEMP_FRAC - f->temp) / (1 << p->ema_shift);
+	f->slope += ((f->temp - prev) * SLOPE_FRAC - f->slope) /
+		    (1 << SLOPE_SHIFT);
+
+	ctrl = f->temp;
+	if (f->slope > 0)
+		ctrl += f->slope * p->predict_sec / SLOPE_FRAC;
+
+	return ctrl;
+}
+
+/*****************************************************************************/
+/* Trace of the thermal control passes */
+
+#if CONFIG_THERMAL_TRACE_SIZE
+static struct ec_thermal_trace_entry trace[CONFIG_THERMAL_TRACE_SIZE];
+static int trace_head;
+static int trace_count;
+static struct mutex trace_lock;
+
+static void trace_record(const int *temp, const int *rv, int ctrl, int fan_pct)
+{
+	struct ec_thermal_trace_entry e = {
+		.time_ms = get_time().val / MSEC,
+		.fan_pct = fan_pct,
+		.ctrl_temp = CLAMP(ctrl / TEMP_FRAC - EC_TEMP_SENSOR_OFFSET, 0,
+				   EC_TEMP_SENSOR_NOT_POWERED - 1),
+	};
+	int i;
+
+	memset(e.temp, EC_TEMP_SENSOR_NOT_PRESENT, sizeof(e.temp));
+	for (i = 0; i < MIN(TEMP_SENSOR_COUNT, EC_THERMAL_TRACE_MAX_TEMPS); i++)
+		e.temp[i] = rv[i] ? EC_TEMP_SENSOR_ERROR :
+			CLAMP(temp[i] - EC_TEMP_SENSOR_OFFSET, 0,
+			      EC_TEMP_SENSOR_NOT_POWERED - 1);
+
+#ifdef CONFIG_FANS
+	if (fan_get_count()) {
+		e.target_rpm = fan_get_rpm_target(FAN_CH(0));
+		e.actual_rpm = fan_get_rpm_actual(FAN_CH(0));
+	}
+#endif
+
+	mutex_lock(&trace_lock);
+	trace[trace_head] = e;
+	trace_head = (trace_head + 1) % CONFIG_THERMAL_TRACE_SIZE;
+	if (trace_count < CONFIG_THERMAL_TRACE_SIZE)
+		trace_count++;
+	mutex_unlock(&trace_lock);
+}
+#else
+static void trace_record(const int *temp, const int *rv, int ctrl, int fan_pct)
+{
+}
+#endif
+
+/*****************************************************************************/
+
 /* The logic below is hard-coded for only three thresholds: WARN, HIGH, HALT.
  * This is just a validity check to be sure we catch any changes in thermal.h
  */
@@ -58,6 +185,9 @@ static void thermal_control(void)
 	int num_sensors_read;
 	int fmax;
 	int temp_fan_configured;
+	int raw[TEMP_SENSOR_COUNT];
+	int read_rv[TEMP_SENSOR_COUNT];
+	int ctrl, ctrl_max;
 
 #ifdef CONFIG_CUSTOM_FAN_CONTROL
 	int temp[TEMP_SENSOR_COUNT];
@@ -69,6 +199,7 @@ static void thermal_control(void)
 	memset(num_valid_limits, 0, sizeof(num_valid_limits));
 	num_sensors_read = 0;
 	fmax = 0;
+	ctrl_max = 0;
 	temp_fan_configured = 0;
 
 	/* go through all the sensors */
@@ -76,16 +207,24 @@ static void thermal_control(void)
 
 		/* read one */
 		rv = temp_sensor_read(i, &t);
+		raw[i] = t;
+		read_rv[i] = rv;
 
 #ifdef CONFIG_CUSTOM_FAN_CONTROL
 		/* Store all sensors value */
 		temp[i] = K_TO_C(t);
 #endif
 
-		if (rv != EC_SUCCESS)
+		if (rv != EC_SUCCESS) {
+			filters[i].valid = 0;
 			continue;
-		else
+		} else {
 			num_sensors_read++;
+		}
+
+		ctrl = filter_update(&filters[i], t);
+		if (ctrl > ctrl_max)
+			ctrl_max = ctrl;
 
 		/* check all the limits */
 		for (j = 0; j < EC_TEMP_THRESH_COUNT; j++) {
@@ -107,9 +246,10 @@ static void thermal_control(void)
 		/* figure out the max fan needed, too */
 		if (thermal_params[i].temp_fan_off &&
 		    thermal_params[i].temp_fan_max) {
-			f = thermal_fan_percent(thermal_params[i].temp_fan_off,
-						thermal_params[i].temp_fan_max,
-						t);
+			f = thermal_fan_percent(
+				thermal_params[i].temp_fan_off * TEMP_FRAC,
+				thermal_params[i].temp_fan_max * TEMP_FRAC,
+				ctrl);
 			if (f > fmax)
 				fmax = f;
 
@@ -203,6 +343,8 @@ static void thermal_control(void)
 #endif
 #endif
 	}
+
+	trace_record(raw, read_rv, ctrl_max, fmax);
 }
 
 /* Wait until after the sensors have been read */
@@ -280,6 +422,44 @@ DECLARE_CONSOLE_COMMAND(thermalset, command_thermalset,
 			"Set thermal parameters (degrees Kelvin)."
 			" Use -1 to skip.");
 
+static int command_thermalfilter(int argc, char **argv)
+{
+	struct thermal_filter_params p = filter_params;
+	char *e;
+	int val[3], i;
+
+	if (argc == 4) {
+		for (i = 0; i < 3; i++) {
+			val[i] = strtoi(argv[i + 1], &e, 0);
+			if (*e || val[i] < 0 || val[i] > 60)
+				return EC_ERROR_PARAM1 + i;
+		}
+		p.median = !!val[0];
+		p.ema_shift = MIN(val[1], 8);
+		p.predict_sec = val[2];
+		thermal_set_filter_params(&p);
+	} else if (argc != 1) {
+		return EC_ERROR_PARAM_COUNT;
+	}
+
+	ccprintf("median %d, ema_shift %d, predict %d s\n",
+		 p.median, p.ema_shift, p.predict_sec);
+	ccprintf("sensor  filtered(K)  slope(cK/s)\n");
+	for (i = 0; i < TEMP_SENSOR_COUNT; i++) {
+		if (!filters[i].valid)
+			continue;
+		ccprintf(" %2d      %4d.%02d     %5d\n", i,
+			 filters[i].temp / TEMP_FRAC,
+			 (filters[i].temp % TEMP_FRAC) * 100 / TEMP_FRAC,
+			 filters[i].slope * 100 / (TEMP_FRAC * SLOPE_FRAC));
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(thermalfilter, command_thermalfilter,
+			"[median ema_shift predict_sec]",
+			"Get/set fan demand temperature filtering");
+
 /*****************************************************************************/
 /* Host commands. We'll reuse the host command number, but this is version 1,
  * not version 0. Different structs, different meanings.
@@ -317,3 +497,31 @@ thermal_command_get_threshold(struct host_cmd_handler_args *args)
 DECLARE_HOST_COMMAND(EC_CMD_THERMAL_GET_THRESHOLD,
 		     thermal_command_get_threshold,
 		     EC_VER_MASK(1));
+
+#if CONFIG_THERMAL_TRACE_SIZE
+static enum ec_status
+thermal_command_trace(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_thermal_trace *p = args->params;
+	struct ec_response_thermal_trace *r = args->response;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->entry[0]);
+	int i;
+
+	max = MIN(max, p->count);
+	r->count = 0;
+	r->num_temps = MIN(TEMP_SENSOR_COUNT, EC_THERMAL_TRACE_MAX_TEMPS);
+
+	mutex_lock(&trace_lock);
+	for (i = p->offset; i < trace_count && r->count < max; i++)
+		r->entry[r->count++] = trace[(trace_head +
+					      CONFIG_THERMAL_TRACE_SIZE - 1 - i) %
+					     CONFIG_THERMAL_TRACE_SIZE];
+	mutex_unlock(&trace_lock);
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entry[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_THERMAL_TRACE,
+		     thermal_command_trace,
+		     EC_VER_MASK(0));
+#endif /* CONFIG_THERMAL_TRACE_SIZE */
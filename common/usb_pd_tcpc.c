@@ -22,6 +22,7 @@
 #include "usb_pd.h"
 #include "usb_pd_config.h"
 #include "usb_pd_tcpm.h"
+#include "usb_pd_timing.h"
 
 #ifdef CONFIG_COMMON_RUNTIME
 #define CPRINTF(format, args...) cprintf(CC_USBPD, format, ## args)
@@ -842,6 +843,8 @@ int tcpc_run(int port, int evt)
 
 	/* incoming packet ? */
 	if (pd_rx_started(port) && pd[port].rx_enabled) {
+		pd_timing_alert(port);
+
 		/* Get message and place at RX buffer head */
 		res = pd[port].rx_head[pd[port].rx_buf_head] =
 			pd_analyze_rx(port,
@@ -12,6 +12,15 @@
 #include "usb_pd.h"
 #include "util.h"
 
+#ifdef CONFIG_USB_SM_STATS
+static void print_sm_stats(const char *name, const struct sm_stats *stats)
+{
+	ccprintf("%s: %u transitions, %u us in state, longest %u us\n", name,
+		 stats->transitions, sm_get_time_in_state(stats),
+		 stats->longest_us);
+}
+#endif
+
 test_export_static int command_pd(int argc, char **argv)
 {
 	int port;
@@ -174,6 +183,12 @@ test_export_static int command_pd(int argc, char **argv)
 				pe_get_flags(port));
 		else
 			ccprintf("\n");
+
+#ifdef CONFIG_USB_SM_STATS
+		print_sm_stats("TC", tc_get_sm_stats(port));
+		if (IS_ENABLED(CONFIG_USB_PE_SM))
+			print_sm_stats("PE", pe_get_sm_stats(port));
+#endif
 	}
 
 	return EC_SUCCESS;
@@ -16,6 +16,7 @@
 #include "usb_pd.h"
 #include "usb_pd_dpm.h"
 #include "usb_tbt_alt_mode.h"
+#include "task.h"
 #include "tcpm.h"
 
 #ifdef CONFIG_COMMON_RUNTIME
@@ -45,6 +46,26 @@ void dpm_set_mode_entry_done(int port)
 void dpm_set_mode_exit_request(int port)
 {
 	dpm[port].mode_exit_request = true;
+
+	/* The PD task may be sleeping until its next deadline */
+	if (IS_ENABLED(CONFIG_USB_PD_TICKLESS))
+		task_wake(PD_PORT_TO_TASK_ID(port));
+}
+
+bool dpm_is_idle(int port)
+{
+	if (dpm[port].mode_exit_request)
+		return false;
+
+	/*
+	 * Mode entry waits for these, and the PD task is woken when they
+	 * change: by a state transition or a chipset hook.
+	 */
+	return dpm[port].mode_entry_done ||
+	       pd_get_data_role(port) != PD_ROLE_DFP ||
+	       chipset_in_or_transitioning_to_state(CHIPSET_STATE_ANY_OFF) ||
+	       pd_get_svids_discovery(port, TCPC_TX_SOP) != PD_DISC_COMPLETE ||
+	       pd_get_modes_discovery(port, TCPC_TX_SOP) != PD_DISC_COMPLETE;
 }
 
 static inline void dpm_clear_mode_exit_request(int port)
@@ -0,0 +1,302 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * USB-PD message latencies.
+ *
+ * Probes on the TCPC alert, the Protocol Layer's receive and transmit paths
+ * and the Policy Engine time each message, and count the latencies in log2
+ * histograms per port, stage and message type. The histograms are in a small
+ * open-addressing table, claimed and updated with interrupts disabled since
+ * the alert and transmit complete probes may run in interrupt context.
+ * They are read with the
+ * "pdtiming" console command, EC_CMD_PD_TIMING and "ectool pdtiming".
+ */
+
+#include "atomic.h"
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "task.h"
+#include "timer.h"
+#include "usb_pd.h"
+#include "usb_pd_tcpm.h"
+#include "usb_pd_timing.h"
+#include "util.h"
+
+/* Slots to try before dropping a latency, when the table is nearly full */
+#define PD_TIMING_MAX_PROBES 8
+
+/*
+ * A message transmitted this long after one was received isn't counted as
+ * the response to it. It is well past tSenderResponse, so late responses
+ * are still counted.
+ */
+#define PD_TIMING_RESPONSE_WINDOW (4 * PD_T_SENDER_RESPONSE)
+
+BUILD_ASSERT(CONFIG_USB_PD_TIMING_ENTRIES <= UINT16_MAX);
+
+struct pd_timing_hist {
+	uint32_t key;		/* 0 if the histogram is free */
+	uint32_t max_us;
+	uint16_t count[EC_PD_TIMING_BUCKETS];
+};
+
+static struct pd_timing_hist hists[CONFIG_USB_PD_TIMING_ENTRIES];
+static uint32_t dropped;
+static uint32_t tx_failed;
+
+/*
+ * Times are the low 32 bits of the EC clock. No bitfields, as the alert and
+ * transmit complete probes may interrupt the others.
+ */
+static struct {
+	uint32_t alert_time;
+	uint32_t rx_time;
+	uint32_t tx_time;
+	uint8_t rx_msg;
+	uint8_t tx_msg;
+	uint8_t alert_pending;
+	uint8_t pe_pending;
+	uint8_t response_pending;
+	uint8_t tx_pending;
+} ports[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+static uint8_t header_to_msg(uint16_t header)
+{
+	uint8_t msg = PD_HEADER_TYPE(header);
+
+	if (PD_HEADER_EXT(header))
+		msg |= EC_PD_TIMING_MSG_EXT;
+	else if (PD_HEADER_CNT(header))
+		msg |= EC_PD_TIMING_MSG_DATA;
+
+	return msg;
+}
+
+static int latency_bucket(uint32_t us)
+{
+	if (us < BIT(EC_PD_TIMING_BUCKET_SHIFT))
+		return 0;
+
+	return MIN(__fls(us) - EC_PD_TIMING_BUCKET_SHIFT + 1,
+		   EC_PD_TIMING_BUCKETS - 1);
+}
+
+static void record(int port, enum ec_pd_timing_stage stage, uint8_t msg,
+		   uint32_t start)
+{
+	uint32_t us = get_time().le.lo - start;
+	uint32_t key = BIT(31) | (port << 16) | (stage << 8) | msg;
+	struct pd_timing_hist *h;
+	uint16_t *count;
+	int i;
+
+	/* --- critical section : claim the histogram and update it --- */
+	interrupt_disable();
+	for (i = 0; i < PD_TIMING_MAX_PROBES; i++) {
+		h = &hists[(key * 2654435761u + i) %
+			   CONFIG_USB_PD_TIMING_ENTRIES];
+		if (!h->key)
+			h->key = key;
+		if (h->key == key)
+			break;
+	}
+	if (i == PD_TIMING_MAX_PROBES) {
+		dropped++;
+	} else {
+		count = &h->count[latency_bucket(us)];
+		if (*count < UINT16_MAX)
+			(*count)++;
+		if (us > h->max_us)
+			h->max_us = us;
+	}
+	interrupt_enable();
+	/* --- end of critical section --- */
+}
+
+void pd_timing_alert(int port)
+{
+	ports[port].alert_time = get_time().le.lo;
+	ports[port].alert_pending = 1;
+}
+
+void pd_timing_rx(int port, uint16_t header)
+{
+	uint8_t msg = header_to_msg(header);
+
+	if (ports[port].alert_pending) {
+		ports[port].alert_pending = 0;
+		record(port, EC_PD_TIMING_ALERT_TO_RX, msg,
+		       ports[port].alert_time);
+	}
+
+	ports[port].rx_time = get_time().le.lo;
+	ports[port].rx_msg = msg;
+	ports[port].pe_pending = 1;
+	ports[port].response_pending = 1;
+}
+
+void pd_timing_pe(int port)
+{
+	if (!ports[port].pe_pending)
+		return;
+
+	ports[port].pe_pending = 0;
+	record(port, EC_PD_TIMING_RX_TO_PE, ports[port].rx_msg,
+	       ports[port].rx_time);
+}
+
+void pd_timing_tx(int port, uint16_t header)
+{
+	if (ports[port].response_pending) {
+		ports[port].response_pending = 0;
+		if (get_time().le.lo - ports[port].rx_time <
+		    PD_TIMING_RESPONSE_WINDOW)
+			record(port, EC_PD_TIMING_RX_TO_TX, ports[port].rx_msg,
+			       ports[port].rx_time);
+	}
+
+	ports[port].tx_msg = header_to_msg(header);
+	ports[port].tx_time = get_time().le.lo;
+	ports[port].tx_pending = 1;
+}
+
+void pd_timing_tx_done(int port, int status)
+{
+	if (!ports[port].tx_pending)
+		return;
+
+	ports[port].tx_pending = 0;
+	if (status == TCPC_TX_COMPLETE_SUCCESS)
+		record(port, EC_PD_TIMING_TX_TO_GOODCRC, ports[port].tx_msg,
+		       ports[port].tx_time);
+	else
+		deprecated_atomic_add(&tx_failed, 1);
+}
+
+void pd_timing_clear(void)
+{
+	memset(hists, 0, sizeof(hists));
+	memset(ports, 0, sizeof(ports));
+	dropped = 0;
+	tx_failed = 0;
+}
+
+static int pd_timing_used(void)
+{
+	int i, n = 0;
+
+	for (i = 0; i < CONFIG_USB_PD_TIMING_ENTRIES; i++)
+		if (hists[i].key)
+			n++;
+
+	return n;
+}
+
+int pd_timing_read(int offset, struct ec_pd_timing_entry *out, int max)
+{
+	const struct pd_timing_hist *h;
+	int i, n = 0;
+
+	for (i = 0; i < CONFIG_USB_PD_TIMING_ENTRIES && n < max; i++) {
+		h = &hists[i];
+		if (!h->key || offset-- > 0)
+			continue;
+		out[n].port = (h->key >> 16) & 0xff;
+		out[n].stage = (h->key >> 8) & 0xff;
+		out[n].msg = h->key & 0xff;
+		out[n].reserved = 0;
+		out[n].max_us = h->max_us;
+		memcpy(out[n].count, h->count, sizeof(h->count));
+		n++;
+	}
+
+	return n;
+}
+
+/*****************************************************************************/
+/* Host command */
+
+static enum ec_status pd_timing_command(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_pd_timing *p = args->params;
+	struct ec_response_pd_timing *r = args->response;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->entry[0]);
+
+	switch (p->cmd) {
+	case EC_PD_TIMING_READ:
+		break;
+	case EC_PD_TIMING_CLEAR:
+		pd_timing_clear();
+		break;
+	default:
+		return EC_RES_INVALID_PARAM;
+	}
+
+	r->dropped = dropped;
+	r->tx_failed = tx_failed;
+	r->entries = pd_timing_used();
+	r->count = 0;
+	r->reserved = 0;
+	if (p->cmd == EC_PD_TIMING_READ)
+		r->count = pd_timing_read(p->offset, r->entry,
+					  MIN(max, UINT8_MAX));
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entry[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_PD_TIMING,
+		     pd_timing_command,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console command */
+
+static const char * const stage_names[] = {
+	[EC_PD_TIMING_ALERT_TO_RX] = "alert-rx",
+	[EC_PD_TIMING_RX_TO_PE] = "rx-pe",
+	[EC_PD_TIMING_RX_TO_TX] = "rx-tx",
+	[EC_PD_TIMING_TX_TO_GOODCRC] = "tx-crc",
+};
+BUILD_ASSERT(ARRAY_SIZE(stage_names) == EC_PD_TIMING_STAGE_COUNT);
+
+static int command_pd_timing(int argc, char **argv)
+{
+	struct ec_pd_timing_entry e;
+	int i, b, used;
+
+	if (argc >= 2) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		pd_timing_clear();
+		return EC_SUCCESS;
+	}
+
+	used = pd_timing_used();
+	ccprintf("%d histograms, %u dropped, %u tx failed\n", used, dropped,
+		 tx_failed);
+	ccprintf("buckets from <%dus, doubling\n",
+		 BIT(EC_PD_TIMING_BUCKET_SHIFT));
+	for (i = 0; i < used; i++) {
+		if (!pd_timing_read(i, &e, 1))
+			break;
+		ccprintf("C%d %-8s %s%-2d max %6uus:", e.port,
+			 stage_names[e.stage],
+			 (e.msg & EC_PD_TIMING_MSG_EXT) ? "ext " :
+			 (e.msg & EC_PD_TIMING_MSG_DATA) ? "data" : "ctrl",
+			 e.msg & EC_PD_TIMING_MSG_TYPE, e.max_us);
+		for (b = 0; b < EC_PD_TIMING_BUCKETS; b++)
+			ccprintf(" %u", e.count[b]);
+		ccprintf("\n");
+		cflush();
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(pdtiming, command_pd_timing,
+			"[clear]",
+			"Print or clear the USB-PD message latency histograms");
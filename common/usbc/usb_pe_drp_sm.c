@@ -22,6 +22,7 @@
 #include "usb_pd_dpm.h"
 #include "usb_pd.h"
 #include "usb_pd_tcpm.h"
+#include "usb_pd_timing.h"
 #include "usb_pe_sm.h"
 #include "usb_tbt_alt_mode.h"
 #include "usb_prl_sm.h"
@@ -910,6 +911,9 @@ void pe_run(int port, int evt, int en)
 			set_state_pe(port, PE_FRS_SNK_SRC_START_AMS);
 		}
 
+		if (PE_CHK_FLAG(port, PE_FLAGS_MSG_RECEIVED))
+			pd_timing_pe(port);
+
 		/* Run state machine */
 		run_state(port, &pe[port].ctx);
 		break;
@@ -1205,6 +1209,10 @@ void pe_got_soft_reset(int port)
 void pd_dpm_request(int port, enum pd_dpm_request req)
 {
 	PE_SET_DPM_REQUEST(port, req);
+
+	/* Requests come from other tasks too, which must not wait a deadline */
+	if (IS_ENABLED(CONFIG_USB_PD_TICKLESS))
+		task_wake(PD_PORT_TO_TASK_ID(port));
 }
 
 void pe_vconn_swap_complete(int port)
@@ -6207,6 +6215,74 @@ const char *pe_get_current_state(int port)
 		return "";
 }
 
+#ifdef CONFIG_USB_SM_STATS
+const struct sm_stats *pe_get_sm_stats(int port)
+{
+	return &pe[port].ctx.stats;
+}
+#endif
+
+#ifdef CONFIG_USB_PD_TICKLESS
+/* Whether the discover identity timer can still start a discovery */
+static bool pe_discovery_needed(int port)
+{
+	enum tcpm_transmit_type type;
+
+	for (type = TCPC_TX_SOP; type <= TCPC_TX_SOP_PRIME; type++)
+		if (pd_get_identity_discovery(port, type) == PD_DISC_NEEDED ||
+		    pd_get_svids_discovery(port, type) == PD_DISC_NEEDED ||
+		    pd_get_modes_discovery(port, type) == PD_DISC_NEEDED)
+			return true;
+
+	return false;
+}
+
+uint64_t pe_get_next_deadline(int port, int en)
+{
+	enum usb_pe_state state = get_state_pe(port);
+	uint64_t deadline;
+
+	/* Paused until the TypeC layer enables PD again */
+	if (local_state[port] == SM_PAUSED && !en)
+		return USB_SM_NO_DEADLINE;
+
+	if (local_state[port] != SM_RUN || !en)
+		return USB_SM_POLL;
+
+	/* Left only on a Hard Reset, which wakes the task */
+	if (state == PE_SRC_DISABLED)
+		return USB_SM_NO_DEADLINE;
+
+	/*
+	 * Only the Ready states wait for long. They act on these flags, DPM
+	 * requests and mode entry/exit as soon as they can.
+	 */
+	if ((state != PE_SRC_READY && state != PE_SNK_READY) ||
+	    PE_CHK_FLAG(port, PE_FLAGS_MSG_RECEIVED |
+			      PE_FLAGS_TX_COMPLETE |
+			      PE_FLAGS_PROTOCOL_ERROR |
+			      PE_FLAGS_MSG_DISCARDED |
+			      PE_FLAGS_FAST_ROLE_SWAP_SIGNALED |
+			      PE_FLAGS_VDM_REQUEST_CONTINUE |
+			      PE_FLAGS_DR_SWAP_TO_DFP |
+			      PE_FLAGS_VCONN_SWAP_TO_ON) ||
+	    pe[port].dpm_request || !dpm_is_idle(port))
+		return USB_SM_POLL;
+
+	deadline = pe[port].wait_and_add_jitter_timer;
+	if (!PE_CHK_FLAG(port, PE_FLAGS_VDM_SETUP_DONE) &&
+	    pe_discovery_needed(port))
+		deadline = MIN(deadline, pe[port].discover_identity_timer);
+	if (state == PE_SRC_READY &&
+	    PE_CHK_FLAG(port, PE_FLAGS_WAITING_PR_SWAP))
+		deadline = MIN(deadline, pe[port].pr_swap_wait_timer);
+	if (state == PE_SNK_READY)
+		deadline = MIN(deadline, pe[port].sink_request_timer);
+
+	return deadline;
+}
+#endif
+
 uint32_t pe_get_flags(int port)
 {
 	return pe[port].flags;
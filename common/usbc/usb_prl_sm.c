@@ -24,6 +24,7 @@
 #include "usb_charge.h"
 #include "usb_mux.h"
 #include "usb_pd.h"
+#include "usb_pd_timing.h"
 #include "usb_pe_sm.h"
 #include "usb_prl_sm.h"
 #include "usb_tc_sm.h"
@@ -296,6 +297,14 @@ static struct pd_message {
 	/* temp chunk buffer */
 	uint32_t tx_chk_buf[CHK_BUF_SIZE];
 	uint32_t rx_chk_buf[CHK_BUF_SIZE];
+	/*
+	 * Data objects to transmit: tx_chk_buf, or the buffer of tx_emsg for
+	 * unchunked messages, which are transmitted in place unless they
+	 * have to wait (see prl_tx_snapshot_msg()).
+	 */
+	const uint32_t *tx_data;
+	/* Bytes copied between message buffers, see prl_get_copy_bytes() */
+	uint32_t copy_bytes;
 	uint32_t chunk_number_expected;
 	uint32_t num_bytes_received;
 #ifdef CONFIG_USB_PD_EXTENDED_MESSAGES
@@ -309,6 +318,10 @@ static struct pd_message {
 struct extended_msg rx_emsg[CONFIG_USB_PD_PORT_MAX_COUNT];
 struct extended_msg tx_emsg[CONFIG_USB_PD_PORT_MAX_COUNT];
 
+/* Unchunked messages are transmitted straight from tx_emsg */
+BUILD_ASSERT(offsetof(struct extended_msg, buf) % sizeof(uint32_t) == 0);
+BUILD_ASSERT(EXTENDED_BUFFER_SIZE >= CHK_BUF_SIZE_BYTES);
+
 /* Common Protocol Layer Message Transmission */
 static void prl_tx_construct_message(int port);
 static void prl_rx_wait_for_phy_message(const int port, int evt);
@@ -453,6 +466,7 @@ static void print_current_tch_state(const int port)
 
 void pd_transmit_complete(int port, int status)
 {
+	pd_timing_tx_done(port, status);
 	prl_tx[port].xmit_status = status;
 }
 
@@ -540,6 +554,39 @@ bool prl_is_busy(int port)
 #endif /* CONFIG_USB_PD_EXTENDED_MESSAGES */
 }
 
+uint32_t prl_get_copy_bytes(int port)
+{
+	return pdmsg[port].copy_bytes;
+}
+
+#ifdef CONFIG_USB_PD_TICKLESS
+uint64_t prl_get_next_deadline(int port, int en)
+{
+	/* Paused until the TypeC layer enables PD again */
+	if (local_state[port] == SM_PAUSED && !en)
+		return USB_SM_NO_DEADLINE;
+
+	/*
+	 * Waiting for a message request, a received message, a hard reset or
+	 * the Policy Engine to complete one is driven by events; every other
+	 * state is timed.
+	 */
+	if (local_state[port] != SM_RUN || !en || prl_is_busy(port) ||
+	    prl_tx_get_state(port) != PRL_TX_WAIT_FOR_MESSAGE_REQUEST ||
+	    (prl_hr_get_state(port) != PRL_HR_WAIT_FOR_REQUEST &&
+	     prl_hr_get_state(port) != PRL_HR_WAIT_FOR_PE_HARD_RESET_COMPLETE) ||
+	    PRL_HR_CHK_FLAG(port, PRL_FLAGS_HARD_RESET_COMPLETE) ||
+	    PRL_TX_CHK_FLAG(port, PRL_FLAGS_MSG_XMIT | PRL_FLAGS_SINK_NG |
+				  PRL_FLAGS_WAIT_SINK_OK) ||
+	    PDMSG_CHK_FLAG(port, PRL_FLAGS_TX_COMPLETE | PRL_FLAGS_TX_ERROR) ||
+	    RCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED) ||
+	    TCH_CHK_FLAG(port, PRL_FLAGS_MSG_RECEIVED | PRL_FLAGS_MSG_XMIT))
+		return USB_SM_POLL;
+
+	return USB_SM_NO_DEADLINE;
+}
+#endif
+
 void prl_set_debug_level(enum debug_level debug_level)
 {
 #ifndef CONFIG_USB_PD_DEBUG_LEVEL
@@ -560,6 +607,7 @@ void prl_send_ctrl_msg(int port,
 	pdmsg[port].xmit_type = type;
 	pdmsg[port].msg_type = msg;
 	pdmsg[port].data_objs = 0;
+	pdmsg[port].tx_data = pdmsg[port].tx_chk_buf;
 	tx_emsg[port].len = 0;
 
 #ifdef CONFIG_USB_PD_EXTENDED_MESSAGES
@@ -723,6 +771,7 @@ static void prl_copy_msg_to_buffer(int port)
 	 */
 	if (tx_emsg[port].len == 0) {
 		pdmsg[port].data_objs = 0;
+		pdmsg[port].tx_data = pdmsg[port].tx_chk_buf;
 		return;
 	}
 
@@ -736,10 +785,13 @@ static void prl_copy_msg_to_buffer(int port)
 	if (tx_emsg[port].len > CHK_BUF_SIZE_BYTES)
 		tx_emsg[port].len = CHK_BUF_SIZE_BYTES;
 
-	/* Copy message to chunked buffer */
-	memset((uint8_t *)pdmsg[port].tx_chk_buf, 0, CHK_BUF_SIZE_BYTES);
-	memcpy((uint8_t *)pdmsg[port].tx_chk_buf, (uint8_t *)tx_emsg[port].buf,
-		tx_emsg[port].len);
+	/*
+	 * The message fits in one chunk, so transmit it from tx_emsg rather
+	 * than copying it to tx_chk_buf. Just zero the padding.
+	 */
+	memset(tx_emsg[port].buf + tx_emsg[port].len, 0,
+	       -tx_emsg[port].len & 3);
+	pdmsg[port].tx_data = (const uint32_t *)tx_emsg[port].buf;
 	/*
 	 * Pad length to 4-byte boundary and
 	 * convert to number of 32-bit objects.
@@ -750,6 +802,27 @@ static void prl_copy_msg_to_buffer(int port)
 	pdmsg[port].data_objs = (tx_emsg[port].len + 3) >> 2;
 }
 
+/*
+ * tcpm_transmit() hands the message to the TCPC, which retries it from its
+ * own buffer, so a message sent in place only has to stay put until then.
+ * When the transmission is deferred for collision avoidance, the Policy
+ * Engine runs again first and may already be building its next message in
+ * tx_emsg. Copy the queued message to tx_chk_buf so the one that goes out
+ * is the one that was requested.
+ */
+static __maybe_unused void prl_tx_snapshot_msg(int port)
+{
+	const uint32_t bytes = pdmsg[port].data_objs * sizeof(uint32_t);
+
+	if (!PRL_TX_CHK_FLAG(port, PRL_FLAGS_MSG_XMIT) ||
+	    pdmsg[port].tx_data != (const uint32_t *)tx_emsg[port].buf)
+		return;
+
+	memcpy(pdmsg[port].tx_chk_buf, tx_emsg[port].buf, bytes);
+	pdmsg[port].copy_bytes += bytes;
+	pdmsg[port].tx_data = pdmsg[port].tx_chk_buf;
+}
+
 static __maybe_unused int pdmsg_xmit_type_is_rev30(const int port)
 {
 	if (IS_ENABLED(CONFIG_USB_PD_REV30))
@@ -897,6 +970,9 @@ static void prl_tx_src_source_tx_entry(const int port)
 	/* Set Rp = SinkTxNG */
 	typec_select_src_collision_rp(port, SINK_TX_NG);
 	typec_update_cc(port);
+
+	/* The message waits for SinkTxTimer */
+	prl_tx_snapshot_msg(port);
 }
 
 static void prl_tx_src_source_tx_run(const int port)
@@ -916,6 +992,9 @@ static void prl_tx_src_source_tx_run(const int port)
 static void prl_tx_snk_start_ams_entry(const int port)
 {
 	print_current_prl_tx_state(port);
+
+	/* The message waits for SinkTxOk */
+	prl_tx_snapshot_msg(port);
 }
 
 static void prl_tx_snk_start_ams_run(const int port)
@@ -1000,8 +1079,9 @@ static void prl_tx_construct_message(const int port)
 	 * should not retry those messages. We do not support that and probably
 	 * never will (since we support chunking).
 	 */
+	pd_timing_tx(port, header);
 	tcpm_transmit(port, pdmsg[port].xmit_type, header,
-		      pdmsg[port].tx_chk_buf);
+		      pdmsg[port].tx_data);
 }
 
 /*
@@ -1091,6 +1171,8 @@ static void prl_tx_src_pending_entry(const int port)
 
 	/* Start SinkTxTimer */
 	prl_tx[port].sink_tx_timer = get_time().val + PD_T_SINK_TX;
+
+	prl_tx_snapshot_msg(port);
 }
 
 static void prl_tx_src_pending_run(const int port)
@@ -1128,6 +1210,8 @@ static void prl_tx_src_pending_run(const int port)
 static void prl_tx_snk_pending_entry(const int port)
 {
 	print_current_prl_tx_state(port);
+
+	prl_tx_snapshot_msg(port);
 }
 
 static void prl_tx_snk_pending_run(const int port)
@@ -1309,6 +1393,7 @@ static void copy_chunk_to_ext(int port)
 	/* Copy chunk into extended message */
 	memcpy((uint8_t *)rx_emsg[port].buf, (uint8_t *)pdmsg[port].rx_chk_buf,
 		pdmsg[port].num_bytes_received);
+	pdmsg[port].copy_bytes += pdmsg[port].num_bytes_received;
 
 	/* Set extended message length */
 	rx_emsg[port].len = pdmsg[port].num_bytes_received;
@@ -1461,6 +1546,7 @@ static void rch_processing_extended_message_run(const int port)
 				pdmsg[port].num_bytes_received),
 				(uint8_t *)pdmsg[port].rx_chk_buf + 2,
 				byte_num);
+		pdmsg[port].copy_bytes += byte_num;
 		/* increment chunk number expected */
 		pdmsg[port].chunk_number_expected++;
 		/* adjust num bytes received */
@@ -1501,6 +1587,7 @@ static void rch_requesting_chunk_entry(const int port)
 				1, /* Request Chunk */
 				0 /* Data Size */
 				);
+	pdmsg[port].tx_data = pdmsg[port].tx_chk_buf;
 
 	pdmsg[port].data_objs = 1;
 	pdmsg[port].ext = 1;
@@ -1766,6 +1853,8 @@ static void tch_construct_chunked_message_entry(const int port)
 	memset(data, 0, 28);
 	memcpy(data, tx_emsg[port].buf + pdmsg[port].send_offset, num);
 	pdmsg[port].send_offset += num;
+	pdmsg[port].copy_bytes += num;
+	pdmsg[port].tx_data = pdmsg[port].tx_chk_buf;
 
 	/*
 	 * Add in 2 bytes for extended header
@@ -1982,6 +2071,8 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 	    tcpm_dequeue_message(port, pdmsg[port].rx_chk_buf, &header))
 		return;
 
+	pd_timing_rx(port, header);
+
 	rx_emsg[port].header = header;
 	type = PD_HEADER_TYPE(header);
 	cnt = PD_HEADER_CNT(header);
@@ -7,6 +7,7 @@
 #include "console.h"
 #include "stdbool.h"
 #include "task.h"
+#include "timer.h"
 #include "usb_pd.h"
 #include "usb_sm.h"
 #include "util.h"
@@ -29,34 +30,39 @@ struct internal_ctx {
 BUILD_ASSERT(sizeof(struct internal_ctx) ==
 	     member_size(struct sm_ctx, internal));
 
+/* Number of levels of the hierarchy of a state, including the state */
+static int state_depth(usb_state_ptr s)
+{
+	int depth = 0;
+
+	for (; s != NULL; s = s->parent)
+		depth++;
+
+	return depth;
+}
+
 /* Gets the first shared parent state between a and b (inclusive) */
 static usb_state_ptr shared_parent_state(usb_state_ptr a, usb_state_ptr b)
 {
-	const usb_state_ptr orig_b = b;
-
-	/* There are no common ancestors */
-	if (b == NULL)
-		return NULL;
+	int depth_a = state_depth(a);
+	int depth_b = state_depth(b);
 
-	/* This assumes that both A and B are NULL terminated without cycles */
-	while (a != NULL) {
-		/* We found a match return */
-		if (a == b)
-			return a;
+	/* Bring the deeper state up to the level of the other one */
+	for (; depth_a > depth_b; depth_a--)
+		a = a->parent;
+	for (; depth_b > depth_a; depth_b--)
+		b = b->parent;
 
-		/*
-		 * Otherwise, increment b down the list for comparison until we
-		 * run out, then increment a and start over on b for comparison
-		 */
-		if (b->parent == NULL) {
-			a = a->parent;
-			b = orig_b;
-		} else {
-			b = b->parent;
-		}
+	/*
+	 * Then go up both hierarchies in step until they meet, at the latest
+	 * above the top states (NULL) if there are no common ancestors.
+	 */
+	while (a != b) {
+		a = a->parent;
+		b = b->parent;
 	}
 
-	return NULL;
+	return a;
 }
 
 /*
@@ -67,24 +73,35 @@ static usb_state_ptr shared_parent_state(usb_state_ptr a, usb_state_ptr b)
 static void call_entry_functions(const int port,
 			       struct internal_ctx *const internal,
 			       const usb_state_ptr stop,
-			       const usb_state_ptr current)
+			       usb_state_ptr current)
 {
-	if (current == stop)
-		return;
+	usb_state_ptr to_enter[USB_SM_MAX_DEPTH];
+	int n = 0;
 
-	call_entry_functions(port, internal, stop, current->parent);
+	/* Collect the states to enter, children first */
+	for (; current != stop && n < USB_SM_MAX_DEPTH;
+	       current = current->parent)
+		to_enter[n++] = current;
 
-	/*
-	 * If the previous entry function called set_state, then don't enter
-	 * remaining states.
-	 */
-	if (!internal->enter)
-		return;
+	/* Else the hierarchy is deeper than USB_SM_MAX_DEPTH */
+	ASSERT(current == stop);
+
+	while (n-- > 0) {
+		/*
+		 * If the previous entry function called set_state, then don't
+		 * enter remaining states.
+		 */
+		if (!internal->enter)
+			return;
 
-	/* Track the latest state that was entered, so we can exit properly. */
-	internal->last_entered = current;
-	if (current->entry)
-		current->entry(port);
+		/*
+		 * Track the latest state that was entered, so we can exit
+		 * properly.
+		 */
+		internal->last_entered = to_enter[n];
+		if (to_enter[n]->entry)
+			to_enter[n]->entry(port);
+	}
 }
 
 /*
@@ -92,16 +109,34 @@ static void call_entry_functions(const int port,
  * during an exit function.
  */
 static void call_exit_functions(const int port, const usb_state_ptr stop,
-			      const usb_state_ptr current)
+			      usb_state_ptr current)
 {
-	if (current == stop)
-		return;
+	for (; current != stop; current = current->parent) {
+		if (current->exit)
+			current->exit(port);
+	}
+}
 
-	if (current->exit)
-		current->exit(port);
+#ifdef CONFIG_USB_SM_STATS
+static void update_stats(struct sm_ctx *const ctx)
+{
+	struct sm_stats *const stats = &ctx->stats;
+	uint32_t now = get_time().le.lo;
+	uint32_t held = now - stats->entered_us;
+
+	if (stats->transitions && held > stats->longest_us) {
+		stats->longest_us = held;
+		stats->longest = ctx->current;
+	}
+	stats->transitions++;
+	stats->entered_us = now;
+}
 
-	call_exit_functions(port, stop, current->parent);
+uint32_t sm_get_time_in_state(const struct sm_stats *stats)
+{
+	return get_time().le.lo - stats->entered_us;
 }
+#endif
 
 void set_state(const int port, struct sm_ctx *const ctx,
 	       const usb_state_ptr new_state)
@@ -138,6 +173,9 @@ void set_state(const int port, struct sm_ctx *const ctx,
 	call_exit_functions(port, shared_parent, last_state);
 	internal->exit = false;
 
+#ifdef CONFIG_USB_SM_STATS
+	update_stats(ctx);
+#endif
 	ctx->previous = ctx->current;
 	ctx->current = new_state;
 
@@ -170,33 +208,21 @@ void set_state(const int port, struct sm_ctx *const ctx,
 		task_wake(PD_PORT_TO_TASK_ID(port));
 }
 
-/*
- * Call all run functions of children before parents. If set_state is called
- * during one of the entry functions, then do not call any remaining entry
- * functions.
- */
-static void call_run_functions(const int port,
-			     const struct internal_ctx *const internal,
-			     const usb_state_ptr current)
-{
-	if (!current)
-		return;
-
-	/* If set_state is called during run, don't call remain functions. */
-	if (!internal->running)
-		return;
-
-	if (current->run)
-		current->run(port);
-
-	call_run_functions(port, internal, current->parent);
-}
-
 void run_state(const int port, struct sm_ctx *const ctx)
 {
 	struct internal_ctx * const internal = (void *) ctx->internal;
+	usb_state_ptr current;
 
+	/*
+	 * Call all run functions of children before parents. If set_state is
+	 * called during one of the run functions, then do not call any
+	 * remaining run functions.
+	 */
 	internal->running = true;
-	call_run_functions(port, internal, ctx->current);
+	for (current = ctx->current; current != NULL && internal->running;
+	     current = current->parent) {
+		if (current->run)
+			current->run(port);
+	}
 	internal->running = false;
 }
@@ -734,6 +734,74 @@ const char *tc_get_current_state(int port)
 		return "";
 }
 
+#ifdef CONFIG_USB_SM_STATS
+const struct sm_stats *tc_get_sm_stats(int port)
+{
+	return &tc[port].ctx.stats;
+}
+#endif
+
+#ifdef CONFIG_USB_PD_TICKLESS
+uint64_t tc_get_next_deadline(int port)
+{
+	enum usb_tc_state state = get_state_tc(port);
+
+	/* Requests which the run functions act on as soon as they can */
+	if (TC_CHK_FLAG(port, TC_FLAGS_CHECK_CONNECTION |
+			      TC_FLAGS_HARD_RESET_REQUESTED |
+			      TC_FLAGS_PR_SWAP_IN_PROGRESS |
+			      TC_FLAGS_POWER_OFF_SNK |
+			      TC_FLAGS_REQUEST_PR_SWAP |
+			      TC_FLAGS_REQUEST_DR_SWAP |
+			      TC_FLAGS_REQUEST_VC_SWAP_ON |
+			      TC_FLAGS_REQUEST_VC_SWAP_OFF |
+			      TC_FLAGS_CTVPD_DETECTED))
+		return USB_SM_POLL;
+
+	/*
+	 * CC and VBUS changes raise an event, so the stable states only need
+	 * to run for their own timers.
+	 */
+	if (state == TC_UNATTACHED_SNK)
+		return drp_state[port] == PD_DRP_TOGGLE_ON ?
+			tc[port].next_role_swap : USB_SM_NO_DEADLINE;
+
+	if (state == TC_UNATTACHED_SRC) {
+		if (IS_ENABLED(CONFIG_USBC_PPC) &&
+		    ppc_is_port_latched_off(port))
+			return USB_SM_POLL;
+		return drp_state[port] != PD_DRP_FORCE_SOURCE &&
+		       drp_state[port] != PD_DRP_FREEZE ?
+			tc[port].next_role_swap : USB_SM_NO_DEADLINE;
+	}
+
+	/* Rp value changes are debounced while there is no contract */
+	if (state == TC_ATTACHED_SNK)
+		return tc[port].cc_debounce && !pe_is_explicit_contract(port) ?
+			tc[port].cc_debounce : USB_SM_NO_DEADLINE;
+
+	/* PD is enabled once the power supply is on */
+	if (state == TC_ATTACHED_SRC)
+		return tc[port].timeout ?
+			tc[port].timeout : USB_SM_NO_DEADLINE;
+
+	if (IS_ENABLED(CONFIG_USB_PD_DUAL_ROLE_AUTO_TOGGLE) &&
+	    state == TC_DRP_AUTO_TOGGLE)
+		return tc[port].timeout;
+
+	if (IS_ENABLED(CONFIG_USB_PD_TCPC_LOW_POWER) &&
+	    state == TC_LOW_POWER_MODE) {
+		if (TC_CHK_FLAG(port, TC_FLAGS_LPM_ENGAGED))
+			return USB_SM_NO_DEADLINE;
+		if (tc[port].tasks_preventing_lpm)
+			return USB_SM_POLL;
+		return tc[port].low_power_time;
+	}
+
+	return USB_SM_POLL;
+}
+#endif
+
 uint32_t tc_get_flags(int port)
 {
 	return tc[port].flags;
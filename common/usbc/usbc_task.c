@@ -38,6 +38,12 @@
 #define CPRINTS(format, args...) cprints(CC_USBPD, format, ## args)
 
 static uint8_t paused[CONFIG_USB_PD_PORT_MAX_COUNT];
+static uint32_t wakeups[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+#ifdef CONFIG_USB_PD_TICKLESS
+/* How long to wait for an event before running the state machines again */
+static int next_timeout[CONFIG_USB_PD_PORT_MAX_COUNT];
+#endif
 
 void tc_pause_event_loop(int port)
 {
@@ -56,11 +62,58 @@ void tc_start_event_loop(int port)
 	}
 }
 
+uint32_t tc_get_event_loop_wakeups(int port)
+{
+	return wakeups[port];
+}
+
+#ifdef CONFIG_USB_PD_TICKLESS
+/*
+ * Returns how long to wait for an event after running the state machines:
+ * until the earliest deadline they report, or the regular polling interval
+ * if one of them is busy.
+ */
+static int get_next_timeout(int port, uint32_t evt)
+{
+	uint64_t deadline = USB_SM_NO_DEADLINE;
+	uint64_t now;
+
+	/*
+	 * An event may have left work for a state machine which had already
+	 * run, so poll once before sleeping for longer.
+	 */
+	if (IS_ENABLED(CONFIG_USB_PD_TCPC) || (evt & ~TASK_EVENT_TIMER))
+		return USBC_EVENT_TIMEOUT;
+
+	if (IS_ENABLED(CONFIG_USB_TYPEC_SM))
+		deadline = MIN(deadline, tc_get_next_deadline(port));
+	if (IS_ENABLED(CONFIG_USB_PE_SM))
+		deadline = MIN(deadline, pe_get_next_deadline(port,
+						tc_get_pd_enabled(port)));
+	if (IS_ENABLED(CONFIG_USB_PRL_SM))
+		deadline = MIN(deadline, prl_get_next_deadline(port,
+						tc_get_pd_enabled(port)));
+
+	if (deadline == USB_SM_NO_DEADLINE)
+		return -1;
+
+	now = get_time().val;
+	if (deadline <= now)
+		return USBC_EVENT_TIMEOUT;
+
+	/* The timers expire once the time is past them */
+	return MIN(deadline - now + 1, INT32_MAX);
+}
+#endif
+
 static void pd_task_init(int port)
 {
 	if (IS_ENABLED(CONFIG_USB_TYPEC_SM))
 		tc_state_init(port);
 	paused[port] = 0;
+#ifdef CONFIG_USB_PD_TICKLESS
+	next_timeout[port] = USBC_EVENT_TIMEOUT;
+#endif
 
 	/*
 	 * Since most boards configure the TCPC interrupt as edge
@@ -75,11 +128,15 @@ static void pd_task_init(int port)
 
 static bool pd_task_loop(int port)
 {
+#ifdef CONFIG_USB_PD_TICKLESS
+	const int timeout = next_timeout[port];
+#else
+	const int timeout = USBC_EVENT_TIMEOUT;
+#endif
 	/* wait for next event/packet or timeout expiration */
-	const uint32_t evt =
-		task_wait_event(paused[port]
-					? -1
-					: USBC_EVENT_TIMEOUT);
+	const uint32_t evt = task_wait_event(paused[port] ? -1 : timeout);
+
+	wakeups[port]++;
 
 	/*
 	 * Re-use TASK_EVENT_RESET_DONE in tests to restart the USB task
@@ -111,6 +168,10 @@ static bool pd_task_loop(int port)
 	if (IS_ENABLED(CONFIG_USB_TYPEC_SM))
 		tc_run(port);
 
+#ifdef CONFIG_USB_PD_TICKLESS
+	next_timeout[port] = get_next_timeout(port, evt);
+#endif
+
 	return true;
 }
 
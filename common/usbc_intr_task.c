@@ -10,6 +10,7 @@
 #include "timer.h"
 #include "usb_mux.h"
 #include "usb_pd.h"
+#include "usb_pd_timing.h"
 
 #define CPRINTF(format, args...) cprintf(CC_USBPD, format, ## args)
 #define CPRINTS(format, args...) cprints(CC_USBPD, format, ## args)
@@ -29,6 +30,7 @@ static uint8_t pd_int_task_id[CONFIG_USB_PD_PORT_MAX_COUNT];
 
 void schedule_deferred_pd_interrupt(const int port)
 {
+	pd_timing_alert(port);
 	task_set_event(pd_int_task_id[port], PD_PROCESS_INTERRUPT, 0);
 }
 
@@ -33,11 +33,25 @@ struct vboot_hash_tag {
 #define VBOOT_HASH_SYSJUMP_TAG 0x5648 /* "VH" */
 #define VBOOT_HASH_SYSJUMP_VERSION 1
 
-#define CHUNK_SIZE 1024       /* Bytes to hash per deferred call */
+#define CHUNK_SIZE CONFIG_VBOOT_HASH_CHUNK_SIZE /* Bytes read at a time */
 #define WORK_INTERVAL_US 100  /* Delay between deferred calls */
+/* Times the blocking hash waits for shared memory before giving up */
+#define BUSY_RETRIES (SECOND / WORK_INTERVAL_US)
+
+#ifdef CONFIG_FLASH_READ_ASYNC
+/*
+ * Chunks per call: the second one is read while the first one is hashed.
+ * The buffer is only held for the call, so the read of the first chunk of
+ * each call doesn't overlap with hashing.
+ */
+#define CHUNK_BUFS 2
+#else
+#define CHUNK_BUFS 1
+#endif
+#define CALL_SIZE (CHUNK_BUFS * CHUNK_SIZE) /* Bytes per deferred call */
 
-/* Check that CHUNK_SIZE fits in shared memory. */
-SHARED_MEM_CHECK_SIZE(CHUNK_SIZE);
+/* Check that the chunks fit in shared memory. */
+SHARED_MEM_CHECK_SIZE(CALL_SIZE);
 
 static uint32_t data_offset;
 static uint32_t data_size;
@@ -45,6 +59,8 @@ static uint32_t curr_pos;
 static const uint8_t *hash;   /* Hash, or NULL if not valid */
 static int want_abort;
 static int in_progress;
+static timestamp_t start_time;
+static uint32_t hash_time_us; /* Time the last hash took */
 #define VBOOT_HASH_DEFERRED	true
 #define VBOOT_HASH_BLOCKING	false
 
@@ -73,7 +89,56 @@ void vboot_hash_abort(void)
 static void vboot_hash_next_chunk(void);
 DECLARE_DEFERRED(vboot_hash_next_chunk);
 
-#ifndef CONFIG_MAPPED_STORAGE
+#ifdef CONFIG_FLASH_READ_ASYNC
+
+/*
+ * Hash up to two chunks at curr_pos, the flash reading the second one in the
+ * background while the first one is hashed.
+ */
+static int read_ahead_and_hash_chunks(int size)
+{
+	uint32_t offset = data_offset + curr_pos;
+	int first = MIN(size, CHUNK_SIZE);
+	int second = size - first;
+	char *buf;
+	int rv;
+
+	if (size == 0)
+		return EC_SUCCESS;
+
+	rv = shared_mem_acquire(size, &buf);
+	if (rv == EC_ERROR_BUSY) {
+		/* Couldn't update hash right now; try again later */
+		return rv;
+	} else if (rv != EC_SUCCESS) {
+		vboot_hash_abort();
+		return rv;
+	}
+
+	rv = flash_physical_read_async(offset, first, buf);
+	if (rv == EC_SUCCESS)
+		rv = flash_physical_read_wait();
+	if (rv == EC_SUCCESS && second)
+		rv = flash_physical_read_async(offset + first, second,
+					       buf + first);
+	if (rv == EC_SUCCESS)
+		SHA256_update(&ctx, (const uint8_t *)buf, first);
+	if (rv == EC_SUCCESS && second) {
+		rv = flash_physical_read_wait();
+		if (rv == EC_SUCCESS)
+			SHA256_update(&ctx, (const uint8_t *)buf + first,
+				      second);
+	}
+	if (rv != EC_SUCCESS)
+		vboot_hash_abort();
+
+	shared_mem_release(buf);
+	return rv;
+}
+
+#endif /* CONFIG_FLASH_READ_ASYNC */
+
+#if !defined(CONFIG_MAPPED_STORAGE) && !defined(CONFIG_FLASH_READ_ASYNC)
 
 static int read_and_hash_chunk(int offset, int size)
 {
@@ -86,8 +151,6 @@ static int read_and_hash_chunk(int offset, int size)
 	rv = shared_mem_acquire(size, &buf);
 	if (rv == EC_ERROR_BUSY) {
 		/* Couldn't update hash right now; try again later */
-		hook_call_deferred(&vboot_hash_next_chunk_data,
-				   WORK_INTERVAL_US);
 		return rv;
 	} else if (rv != EC_SUCCESS) {
 		vboot_hash_abort();
@@ -112,33 +175,69 @@ static int read_and_hash_chunk(int offset, int size)
 #define SHA256_PRINT_SIZE 4
 #endif
 
-static void hash_next_chunk(size_t size)
+/**
+ * Hash size bytes at curr_pos, at most CALL_SIZE.
+ *
+ * @return EC_SUCCESS, EC_ERROR_BUSY if shared memory is in use, so the chunk
+ * has to be tried again later, or another error if the hash was aborted.
+ */
+static int hash_next_chunk(size_t size)
 {
-#ifdef CONFIG_MAPPED_STORAGE
+#if defined(CONFIG_FLASH_READ_ASYNC)
+	return read_ahead_and_hash_chunks(size);
+#elif defined(CONFIG_MAPPED_STORAGE)
 	flash_lock_mapped_storage(1);
 	SHA256_update(&ctx, (const uint8_t *)(CONFIG_MAPPED_STORAGE_BASE +
 					      data_offset + curr_pos), size);
 	flash_lock_mapped_storage(0);
+	return EC_SUCCESS;
 #else
-	if (read_and_hash_chunk(data_offset + curr_pos, size) != EC_SUCCESS)
-		return;
+	return read_and_hash_chunk(data_offset + curr_pos, size);
 #endif
 }
 
-static void vboot_hash_all_chunks(void)
+/* Store the final hash */
+static void hash_done(void)
 {
-	do {
-		size_t size = MIN(CHUNK_SIZE, data_size - curr_pos);
-		hash_next_chunk(size);
-		curr_pos += size;
-	} while (curr_pos < data_size);
-
 	hash = SHA256_final(&ctx);
-	CPRINTS("hash done %ph", HEX_BUF(hash, SHA256_PRINT_SIZE));
+	hash_time_us = get_time().val - start_time.val;
+	CPRINTS("hash done %ph in %d us", HEX_BUF(hash, SHA256_PRINT_SIZE),
+		hash_time_us);
+	in_progress = 0;
+	clock_enable_module(MODULE_FAST_CPU, 0);
+}
+
+/* Stop hashing, after an abort */
+static void hash_aborted(void)
+{
 	in_progress = 0;
 	clock_enable_module(MODULE_FAST_CPU, 0);
+	vboot_hash_abort();
+}
+
+static int vboot_hash_all_chunks(void)
+{
+	int retries = 0;
+	int rv;
+
+	do {
+		size_t size = MIN(CALL_SIZE, data_size - curr_pos);
+
+		rv = hash_next_chunk(size);
+		if (rv == EC_ERROR_BUSY && ++retries < BUSY_RETRIES) {
+			/* Wait for shared memory, and hash the same chunk */
+			usleep(WORK_INTERVAL_US);
+			continue;
+		} else if (rv != EC_SUCCESS) {
+			hash_aborted();
+			return rv;
+		}
+		retries = 0;
+		curr_pos += size;
+	} while (curr_pos < data_size);
 
-	return;
+	hash_done();
+	return EC_SUCCESS;
 }
 
 /**
@@ -150,25 +249,22 @@ static void vboot_hash_next_chunk(void)
 
 	/* Handle abort */
 	if (want_abort) {
-		in_progress = 0;
-		clock_enable_module(MODULE_FAST_CPU, 0);
-		vboot_hash_abort();
+		hash_aborted();
 		return;
 	}
 
 	/* Compute the next chunk of hash */
-	size = MIN(CHUNK_SIZE, data_size - curr_pos);
-	hash_next_chunk(size);
+	size = MIN(CALL_SIZE, data_size - curr_pos);
+	if (hash_next_chunk(size) == EC_ERROR_BUSY) {
+		/* Try the same chunk again when shared memory is free */
+		hook_call_deferred(&vboot_hash_next_chunk_data,
+				   WORK_INTERVAL_US);
+		return;
+	}
 
 	curr_pos += size;
 	if (curr_pos >= data_size) {
-		/* Store the final hash */
-		hash = SHA256_final(&ctx);
-		CPRINTS("hash done %ph", HEX_BUF(hash, SHA256_PRINT_SIZE));
-
-		in_progress = 0;
-
-		clock_enable_module(MODULE_FAST_CPU, 0);
+		hash_done();
 
 		/* Handle receiving abort during finalize */
 		if (want_abort)
@@ -221,6 +317,8 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 	hash = NULL;
 	want_abort = 0;
 	in_progress = 1;
+	start_time = get_time();
+	hash_time_us = 0;
 
 	/* Restart the hash computation */
 	CPRINTS("hash start 0x%08x 0x%08x", offset, size);
@@ -228,11 +326,10 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 	if (nonce_size)
 		SHA256_update(&ctx, nonce, nonce_size);
 
-	if (deferred)
-		hook_call_deferred(&vboot_hash_next_chunk_data, 0);
-	else
-		vboot_hash_all_chunks();
+	if (!deferred)
+		return vboot_hash_all_chunks();
 
+	hook_call_deferred(&vboot_hash_next_chunk_data, 0);
 	return EC_SUCCESS;
 }
 
@@ -380,6 +477,9 @@ static int command_hash(int argc, char **argv)
 			ccprintf("%ph\n", HEX_BUF(hash, SHA256_DIGEST_SIZE));
 		else
 			ccprintf("(invalid)\n");
+		if (hash)
+			ccprintf("Time:   %d us in %d byte chunks\n",
+				 hash_time_us, CHUNK_SIZE);
 
 		return EC_SUCCESS;
 	}
@@ -487,21 +587,36 @@ static int host_start_hash(const struct ec_params_vboot_hash *p)
 		return EC_RES_ERROR;
 }
 
+/* Fill in the response of the version of the command */
+static void fill_response_version(struct host_cmd_handler_args *args,
+				  int request_offset)
+{
+	struct ec_response_vboot_hash_v1 *r = args->response;
+
+	fill_response(&r->v0, request_offset);
+	args->response_size = sizeof(r->v0);
+
+	if (args->version >= 1) {
+		r->hash_time_us = r->v0.status == EC_VBOOT_HASH_STATUS_DONE ?
+				  hash_time_us : 0;
+		r->chunk_size = CHUNK_SIZE;
+		args->response_size = sizeof(*r);
+	}
+}
+
 static enum ec_status
 host_command_vboot_hash(struct host_cmd_handler_args *args)
 {
 	const struct ec_params_vboot_hash *p = args->params;
-	struct ec_response_vboot_hash *r = args->response;
 	int rv;
 
 	switch (p->cmd) {
 	case EC_VBOOT_HASH_GET:
 		if (p->offset || p->size)
-			fill_response(r, p->offset);
+			fill_response_version(args, p->offset);
 		else
-			fill_response(r, data_offset);
+			fill_response_version(args, data_offset);
 
-		args->response_size = sizeof(*r);
 		return EC_RES_SUCCESS;
 
 	case EC_VBOOT_HASH_ABORT:
@@ -519,8 +634,7 @@ host_command_vboot_hash(struct host_cmd_handler_args *args)
 			while (in_progress)
 				usleep(1000);
 
-		fill_response(r, p->offset);
-		args->response_size = sizeof(*r);
+		fill_response_version(args, p->offset);
 		return EC_RES_SUCCESS;
 
 	default:
@@ -529,4 +643,4 @@ host_command_vboot_hash(struct host_cmd_handler_args *args)
 }
 DECLARE_HOST_COMMAND(EC_CMD_VBOOT_HASH,
 		     host_command_vboot_hash,
-		     EC_VER_MASK(0));
+		     EC_VER_MASK(0) | EC_VER_MASK(1));
@@ -73,4 +73,20 @@ static inline uint32_t deprecated_atomic_read_clear(uint32_t volatile *addr)
 
 	return ret;
 }
+
+static inline uint32_t deprecated_atomic_read_add(uint32_t volatile *addr,
+						  uint32_t value)
+{
+	uint32_t ret, tmp, sum;
+
+	__asm__ __volatile__("1: ldrex   %0, [%3]\n"
+			     "   add     %2, %0, %4\n"
+			     "   strex   %1, %2, [%3]\n"
+			     "   teq     %1, #0\n"
+			     "   bne     1b"
+			     : "=&r" (ret), "=&r" (tmp), "=&r" (sum)
+			     : "r" (addr), "r" (value) : "cc");
+
+	return ret;
+}
 #endif  /* __CROS_EC_ATOMIC_H */
@@ -19,6 +19,9 @@
 #define ST_TICKINT             BIT(1)
 #define ST_CLKSOURCE           BIT(2)
 #define ST_COUNTFLAG           BIT(16)
+#define CPU_NVIC_ST_RELOAD     CPUREG(0xE000E014)
+#define ST_RELOAD_MAX          0x00ffffff
+#define CPU_NVIC_ST_CURRENT    CPUREG(0xE000E018)
 
 /* Nested Vectored Interrupt Controller */
 #define CPU_NVIC_EN(x)         CPUREG(0xe000e100 + 4 * (x))
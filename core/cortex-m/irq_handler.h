@@ -8,7 +8,7 @@
 #ifndef __CROS_EC_IRQ_HANDLER_H
 #define __CROS_EC_IRQ_HANDLER_H
 
-#ifdef CONFIG_TASK_PROFILING
+#if defined(CONFIG_TASK_PROFILING) || defined(CONFIG_TASK_TRACE)
 #define bl_task_start_irq_handler "bl task_start_irq_handler\n"
 #else
 #define bl_task_start_irq_handler ""
@@ -281,6 +281,8 @@ void panic_data_print(const struct panic_data *pdata)
 	print_reg(13, lregs, in_handler ? 2 : 0);
 	print_reg(14, sregs, 5);
 	print_reg(15, sregs, 6);
+	if (pdata->flags & PANIC_DATA_FLAG_STACK_TASK)
+		panic_printf("Stack overflow in task %d\n", pdata->stack_task);
 
 #ifdef CONFIG_DEBUG_EXCEPTIONS
 	panic_show_extra(pdata);
@@ -295,13 +297,14 @@ void __keep report_panic(void)
 	 */
 	struct panic_data *pdata = pdata_ptr;
 	uint32_t sp;
+	int task;
 
 	pdata->magic = PANIC_DATA_MAGIC;
 	pdata->struct_size = sizeof(*pdata);
 	pdata->struct_version = 2;
 	pdata->arch = PANIC_ARCH_CORTEX_M;
 	pdata->flags = 0;
-	pdata->reserved = 0;
+	pdata->stack_task = 0;
 
 	/* Choose the right sp (psp or msp) based on EXC_RETURN value */
 	sp = is_frame_in_handler_stack(pdata->cm.regs[11])
@@ -325,6 +328,13 @@ void __keep report_panic(void)
 	pdata->cm.hfsr = CPU_NVIC_HFSR;
 	pdata->cm.dfsr = CPU_NVIC_DFSR;
 
+	/* Record whose stack overflowed, whether or not it caused the panic */
+	task = task_find_stack_overflow();
+	if (task >= 0) {
+		pdata->stack_task = task;
+		pdata->flags |= PANIC_DATA_FLAG_STACK_TASK;
+	}
+
 #ifdef CONFIG_UART_PAD_SWITCH
 	uart_reset_default_pad_panic();
 #endif
@@ -0,0 +1,77 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Profiler sampling timer for Cortex-M: SysTick, which the EC doesn't use
+ * otherwise. SysTick is clocked by the core and some chips (MCHP) turn it off
+ * for deep sleep without turning it back on, so the profiler keeps the EC out
+ * of deep sleep while it runs.
+ */
+
+#include "clock.h"
+#include "common.h"
+#include "cpu.h"
+#include "ec_commands.h"
+#include "profiler.h"
+#include "task.h"
+
+uintptr_t profiler_pc_base(void)
+{
+	return 0;
+}
+
+/**
+ * Count the sample taken by the SysTick exception.
+ *
+ * @param pc		PC in the exception frame.
+ * @param exc_return	EXC_RETURN value of the exception, which tells if
+ *			a task (thread mode) or an interrupt was interrupted.
+ */
+void __attribute__((used)) profiler_tick(uint32_t pc, uint32_t exc_return)
+{
+	profiler_sample(pc, (exc_return & BIT(3)) ? task_get_current() :
+			EC_PROFILER_TASK_IRQ);
+}
+
+/*
+ * Pass the interrupted PC and EXC_RETURN to profiler_tick(), which returns
+ * from the exception.
+ */
+void __attribute__((used, naked)) sys_tick_handler(void);
+void sys_tick_handler(void)
+{
+	asm(
+	".thumb_func\n"
+	"	tst lr, #4		/* see which stack has the frame */\n"
+	"	mrs r0, msp\n"
+	"	it ne\n"
+	"	mrsne r0, psp\n"
+	"	ldr r0, [r0, #24]	/* stacked PC */\n"
+	"	mov r1, lr\n"
+	"	b %0\n"
+	:
+	: "i"(profiler_tick)
+	);
+}
+
+int profiler_timer_start(uint32_t period_us)
+{
+	uint32_t reload = clock_get_freq() / 1000000 * period_us - 1;
+
+	if (reload > ST_RELOAD_MAX)
+		return EC_ERROR_INVAL;
+
+	CPU_NVIC_ST_CTRL = 0;
+	CPU_NVIC_ST_RELOAD = reload;
+	CPU_NVIC_ST_CURRENT = 0;
+	CPU_NVIC_ST_CTRL = ST_CLKSOURCE | ST_TICKINT | ST_ENABLE;
+
+	return EC_SUCCESS;
+}
+
+void profiler_timer_stop(void)
+{
+	CPU_NVIC_ST_CTRL = 0;
+}
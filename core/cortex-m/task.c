@@ -11,7 +11,9 @@
 #include "cpu.h"
 #include "link_defs.h"
 #include "panic.h"
+#include "stack_watch.h"
 #include "task.h"
+#include "task_trace.h"
 #include "timer.h"
 #include "util.h"
 
@@ -25,12 +27,10 @@ typedef union {
 		uint32_t events;   /* Bitmaps of received events */
 		uint64_t runtime;  /* Time spent in task */
 		uint32_t *stack;   /* Start of stack */
+		struct mutex *blocked_on; /* Mutex the task waits on */
 	};
 } task_;
 
-/* Value to store in unused stack */
-#define STACK_UNUSED_VALUE 0xdeadd00d
-
 /* declare task routine prototypes */
 #define TASK(n, r, d, s) void r(void *);
 void __idle(void);
@@ -71,6 +71,9 @@ extern int __task_start(int *task_stack_ready);
 void __idle(void)
 {
 	while (1) {
+#ifdef CONFIG_STACK_WATCH
+		stack_watch_idle();
+#endif
 #ifdef CHIP_NPCX
 
 		/*
@@ -210,6 +213,9 @@ static uint32_t tasks_ready = BIT(TASK_ID_HOOKS);
  */
 static uint32_t tasks_enabled = BIT(TASK_ID_HOOKS) | BIT(TASK_ID_IDLE);
 
+/* Bitmap of tasks waiting on a mutex; see pick_next_task() */
+static uint32_t tasks_mutex_blocked;
+
 static int start_called;  /* Has task swapping started */
 
 static inline task_ *__task_id_to_ptr(task_id_t id)
@@ -227,6 +233,15 @@ void interrupt_enable(void)
 	asm("cpsie i");
 }
 
+int is_interrupt_enabled(void)
+{
+	int primask;
+
+	/* Bit 0 of PRIMASK is set by cpsid */
+	asm("mrs %0, primask" : "=r"(primask));
+	return !(primask & 0x1);
+}
+
 inline int in_interrupt_context(void)
 {
 	int ret;
@@ -235,7 +250,7 @@ inline int in_interrupt_context(void)
 	return ret;
 }
 
-#ifdef CONFIG_TASK_PROFILING
+#if defined(CONFIG_TASK_PROFILING) || defined(CONFIG_TASK_TRACE)
 static inline int get_interrupt_context(void)
 {
 	int ret;
@@ -264,6 +279,66 @@ int task_start_called(void)
 	return start_called;
 }
 
+const char *task_get_name(task_id_t tskid)
+{
+	return task_names[tskid];
+}
+
+#ifdef CONFIG_STACK_WATCH
+uint32_t *task_get_stack(task_id_t tskid, int *size)
+{
+	*size = tasks_init[tskid].stack_size;
+	return tasks[tskid].stack;
+}
+#endif
+
+int task_find_stack_overflow(void)
+{
+	int i;
+
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+		if (tasks[i].stack && *tasks[i].stack != STACK_UNUSED_VALUE)
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * Return the next task to run.
+ *
+ * This is the highest priority ready task, unless a higher priority task
+ * waits on a mutex: then the owner of the mutex (or, if the owner itself waits
+ * on another mutex, the owner of that one, and so on) runs in its place. The
+ * owner thus inherits the priority of its highest waiter, and a medium
+ * priority task can't keep it from releasing the mutex.
+ */
+static task_ *pick_next_task(void)
+{
+	uint32_t ready = tasks_ready & tasks_enabled;
+	uint32_t candidates = ready | (tasks_mutex_blocked & tasks_enabled);
+
+	while (candidates) {
+		task_id_t id = __fls(candidates);
+		int hops;
+
+		for (hops = 0; hops < TASK_ID_COUNT; hops++) {
+			struct mutex *mtx = tasks[id].blocked_on;
+
+			if ((ready & BIT(id)) || !mtx || !mtx->owner)
+				break;
+			id = __fls(mtx->owner);
+		}
+		if (ready & BIT(id))
+			return __task_id_to_ptr(id);
+
+		/* Owner can't run either, try the next candidate */
+		candidates &= ~BIT(__fls(candidates));
+	}
+
+	return __task_id_to_ptr(__fls(ready));
+}
+
 /**
  * Scheduling system call
  */
@@ -316,7 +391,7 @@ void svc_handler(int desched, task_id_t resched)
 	tasks_ready |= 1 << resched;
 
 	ASSERT(tasks_ready & tasks_enabled);
-	next = __task_id_to_ptr(__fls(tasks_ready & tasks_enabled));
+	next = pick_next_task();
 
 #ifdef CONFIG_TASK_PROFILING
 	/* Track time in interrupts */
@@ -345,6 +420,7 @@ void svc_handler(int desched, task_id_t resched)
 #ifdef CONFIG_TASK_PROFILING
 	task_switches++;
 #endif
+	task_trace_record(EC_TASK_TRACE_SWITCH, next - tasks);
 	current_task = next;
 	__switchto(current, next);
 }
@@ -357,16 +433,21 @@ void __schedule(int desched, int resched)
 	asm("svc 0"::"r"(p0),"r"(p1));
 }
 
-#ifdef CONFIG_TASK_PROFILING
+#if defined(CONFIG_TASK_PROFILING) || defined(CONFIG_TASK_TRACE)
 void __keep task_start_irq_handler(void *excep_return)
 {
+#ifdef CONFIG_TASK_PROFILING
 	/*
 	 * Get time before checking depth, in case this handler is
 	 * pre-empted.
 	 */
 	uint32_t t = get_time().le.lo;
+#endif
 	int irq = get_interrupt_context() - 16;
 
+	task_trace_record(EC_TASK_TRACE_IRQ_ENTER, irq);
+
+#ifdef CONFIG_TASK_PROFILING
 	/*
 	 * Track IRQ distribution.  No need for atomic add, because an IRQ
 	 * can't pre-empt itself.
@@ -383,11 +464,16 @@ void __keep task_start_irq_handler(void *excep_return)
 		return;
 
 	exc_start_time = t;
+#endif
 }
 #endif
 
 void __keep task_resched_if_needed(void *excep_return)
 {
+#ifdef CONFIG_TASK_TRACE
+	task_trace_record(EC_TASK_TRACE_IRQ_EXIT, get_interrupt_context() - 16);
+#endif
+
 	/*
 	 * Continue iff a rescheduling event happened or profiling is active,
 	 * and we are not called from another exception.
@@ -861,6 +947,10 @@ void mutex_lock(struct mutex *mtx)
 {
 	uint32_t value;
 	uint32_t id;
+#ifdef CONFIG_MUTEX_STATS
+	uint32_t wait_start;
+	int contended = 0;
+#endif
 
 	/*
 	 * mutex_lock() must not be used in interrupt context (because we wait
@@ -877,6 +967,9 @@ void mutex_lock(struct mutex *mtx)
 		return;
 
 	id = 1 << task_get_current();
+#ifdef CONFIG_MUTEX_STATS
+	wait_start = get_time().le.lo;
+#endif
 
 	deprecated_atomic_or(&mtx->waiters, id);
 
@@ -892,12 +985,24 @@ void mutex_lock(struct mutex *mtx)
 		 * "value" is equals to 1 if the store conditional failed,
 		 * 2 if somebody else owns the mutex, 0 else.
 		 */
-		if (value == 2)
-			/* Contention on the mutex */
+		if (value == 2) {
+			/* Contention on the mutex, lend our priority */
+			current_task->blocked_on = mtx;
+			deprecated_atomic_or(&tasks_mutex_blocked, id);
+#ifdef CONFIG_MUTEX_STATS
+			contended = 1;
+#endif
 			task_wait_event_mask(TASK_EVENT_MUTEX, 0);
+		}
 	} while (value);
 
+	mtx->owner = id;
+	deprecated_atomic_clear_bits(&tasks_mutex_blocked, id);
+	current_task->blocked_on = NULL;
 	deprecated_atomic_clear_bits(&mtx->waiters, id);
+#ifdef CONFIG_MUTEX_STATS
+	mutex_stats_locked(mtx, wait_start, contended);
+#endif
 }
 
 void mutex_unlock(struct mutex *mtx)
@@ -905,12 +1010,17 @@ void mutex_unlock(struct mutex *mtx)
 	uint32_t waiters;
 	task_ *tsk = current_task;
 
+#ifdef CONFIG_MUTEX_STATS
+	mutex_stats_unlocked(mtx);
+#endif
+
 	/*
 	 * Add a critical section to keep the unlock and the snapshotting of
 	 * waiters atomic in case a task switching occurs between them.
 	 */
 	interrupt_disable();
 	waiters = mtx->waiters;
+	mtx->owner = 0;
 	mtx->lock = 0;
 	interrupt_enable();
 
@@ -976,6 +1086,9 @@ int command_task_info(int argc, char **argv)
 		 get_time().val - task_start_time);
 	ccprintf("Time in exceptions:     %11.6lld s\n", exc_total_time);
 #endif
+#ifdef CONFIG_MUTEX_STATS
+	mutex_stats_print();
+#endif
 
 	return EC_SUCCESS;
 }
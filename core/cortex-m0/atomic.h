@@ -70,4 +70,20 @@ static inline uint32_t deprecated_atomic_read_clear(uint32_t volatile *addr)
 
 	return ret;
 }
+
+static inline uint32_t deprecated_atomic_read_add(uint32_t volatile *addr,
+						  uint32_t value)
+{
+	uint32_t ret, sum;
+
+	__asm__ __volatile__("   cpsid   i\n"
+			     "   ldr     %0, [%2]\n"
+			     "   add     %1, %0, %3\n"
+			     "   str     %1, [%2]\n"
+			     "   cpsie   i\n"
+			     : "=&b" (ret), "=&b" (sum)
+			     : "b" (addr), "b" (value) : "cc");
+
+	return ret;
+}
 #endif  /* __CROS_EC_ATOMIC_H */
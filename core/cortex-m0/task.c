@@ -28,9 +28,6 @@ typedef union {
 	};
 } task_;
 
-/* Value to store in unused stack */
-#define STACK_UNUSED_VALUE 0xdeadd00d
-
 /* declare task routine prototypes */
 #define TASK(n, r, d, s) void r(void *);
 void __idle(void);
@@ -161,6 +158,15 @@ void interrupt_enable(void)
 	asm("cpsie i");
 }
 
+int is_interrupt_enabled(void)
+{
+	int primask;
+
+	/* Bit 0 of PRIMASK is set by cpsid */
+	asm("mrs %0, primask" : "=r"(primask));
+	return !(primask & 0x1);
+}
+
 inline int in_interrupt_context(void)
 {
 	int ret;
@@ -43,4 +43,10 @@ static inline uint32_t deprecated_atomic_read_clear(uint32_t volatile *addr)
 {
 	return __sync_fetch_and_and(addr, 0);
 }
+
+static inline uint32_t deprecated_atomic_read_add(uint32_t volatile *addr,
+						  uint32_t value)
+{
+	return __sync_fetch_and_add(addr, value);
+}
 #endif  /* __CROS_EC_ATOMIC_H */
@@ -8,4 +8,26 @@
 
 CFLAGS_CPU=-fno-builtin
 
-core-y=main.o task.o timer.o panic.o disabled.o stack_trace.o
+core-y=main.o timer.o panic.o disabled.o stack_trace.o task_common.o
+
+# TEST_CORO=y runs the emulator tasks as coroutines on a single thread, which
+# is much cheaper than switching between threads. Fuzzing drives the emulator
+# from a separate thread, so it keeps the threaded scheduler.
+ifeq ($(TEST_CORO)_$(TEST_FUZZ),y_)
+host-task-obj=task_coro.o
+else
+host-task-obj=task.o
+endif
+core-y+=$(host-task-obj)
+core-$(CONFIG_PROFILER)+=profiler.o
+core-$(CONFIG_TASK_TRACE)+=task_trace_file.o
+
+# Relink when switching schedulers, as the objects themselves don't change.
+host-task-stamp=$(out)/host_task.stamp
+ifneq ($(shell cat $(host-task-stamp) 2>/dev/null),$(host-task-obj))
+.PHONY: $(host-task-stamp)
+endif
+$(host-task-stamp):
+	@mkdir -p $(@D)
+	@echo $(host-task-obj) > $@
+$(out)/$(PROJECT).exe: $(host-task-stamp)
@@ -17,6 +17,12 @@
  */
 pthread_t task_get_thread(task_id_t tskid);
 
+/**
+ * Returns the OS thread ID (not the pthread_t) of the thread running the
+ * task, or 0 if the task isn't created yet. Several tasks may share one.
+ */
+pid_t task_get_os_tid(task_id_t tskid);
+
 /**
  * Returns the ID of the active task, regardless of current thread
  * context.
@@ -29,9 +35,26 @@ task_id_t task_get_running(void);
  */
 void task_register_interrupt(void);
 
+/**
+ * Deliver an emulated interrupt which is due. Called on every get_time(), for
+ * the single-threaded scheduler which can't preempt a task asynchronously.
+ */
+void task_poll_interrupt(void);
+
 /**
  * Returns the process ID of the calling process.
  */
 pid_t getpid(void);
 
+/**
+ * Returns the OS thread ID of the calling thread.
+ */
+pid_t gettid(void);
+
+/**
+ * Returns the PC a signal interrupted, given the ucontext_t passed to an
+ * SA_SIGINFO handler, or 0 on hosts we don't know how to get it on.
+ */
+uintptr_t signal_context_pc(const void *ctx);
+
 #endif  /* __CROS_EC_HOST_TASK_H */
@@ -0,0 +1,131 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Profiler sampling timer for the emulator: SIGPROF, every period of CPU
+ * time used by a thread running tasks. Each such thread has its own timer on
+ * its CPU clock, which signals that thread, so the sampled PC is always the
+ * one of the task which used the time. A process wide ITIMER_PROF signals
+ * whichever thread, e.g. one blocked in the emulator's interrupt delivery.
+ *
+ * The sampled PCs are relative to the start of the executable, which is
+ * position independent, so that they can be looked up in the ELF.
+ */
+
+#define _GNU_SOURCE /* For SIGEV_THREAD_ID */
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "ec_commands.h"
+#include "host_task.h"
+#include "profiler.h"
+#include "task.h"
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+extern char __executable_start[];
+
+/* One timer per OS thread running tasks */
+static timer_t timers[TASK_ID_COUNT];
+static int timer_count;
+
+uintptr_t profiler_pc_base(void)
+{
+	return (uintptr_t)__executable_start;
+}
+
+static void sigprof_handler(int sig, siginfo_t *info, void *ctx)
+{
+	task_id_t tid = task_get_current();
+
+	/* Emulator thread, such as console input: not firmware */
+	if (tid >= TASK_ID_COUNT ||
+	    !pthread_equal(pthread_self(), task_get_thread(tid)))
+		return;
+
+	if (in_interrupt_context())
+		tid = EC_PROFILER_TASK_IRQ;
+
+	profiler_sample(signal_context_pc(ctx) - profiler_pc_base(), tid);
+}
+
+/* Does a task before tskid run on the same OS thread? */
+static int thread_has_timer(task_id_t tskid)
+{
+	int i;
+
+	for (i = 0; i < tskid; i++)
+		if (task_get_os_tid(i) == task_get_os_tid(tskid))
+			return 1;
+
+	return 0;
+}
+
+static int start_thread_timer(task_id_t tskid, uint32_t period_us)
+{
+	struct sigevent sev;
+	struct itimerspec its;
+	clockid_t clock;
+	timer_t *timer = &timers[timer_count];
+
+	if (pthread_getcpuclockid(task_get_thread(tskid), &clock))
+		return EC_ERROR_UNKNOWN;
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = SIGPROF;
+	sev.sigev_notify_thread_id = task_get_os_tid(tskid);
+	if (timer_create(clock, &sev, timer))
+		return EC_ERROR_UNKNOWN;
+	timer_count++;
+
+	its.it_interval.tv_sec = period_us / 1000000;
+	its.it_interval.tv_nsec = (period_us % 1000000) * 1000;
+	its.it_value = its.it_interval;
+	if (timer_settime(*timer, 0, &its, NULL))
+		return EC_ERROR_UNKNOWN;
+
+	return EC_SUCCESS;
+}
+
+int profiler_timer_start(uint32_t period_us)
+{
+	struct sigaction sa;
+	int i, rv;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = sigprof_handler;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, NULL))
+		return EC_ERROR_UNKNOWN;
+
+	/* Restart with the new period */
+	profiler_timer_stop();
+
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+		if (!task_get_os_tid(i) || thread_has_timer(i))
+			continue;
+
+		rv = start_thread_timer(i, period_us);
+		if (rv != EC_SUCCESS) {
+			profiler_timer_stop();
+			return rv;
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+void profiler_timer_stop(void)
+{
+	while (timer_count > 0)
+		timer_delete(timers[--timer_count]);
+}
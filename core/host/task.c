@@ -5,6 +5,7 @@
 
 /* Task scheduling / events module for Chrome EC operating system */
 
+#include <errno.h>
 #include <malloc.h>
 #include <pthread.h>
 #include <semaphore.h>
@@ -19,30 +20,24 @@
 #include "console.h"
 #include "host_task.h"
 #include "task.h"
+#include "task_common.h"
 #include "task_id.h"
+#include "task_trace.h"
 #include "test_util.h"
 #include "timer.h"
 
 #define SIGNAL_INTERRUPT SIGUSR1
 
-struct emu_task_t {
-	pthread_t thread;
-	pthread_cond_t resume;
-	uint32_t event;
-	timestamp_t wake_time;
-	uint8_t started;
-};
-
-struct task_args {
-	void (*routine)(void *);
-	void *d;
-};
+/*
+ * With CONFIG_STACK_WATCH, size of the stack of each task thread. It is much
+ * bigger than the tasklist sizes, as the host's libc needs a lot more.
+ */
+#define HOST_STACK_SIZE (256 * 1024)
 
-static struct emu_task_t tasks[TASK_ID_COUNT];
+static pthread_t task_threads[TASK_ID_COUNT];
+static pthread_cond_t task_resume[TASK_ID_COUNT];
 static pthread_cond_t scheduler_cond;
 static pthread_mutex_t run_lock;
-static task_id_t running_task_id;
-static int task_started;
 
 static sem_t interrupt_sem;
 static pthread_mutex_t interrupt_lock;
@@ -52,73 +47,12 @@ static int interrupt_disabled;
 static void (*pending_isr)(void);
 static int generator_sleeping;
 static timestamp_t generator_sleep_deadline;
-static int has_interrupt_generator = 1;
 
 /* thread local task id */
 static __thread task_id_t my_task_id = TASK_ID_INVALID;
 
 static void task_enable_all_tasks_callback(void);
 
-#define TASK(n, r, d, s) void r(void *);
-CONFIG_TASK_LIST
-CONFIG_TEST_TASK_LIST
-CONFIG_CTS_TASK_LIST
-#undef TASK
-
-/* usleep that uses OS functions, instead of emulated timer. */
-void _usleep(int usec)
-{
-	struct timespec req;
-
-	req.tv_sec = usec / 1000000;
-	req.tv_nsec = (usec % 1000000) * 1000;
-
-	nanosleep(&req, NULL);
-}
-
-/* msleep that uses OS functions, instead of emulated timer. */
-void _msleep(int msec)
-{
-	_usleep(1000 * msec);
-}
-
-/* Idle task */
-void __idle(void *d)
-{
-	while (1)
-		task_wait_event(-1);
-}
-
-void _run_test(void *d)
-{
-	run_test(0, NULL);
-}
-
-#define TASK(n, r, d, s) {r, d},
-const struct task_args task_info[TASK_ID_COUNT] = {
-	{__idle, NULL},
-	CONFIG_TASK_LIST
-	CONFIG_TEST_TASK_LIST
-	CONFIG_CTS_TASK_LIST
-	{_run_test, NULL},
-};
-#undef TASK
-
-#define TASK(n, r, d, s) #n,
-static const char * const task_names[] = {
-	"<< idle >>",
-	CONFIG_TASK_LIST
-	CONFIG_TEST_TASK_LIST
-	CONFIG_CTS_TASK_LIST
-	"<< test runner >>",
-};
-#undef TASK
-
-void task_pre_init(void)
-{
-	/* Nothing */
-}
-
 int in_interrupt_context(void)
 {
 	return !!in_interrupt;
@@ -138,10 +72,17 @@ void interrupt_enable(void)
 	pthread_mutex_unlock(&interrupt_lock);
 }
 
+int is_interrupt_enabled(void)
+{
+	return !interrupt_disabled;
+}
+
 static void _task_execute_isr(int sig)
 {
 	in_interrupt = 1;
+	task_trace_record(EC_TASK_TRACE_IRQ_ENTER, 0);
 	pending_isr();
+	task_trace_record(EC_TASK_TRACE_IRQ_EXIT, 0);
 	sem_post(&interrupt_sem);
 	in_interrupt = 0;
 }
@@ -164,14 +105,15 @@ void task_trigger_test_interrupt(void (*isr)(void))
 	/* Suspend current task and excute ISR */
 	pending_isr = isr;
 	if (task_started) {
-		pthread_kill(tasks[running_task_id].thread, SIGNAL_INTERRUPT);
+		pthread_kill(task_threads[running_task_id], SIGNAL_INTERRUPT);
 	} else {
 		main_pid = getpid();
 		kill(main_pid, SIGNAL_INTERRUPT);
 	}
 
 	/* Wait for ISR to complete */
-	sem_wait(&interrupt_sem);
+	while (sem_wait(&interrupt_sem) && errno == EINTR)
+		;
 	while (in_interrupt)
 		_usleep(10);
 	pending_isr = NULL;
@@ -179,6 +121,11 @@ void task_trigger_test_interrupt(void (*isr)(void))
 	pthread_mutex_unlock(&interrupt_lock);
 }
 
+void task_poll_interrupt(void)
+{
+	/* Interrupts are delivered asynchronously, with SIGNAL_INTERRUPT */
+}
+
 void interrupt_generator_udelay(unsigned us)
 {
 	generator_sleep_deadline.val = get_time().val + us;
@@ -188,27 +135,9 @@ void interrupt_generator_udelay(unsigned us)
 	generator_sleeping = 0;
 }
 
-const char *task_get_name(task_id_t tskid)
-{
-	return task_names[tskid];
-}
-
 pthread_t task_get_thread(task_id_t tskid)
 {
-	return tasks[tskid].thread;
-}
-
-uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
-{
-	deprecated_atomic_or(&tasks[tskid].event, event);
-	if (wait)
-		return task_wait_event(-1);
-	return 0;
-}
-
-uint32_t *task_get_event_bitmap(task_id_t tskid)
-{
-	return &tasks[tskid].event;
+	return task_threads[tskid];
 }
 
 uint32_t task_wait_event(int timeout_us)
@@ -221,7 +150,7 @@ uint32_t task_wait_event(int timeout_us)
 
 	/* Transfer control to scheduler */
 	pthread_cond_signal(&scheduler_cond);
-	pthread_cond_wait(&tasks[tid].resume, &run_lock);
+	pthread_cond_wait(&task_resume[tid], &run_lock);
 
 	/* Resume */
 	ret = deprecated_atomic_read_clear(&tasks[tid].event);
@@ -229,148 +158,11 @@ uint32_t task_wait_event(int timeout_us)
 	return ret;
 }
 
-uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
-{
-	uint64_t deadline = get_time().val + timeout_us;
-	uint32_t events = 0;
-	int time_remaining_us = timeout_us;
-
-	/* Add the timer event to the mask so we can indicate a timeout */
-	event_mask |= TASK_EVENT_TIMER;
-
-	while (!(events & event_mask)) {
-		/* Collect events to re-post later */
-		events |= task_wait_event(time_remaining_us);
-
-		time_remaining_us = deadline - get_time().val;
-		if (timeout_us > 0 && time_remaining_us <= 0) {
-			/* Ensure we return a TIMER event if we timeout */
-			events |= TASK_EVENT_TIMER;
-			break;
-		}
-	}
-
-	/* Re-post any other events collected */
-	if (events & ~event_mask)
-		deprecated_atomic_or(&tasks[task_get_current()].event,
-				     events & ~event_mask);
-
-	return events & event_mask;
-}
-
-void mutex_lock(struct mutex *mtx)
-{
-	int value = 0;
-	int id = 1 << task_get_current();
-
-	mtx->waiters |= id;
-
-	do {
-		if (mtx->lock == 0) {
-			mtx->lock = 1;
-			value = 1;
-		}
-
-		if (!value)
-			task_wait_event_mask(TASK_EVENT_MUTEX, 0);
-	} while (!value);
-
-	mtx->waiters &= ~id;
-}
-
-void mutex_unlock(struct mutex *mtx)
-{
-	int v;
-	mtx->lock = 0;
-
-	for (v = 31; v >= 0; --v)
-		if ((1ul << v) & mtx->waiters) {
-			mtx->waiters &= ~(1ul << v);
-			task_set_event(v, TASK_EVENT_MUTEX, 0);
-			break;
-		}
-}
-
 task_id_t task_get_current(void)
 {
 	return my_task_id;
 }
 
-task_id_t task_get_running(void)
-{
-	return running_task_id;
-}
-
-void task_print_list(void)
-{
-	int i;
-
-	ccputs("Name         Events\n");
-
-	for (i = 0; i < TASK_ID_COUNT; i++) {
-		ccprintf("%4d %-16s %08x\n", i, task_names[i], tasks[i].event);
-		cflush();
-	}
-}
-
-int command_task_info(int argc, char **argv)
-{
-	task_print_list();
-
-	return EC_SUCCESS;
-}
-DECLARE_SAFE_CONSOLE_COMMAND(taskinfo, command_task_info,
-			     NULL,
-			     "Print task info");
-
-static void _wait_for_task_started(int can_sleep)
-{
-	int i, ok;
-
-	while (1) {
-		ok = 1;
-		for (i = 0; i < TASK_ID_COUNT - 1; ++i) {
-			if (!tasks[i].started) {
-				if (can_sleep)
-					msleep(10);
-				else
-					_msleep(10);
-				ok = 0;
-				break;
-			}
-		}
-		if (ok)
-			return;
-	}
-}
-
-void wait_for_task_started(void)
-{
-	_wait_for_task_started(1);
-}
-
-void wait_for_task_started_nosleep(void)
-{
-	_wait_for_task_started(0);
-}
-
-static task_id_t task_get_next_wake(void)
-{
-	int i;
-	timestamp_t min_time;
-	int which_task = TASK_ID_INVALID;
-
-	min_time.val = ~0ull;
-
-	for (i = TASK_ID_COUNT - 1; i >= 0; --i)
-		if (min_time.val >= tasks[i].wake_time.val) {
-			min_time.val = tasks[i].wake_time.val;
-			which_task = i;
-		}
-
-	return which_task;
-}
-
 static int fast_forward(void)
 {
 	/*
@@ -398,7 +190,7 @@ static int fast_forward(void)
 		return TASK_ID_IDLE;
 
 	if (task_id != TASK_ID_INVALID &&
-	    tasks[task_id].thread != (pthread_t)NULL &&
+	    tasks[task_id].created &&
 	    tasks[task_id].wake_time.val < generator_sleep_deadline.val) {
 		force_time(tasks[task_id].wake_time);
 		return task_id;
@@ -408,14 +200,9 @@ static int fast_forward(void)
 	}
 }
 
-int task_start_called(void)
-{
-	return task_started;
-}
-
 void task_scheduler(void)
 {
-	int i;
+	int i, next;
 	timestamp_t now;
 
 	task_started = 1;
@@ -424,27 +211,25 @@ void task_scheduler(void)
 		now = get_time();
 		i = TASK_ID_COUNT - 1;
 		while (i >= 0) {
-			/*
-			 * Only tasks with spawned threads are valid to be
-			 * resumed.
-			 */
-			if (tasks[i].thread) {
-				if (tasks[i].event ||
-				    now.val >= tasks[i].wake_time.val)
-					break;
-			}
+			next = task_to_run(i, now);
+			if (next != TASK_ID_INVALID)
+				break;
 			--i;
 		}
 		if (i < 0)
 			i = fast_forward();
+		else
+			i = next;
 
 		now = get_time();
 		if (now.val >= tasks[i].wake_time.val)
 			tasks[i].event |= TASK_EVENT_TIMER;
 		tasks[i].wake_time.val = ~0ull;
+		if (i != running_task_id)
+			task_trace_record(EC_TASK_TRACE_SWITCH, i);
 		running_task_id = i;
 		tasks[i].started = 1;
-		pthread_cond_signal(&tasks[i].resume);
+		pthread_cond_signal(&task_resume[i]);
 		pthread_cond_wait(&scheduler_cond, &run_lock);
 	}
 }
@@ -454,6 +239,7 @@ void *_task_start_impl(void *a)
 	long tid = (long)a;
 	const struct task_args *arg = task_info + tid;
 	my_task_id = tid;
+	tasks[tid].os_tid = gettid();
 	pthread_mutex_lock(&run_lock);
 
 	/* Wait for scheduler */
@@ -468,9 +254,22 @@ void *_task_start_impl(void *a)
 		task_wait_event(-1);
 }
 
-test_mockable void interrupt_generator(void)
+static void create_task_thread(int i)
 {
-	has_interrupt_generator = 0;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+#ifdef CONFIG_STACK_WATCH
+	if (!tasks[i].stack) {
+		tasks[i].stack = task_alloc_stack(HOST_STACK_SIZE);
+		tasks[i].stack_size = HOST_STACK_SIZE;
+	}
+	pthread_attr_setstack(&attr, tasks[i].stack, HOST_STACK_SIZE);
+#endif
+	pthread_create(&task_threads[i], &attr, _task_start_impl,
+		       (void *)(uintptr_t)i);
+	tasks[i].created = 1;
+	pthread_attr_destroy(&attr);
 }
 
 void *_task_int_generator_start(void *d)
@@ -497,9 +296,8 @@ int task_start(void)
 	tasks[i].event = TASK_EVENT_WAKE;
 	tasks[i].wake_time.val = ~0ull;
 	tasks[i].started = 0;
-	pthread_cond_init(&tasks[i].resume, NULL);
-	pthread_create(&tasks[i].thread, NULL, _task_start_impl,
-		       (void *)(uintptr_t)i);
+	pthread_cond_init(&task_resume[i], NULL);
+	create_task_thread(i);
 	pthread_cond_wait(&scheduler_cond, &run_lock);
 	/*
 	 * Interrupt lock is grabbed by the task which just started.
@@ -520,7 +318,7 @@ int task_start(void)
 	 * Tell the hooks task to continue so that it can call back to enable
 	 * the other tasks.
 	 */
-	pthread_cond_signal(&tasks[i].resume);
+	pthread_cond_signal(&task_resume[i]);
 	pthread_cond_wait(&scheduler_cond, &run_lock);
 	task_enable_all_tasks_callback();
 
@@ -535,15 +333,14 @@ static void task_enable_all_tasks_callback(void)
 
 	/* Initialize the remaning tasks. */
 	for (i = 0; i < TASK_ID_COUNT; ++i) {
-		if (tasks[i].thread != (pthread_t)NULL)
+		if (tasks[i].created)
 			continue;
 
 		tasks[i].event = TASK_EVENT_WAKE;
 		tasks[i].wake_time.val = ~0ull;
 		tasks[i].started = 0;
-		pthread_cond_init(&tasks[i].resume, NULL);
-		pthread_create(&tasks[i].thread, NULL, _task_start_impl,
-			       (void *)(uintptr_t)i);
+		pthread_cond_init(&task_resume[i], NULL);
+		create_task_thread(i);
 		/*
 		 * Interrupt lock is grabbed by the task which just started.
 		 * Let's unlock it so the next task can be started.
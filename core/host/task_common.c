@@ -0,0 +1,365 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Task events, mutexes and stacks, common to the emulator schedulers */
+
+#define _GNU_SOURCE /* For REG_RIP */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "atomic.h"
+#include "common.h"
+#include "console.h"
+#include "host_task.h"
+#include "task.h"
+#include "task_common.h"
+#include "task_id.h"
+#include "test_util.h"
+#include "timer.h"
+
+/* Guard area below each task stack */
+#define STACK_GUARD_SIZE 4096
+
+struct emu_task_t tasks[TASK_ID_COUNT];
+task_id_t running_task_id;
+int task_started;
+int has_interrupt_generator = 1;
+
+#define TASK(n, r, d, s) void r(void *);
+CONFIG_TASK_LIST
+CONFIG_TEST_TASK_LIST
+CONFIG_CTS_TASK_LIST
+#undef TASK
+
+/* usleep that uses OS functions, instead of emulated timer. */
+void _usleep(int usec)
+{
+	struct timespec req;
+
+	req.tv_sec = usec / 1000000;
+	req.tv_nsec = (usec % 1000000) * 1000;
+
+	nanosleep(&req, NULL);
+}
+
+/* msleep that uses OS functions, instead of emulated timer. */
+void _msleep(int msec)
+{
+	_usleep(1000 * msec);
+}
+
+/* Idle task */
+void __idle(void *d)
+{
+	while (1)
+		task_wait_event(-1);
+}
+
+void _run_test(void *d)
+{
+	run_test(0, NULL);
+}
+
+#define TASK(n, r, d, s) {r, d},
+const struct task_args task_info[TASK_ID_COUNT] = {
+	{__idle, NULL},
+	CONFIG_TASK_LIST
+	CONFIG_TEST_TASK_LIST
+	CONFIG_CTS_TASK_LIST
+	{_run_test, NULL},
+};
+#undef TASK
+
+#define TASK(n, r, d, s) #n,
+static const char * const task_names[] = {
+	"<< idle >>",
+	CONFIG_TASK_LIST
+	CONFIG_TEST_TASK_LIST
+	CONFIG_CTS_TASK_LIST
+	"<< test runner >>",
+};
+#undef TASK
+
+void task_pre_init(void)
+{
+	/* Nothing */
+}
+
+const char *task_get_name(task_id_t tskid)
+{
+	return task_names[tskid];
+}
+
+uint8_t *task_alloc_stack(size_t size)
+{
+	uint8_t *p;
+#ifdef CONFIG_STACK_WATCH
+	uint32_t *w;
+#endif
+
+	p = mmap(NULL, size + STACK_GUARD_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED) {
+		perror("task stack");
+		exit(1);
+	}
+	/* Overflowing the stack faults instead of corrupting a neighbour */
+	mprotect(p, STACK_GUARD_SIZE, PROT_NONE);
+	p += STACK_GUARD_SIZE;
+
+#ifdef CONFIG_STACK_WATCH
+	/* For the stack high-water tracker */
+	for (w = (uint32_t *)p; w < (uint32_t *)(p + size); w++)
+		*w = STACK_UNUSED_VALUE;
+#endif
+
+	return p;
+}
+
+#ifdef CONFIG_STACK_WATCH
+uint32_t *task_get_stack(task_id_t tskid, int *size)
+{
+	*size = tasks[tskid].stack_size;
+	return (uint32_t *)tasks[tskid].stack;
+}
+
+int task_find_stack_overflow(void)
+{
+	int i;
+
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+		if (tasks[i].stack &&
+		    *(uint32_t *)tasks[i].stack != STACK_UNUSED_VALUE)
+			return i;
+	}
+
+	return -1;
+}
+#endif
+
+uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
+{
+	deprecated_atomic_or(&tasks[tskid].event, event);
+	if (wait)
+		return task_wait_event(-1);
+	return 0;
+}
+
+uint32_t *task_get_event_bitmap(task_id_t tskid)
+{
+	return &tasks[tskid].event;
+}
+
+uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
+{
+	uint64_t deadline = get_time().val + timeout_us;
+	uint32_t events = 0;
+	int time_remaining_us = timeout_us;
+
+	/* Add the timer event to the mask so we can indicate a timeout */
+	event_mask |= TASK_EVENT_TIMER;
+
+	while (!(events & event_mask)) {
+		/* Collect events to re-post later */
+		events |= task_wait_event(time_remaining_us);
+
+		time_remaining_us = deadline - get_time().val;
+		if (timeout_us > 0 && time_remaining_us <= 0) {
+			/* Ensure we return a TIMER event if we timeout */
+			events |= TASK_EVENT_TIMER;
+			break;
+		}
+	}
+
+	/* Re-post any other events collected */
+	if (events & ~event_mask)
+		deprecated_atomic_or(&tasks[task_get_current()].event,
+				     events & ~event_mask);
+
+	return events & event_mask;
+}
+
+void mutex_lock(struct mutex *mtx)
+{
+	int value = 0;
+	task_id_t me = task_get_current();
+	int id = 1 << me;
+#ifdef CONFIG_MUTEX_STATS
+	uint32_t wait_start = get_time().le.lo;
+	int contended = 0;
+#endif
+
+	do {
+		/* mutex_unlock() takes the task it wakes off the waiters */
+		mtx->waiters |= id;
+
+		if (mtx->lock == 0) {
+			mtx->lock = 1;
+			value = 1;
+		}
+
+		if (!value) {
+			/* Lend our priority to the owner, see task_to_run() */
+			tasks[me].blocked_on = mtx;
+#ifdef CONFIG_MUTEX_STATS
+			contended = 1;
+#endif
+			task_wait_event_mask(TASK_EVENT_MUTEX, 0);
+			tasks[me].blocked_on = NULL;
+		}
+	} while (!value);
+
+	mtx->owner = id;
+	mtx->waiters &= ~id;
+#ifdef CONFIG_MUTEX_STATS
+	mutex_stats_locked(mtx, wait_start, contended);
+#endif
+}
+
+void mutex_unlock(struct mutex *mtx)
+{
+	int v;
+
+#ifdef CONFIG_MUTEX_STATS
+	mutex_stats_unlocked(mtx);
+#endif
+	mtx->owner = 0;
+	mtx->lock = 0;
+
+	for (v = 31; v >= 0; --v)
+		if ((1ul << v) & mtx->waiters) {
+			mtx->waiters &= ~(1ul << v);
+			task_set_event(v, TASK_EVENT_MUTEX, 0);
+			break;
+		}
+}
+
+uintptr_t signal_context_pc(const void *ctx)
+{
+	const ucontext_t *uc = ctx;
+
+#if defined(__x86_64__)
+	return uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+	return uc->uc_mcontext.gregs[REG_EIP];
+#elif defined(__aarch64__)
+	return uc->uc_mcontext.pc;
+#else
+	return 0;
+#endif
+}
+
+pid_t task_get_os_tid(task_id_t tskid)
+{
+	return tasks[tskid].os_tid;
+}
+
+task_id_t task_get_running(void)
+{
+	return running_task_id;
+}
+
+void task_print_list(void)
+{
+	int i;
+
+	ccputs("Name         Events\n");
+
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+		ccprintf("%4d %-16s %08x\n", i, task_names[i], tasks[i].event);
+		cflush();
+	}
+}
+
+int command_task_info(int argc, char **argv)
+{
+	task_print_list();
+#ifdef CONFIG_MUTEX_STATS
+	mutex_stats_print();
+#endif
+
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(taskinfo, command_task_info,
+			     NULL,
+			     "Print task info");
+
+static void _wait_for_task_started(int can_sleep)
+{
+	int i, ok;
+
+	while (1) {
+		ok = 1;
+		for (i = 0; i < TASK_ID_COUNT - 1; ++i) {
+			if (!tasks[i].started) {
+				if (can_sleep)
+					msleep(10);
+				else
+					_msleep(10);
+				ok = 0;
+				break;
+			}
+		}
+		if (ok)
+			return;
+	}
+}
+
+void wait_for_task_started(void)
+{
+	_wait_for_task_started(1);
+}
+
+void wait_for_task_started_nosleep(void)
+{
+	_wait_for_task_started(0);
+}
+
+task_id_t task_get_next_wake(void)
+{
+	int i;
+	timestamp_t min_time;
+	int which_task = TASK_ID_INVALID;
+
+	min_time.val = ~0ull;
+
+	for (i = TASK_ID_COUNT - 1; i >= 0; --i)
+		if (min_time.val >= tasks[i].wake_time.val) {
+			min_time.val = tasks[i].wake_time.val;
+			which_task = i;
+		}
+
+	return which_task;
+}
+
+int task_start_called(void)
+{
+	return task_started;
+}
+
+int task_to_run(int i, timestamp_t now)
+{
+	int hops;
+
+	for (hops = 0; hops < TASK_ID_COUNT; hops++) {
+		/* Only created tasks are valid to be resumed. */
+		if (tasks[i].created && (tasks[i].event ||
+				    now.val >= tasks[i].wake_time.val))
+			return i;
+		if (!tasks[i].blocked_on || !tasks[i].blocked_on->owner)
+			break;
+		i = __fls(tasks[i].blocked_on->owner);
+	}
+
+	return TASK_ID_INVALID;
+}
+
+test_mockable void interrupt_generator(void)
+{
+	has_interrupt_generator = 0;
+}
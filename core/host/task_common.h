@@ -0,0 +1,71 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Task bookkeeping shared by the emulator schedulers: the threaded one in
+ * task.c and the coroutine one in task_coro.c. They only differ in how they
+ * switch between tasks and deliver interrupts.
+ */
+
+#ifndef __CROS_EC_HOST_TASK_COMMON_H
+#define __CROS_EC_HOST_TASK_COMMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "task.h"
+#include "timer.h"
+
+struct emu_task_t {
+	uint32_t event;
+	timestamp_t wake_time;
+	/* Mutex the task waits for, see task_to_run() */
+	struct mutex *blocked_on;
+	/* Set by the scheduler once the task can be resumed */
+	uint8_t created;
+	uint8_t started;
+	/* OS thread the task runs on, see task_get_os_tid() */
+	pid_t os_tid;
+	/* From task_alloc_stack(), if the scheduler gave the task one */
+	uint8_t *stack;
+	size_t stack_size;
+};
+
+struct task_args {
+	void (*routine)(void *);
+	void *d;
+};
+
+extern struct emu_task_t tasks[TASK_ID_COUNT];
+extern const struct task_args task_info[TASK_ID_COUNT];
+extern task_id_t running_task_id;
+extern int task_started;
+/* Cleared if the test doesn't override interrupt_generator() */
+extern int has_interrupt_generator;
+
+/* Sleep functions that use OS functions, instead of the emulated timer. */
+void _usleep(int usec);
+void _msleep(int msec);
+
+/**
+ * Map a task stack of the given size, with a guard page below it. With
+ * CONFIG_STACK_WATCH, it is filled for the stack high-water tracker.
+ */
+uint8_t *task_alloc_stack(size_t size);
+
+/**
+ * Returns the task which wakes up first, or TASK_ID_INVALID.
+ */
+task_id_t task_get_next_wake(void);
+
+/**
+ * Return the task to run for task i: i itself if it can run, or else, if it
+ * waits on a mutex, the owner of the mutex, so that the owner inherits the
+ * priority of its waiters. TASK_ID_INVALID if neither can run.
+ */
+int task_to_run(int i, timestamp_t now);
+
+#endif  /* __CROS_EC_HOST_TASK_COMMON_H */
@@ -0,0 +1,451 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Task scheduling / events module for the emulator, single-threaded variant.
+ *
+ * Every task, and the interrupt generator, is a stackful coroutine running on
+ * the main OS thread, so a task switch is a swapcontext() instead of a
+ * condition variable handoff between threads. Scheduling order and the
+ * virtual time fast forward are the same as in task.c.
+ *
+ * As nothing runs concurrently, the interrupt generator can't preempt a task
+ * whenever it likes. Instead, get_time() polls for a due interrupt, and
+ * switches to the interrupt generator from the task that is spinning on the
+ * clock. A periodic SIGALRM catches tasks that spin for long without reading
+ * the clock (e.g. on a register): if there were no polls since the previous
+ * tick, the generator runs and moves time on to its deadline. The signal
+ * handler only switches to the generator when it interrupted the
+ * executable's own code, never libc, which the generator's ISRs may call in
+ * turn. Otherwise it leaves a flag for the next poll.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include "atomic.h"
+#include "common.h"
+#include "console.h"
+#include "host_task.h"
+#include "task.h"
+#include "task_common.h"
+#include "task_id.h"
+#include "task_trace.h"
+#include "test_util.h"
+#include "timer.h"
+
+/* Stack size of each coroutine */
+#define CORO_STACK_SIZE (1024 * 1024)
+
+/* Real time period of the spin loop preemption tick */
+#define GENERATOR_TICK_US 1000
+
+extern char __executable_start[];
+extern char etext[];
+
+static ucontext_t task_contexts[TASK_ID_COUNT];
+static ucontext_t scheduler_context;
+static pthread_t main_thread;
+static task_id_t my_task_id = TASK_ID_INVALID;
+
+static volatile int in_interrupt;
+static volatile int interrupt_disabled;
+/* Set while the current context is being changed */
+static volatile int in_switch;
+
+/* Interrupt generator coroutine */
+static ucontext_t generator_context;
+static uint8_t *generator_stack;
+/* Where the generator returns to when it goes back to sleep */
+static ucontext_t *generator_caller;
+static volatile int generator_sleeping;
+static timestamp_t generator_sleep_deadline;
+static volatile int generator_polling;
+/* Polls since the last tick */
+static volatile sig_atomic_t generator_polls;
+/* Set by a tick which came without polls since the previous one */
+static volatile sig_atomic_t generator_tick_pending;
+
+/* Interrupts triggered from other OS threads (console input) */
+static pthread_mutex_t foreign_isr_lock = PTHREAD_MUTEX_INITIALIZER;
+static void (*volatile foreign_isr)(void);
+static sem_t foreign_isr_sem;
+
+static void make_coroutine(ucontext_t *ctx, uint8_t *stack,
+			   void (*entry)(int), int arg)
+{
+	getcontext(ctx);
+	ctx->uc_stack.ss_sp = stack;
+	ctx->uc_stack.ss_size = CORO_STACK_SIZE;
+	ctx->uc_link = NULL;
+	makecontext(ctx, (void (*)(void))entry, 1, arg);
+}
+
+int in_interrupt_context(void)
+{
+	return !!in_interrupt;
+}
+
+void interrupt_disable(void)
+{
+	interrupt_disabled = 1;
+}
+
+void interrupt_enable(void)
+{
+	interrupt_disabled = 0;
+}
+
+int is_interrupt_enabled(void)
+{
+	return !interrupt_disabled;
+}
+
+/* Run an ISR on top of whatever was running. */
+static void run_isr(void (*isr)(void))
+{
+	task_id_t interrupted = my_task_id;
+
+	/* The ISR runs in the context of the task it interrupted */
+	in_interrupt = 1;
+	my_task_id = task_started ? running_task_id : TASK_ID_INVALID;
+	task_trace_record(EC_TASK_TRACE_IRQ_ENTER, 0);
+	isr();
+	task_trace_record(EC_TASK_TRACE_IRQ_EXIT, 0);
+	my_task_id = interrupted;
+	in_interrupt = 0;
+}
+
+static void run_foreign_isr(void)
+{
+	void (*isr)(void) = foreign_isr;
+
+	if (!isr || in_interrupt || interrupt_disabled)
+		return;
+
+	run_isr(isr);
+	foreign_isr = NULL;
+	sem_post(&foreign_isr_sem);
+}
+
+void task_register_interrupt(void)
+{
+	main_thread = pthread_self();
+	sem_init(&foreign_isr_sem, 0, 0);
+}
+
+void task_trigger_test_interrupt(void (*isr)(void))
+{
+	if (interrupt_disabled)
+		return;
+
+	if (pthread_equal(pthread_self(), main_thread)) {
+		run_isr(isr);
+		return;
+	}
+
+	/* Hand it to the main thread, and wait for it to run */
+	pthread_mutex_lock(&foreign_isr_lock);
+	foreign_isr = isr;
+	while (sem_wait(&foreign_isr_sem) && errno == EINTR)
+		;
+	pthread_mutex_unlock(&foreign_isr_lock);
+}
+
+/* Switch to the interrupt generator, saving the current context in from. */
+static void run_generator(ucontext_t *from)
+{
+	task_id_t prev = my_task_id;
+
+	in_switch = 1;
+	generator_caller = from;
+	my_task_id = TASK_ID_INT_GEN;
+	swapcontext(from, &generator_context);
+	my_task_id = prev;
+	in_switch = 0;
+}
+
+static int generator_due(timestamp_t now)
+{
+	return generator_sleeping &&
+	       now.val >= generator_sleep_deadline.val;
+}
+
+/* Can the generator preempt the current task now? */
+static int can_preempt(void)
+{
+	return generator_sleeping && !generator_polling && !in_switch &&
+	       !in_interrupt && !interrupt_disabled &&
+	       my_task_id != TASK_ID_INVALID && my_task_id != TASK_ID_INT_GEN;
+}
+
+void task_poll_interrupt(void)
+{
+	int due;
+
+	if (foreign_isr && pthread_equal(pthread_self(), main_thread))
+		run_foreign_isr();
+
+	if (!can_preempt())
+		return;
+
+	/* get_time() calls us back, so don't recurse */
+	generator_polling = 1;
+	generator_polls++;
+	/* A pending tick makes the generator catch up, see below */
+	due = generator_tick_pending || generator_due(get_time());
+	generator_polling = 0;
+
+	/* Preempt the task spinning on the clock */
+	if (due)
+		run_generator(&task_contexts[my_task_id]);
+}
+
+static void generator_tick(int sig, siginfo_t *info, void *ctx)
+{
+	uintptr_t pc = signal_context_pc(ctx);
+
+	/* The task reads the clock, so polling takes care of it */
+	if (generator_polls) {
+		generator_polls = 0;
+		return;
+	}
+
+	generator_tick_pending = 1;
+
+	/*
+	 * Preempt the task right away if it spins in our code. Not if it is
+	 * in libc, which may hold locks the generator's ISRs then need.
+	 */
+	if (can_preempt() && pc >= (uintptr_t)__executable_start &&
+	    pc < (uintptr_t)etext)
+		run_generator(&task_contexts[my_task_id]);
+}
+
+static void start_generator_tick(void)
+{
+	struct sigaction sa = {
+		.sa_sigaction = generator_tick,
+		.sa_flags = SA_RESTART | SA_SIGINFO,
+	};
+	struct itimerval tick = {
+		.it_interval = { .tv_usec = GENERATOR_TICK_US },
+		.it_value = { .tv_usec = GENERATOR_TICK_US },
+	};
+
+	sigaction(SIGALRM, &sa, NULL);
+	setitimer(ITIMER_REAL, &tick, NULL);
+}
+
+void interrupt_generator_udelay(unsigned us)
+{
+	generator_sleep_deadline.val = get_time().val + us;
+	in_switch = 1;
+	generator_sleeping = 1;
+	swapcontext(&generator_context, generator_caller);
+	generator_sleeping = 0;
+	in_switch = 0;
+
+	/*
+	 * Preempted by a tick: the task spun without reading the clock, so
+	 * time didn't move on by itself.
+	 */
+	if (generator_tick_pending) {
+		generator_tick_pending = 0;
+		if (get_time().val < generator_sleep_deadline.val)
+			force_time(generator_sleep_deadline);
+	}
+}
+
+pthread_t task_get_thread(task_id_t tskid)
+{
+	/* All tasks run on the main thread */
+	return main_thread;
+}
+
+uint32_t task_wait_event(int timeout_us)
+{
+	int tid = task_get_current();
+
+	if (timeout_us > 0)
+		tasks[tid].wake_time.val = get_time().val + timeout_us;
+
+	/* Transfer control to scheduler */
+	in_switch = 1;
+	swapcontext(&task_contexts[tid], &scheduler_context);
+	in_switch = 0;
+
+	/* Resume */
+	return deprecated_atomic_read_clear(&tasks[tid].event);
+}
+
+task_id_t task_get_current(void)
+{
+	return my_task_id;
+}
+
+/*
+ * Same as in task.c, except that the interrupt generator is always asleep
+ * while the scheduler runs. Returns TASK_ID_INVALID when time was moved to
+ * the generator's deadline.
+ */
+static int fast_forward(void)
+{
+	int task_id = task_get_next_wake();
+
+	if (!has_interrupt_generator) {
+		if (task_id == TASK_ID_INVALID) {
+			return TASK_ID_IDLE;
+		} else {
+			force_time(tasks[task_id].wake_time);
+			return task_id;
+		}
+	}
+
+	if (task_id != TASK_ID_INVALID && tasks[task_id].created &&
+	    tasks[task_id].wake_time.val < generator_sleep_deadline.val) {
+		force_time(tasks[task_id].wake_time);
+		return task_id;
+	} else {
+		force_time(generator_sleep_deadline);
+		return TASK_ID_INVALID;
+	}
+}
+
+static void resume_task(int i)
+{
+	in_switch = 1;
+	if (i != running_task_id)
+		task_trace_record(EC_TASK_TRACE_SWITCH, i);
+	running_task_id = i;
+	my_task_id = i;
+	tasks[i].started = 1;
+	swapcontext(&scheduler_context, &task_contexts[i]);
+	my_task_id = TASK_ID_INVALID;
+	in_switch = 0;
+}
+
+void task_scheduler(void)
+{
+	int i, next;
+	timestamp_t now;
+
+	task_started = 1;
+
+	while (1) {
+		now = get_time();
+		if (generator_due(now)) {
+			run_generator(&scheduler_context);
+			continue;
+		}
+
+		i = TASK_ID_COUNT - 1;
+		while (i >= 0) {
+			next = task_to_run(i, now);
+			if (next != TASK_ID_INVALID)
+				break;
+			--i;
+		}
+		if (i < 0) {
+			i = fast_forward();
+			if (i == TASK_ID_INVALID)
+				continue;
+		} else {
+			i = next;
+		}
+
+		now = get_time();
+		if (now.val >= tasks[i].wake_time.val)
+			tasks[i].event |= TASK_EVENT_TIMER;
+		tasks[i].wake_time.val = ~0ull;
+		resume_task(i);
+	}
+}
+
+static void _task_start_impl(int tid)
+{
+	const struct task_args *arg = task_info + tid;
+
+	in_switch = 0;
+	tasks[tid].event = 0;
+
+	/* Start the task routine */
+	(arg->routine)(arg->d);
+
+	/* Catch exited routine */
+	while (1)
+		task_wait_event(-1);
+}
+
+static void _task_int_generator_start(int unused)
+{
+	in_switch = 0;
+	interrupt_generator();
+
+	/* Generator is gone, never come back here */
+	in_switch = 1;
+	has_interrupt_generator = 0;
+	generator_sleeping = 0;
+	setcontext(generator_caller);
+}
+
+static void create_task(int i)
+{
+	tasks[i].event = TASK_EVENT_WAKE;
+	tasks[i].wake_time.val = ~0ull;
+	tasks[i].started = 0;
+	tasks[i].stack = task_alloc_stack(CORO_STACK_SIZE);
+	tasks[i].stack_size = CORO_STACK_SIZE;
+	/* Every task runs on the main thread */
+	tasks[i].os_tid = gettid();
+	make_coroutine(&task_contexts[i], tasks[i].stack, _task_start_impl, i);
+	tasks[i].created = 1;
+}
+
+int task_start(void)
+{
+	int i;
+
+	/*
+	 * Initialize the hooks task first. It runs until it first waits,
+	 * which is after it has asked for the remaining tasks to be enabled.
+	 */
+	create_task(TASK_ID_HOOKS);
+
+	generator_stack = task_alloc_stack(CORO_STACK_SIZE);
+	make_coroutine(&generator_context, generator_stack,
+		       _task_int_generator_start, 0);
+	run_generator(&scheduler_context);
+	if (has_interrupt_generator)
+		start_generator_tick();
+
+	tasks[TASK_ID_HOOKS].wake_time.val = ~0ull;
+	resume_task(TASK_ID_HOOKS);
+
+	/* Initialize the remaining tasks. */
+	for (i = 0; i < TASK_ID_COUNT; ++i)
+		if (!tasks[i].created)
+			create_task(i);
+
+	task_scheduler();
+
+	return 0;
+}
+
+void task_enable_all_tasks(void)
+{
+	/*
+	 * Nothing to do: the remaining tasks are created once the hooks task
+	 * yields back to task_start().
+	 */
+}
@@ -0,0 +1,54 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Write the task trace to the file named by $EC_TASK_TRACE when the emulator
+ * exits, so that host tests can produce timelines, e.g.:
+ *
+ *   EC_TASK_TRACE=/tmp/usb_pe_drp.trace make run-usb_pe_drp
+ *   util/task_trace_to_chrome.py /tmp/usb_pe_drp.trace > usb_pe_drp.json
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "hooks.h"
+#include "task.h"
+#include "task_trace.h"
+
+static void task_trace_write_file(void)
+{
+	const char *path = getenv("EC_TASK_TRACE");
+	struct ec_task_trace_entry e;
+	FILE *f;
+	int i, kept;
+
+	f = fopen(path, "w");
+	if (!f) {
+		perror(path);
+		return;
+	}
+
+	task_trace_stop();
+	kept = task_trace_kept();
+	fprintf(f, "%u records, %d kept\n", task_trace_total(), kept);
+	for (i = 0; i < TASK_ID_COUNT; i++)
+		fprintf(f, "task %d %s\n", i, task_get_name(i));
+	for (i = 0; i < kept; i++) {
+		task_trace_read(i, &e, 1);
+		fprintf(f, "%10u %-9s %d\n", e.time_us,
+			task_trace_event_name(e.event), e.id);
+	}
+
+	fclose(f);
+}
+
+static void task_trace_file_init(void)
+{
+	if (getenv("EC_TASK_TRACE"))
+		atexit(task_trace_write_file);
+}
+DECLARE_HOOK(HOOK_INIT, task_trace_file_init, HOOK_PRIO_FIRST);
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "host_task.h"
 #include "task.h"
 #include "test_util.h"
 #include "timer.h"
@@ -45,7 +46,11 @@ timestamp_t _get_time(void)
 
 test_mockable timestamp_t get_time(void)
 {
-	timestamp_t ret = _get_time();
+	timestamp_t ret;
+
+	task_poll_interrupt();
+
+	ret = _get_time();
 	ret.val -= boot_time.val;
 	return ret;
 }
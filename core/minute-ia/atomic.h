@@ -91,4 +91,16 @@ static inline uint32_t deprecated_atomic_read_clear(uint32_t volatile *addr)
 	return ret;
 }
 
+static inline uint32_t deprecated_atomic_read_add(uint32_t volatile *addr,
+						  uint32_t value)
+{
+	uint32_t ret = value;
+
+	asm volatile(ASM_LOCK_PREFIX "xaddl %0, %1\n"
+		     : "+r" (ret), "+m" (*addr)
+		     : : "memory", "cc");
+
+	return ret;
+}
+
 #endif  /* __CROS_EC_ATOMIC_H */
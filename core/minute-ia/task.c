@@ -29,9 +29,6 @@
 #define CPRINTF(format, args...) cprintf(CC_SYSTEM, format, ## args)
 #define CPRINTS(format, args...) cprints(CC_SYSTEM, format, ## args)
 
-/* Value to store in unused stack */
-#define STACK_UNUSED_VALUE 0xdeadd00d
-
 /* declare task routine prototypes */
 #define TASK(n, r, d, s, f) void r(void *);
 void __idle(void);
@@ -173,6 +170,16 @@ void interrupt_enable(void)
 	__asm__ __volatile__ ("sti");
 }
 
+int is_interrupt_enabled(void)
+{
+	uint32_t eflags;
+
+	__asm__ __volatile__ ("pushfl\n"
+			      "popl %0" : "=r"(eflags));
+	/* IF bit, cleared by cli */
+	return !!(eflags & BIT(9));
+}
+
 inline int in_interrupt_context(void)
 {
 	return !!__in_isr;
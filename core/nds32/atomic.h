@@ -63,4 +63,16 @@ static inline uint32_t deprecated_atomic_read_clear(uint32_t volatile *addr)
 	set_int_mask(int_mask);
 	return val;
 }
+
+static inline uint32_t deprecated_atomic_read_add(uint32_t volatile *addr,
+						  uint32_t value)
+{
+	uint32_t val;
+	uint32_t int_mask = read_clear_int_mask();
+
+	val = *addr;
+	*addr += value;
+	set_int_mask(int_mask);
+	return val;
+}
 #endif  /* __CROS_EC_ATOMIC_H */
@@ -31,9 +31,6 @@ typedef union {
 	};
 } task_;
 
-/* Value to store in unused stack */
-#define STACK_UNUSED_VALUE 0xdeadd00d
-
 /* declare task routine prototypes */
 #define TASK(n, r, d, s) void r(void *);
 void __idle(void);
@@ -224,6 +221,15 @@ void __ram_code interrupt_enable(void)
 	asm volatile ("mtsr %0, $INT_MASK" : : "r"(val));
 }
 
+int __ram_code is_interrupt_enabled(void)
+{
+	uint32_t val;
+
+	/* interrupt_disable() masks all but the division by zero exception */
+	asm volatile ("mfsr %0, $INT_MASK" : "=r"(val));
+	return !!(val & 0xFFFC);
+}
+
 inline int in_interrupt_context(void)
 {
 	/* check INTL (Interrupt Stack Level) bits */
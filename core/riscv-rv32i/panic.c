@@ -147,7 +147,7 @@ void report_panic(uint32_t *regs)
 	pdata->struct_version = 2;
 	pdata->arch = PANIC_ARCH_RISCV_RV32I;
 	pdata->flags = 0;
-	pdata->reserved = 0;
+	pdata->stack_task = 0;
 
 	pdata->riscv.mcause = mcause;
 	pdata->riscv.mepc = mepc;
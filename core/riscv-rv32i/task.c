@@ -25,9 +25,6 @@ typedef struct {
 	uint32_t *stack;   /* Start of stack */
 } task_;
 
-/* Value to store in unused stack */
-#define STACK_UNUSED_VALUE 0xdeadd00d
-
 /* declare task routine prototypes */
 #define TASK(n, r, d, s) void r(void *);
 void __idle(void);
@@ -199,6 +196,15 @@ void __ram_code interrupt_enable(void)
 	asm volatile ("csrs  mie, t0");
 }
 
+int __ram_code is_interrupt_enabled(void)
+{
+	int mie;
+
+	/* bit11: MEIE, cleared by interrupt_disable() */
+	asm volatile ("csrr %0, mie" : "=r"(mie));
+	return !!(mie & 0x800);
+}
+
 inline int in_interrupt_context(void)
 {
 	return in_interrupt;
@@ -381,121 +381,41 @@ void bmi_normalize(const struct motion_sensor_t *s, intv3_t v, uint8_t *input)
 		v[i] = SENSOR_APPLY_SCALE(v[i], data->scale[i]);
 }
 
-int bmi_decode_header(struct motion_sensor_t *accel,
-		enum fifo_header hdr, uint32_t last_ts,
-		uint8_t **bp, uint8_t *ep)
+static int bmi_fifo_get_length(struct motion_sensor_t *s, int *length)
 {
-	if ((hdr & BMI_FH_MODE_MASK) == BMI_FH_EMPTY &&
-			(hdr & BMI_FH_PARM_MASK) != 0) {
-		int i, size = 0;
-		/* Check if there is enough space for the data frame */
-		for (i = MOTIONSENSE_TYPE_MAG; i >= MOTIONSENSE_TYPE_ACCEL;
-		     i--) {
-			if (hdr & (1 << (i + BMI_FH_PARM_OFFSET)))
-				size += (i == MOTIONSENSE_TYPE_MAG ? 8 : 6);
-		}
-		if (*bp + size > ep) {
-			/* frame is not complete, it will be retransmitted. */
-			*bp = ep;
-			return 1;
-		}
-		for (i = MOTIONSENSE_TYPE_MAG; i >= MOTIONSENSE_TYPE_ACCEL;
-		     i--) {
-			struct motion_sensor_t *s = accel + i;
-
-			if (hdr & (1 << (i + BMI_FH_PARM_OFFSET))) {
-				struct ec_response_motion_sensor_data vector;
-				int *v = s->raw_xyz;
-
-				vector.flags = 0;
-				bmi_normalize(s, v, *bp);
-				if (IS_ENABLED(CONFIG_ACCEL_SPOOF_MODE) &&
-					s->flags &
-					MOTIONSENSE_FLAG_IN_SPOOF_MODE)
-					v = s->spoof_xyz;
-				vector.data[X] = v[X];
-				vector.data[Y] = v[Y];
-				vector.data[Z] = v[Z];
-				vector.sensor_num = s - motion_sensors;
-				motion_sense_fifo_stage_data(&vector, s, 3,
-						last_ts);
-				*bp += (i == MOTIONSENSE_TYPE_MAG ? 8 : 6);
-			}
-		}
+	uint16_t val;
+	int ret;
 
-		return 1;
-	} else {
-		return 0;
-	}
-}
+	ret = bmi_read_n(s->port, s->i2c_spi_addr_flags,
+			 BMI_FIFO_LENGTH_0(V(s)), (uint8_t *)&val, sizeof(val));
+	if (ret)
+		return ret;
 
-enum fifo_state {
-	FIFO_HEADER,
-	FIFO_DATA_SKIP,
-	FIFO_DATA_TIME,
-	FIFO_DATA_CONFIG,
-};
+	*length = val & BMI_FIFO_LENGTH_MASK(V(s));
+	/*
+	 * Disable this message on BMI260, due to this seems to always
+	 * happen after we complete to read the data.
+	 * TODO(chingkang): check why this happen on BMI260.
+	 */
+	if (*length == 0 && V(s) == 0)
+		CPRINTS("unexpected empty FIFO");
+	return EC_SUCCESS;
+}
 
-#define BMI_FIFO_BUFFER 64
-static uint8_t bmi_buffer[BMI_FIFO_BUFFER];
+static int bmi_fifo_read(struct motion_sensor_t *s, uint8_t *data, int length)
+{
+	return bmi_read_n(s->port, s->i2c_spi_addr_flags,
+			  BMI_FIFO_DATA(V(s)), data, length);
+}
 
-int bmi_load_fifo(struct motion_sensor_t *s, uint32_t last_ts)
+static int bmi_fifo_check(struct motion_sensor_t *s, const uint8_t *data,
+			  int length)
 {
-	struct bmi_drv_data_t *data = BMI_GET_DATA(s);
-	uint16_t length;
-	enum fifo_state state = FIFO_HEADER;
-	uint8_t *bp = bmi_buffer;
-	uint8_t *ep;
 	uint32_t beginning;
 
+	if (length < (int)sizeof(beginning))
+		return 0;
 
-	if (s->type != MOTIONSENSE_TYPE_ACCEL)
-		return EC_SUCCESS;
-
-	if (!(data->flags &
-	     (BMI_FIFO_ALL_MASK << BMI_FIFO_FLAG_OFFSET))) {
-		/*
-		 * The FIFO was disabled while we were processing it.
-		 *
-		 * Flush potential left over:
-		 * When sensor is resumed, we won't read old data.
-		 */
-		bmi_write8(s->port, s->i2c_spi_addr_flags,
-			   BMI_CMD_REG(V(s)), BMI_CMD_FIFO_FLUSH);
-		return EC_SUCCESS;
-	}
-
-	bmi_read_n(s->port, s->i2c_spi_addr_flags,
-		   BMI_FIFO_LENGTH_0(V(s)),
-		   (uint8_t *)&length, sizeof(length));
-	length &= BMI_FIFO_LENGTH_MASK(V(s));
-
-	/*
-	 * We have not requested timestamp, no extra frame to read.
-	 * if we have too much to read, read the whole buffer.
-	 */
-	if (length == 0) {
-		/*
-		 * Disable this message on BMI260, due to this seems to always
-		 * happen after we complete to read the data.
-		 * TODO(chingkang): check why this happen on BMI260.
-		 */
-		if (V(s) == 0)
-			CPRINTS("unexpected empty FIFO");
-		return EC_SUCCESS;
-	}
-
-	/* Add one byte to get an empty FIFO frame.*/
-	length++;
-
-	if (length > sizeof(bmi_buffer))
-		CPRINTS("unexpected large FIFO: %d", length);
-	length = MIN(length, sizeof(bmi_buffer));
-
-	bmi_read_n(s->port, s->i2c_spi_addr_flags,
-		   BMI_FIFO_DATA(V(s)), bmi_buffer, length);
-	beginning = *(uint32_t *)bmi_buffer;
-	ep = bmi_buffer + length;
 	/*
 	 * FIFO is invalid when reading while the sensors are all
 	 * suspended.
@@ -504,80 +424,135 @@ int bmi_load_fifo(struct motion_sensor_t *s, uint32_t last_ts)
 	 * If we see those, assume the sensors have been disabled
 	 * while this thread was running.
 	 */
+	memcpy(&beginning, data, sizeof(beginning));
 	if (beginning == 0x84848484 ||
 			(beginning & 0xdcdcdcdc) == 0x40404040) {
 		CPRINTS("Suspended FIFO: accel ODR/rate: %d/%d: 0x%08x",
 				BASE_ODR(s->config[SENSOR_CONFIG_AP].odr),
 				BMI_GET_SAVED_DATA(s)->odr,
 				beginning);
-		return EC_SUCCESS;
+		return 1;
 	}
+	return 0;
+}
 
+/* Stage the samples of a data frame; return its size, or 0 if cut short */
+static int bmi_decode_data(struct motion_sensor_t *accel,
+			   enum fifo_header hdr, uint32_t last_ts,
+			   uint8_t *bp, int length)
+{
+	int i, size = 0;
 
-	while (bp < ep) {
-		switch (state) {
-		case FIFO_HEADER: {
-			enum fifo_header hdr = *bp++;
-
-			if (bmi_decode_header(s, hdr, last_ts, &bp, ep))
-				continue;
-			/* Other cases */
-			hdr &= 0xdc;
-			switch (hdr) {
-			case BMI_FH_EMPTY:
-				return EC_SUCCESS;
-			case BMI_FH_SKIP:
-				state = FIFO_DATA_SKIP;
-				break;
-			case BMI_FH_TIME:
-				state = FIFO_DATA_TIME;
-				break;
-			case BMI_FH_CONFIG:
-				state = FIFO_DATA_CONFIG;
-				break;
-			default:
-				CPRINTS("Unknown header: 0x%02x @ %zd",
-						hdr, bp - bmi_buffer);
-				bmi_write8(s->port, s->i2c_spi_addr_flags,
-						BMI_CMD_REG(V(s)),
-						BMI_CMD_FIFO_FLUSH);
-				return EC_ERROR_NOT_HANDLED;
-			}
-			break;
-		}
-		case FIFO_DATA_SKIP:
-			CPRINTS("@ %zd - %d, skipped %d frames",
-					bp - bmi_buffer, length, *bp);
-			bp++;
-			state = FIFO_HEADER;
-			break;
-		case FIFO_DATA_CONFIG:
-			CPRINTS("@ %zd - %d, config change: 0x%02x",
-					bp - bmi_buffer, length, *bp);
-			bp++;
-			if (V(s))
-				state = FIFO_DATA_TIME;
-			else
-				state = FIFO_HEADER;
-			break;
-		case FIFO_DATA_TIME:
-			if (bp + 3 > ep) {
-				bp = ep;
-				continue;
-			}
-			/* We are not requesting timestamp */
-			CPRINTS("timestamp %d", (bp[2] << 16) |
-					(bp[1] << 8) | bp[0]);
-			state = FIFO_HEADER;
-			bp += 3;
-			break;
-		default:
-			CPRINTS("Unknown data: 0x%02x", *bp++);
-			state = FIFO_HEADER;
+	/* Check if there is enough space for the data frame */
+	for (i = MOTIONSENSE_TYPE_MAG; i >= MOTIONSENSE_TYPE_ACCEL; i--) {
+		if (hdr & (1 << (i + BMI_FH_PARM_OFFSET)))
+			size += (i == MOTIONSENSE_TYPE_MAG ? 8 : 6);
+	}
+	if (size > length)
+		return 0;
+
+	for (i = MOTIONSENSE_TYPE_MAG; i >= MOTIONSENSE_TYPE_ACCEL; i--) {
+		struct motion_sensor_t *s = accel + i;
+
+		if (hdr & (1 << (i + BMI_FH_PARM_OFFSET))) {
+			struct ec_response_motion_sensor_data vector;
+			int *v = s->raw_xyz;
+
+			vector.flags = 0;
+			bmi_normalize(s, v, bp);
+			if (IS_ENABLED(CONFIG_ACCEL_SPOOF_MODE) &&
+				s->flags &
+				MOTIONSENSE_FLAG_IN_SPOOF_MODE)
+				v = s->spoof_xyz;
+			vector.data[X] = v[X];
+			vector.data[Y] = v[Y];
+			vector.data[Z] = v[Z];
+			vector.sensor_num = s - motion_sensors;
+			motion_sense_fifo_stage_data(&vector, s, 3,
+					last_ts);
+			bp += (i == MOTIONSENSE_TYPE_MAG ? 8 : 6);
 		}
 	}
 
-	return EC_SUCCESS;
+	return size;
+}
+
+static int bmi_fifo_decode(struct motion_sensor_t *s, uint8_t *data,
+			   int length, uint32_t last_ts)
+{
+	enum fifo_header hdr = data[0];
+	int size;
+
+	if ((hdr & BMI_FH_MODE_MASK) == BMI_FH_EMPTY &&
+			(hdr & BMI_FH_PARM_MASK) != 0) {
+		size = bmi_decode_data(s, hdr, last_ts, data + 1, length - 1);
+		return size ? size + 1 : 0;
+	}
+
+	/* Other cases */
+	switch (hdr & 0xdc) {
+	case BMI_FH_EMPTY:
+		return -1;
+	case BMI_FH_SKIP:
+		if (length < 2)
+			return 0;
+		CPRINTS("skipped %d frames", data[1]);
+		return 2;
+	case BMI_FH_CONFIG:
+		/* On BMI260, a sensor time follows the config */
+		size = V(s) ? 5 : 2;
+		if (length < size)
+			return 0;
+		CPRINTS("config change: 0x%02x", data[1]);
+		return size;
+	case BMI_FH_TIME:
+		if (length < 4)
+			return 0;
+		/* We are not requesting timestamp */
+		CPRINTS("timestamp %d", (data[3] << 16) |
+				(data[2] << 8) | data[1]);
+		return 4;
+	default:
+		CPRINTS("Unknown header: 0x%02x", hdr);
+		bmi_write8(s->port, s->i2c_spi_addr_flags,
+				BMI_CMD_REG(V(s)),
+				BMI_CMD_FIFO_FLUSH);
+		return -EC_ERROR_NOT_HANDLED;
+	}
+}
+
+static const struct motion_sense_fifo_layout bmi_fifo_layout = {
+	.get_length = bmi_fifo_get_length,
+	.read = bmi_fifo_read,
+	.check = bmi_fifo_check,
+	.decode = bmi_fifo_decode,
+	/* Add one byte to get an empty FIFO frame. */
+	.extra = 1,
+	/* A frame cut short is retransmitted. */
+	.resends_partial = 1,
+};
+
+int bmi_load_fifo(struct motion_sensor_t *s, uint32_t last_ts)
+{
+	struct bmi_drv_data_t *data = BMI_GET_DATA(s);
+
+	if (s->type != MOTIONSENSE_TYPE_ACCEL)
+		return EC_SUCCESS;
+
+	if (!(data->flags &
+	     (BMI_FIFO_ALL_MASK << BMI_FIFO_FLAG_OFFSET))) {
+		/*
+		 * The FIFO was disabled while we were processing it.
+		 *
+		 * Flush potential left over:
+		 * When sensor is resumed, we won't read old data.
+		 */
+		bmi_write8(s->port, s->i2c_spi_addr_flags,
+			   BMI_CMD_REG(V(s)), BMI_CMD_FIFO_FLUSH);
+		return EC_SUCCESS;
+	}
+
+	return motion_sense_fifo_drain(s, &bmi_fifo_layout, last_ts);
 }
 
 int bmi_set_range(const struct motion_sensor_t *s, int range, int rnd)
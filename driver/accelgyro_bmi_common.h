@@ -257,20 +257,6 @@ int bmi_set_reg8(const struct motion_sensor_t *s, int reg,
  */
 void bmi_normalize(const struct motion_sensor_t *s, intv3_t v, uint8_t *input);
 
-/*
- * Decode the header from the fifo.
- * Return 0 if we need further processing.
- * Sensor mutex must be held during processing, to protect the fifos.
- *
- * @accel: base sensor
- * @hdr: the header to decode
- * @last_ts: the last timestamp of fifo interrupt.
- * @bp: current pointer in the buffer, updated when processing the header.
- * @ep: pointer to the end of the valid data in the buffer.
- */
-int bmi_decode_header(struct motion_sensor_t *accel,
-		      enum fifo_header hdr, uint32_t last_ts,
-		      uint8_t **bp, uint8_t *ep);
 /**
  * Retrieve hardware FIFO from sensor,
  * - put data in Sensor Hub fifo.
@@ -279,8 +265,8 @@ int bmi_decode_header(struct motion_sensor_t *accel,
  * @s: Pointer to sensor data.
  * @last_ts: The last timestamp of fifo interrupt.
  *
- * Read only up to  bmi_buffer. If more reads are needed, we will be called
- * again by the interrupt routine.
+ * The whole FIFO is read with motion_sense_fifo_drain(), in bursts of up to
+ * CONFIG_ACCEL_FIFO_DRAIN_SIZE bytes.
  *
  * NOTE: If a new driver supports this function, be sure to add a check
  * for spoof_mode in order to load the sensor stack with the spoofed
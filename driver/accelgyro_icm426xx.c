@@ -183,48 +183,56 @@ static void __maybe_unused icm426xx_push_fifo_data(struct motion_sensor_t *s,
 	}
 }
 
-static int __maybe_unused icm426xx_load_fifo(struct motion_sensor_t *s,
-					     uint32_t ts)
+static int icm426xx_fifo_get_length(struct motion_sensor_t *s, int *length)
 {
-	struct icm_drv_data_t *st = ICM_GET_DATA(s);
-	int count, i, size;
-	const uint8_t *accel, *gyro;
 	int ret;
 
-	ret = icm_read16(s, ICM426XX_REG_FIFO_COUNT, &count);
+	ret = icm_read16(s, ICM426XX_REG_FIFO_COUNT, length);
 	if (ret != EC_SUCCESS)
 		return ret;
 
-	if (count <= 0)
-		return EC_ERROR_INVAL;
+	return *length > 0 ? EC_SUCCESS : EC_ERROR_INVAL;
+}
 
-	/* flush FIFO if buffer is not large enough */
-	if (count > ICM_FIFO_BUFFER) {
-		CPRINTS("It should not happen, the EC is too slow for the ODR");
-		ret = icm_write8(s, ICM426XX_REG_SIGNAL_PATH_RESET,
-				 ICM426XX_FIFO_FLUSH);
-		if (ret != EC_SUCCESS)
-			return ret;
-		return EC_ERROR_OVERFLOW;
-	}
+static int icm426xx_fifo_read(struct motion_sensor_t *s, uint8_t *data,
+			      int length)
+{
+	return icm_read_n(s, ICM426XX_REG_FIFO_DATA, data, length);
+}
 
-	ret = icm_read_n(s, ICM426XX_REG_FIFO_DATA, st->fifo_buffer, count);
-	if (ret != EC_SUCCESS)
-		return ret;
+static int icm426xx_fifo_decode(struct motion_sensor_t *s, uint8_t *data,
+				int length, uint32_t ts)
+{
+	struct icm_drv_data_t *st = ICM_GET_DATA(s);
+	const uint8_t *accel, *gyro;
+	int size;
 
-	for (i = 0; i < count; i += size) {
-		size = icm_fifo_decode_packet(&st->fifo_buffer[i],
-				&accel, &gyro);
-		/* exit if error or FIFO is empty */
-		if (size <= 0)
-			return -size;
-		if (accel != NULL)
-			icm426xx_push_fifo_data(st->accel, accel, ts);
-		if (gyro != NULL)
-			icm426xx_push_fifo_data(st->gyro, gyro, ts);
-	}
+	size = icm_fifo_decode_packet(data, &accel, &gyro);
+	/* stop if error or FIFO is empty */
+	if (size <= 0)
+		return size ? size : -1;
+	if (size > length)
+		return 0;
 
-	return EC_SUCCESS;
+	if (accel != NULL)
+		icm426xx_push_fifo_data(st->accel, accel, ts);
+	if (gyro != NULL)
+		icm426xx_push_fifo_data(st->gyro, gyro, ts);
+
+	return size;
+}
+
+static const struct motion_sense_fifo_layout icm426xx_fifo_layout = {
+	.get_length = icm426xx_fifo_get_length,
+	.read = icm426xx_fifo_read,
+	.decode = icm426xx_fifo_decode,
+	/* FIFO is in partial read mode: a cut packet continues next read. */
+};
+
+static int __maybe_unused icm426xx_load_fifo(struct motion_sensor_t *s,
+					     uint32_t ts)
+{
+	return motion_sense_fifo_drain(s, &icm426xx_fifo_layout, ts);
 }
 
 #ifdef CONFIG_ACCEL_INTERRUPTS
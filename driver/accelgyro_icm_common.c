@@ -350,7 +350,7 @@ struct icm_fifo_2sensors_packet {
 } __packed;
 #define ICM_FIFO_2SENSORS_PACKET_SIZE	16
 
-ssize_t icm_fifo_decode_packet(const void *packet, const uint8_t **accel,
+int icm_fifo_decode_packet(const void *packet, const uint8_t **accel,
 		const uint8_t **gyro)
 {
 	const struct icm_fifo_1sensor_packet *pack1 = packet;
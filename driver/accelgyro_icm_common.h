@@ -10,20 +10,12 @@
 
 #include "accelgyro.h"
 
-#ifdef CONFIG_ACCEL_FIFO
-/* reserve maximum 4 samples of 16 bytes */
-#define ICM_FIFO_BUFFER	64
-#else
-#define ICM_FIFO_BUFFER	0
-#endif
-
 struct icm_drv_data_t {
 	struct accelgyro_saved_data_t saved_data[2];
 	struct motion_sensor_t *accel;
 	struct motion_sensor_t *gyro;
 	uint8_t bank;
 	uint8_t fifo_en;
-	uint8_t fifo_buffer[ICM_FIFO_BUFFER] __aligned(sizeof(long));
 };
 
 #define ICM_GET_DATA(_s) \
@@ -95,7 +87,7 @@ int icm_set_scale(const struct motion_sensor_t *s, const uint16_t *scale,
 int icm_get_scale(const struct motion_sensor_t *s, uint16_t *scale,
 		  int16_t *temp);
 
-ssize_t icm_fifo_decode_packet(const void *packet, const uint8_t **accel,
+int icm_fifo_decode_packet(const void *packet, const uint8_t **accel,
 		const uint8_t **gyro);
 
 #endif	/* __CROS_EC_ACCELGYRO_ICM_COMMON_H */
@@ -315,69 +315,92 @@ static int fifo_next(struct lsm6dsm_data *private)
 	return FIFO_DEV_INVALID;
 }
 
+/* Bytes in the FIFO, read by irq_handler() along with the FIFO status */
+static int fifo_len;
+
+static int lsm6dsm_fifo_get_length(struct motion_sensor_t *s, int *length)
+{
+	*length = fifo_len;
+	return EC_SUCCESS;
+}
+
+static int lsm6dsm_fifo_read(struct motion_sensor_t *s, uint8_t *data,
+			     int length)
+{
+	return st_raw_read_n_noinc(s->port, s->i2c_spi_addr_flags,
+				   LSM6DSM_FIFO_DATA_ADDR, data, length);
+}
+
 /**
- * push_fifo_data - Scan data pattern and push upside
+ * lsm6dsm_fifo_decode - Push the sample of the next sensor in the pattern
  */
-static void push_fifo_data(struct motion_sensor_t *accel, uint8_t *fifo,
-			   uint16_t flen,
-			   uint32_t timestamp)
+static int lsm6dsm_fifo_decode(struct motion_sensor_t *accel, uint8_t *fifo,
+			       int length, uint32_t timestamp)
 {
 	struct motion_sensor_t *s;
 	struct lsm6dsm_data *private = LSM6DSM_GET_DATA(accel);
+	struct ec_response_motion_sensor_data vect;
+	int id;
+	int *axis;
+	int next_fifo;
 
-	while (flen > 0) {
-		struct ec_response_motion_sensor_data vect;
-		int id;
-		int *axis;
-		int next_fifo = fifo_next(private);
-		/*
-		 * This should never happen, but it could. There will be a
-		 * report from inside fifo_next about it, so no extra message
-		 * required here.
-		 */
-		if (next_fifo == FIFO_DEV_INVALID) {
-			return;
-		}
+	if (length < OUT_XYZ_SIZE)
+		return 0;
 
-		id = get_sensor_type(next_fifo);
-		if (private->accel_fifo_state->samples_to_discard[id] > 0) {
-			private->accel_fifo_state->samples_to_discard[id]--;
-		} else {
-			s = accel + id;
-			axis = s->raw_xyz;
+	/*
+	 * This should never happen, but it could. There will be a
+	 * report from inside fifo_next about it, so no extra message
+	 * required here. Drop the sample so the FIFO is still emptied.
+	 */
+	next_fifo = fifo_next(private);
+	if (next_fifo == FIFO_DEV_INVALID)
+		return OUT_XYZ_SIZE;
+
+	id = get_sensor_type(next_fifo);
+	if (private->accel_fifo_state->samples_to_discard[id] > 0) {
+		private->accel_fifo_state->samples_to_discard[id]--;
+		return OUT_XYZ_SIZE;
+	}
+
+	s = accel + id;
+	axis = s->raw_xyz;
 
-			/* Apply precision, sensitivity and rotation. */
+	/* Apply precision, sensitivity and rotation. */
 #ifdef CONFIG_MAG_LSM6DSM_LIS2MDL
-			if (s->type == MOTIONSENSE_TYPE_MAG) {
-				lis2mdl_normalize(s, axis, fifo);
-				rotate(axis, *s->rot_standard_ref, axis);
-			} else
+	if (s->type == MOTIONSENSE_TYPE_MAG) {
+		lis2mdl_normalize(s, axis, fifo);
+		rotate(axis, *s->rot_standard_ref, axis);
+	} else
 #endif
-			{
-				st_normalize(s, axis, fifo);
-			}
+	{
+		st_normalize(s, axis, fifo);
+	}
 
+	vect.data[X] = axis[X];
+	vect.data[Y] = axis[Y];
+	vect.data[Z] = axis[Z];
 
-			vect.data[X] = axis[X];
-			vect.data[Y] = axis[Y];
-			vect.data[Z] = axis[Z];
+	vect.flags = 0;
+	vect.sensor_num = s - motion_sensors;
+	motion_sense_fifo_stage_data(&vect, s, 3, timestamp);
 
-			vect.flags = 0;
-			vect.sensor_num = s - motion_sensors;
-			motion_sense_fifo_stage_data(&vect, s, 3, timestamp);
-		}
-
-		fifo += OUT_XYZ_SIZE;
-		flen -= OUT_XYZ_SIZE;
-	}
+	return OUT_XYZ_SIZE;
 }
 
+static const struct motion_sense_fifo_layout lsm6dsm_fifo_layout = {
+	.get_length = lsm6dsm_fifo_get_length,
+	.read = lsm6dsm_fifo_read,
+	.decode = lsm6dsm_fifo_decode,
+	/* Only read whole samples. */
+	.max_burst = (CONFIG_ACCEL_FIFO_DRAIN_SIZE / OUT_XYZ_SIZE) *
+		     OUT_XYZ_SIZE,
+};
+
 static int load_fifo(struct motion_sensor_t *s, const struct fstatus *fsts,
 		     uint32_t *last_fifo_read_ts)
 {
 	uint32_t interrupt_timestamp = last_interrupt_timestamp;
-	int err, left, length;
-	uint8_t fifo[FIFO_READ_LEN];
+	int err;
 
 	/* Reset the load_fifo_sensor_state so we can start a new read. */
 	reset_load_fifo_sensor_state(s, interrupt_timestamp);
@@ -386,9 +409,9 @@ static int load_fifo(struct motion_sensor_t *s, const struct fstatus *fsts,
 	 * DIFF[11:0] are number of unread uint16 in FIFO
 	 * mask DIFF and compute total byte len to read from FIFO.
 	 */
-	left = fsts->len & LSM6DSM_FIFO_DIFF_MASK;
-	left *= sizeof(uint16_t);
-	left = (left / OUT_XYZ_SIZE) * OUT_XYZ_SIZE;
+	fifo_len = fsts->len & LSM6DSM_FIFO_DIFF_MASK;
+	fifo_len *= sizeof(uint16_t);
+	fifo_len = (fifo_len / OUT_XYZ_SIZE) * OUT_XYZ_SIZE;
 
 	/*
 	 * TODO(b/122912601): phaser360: Investigate Standard Deviation error
@@ -396,33 +419,18 @@ static int load_fifo(struct motion_sensor_t *s, const struct fstatus *fsts,
 	 * - check "pattern" register versus where code thinks it is parsing
 	 */
 
-	/* Push all data on upper side. */
-	do {
-		/* Fit len to pre-allocated static buffer. */
-		if (left > FIFO_READ_LEN)
-			length = FIFO_READ_LEN;
-		else
-			length = left;
-
-		/* Read data and copy in buffer. */
-		err = st_raw_read_n_noinc(s->port, s->i2c_spi_addr_flags,
-					  LSM6DSM_FIFO_DATA_ADDR,
-					  fifo, length);
-		*last_fifo_read_ts = __hw_clock_source_read();
-		if (err != EC_SUCCESS)
-			return err;
-
-		/*
-		 * Manage patterns and push data. Data is pushed with the
-		 * timestamp of the interrupt that got us into this function
-		 * in the first place. This avoids a potential race condition
-		 * where we empty the FIFO, and a new IRQ comes in between
-		 * reading the last sample and pushing it into the FIFO.
-		 */
-
-		push_fifo_data(s, fifo, length, interrupt_timestamp);
-		left -= length;
-	} while (left > 0);
+	/*
+	 * Manage patterns and push data. Data is pushed with the
+	 * timestamp of the interrupt that got us into this function
+	 * in the first place. This avoids a potential race condition
+	 * where we empty the FIFO, and a new IRQ comes in between
+	 * reading the last sample and pushing it into the FIFO.
+	 */
+	err = motion_sense_fifo_drain(s, &lsm6dsm_fifo_layout,
+				      interrupt_timestamp);
+	*last_fifo_read_ts = __hw_clock_source_read();
+	if (err != EC_SUCCESS)
+		return err;
 
 	motion_sense_fifo_commit_data();
 
@@ -0,0 +1,93 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Microbenchmark harness for tests */
+
+#ifndef __CROS_EC_BENCHMARK_H
+#define __CROS_EC_BENCHMARK_H
+
+#include "common.h"
+
+/* Maximum number of timed runs of one benchmark */
+#define BENCHMARK_MAX_RUNS 1000
+
+struct benchmark_options {
+	/* Untimed runs before measuring, to warm up caches and branches */
+	int warmup;
+	/* Timed runs, up to BENCHMARK_MAX_RUNS */
+	int runs;
+	/*
+	 * Calls per timed run. Use more than 1 for functions which are too
+	 * short for the clock resolution; results are still per call.
+	 */
+	int batch;
+};
+
+#define BENCHMARK_DEFAULT_OPTIONS { .warmup = 10, .runs = 100, .batch = 1 }
+
+/* Result of a benchmark, per call */
+struct benchmark_result {
+	const char *name;
+	int runs;
+	int batch;
+	uint32_t min_ns;
+	uint32_t median_ns;
+	uint32_t p99_ns;
+	uint32_t max_ns;
+	uint32_t mean_ns;
+	/* CPU cycles (rdtsc on x86 hosts), 0 if there is no cycle counter */
+	uint32_t median_cycles;
+};
+
+/**
+ * Time a function.
+ *
+ * Time is measured with the host's monotonic clock on the emulator, as the
+ * emulator's own clock is virtual, and with the hardware timer on a device.
+ *
+ * @param name		Name reported in the result.
+ * @param fn		Function to time.
+ * @param arg		Argument passed to fn.
+ * @param opts		Options, or NULL for BENCHMARK_DEFAULT_OPTIONS.
+ * @param result	Filled with the result.
+ * @return		EC_SUCCESS, or EC_ERROR_INVAL if the options are out
+ *			of range.
+ */
+int benchmark_run(const char *name, void (*fn)(void *), void *arg,
+		  const struct benchmark_options *opts,
+		  struct benchmark_result *result);
+
+/**
+ * Print a result on the console, on one line, as:
+ *
+ *   BENCH name=<name> runs=<n> batch=<n> min_ns=<n> median_ns=<n> p99_ns=<n>
+ *         max_ns=<n> mean_ns=<n> median_cycles=<n>
+ *
+ * The format is stable, so that results can be collected by scripts.
+ */
+void benchmark_print(const struct benchmark_result *result);
+
+/**
+ * Print a result, and check that it is consistent: min <= median <= p99 <=
+ * max, with the mean between min and max.
+ *
+ * @param result	Result from benchmark_run().
+ * @return		EC_SUCCESS, or EC_ERROR_UNKNOWN if it isn't consistent.
+ */
+int benchmark_check(const struct benchmark_result *result);
+
+/*
+ * Run a benchmark from a test function, and fail the test if it can't run or
+ * gives an inconsistent result. Needs test_util.h.
+ */
+#define TEST_BENCHMARK(name, fn, arg, opts)				\
+	do {								\
+		struct benchmark_result r;				\
+		TEST_EQ(benchmark_run(name, fn, arg, opts, &r),		\
+			EC_SUCCESS, "%d");				\
+		TEST_EQ(benchmark_check(&r), EC_SUCCESS, "%d");		\
+	} while (0)
+
+#endif  /* __CROS_EC_BENCHMARK_H */
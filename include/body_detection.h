@@ -23,6 +23,42 @@ void body_detect_reset(void);
 /* Body detect main function. This should be called when new sensor data come */
 void body_detect(void);
 
+/*
+ * Run body detection on n samples of the X and Y axes, in order. body_detect()
+ * calls it with the samples the FIFO got since it last ran.
+ */
+void body_detect_batch(const int *x, const int *y, int n);
+
+/* Most samples body_detect() takes from the FIFO at a time */
+#define BODY_DETECTION_BATCH_SIZE 32
+
+/*
+ * Curve from the motion variance to the confidence that the device is on a
+ * body: the confidence goes from 0% at var_threshold - confidence_delta up to
+ * 100% at var_threshold + confidence_delta. The detection changes to on-body
+ * above on_body_con, and to off-body after the confidence stayed below
+ * off_body_con for CONFIG_BODY_DETECTION_STATIONARY_DURATION.
+ */
+struct body_detect_params {
+	int var_threshold;	/* (mm/s^2)^2 */
+	int confidence_delta;	/* (mm/s^2)^2 */
+	int on_body_con;	/* % */
+	int off_body_con;	/* % */
+};
+
+/* Get the confidence curve */
+void body_detect_get_params(struct body_detect_params *p);
+
+/*
+ * Set the confidence curve, in place of the CONFIG_BODY_DETECTION_* defaults.
+ *
+ * @return EC_SUCCESS, or EC_ERROR_INVAL if it is out of range.
+ */
+int body_detect_set_params(const struct body_detect_params *p);
+
+/* Var(X) + Var(Y) of the sensor data over the window, in LSB^2 */
+uint64_t body_detect_get_variance(void);
+
 /* enable/disable body detection */
 void body_detect_set_enable(int enable);
 
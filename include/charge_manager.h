@@ -195,6 +195,23 @@ int charge_manager_get_active_charge_port(void);
  */
 int charge_manager_get_selected_charge_port(void);
 
+/* Charge manager refresh statistics */
+struct charge_manager_stats {
+	/* Charge / dual-role updates received */
+	uint32_t updates;
+	/* Refreshes requested, including those coalesced into a pending one */
+	uint32_t refresh_requests;
+	/* Refreshes actually run */
+	uint32_t refreshes;
+};
+
+/**
+ * Get the charge manager refresh statistics.
+ *
+ * @param stats	Filled with the current counter values.
+ */
+void charge_manager_get_stats(struct charge_manager_stats *stats);
+
 /**
  * Get the power limit set by charge manager.
  *
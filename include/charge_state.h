@@ -19,6 +19,17 @@
 #define CHARGE_POLL_PERIOD_CHARGE      (MSEC * 250)
 #define CHARGE_POLL_PERIOD_SHORT       (MSEC * 100)
 #define CHARGE_MIN_SLEEP_USEC          (MSEC * 50)
+/* Polling period on AC once the charge inputs have settled */
+#define CHARGE_POLL_PERIOD_CHARGE_STABLE SECOND
+/* Number of passes without any input change before inputs are settled */
+#define CHARGE_STABLE_PASSES           4
+/*
+ * Unchanged charger settings are rewritten at least this often, for chargers
+ * which stop charging when they aren't talked to frequently enough.
+ */
+#ifndef CHARGE_REWRITE_PERIOD_USEC
+#define CHARGE_REWRITE_PERIOD_USEC     (SECOND * 30)
+#endif
 /* If a board hasn't provided a max sleep, use 1 minute as default */
 #ifndef CHARGE_MAX_SLEEP_USEC
 #define CHARGE_MAX_SLEEP_USEC          MINUTE
@@ -53,6 +53,19 @@
 /* The amount of free entries that trigger an interrupt to the AP. */
 #undef CONFIG_ACCEL_FIFO_THRES
 
+/*
+ * Size of the buffer motion_sense_fifo_drain() reads hardware FIFOs into,
+ * which is the largest burst it reads.
+ */
+#define CONFIG_ACCEL_FIFO_DRAIN_SIZE 256
+
+/*
+ * Count the hardware FIFO drains of each sensor: bursts, bytes, frames and
+ * the time spent reading and decoding them. See the "fifodrain" console
+ * command.
+ */
+#undef CONFIG_ACCEL_FIFO_DRAIN_STATS
+
 /*
  * Sensors in this mask are in forced mode: they needed to be polled
  * at their data rate frequency.
@@ -299,6 +312,20 @@
 /* Support AES-GCM */
 #undef CONFIG_AES_GCM
 
+/*
+ * Have fingerprint template encryption run AES-GCM through the multi-block
+ * CTR32 routine, which computes most of the first AES round once per call,
+ * instead of calling the block cipher for each block.
+ */
+#undef CONFIG_AES_GCM_CTR32
+
+/*
+ * Use 8-bit tables for GHASH instead of 4-bit ones, with half the lookups per
+ * block. This makes each GCM context almost 4 KiB larger, so users of the
+ * context must not keep it on a task stack.
+ */
+#undef CONFIG_AES_GCM_GHASH_8BIT
+
 /*
  * Some ALS modules may be connected to the EC. We need the command, and
  * specific drivers for each module.
@@ -825,6 +852,13 @@
 /* Leave safe mode when battery pct meets or exceeds this value */
 #define CONFIG_CHARGE_MANAGER_BAT_PCT_SAFE_MODE_EXIT 2
 
+/*
+ * Delay (us) between the first charge update of a burst and the charge port
+ * refresh. Updates arriving within this window are handled by a single
+ * refresh.
+ */
+#define CONFIG_CHARGE_MANAGER_REFRESH_DELAY 0
+
 /* The hardware has some input current ramping/back-off mechanism */
 #undef CONFIG_CHARGE_RAMP_HW
 
@@ -1786,6 +1820,13 @@
  */
 #undef CONFIG_FLASH_PSTATE_LOCKED
 
+/*
+ * The chip can read flash in the background, with
+ * flash_physical_read_async(), while the CPU does something else. The vboot
+ * hash uses it to read the next chunk while hashing the current one.
+ */
+#undef CONFIG_FLASH_READ_ASYNC
+
 /*
  * Enable readout protection.
  */
@@ -2855,6 +2896,21 @@
 /* Support host command interface over eSPI bus. */
 #undef CONFIG_HOSTCMD_ESPI
 
+/*
+ * Count ACPI EC port reads and writes per address and time the transactions,
+ * read with EC_CMD_ACPI_STATS, "ectool acpistats" and the "acpistats"
+ * console command. Needs CONFIG_HOSTCMD_X86.
+ */
+#undef CONFIG_ACPI_STATS
+
+/*
+ * In ACPI burst mode, learn how many bytes the AP reads from each memmap
+ * address it starts reading at, and copy that many into the read cache on a
+ * miss, up to CONFIG_ACPI_PREFETCH_SIZE, instead of the default four.
+ */
+#undef CONFIG_ACPI_PREFETCH
+#define CONFIG_ACPI_PREFETCH_SIZE 16
+
 /*
  * SLP signals (SLP_S3 and SLP_S4) use virtual wires intead of physical pins
  * with eSPI interface.
@@ -2896,6 +2952,20 @@
 /* Provide rudimentary malloc/free like services for shared memory. */
 #undef CONFIG_MALLOC
 
+/*
+ * Serve small shared_mem_acquire() requests from fixed-size pools, in constant
+ * time and without fragmenting shared memory, falling back to shared memory
+ * when the pools which fit are all in use. CONFIG_SHAREDMEM_SLAB_CLASSES lists
+ * the pools as SHARED_MEM_SLAB(buffer size, buffers), with distinct sizes
+ * which are multiples of 4, and at most 32 buffers each. The pools are static,
+ * so they come out of the RAM left for shared memory.
+ */
+#undef CONFIG_SHAREDMEM_SLAB
+#define CONFIG_SHAREDMEM_SLAB_CLASSES \
+	SHARED_MEM_SLAB(64, 8) \
+	SHARED_MEM_SLAB(256, 4) \
+	SHARED_MEM_SLAB(1024, 2)
+
 /* Need for a math library */
 #undef CONFIG_MATH_UTIL
 
@@ -3043,6 +3113,30 @@
  */
 #undef CONFIG_PECI_TJMAX
 
+/*
+ * Run PECI transactions from a queue serviced by the PECI task, so callers
+ * can queue writes without waiting on the bus. Requires a PECI task.
+ */
+#undef CONFIG_PECI_QUEUE
+
+/* Number of requests the PECI queue can hold */
+#define CONFIG_PECI_QUEUE_DEPTH 8
+
+/*
+ * Reuse a PECI CPU temperature reading for this long (us) instead of
+ * issuing another GetTemp. 0 disables caching.
+ */
+#define CONFIG_PECI_TEMP_CACHE_US 0
+
+/*
+ * Table-driven SoC power limit (PL1/PL2/PL4/PsysPL2) policy. The board
+ * provides the policy table and board_soc_pl_write().
+ */
+#undef CONFIG_SOC_POWER_LIMIT
+
+/* Number of SoC power limit write batches kept for the socpl command */
+#define CONFIG_SOC_POWER_LIMIT_HISTORY 8
+
 /*****************************************************************************/
 /* PMU config */
 
@@ -3170,6 +3264,17 @@
  */
 #undef CONFIG_PRINTF_LEGACY_LI_FORMAT
 
+/*
+ * Statistical profiler: a periodic timer interrupt (SysTick on Cortex-M,
+ * SIGPROF on the emulator) counts the interrupted PC and task in a RAM
+ * histogram. See the "profile" console command and EC_CMD_PROFILER, and
+ * util/profiler_symbolize.py to map the PCs to functions.
+ */
+#undef CONFIG_PROFILER
+
+/* Number of (PC, task) histogram entries */
+#define CONFIG_PROFILER_ENTRIES 256
+
 /*
  * On x86 systems, define this option if the CPU_PROCHOT signal is active low.
  * This setting also applies to monitoring the PROCHOT input if provided by
@@ -3617,6 +3722,42 @@
  */
 #define CONFIG_TASK_PROFILING
 
+/*
+ * Record task switches and IRQ entry/exit with timestamps in a ring buffer,
+ * for timelines of how tasks and interrupts interleave. See the "tasktrace"
+ * console command, EC_CMD_TASK_TRACE, and util/task_trace_to_chrome.py.
+ */
+#undef CONFIG_TASK_TRACE
+
+/* Number of task trace records; must be a power of 2 */
+#define CONFIG_TASK_TRACE_SIZE 512
+
+/*
+ * Keep contention statistics (locks, wait and hold times) for each mutex,
+ * printed by the "taskinfo" console command. Only the cortex-m and host cores
+ * keep them.
+ */
+#undef CONFIG_MUTEX_STATS
+
+/*
+ * Number of mutexes CONFIG_MUTEX_STATS keeps track of. Only statically
+ * allocated mutexes may be locked with the statistics on, as the table keeps
+ * pointing at each mutex once it was locked.
+ */
+#define CONFIG_MUTEX_STATS_COUNT 32
+
+/*
+ * Track the peak stack usage of each task in the background: the idle task
+ * checks CONFIG_STACK_WATCH_WORDS words of the stacks on each pass. See the
+ * "stackpeak" console command and EC_CMD_STACK_INFO. Only the cortex-m and
+ * host cores support it, and chips with their own low power idle task must
+ * call stack_watch_idle().
+ */
+#undef CONFIG_STACK_WATCH
+
+/* Stack words checked per idle pass */
+#define CONFIG_STACK_WATCH_WORDS 16
+
 /*****************************************************************************/
 /* Mock config */
 
@@ -3680,6 +3821,24 @@
 /* Compile common code for throttling the CPU based on the temp sensors */
 #undef CONFIG_THROTTLE_AP
 
+/*
+ * Filtering of the temperatures the thermal task bases fan demand on. The
+ * warn/high/halt thresholds always use the raw readings. Tunable at run time
+ * with the thermalfilter console command.
+ *
+ * CONFIG_THERMAL_FILTER_MEDIAN rejects single-sample spikes (median of 3).
+ * CONFIG_THERMAL_FILTER_EMA_SHIFT smooths each sensor with an exponential
+ * moving average weighing a new sample 1/2^shift. 0 disables.
+ * CONFIG_THERMAL_PREDICT_SEC raises fan demand ahead of a rising temperature
+ * by extrapolating its slope this many seconds. 0 disables.
+ */
+#undef CONFIG_THERMAL_FILTER_MEDIAN
+#define CONFIG_THERMAL_FILTER_EMA_SHIFT 0
+#define CONFIG_THERMAL_PREDICT_SEC 0
+
+/* Thermal control passes kept for EC_CMD_THERMAL_TRACE. 0 disables. */
+#define CONFIG_THERMAL_TRACE_SIZE 0
+
 /*
  * Throttle the CPU when battery discharge current is too high. When
  * this feature is enabled, BAT_MAX_DISCHG_CURRENT must be defined in board.h.
@@ -3920,6 +4079,27 @@
 #define CONFIG_USB_PRL_SM
 #define CONFIG_USB_PE_SM
 
+/*
+ * Count the transitions of the TCPMv2 state machines and time how long they
+ * stay in each state, for the "pd <port> state" console command.
+ */
+#undef CONFIG_USB_SM_STATS
+
+/*
+ * Let the TCPMv2 PD task sleep until the earliest deadline its state machines
+ * report, or an event, rather than waking every 5 ms to poll them. Only for
+ * TCPCs which raise an alert for every CC and VBUS change.
+ */
+#undef CONFIG_USB_PD_TICKLESS
+
+/*
+ * Record per-port, per-message-type latency histograms of the TCPMv2 receive
+ * and transmit paths, read with EC_CMD_PD_TIMING and "ectool pdtiming".
+ * CONFIG_USB_PD_TIMING_ENTRIES is the number of histograms kept.
+ */
+#undef CONFIG_USB_PD_TIMING
+#define CONFIG_USB_PD_TIMING_ENTRIES 32
+
 /* Enables PD Console commands */
 #define CONFIG_USB_PD_CONSOLE_CMD
 
@@ -4690,6 +4870,14 @@
 /* Support computing hash of code for verified boot */
 #undef CONFIG_VBOOT_HASH
 
+/*
+ * Bytes of flash the vboot hash reads and hashes at a time. With
+ * CONFIG_FLASH_READ_ASYNC, each deferred call hashes two chunks, reading the
+ * second while hashing the first, and holds twice that in shared memory for
+ * the length of the call.
+ */
+#define CONFIG_VBOOT_HASH_CHUNK_SIZE 1024
+
 /* Support for secure temporary storage for verified boot */
 #undef CONFIG_VSTORE
 
@@ -117,7 +117,15 @@ extern "C" {
 #define EC_MEMMAP_SWITCHES_VERSION 0x25 /* Version of data in 0x30 - 0x33 */
 #define EC_MEMMAP_EVENTS_VERSION   0x26 /* Version of data in 0x34 - 0x3f */
 #define EC_MEMMAP_HOST_CMD_FLAGS   0x27 /* Host cmd interface flags (8 bits) */
-/* Unused 0x28 - 0x2f */
+/*
+ * Generation bytes, present if EC_MEMMAP_ID_VERSION >= 2. Each is odd while
+ * the EC updates its data, and steps by two each time new data is published.
+ * A multi-byte read of the data is consistent if the generation was even
+ * before it and is unchanged after it; otherwise read again.
+ */
+#define EC_MEMMAP_THERMAL_GEN      0x28 /* Generation of temps in 0x00 - 0x1f */
+#define EC_MEMMAP_BATTERY_GEN      0x29 /* Generation of data in 0x40 - 0x7f */
+/* Unused 0x2a - 0x2f */
 #define EC_MEMMAP_SWITCHES         0x30	/* 8 bits */
 /* Unused 0x31 - 0x33 */
 #define EC_MEMMAP_HOST_EVENTS      0x34 /* 64 bits */
@@ -2382,6 +2390,13 @@ struct ec_response_vboot_hash {
 	uint8_t hash_digest[64]; /* Hash digest data */
 } __ec_align4;
 
+/* Version 1 adds how long the hash took */
+struct ec_response_vboot_hash_v1 {
+	struct ec_response_vboot_hash v0;
+	uint32_t hash_time_us;   /* Start to done, 0 unless status is DONE */
+	uint32_t chunk_size;     /* Bytes of flash read at a time */
+} __ec_align4;
+
 enum ec_vboot_hash_cmd {
 	EC_VBOOT_HASH_GET = 0,       /* Get current hash status */
 	EC_VBOOT_HASH_ABORT = 1,     /* Abort calculating current hash */
@@ -2686,6 +2701,19 @@ struct ec_motion_sense_activity {
 	uint16_t parameters[3]; /* activity dependent parameters */
 } __ec_todo_unpacked;
 
+/*
+ * Parameters of MOTIONSENSE_ACTIVITY_BODY_DETECTION, to tune its confidence
+ * curve; when they are all 0, the curve is left as it is.
+ */
+enum motionsense_body_detection_param {
+	/* Variance of 50% confidence, in (mm/s^2)^2 */
+	MOTIONSENSE_BODY_DETECTION_VAR_THRESHOLD = 0,
+	/* Variance from 0% to 50%, and 50% to 100% confidence */
+	MOTIONSENSE_BODY_DETECTION_CONFIDENCE_DELTA = 1,
+	/* On-body confidence in the low byte, off-body in the high byte, % */
+	MOTIONSENSE_BODY_DETECTION_CONFIDENCE = 2,
+};
+
 /* Module flag masks used for the dump sub-command. */
 #define MOTIONSENSE_MODULE_FLAG_ACTIVE BIT(0)
 
@@ -3381,6 +3409,132 @@ struct ec_params_auto_fan_ctrl_v1 {
 	uint8_t fan_idx;
 } __ec_align1;
 
+/*
+ * Read the thermal control trace: one entry per thermal control pass (once
+ * a second), newest first.
+ */
+#define EC_CMD_THERMAL_TRACE 0x0056
+
+#define EC_THERMAL_TRACE_MAX_TEMPS 8
+
+struct ec_params_thermal_trace {
+	uint8_t offset;		/* Entries to skip, from the newest */
+	uint8_t count;		/* Max entries to return */
+} __ec_align1;
+
+struct ec_thermal_trace_entry {
+	uint32_t time_ms;	/* Time of the pass, ms since boot */
+	uint16_t target_rpm;	/* Fan 0 target */
+	uint16_t actual_rpm;	/* Fan 0 measured */
+	uint8_t fan_pct;	/* Fan demand (percent) */
+	uint8_t ctrl_temp;	/* Predicted temp the demand is based on */
+	/* Sensor temps, EC_TEMP_SENSOR_OFFSET based like the memmap */
+	uint8_t temp[EC_THERMAL_TRACE_MAX_TEMPS];
+	uint8_t reserved[2];
+} __ec_align4;
+
+struct ec_response_thermal_trace {
+	uint8_t count;		/* Entries returned */
+	uint8_t num_temps;	/* Valid entries in temp[] */
+	uint8_t reserved[2];
+	struct ec_thermal_trace_entry entry[0];
+} __ec_align4;
+
+/*****************************************************************************/
+
+/*
+ * Statistical profiler: the PC and task interrupted by a periodic timer are
+ * counted in a histogram. Stop the profiler before reading it for a
+ * consistent snapshot.
+ */
+#define EC_CMD_PROFILER 0x0057
+
+enum ec_profiler_cmd {
+	EC_PROFILER_START = 0,	/* Start sampling every period_us */
+	EC_PROFILER_STOP,
+	EC_PROFILER_CLEAR,	/* Clear the histogram */
+	EC_PROFILER_READ,	/* Read histogram entries from offset */
+};
+
+struct ec_params_profiler {
+	uint8_t cmd;		/* enum ec_profiler_cmd */
+	uint8_t reserved;
+	uint16_t offset;	/* READ: first entry to return */
+	uint32_t period_us;	/* START: sampling period */
+} __ec_align4;
+
+/* Task of samples taken in interrupt context */
+#define EC_PROFILER_TASK_IRQ 0xff
+
+struct ec_profiler_entry {
+	uint32_t pc;
+	uint32_t count;
+	uint8_t task;
+	uint8_t reserved[3];
+} __ec_align4;
+
+/* Profiler is sampling */
+#define EC_PROFILER_FLAG_RUNNING	BIT(0)
+/* PCs are offsets from the image load address (emulator) */
+#define EC_PROFILER_FLAG_RELATIVE_PC	BIT(1)
+
+struct ec_response_profiler {
+	uint32_t samples;	/* Samples taken */
+	uint32_t dropped;	/* Samples lost, histogram was full */
+	uint32_t period_us;
+	uint16_t entries;	/* Entries in the histogram */
+	uint8_t flags;		/* EC_PROFILER_FLAG_* */
+	uint8_t count;		/* READ: entries returned */
+	struct ec_profiler_entry entry[0];
+} __ec_align4;
+
+/*****************************************************************************/
+
+/*
+ * Task and interrupt trace: a ring buffer of task switches and IRQ entries
+ * and exits. Stop tracing before reading it for a consistent snapshot.
+ */
+#define EC_CMD_TASK_TRACE 0x0058
+
+enum ec_task_trace_cmd {
+	EC_TASK_TRACE_READ = 0,	/* Read records from offset */
+	EC_TASK_TRACE_CLEAR,
+	EC_TASK_TRACE_START,
+	EC_TASK_TRACE_STOP,
+};
+
+struct ec_params_task_trace {
+	uint8_t cmd;		/* enum ec_task_trace_cmd */
+	uint8_t reserved;
+	uint16_t offset;	/* READ: first record, 0 is the oldest kept */
+} __ec_align4;
+
+enum ec_task_trace_event {
+	EC_TASK_TRACE_SWITCH = 0,	/* id is the task switched to */
+	EC_TASK_TRACE_IRQ_ENTER,	/* id is the IRQ number */
+	EC_TASK_TRACE_IRQ_EXIT,
+};
+
+struct ec_task_trace_entry {
+	uint32_t time_us;	/* Low 32 bits of the EC clock */
+	uint8_t event;		/* enum ec_task_trace_event */
+	uint8_t reserved;
+	uint16_t id;
+} __ec_align4;
+
+/* Trace is recording */
+#define EC_TASK_TRACE_FLAG_RUNNING BIT(0)
+
+struct ec_response_task_trace {
+	uint32_t total;		/* Records since cleared, including lost ones */
+	uint16_t size;		/* Capacity of the ring buffer */
+	uint16_t kept;		/* Records in the ring buffer */
+	uint8_t flags;		/* EC_TASK_TRACE_FLAG_* */
+	uint8_t reserved;
+	uint16_t count;		/* READ: records returned */
+	struct ec_task_trace_entry entry[0];
+} __ec_align4;
+
 /* Get/Set TMP006 calibration data */
 #define EC_CMD_TMP006_GET_CALIBRATION 0x0053
 #define EC_CMD_TMP006_SET_CALIBRATION 0x0054
@@ -6519,6 +6673,132 @@ struct ec_response_typec_status {
 	/* TODO(b/167700356): Add revisions and source cap PDOs */
 } __ec_align1;
 
+/*
+ * USB-PD message latencies: log2 histograms of the time between the TCPC
+ * alert, the Protocol Layer reading a message, the Policy Engine acting on
+ * it, the next message transmitted and that message's GoodCRC.
+ */
+#define EC_CMD_PD_TIMING 0x0134
+
+enum ec_pd_timing_cmd {
+	EC_PD_TIMING_READ = 0,	/* Read histograms from offset */
+	EC_PD_TIMING_CLEAR,
+};
+
+struct ec_params_pd_timing {
+	uint8_t cmd;		/* enum ec_pd_timing_cmd */
+	uint8_t reserved;
+	uint16_t offset;	/* READ: first histogram to return */
+} __ec_align4;
+
+enum ec_pd_timing_stage {
+	/* TCPC alert to the received message being read */
+	EC_PD_TIMING_ALERT_TO_RX = 0,
+	/* Received message read to the Policy Engine acting on it */
+	EC_PD_TIMING_RX_TO_PE,
+	/* Received message read to the next message transmitted */
+	EC_PD_TIMING_RX_TO_TX,
+	/* Message transmitted to its GoodCRC; msg is the transmitted one */
+	EC_PD_TIMING_TX_TO_GOODCRC,
+	EC_PD_TIMING_STAGE_COUNT,
+};
+
+/* msg is the message type, with these flags for data and extended ones */
+#define EC_PD_TIMING_MSG_DATA	BIT(5)
+#define EC_PD_TIMING_MSG_EXT	BIT(6)
+#define EC_PD_TIMING_MSG_TYPE	GENMASK(4, 0)
+
+/*
+ * Bucket 0 counts latencies under 2^EC_PD_TIMING_BUCKET_SHIFT us, bucket n
+ * those from 2^(EC_PD_TIMING_BUCKET_SHIFT + n - 1) us and the last bucket
+ * everything longer.
+ */
+#define EC_PD_TIMING_BUCKETS		12
+#define EC_PD_TIMING_BUCKET_SHIFT	7
+
+struct ec_pd_timing_entry {
+	uint8_t port;
+	uint8_t stage;		/* enum ec_pd_timing_stage */
+	uint8_t msg;		/* Message type and EC_PD_TIMING_MSG_* */
+	uint8_t reserved;
+	uint32_t max_us;
+	uint16_t count[EC_PD_TIMING_BUCKETS];
+} __ec_align4;
+
+struct ec_response_pd_timing {
+	uint32_t dropped;	/* Latencies lost, all histograms were used */
+	uint32_t tx_failed;	/* Transmissions without a GoodCRC */
+	uint16_t entries;	/* Histograms in use */
+	uint8_t count;		/* READ: histograms returned */
+	uint8_t reserved;
+	struct ec_pd_timing_entry entry[0];
+} __ec_align4;
+
+/*
+ * ACPI EC port statistics: transactions and their latencies, from the
+ * command byte to the result or the data byte written, burst-mode read cache
+ * use and the reads and writes of each ACPI address.
+ */
+#define EC_CMD_ACPI_STATS 0x0135
+
+enum ec_acpi_stats_cmd {
+	EC_ACPI_STATS_READ = 0,	/* Read addresses from addr on */
+	EC_ACPI_STATS_CLEAR,
+};
+
+struct ec_params_acpi_stats {
+	uint8_t cmd;		/* enum ec_acpi_stats_cmd */
+	uint8_t reserved;
+	uint16_t addr;		/* READ: first ACPI address to return */
+} __ec_align4;
+
+struct ec_acpi_stats_entry {
+	uint8_t addr;
+	uint8_t reserved;
+	uint16_t reads;		/* Saturate at 0xffff */
+	uint16_t writes;
+} __ec_align2;
+
+struct ec_response_acpi_stats {
+	uint32_t reads;		/* Read transactions */
+	uint32_t writes;	/* Write transactions */
+	uint32_t read_total_us;
+	uint32_t write_total_us;
+	uint32_t read_max_us;
+	uint32_t write_max_us;
+	uint32_t handler_max_us; /* Longest time handling one byte */
+	uint32_t bursts;	/* Burst mode enables */
+	uint32_t cache_hits;	/* Burst reads from the read cache */
+	uint32_t cache_fills;	/* Burst reads copying memmap to the cache */
+	uint32_t cache_bytes;	/* Bytes copied by those */
+	uint16_t next;		/* READ: address to continue from, or 0x100 */
+	uint8_t count;		/* READ: entries returned */
+	uint8_t reserved;
+	struct ec_acpi_stats_entry entry[0];
+} __ec_align4;
+
+/*
+ * Peak stack usage of each task, as seen so far by the background stack
+ * high-water tracker.
+ */
+#define EC_CMD_STACK_INFO 0x0136
+
+struct ec_params_stack_info {
+	uint8_t first;		/* First task to return */
+} __ec_align1;
+
+struct ec_stack_info_entry {
+	uint32_t size;		/* Stack size in bytes */
+	uint32_t peak;		/* Most bytes ever used */
+} __ec_align4;
+
+struct ec_response_stack_info {
+	uint8_t tasks;		/* Number of tasks, including idle */
+	uint8_t count;		/* Entries returned, for tasks from first on */
+	uint16_t reserved;
+	struct ec_stack_info_entry entry[0];
+} __ec_align4;
+
 /*****************************************************************************/
 /* The command range 0x200-0x2FF is reserved for Rotor. */
 
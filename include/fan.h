@@ -67,6 +67,40 @@ void fan_set_percent_needed(int fan, int pct);
  */
 int fan_percent_to_rpm(int fan, int pct);
 
+/* Gains of fan_pid_update() are in duty percent per FAN_PID_SCALE rpm */
+#define FAN_PID_SCALE 1000
+
+struct fan_pid_params {
+	int kp;
+	int ki;		/* Per control step */
+	int kd;		/* Per control step, on the measured rpm */
+	int i_max;	/* Bound of the integral (rpm * steps) */
+};
+
+struct fan_pid_state {
+	int integral;
+	int prev_rpm;
+	int prev_target;
+};
+
+/**
+ * Run one step of closed-loop RPM control.
+ *
+ * The integral only accumulates while the target holds still, so the fan
+ * can ramp to a new target on its own, and stops accumulating while the
+ * output is saturated (anti-windup).
+ *
+ * @param p		PID gains
+ * @param s		Controller state, zero initialized
+ * @param ff_duty	Feed-forward duty for target_rpm (percent), e.g.
+ *			from a model of the fan
+ * @param target_rpm	Target speed; 0 resets the controller
+ * @param actual_rpm	Measured speed
+ * @return		Duty to apply (percent, in [0,100])
+ */
+int fan_pid_update(const struct fan_pid_params *p, struct fan_pid_state *s,
+		   int ff_duty, int target_rpm, int actual_rpm);
+
 
 /**
  * These functions require chip-specific implementations.
@@ -132,6 +132,29 @@ enum flash_region {
  */
 int flash_physical_read(int offset, int size, char *data);
 
+#ifdef CONFIG_FLASH_READ_ASYNC
+/**
+ * Start reading from physical flash, in the background.
+ *
+ * Nothing else may use the flash until flash_physical_read_wait(), which
+ * must be called by the same task.
+ *
+ * @param offset	Flash offset to read.
+ * @param size		Number of bytes to read.
+ * @param data		Destination buffer for data.  Must be 32-bit
+ *			aligned.
+ * @return EC_SUCCESS, or non-zero if the read couldn't be started.
+ */
+int flash_physical_read_async(int offset, int size, char *data);
+
+/**
+ * Wait for the read started by flash_physical_read_async() to be done.
+ *
+ * @return EC_SUCCESS, or non-zero if the read failed.
+ */
+int flash_physical_read_wait(void);
+#endif
+
 /**
  * Write to physical flash.
  *
@@ -34,6 +34,19 @@ void kasa_reset(struct kasa_fit *kasa);
  */
 void kasa_accumulate(struct kasa_fit *kasa, fp_t x, fp_t y, fp_t z);
 
+/**
+ * Add n samples to the kasa_fit structure, the same as n calls of
+ * kasa_accumulate() would.
+ *
+ * @param kasa Pointer to the struct to add the samples to.
+ * @param x The X components of the samples.
+ * @param y The Y components of the samples.
+ * @param z The Z components of the samples.
+ * @param n The number of samples.
+ */
+void kasa_accumulate_batch(struct kasa_fit *kasa, const fp_t *x,
+			   const fp_t *y, const fp_t *z, int n);
+
 /**
  * Compute the current center/radius from the kasa_fit structure.
  *
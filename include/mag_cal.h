@@ -38,4 +38,18 @@ void init_mag_cal(struct mag_cal_t *moc);
  * @return    1 if a new calibration value is available, 0 otherwise.
  */
 int mag_cal_update(struct mag_cal_t *moc, const intv3_t v);
+
+/**
+ * Update the magnetometer calibration structure with n samples, the same as n
+ * calls of mag_cal_update() would.
+ *
+ * @param moc Pointer to the magnetometer struct to update.
+ * @param x   The X components of the new data.
+ * @param y   The Y components of the new data.
+ * @param z   The Z components of the new data.
+ * @param n   The number of samples.
+ * @return    1 if a new calibration value is available, 0 otherwise.
+ */
+int mag_cal_update_batch(struct mag_cal_t *moc, const int *x, const int *y,
+			 const int *z, int n);
 #endif  /* __CROS_EC_MAG_CAL_H */
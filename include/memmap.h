@@ -0,0 +1,104 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Publishing data in the host memory map */
+
+#ifndef __CROS_EC_MEMMAP_H
+#define __CROS_EC_MEMMAP_H
+
+#include "common.h"
+#include "ec_commands.h"
+
+/* Blocks of the memory map with a generation byte */
+enum memmap_block {
+	MEMMAP_BLOCK_THERMAL,	/* EC_MEMMAP_THERMAL_GEN */
+	MEMMAP_BLOCK_BATTERY,	/* EC_MEMMAP_BATTERY_GEN */
+	MEMMAP_BLOCK_COUNT,
+};
+
+/* The battery block, EC_MEMMAP_BATT_VOLT to the end of EC_MEMMAP_BATT_TYPE */
+struct memmap_battery {
+	int volt;
+	int rate;
+	int cap;
+	uint8_t flag;
+	uint8_t count;
+	uint8_t index;
+	uint8_t reserved;
+	int dcap;
+	int dvlt;
+	int lfcc;
+	int ccnt;
+	char mfgr[EC_MEMMAP_TEXT_MAX];
+	char model[EC_MEMMAP_TEXT_MAX];
+	char serial[EC_MEMMAP_TEXT_MAX];
+	char type[EC_MEMMAP_TEXT_MAX];
+} __packed;
+
+/**
+ * Start updating a block. Its generation is odd until memmap_write_end(),
+ * and interrupts are disabled if called from a task, so only copy data
+ * staged beforehand. memmap_write_end() leaves them disabled if they
+ * already were.
+ *
+ * @param block Block to update
+ */
+void memmap_write_begin(enum memmap_block block);
+
+/**
+ * Finish updating a block, making its generation even again
+ *
+ * @param block Block updated
+ */
+void memmap_write_end(enum memmap_block block);
+
+/**
+ * Copy staged data into a block, as one update
+ *
+ * @param block Block the data is in
+ * @param offset Memory map offset (EC_MEMMAP_*) to copy to
+ * @param data Staged data
+ * @param size Size of the data
+ */
+void memmap_publish(enum memmap_block block, int offset, const void *data,
+		    int size);
+
+/**
+ * Copy the staged battery block into the memory map, as one update. The
+ * battery count and index are left alone, and so are the flags which changed
+ * in the memory map since the block was staged, e.g. AC present set by
+ * extpower meanwhile.
+ *
+ * @param batt Staged battery block
+ * @param staged_flag Flags as they were staged, by memmap_stage_battery()
+ */
+void memmap_publish_battery(const struct memmap_battery *batt,
+			    uint8_t staged_flag);
+
+/**
+ * Copy the battery block out of the memory map, to stage an update of it.
+ * Only use from the task which publishes the battery block.
+ *
+ * @param batt Where to copy the block
+ */
+void memmap_stage_battery(struct memmap_battery *batt);
+
+/**
+ * Read from the memory map, retrying if a block is updated meanwhile
+ *
+ * @param offset Memory map offset (EC_MEMMAP_*) to read from
+ * @param data Where to copy the data
+ * @param size Size of the data
+ * @return Number of times the read was retried
+ */
+int memmap_read(int offset, void *data, int size);
+
+/**
+ * @param block Block of the memory map
+ * @return Its generation; odd while it is being updated
+ */
+uint8_t memmap_generation(enum memmap_block block);
+
+#endif /* __CROS_EC_MEMMAP_H */
@@ -0,0 +1,42 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+ /* Mock for the PECI bus, provided by chip/host/peci.c */
+
+#ifndef __MOCK_PECI_MOCK_H
+#define __MOCK_PECI_MOCK_H
+
+#include "peci.h"
+
+#define MOCK_PECI_PKG_CONFIG_COUNT 0x40
+#define MOCK_PECI_LOG_SIZE 16
+
+/* Controller for PECI bus state */
+struct mock_peci_ctrl {
+	/* CPU temperature returned by GetTemp, in degrees C */
+	int cpu_temp_c;
+	/* Time each transaction takes on the bus (us) */
+	int latency_us;
+	/* Number of transactions to fail before succeeding again */
+	int fail_count;
+
+	/* Transactions seen, failed ones included, per command code */
+	int transactions[256];
+	/* Transactions in progress; must never exceed 1 */
+	int busy;
+	int max_busy;
+
+	/* Package config space, by index */
+	uint32_t pkg_config[MOCK_PECI_PKG_CONFIG_COUNT];
+	/* Indexes of successful WrPkgConfig, in order */
+	uint8_t wr_log[MOCK_PECI_LOG_SIZE];
+	int wr_log_count;
+};
+
+/* Reset this PECI mock */
+void mock_peci_reset(void);
+
+extern struct mock_peci_ctrl mock_peci;
+
+#endif /* __MOCK_PECI_MOCK_H */
@@ -26,6 +26,8 @@ struct mock_tcpc_ctrl {
 		enum tcpc_cc_pull cc;
 		enum tcpc_rp_value rp;
 		enum tcpc_cc_polarity polarity;
+		uint16_t tx_header;
+		const uint32_t *tx_data;
 	} last;
 
 };
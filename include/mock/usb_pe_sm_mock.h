@@ -20,6 +20,7 @@ struct mock_pe_port_t {
 	int mock_pe_message_received;
 	int mock_got_soft_reset;
 	int mock_pe_message_discarded;
+	bool mock_in_local_ams;
 };
 
 extern struct mock_pe_port_t mock_pe_port[CONFIG_USB_PD_PORT_MAX_COUNT];
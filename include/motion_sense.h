@@ -157,6 +157,19 @@ struct online_calib_data {
 	uint32_t last_temperature_timestamp;
 };
 
+/* Counters of the hardware FIFO drains of a sensor */
+struct motion_sense_fifo_drain_stats {
+	uint32_t drains;	/* Calls of motion_sense_fifo_drain() */
+	uint32_t bursts;	/* Bus reads of FIFO data */
+	uint32_t bytes;		/* Bytes read */
+	uint32_t frames;	/* Frames decoded */
+	uint32_t read_us_total;	/* Time in the bus reads */
+	uint32_t read_us_max;	/* Most time in the bus reads of one drain */
+	/* Time decoding and staging the frames */
+	uint32_t decode_us_total;
+	uint32_t decode_us_max;
+};
+
 struct motion_sensor_t {
 	/* RO fields */
 	uint32_t active_mask;
@@ -251,6 +264,10 @@ struct motion_sensor_t {
 
 	/* Maximum supported sampling frequency in miliHertz for this sensor */
 	uint32_t max_frequency;
+
+	/* Hardware FIFO drains, for sensors which own one */
+	struct motion_sense_fifo_drain_stats
+		drain_stats[__cfg_select(CONFIG_ACCEL_FIFO_DRAIN_STATS, 1, 0)];
 };
 
 /*
@@ -102,6 +102,65 @@ int motion_sense_fifo_over_thres(void);
 int motion_sense_fifo_read(int capacity_bytes, int max_count, void *out,
 			   uint16_t *out_size);
 
+/**
+ * Take the last samples of the body detection sensor staged since the last
+ * call, oldest first, in structure-of-arrays layout.
+ *
+ * @param x The X components of the samples.
+ * @param y The Y components of the samples.
+ * @param max The most samples to take; older ones are dropped.
+ * @return The number of samples taken.
+ */
+int motion_sense_fifo_get_body_samples(int *x, int *y, int max);
+
+/**
+ * Layout of a hardware FIFO, for motion_sense_fifo_drain().
+ */
+struct motion_sense_fifo_layout {
+	/* Get the number of bytes in the FIFO */
+	int (*get_length)(struct motion_sensor_t *s, int *length);
+	/* Read bytes of FIFO data */
+	int (*read)(struct motion_sensor_t *s, uint8_t *data, int length);
+	/*
+	 * Optional: check the start of the first read of a drain, return
+	 * non-zero to drop the drain (e.g. the FIFO is invalid right now).
+	 */
+	int (*check)(struct motion_sensor_t *s, const uint8_t *data,
+		     int length);
+	/*
+	 * Decode the frame at the start of data and stage its samples with
+	 * motion_sense_fifo_stage_data(). Return the bytes it took, 0 if the
+	 * frame doesn't fit in length, -1 if the FIFO holds nothing more (an
+	 * empty frame), or a negated error code for an invalid frame, which
+	 * ends the drain with that error.
+	 */
+	int (*decode)(struct motion_sensor_t *s, uint8_t *data, int length,
+		      uint32_t last_ts);
+	/* Largest read the bus allows, 0 for no limit */
+	uint16_t max_burst;
+	/* Bytes to read beyond the FIFO length, e.g. to get an empty frame */
+	uint8_t extra;
+	/*
+	 * Non-zero if the FIFO sends a frame cut short by the end of a read
+	 * again on the next read; else the rest of it follows.
+	 */
+	uint8_t resends_partial;
+};
+
+/**
+ * Read a hardware FIFO in bursts as large as the layout and
+ * CONFIG_ACCEL_FIFO_DRAIN_SIZE allow, decoding the frames of each burst in
+ * one pass. The caller commits the data staged.
+ *
+ * @param s The sensor which owns the FIFO.
+ * @param layout Its FIFO layout.
+ * @param last_ts The time of the FIFO interrupt.
+ * @return EC_SUCCESS, or the error of a bus transfer or of an invalid frame.
+ */
+int motion_sense_fifo_drain(struct motion_sensor_t *s,
+			    const struct motion_sense_fifo_layout *layout,
+			    uint32_t last_ts);
+
 /**
  * Reset the internal data structures of the motion sense fifo.
  */
@@ -27,6 +27,26 @@ int online_calibration_process_data(
 	struct motion_sensor_t *sensor,
 	uint32_t timestamp);
 
+/**
+ * Process n data measurements from a given sensor, in structure-of-arrays
+ * layout. This is the same as n calls of online_calibration_process_data(),
+ * but for the temperature which is read once for the batch.
+ *
+ * @param sensor Pointer to the sensor that generated the data.
+ * @param x The X components of the data.
+ * @param y The Y components of the data.
+ * @param z The Z components of the data.
+ * @param timestamps The time associated with each sample.
+ * @param n The number of samples.
+ * @return EC_SUCCESS when successful.
+ */
+int online_calibration_process_batch(struct motion_sensor_t *sensor,
+				     const int *x, const int *y, const int *z,
+				     const uint32_t *timestamps, int n);
+
+/* Most samples the FIFO passes to online_calibration_process_batch() */
+#define ONLINE_CALIB_BATCH_SIZE 16
+
 /**
  * Check if new calibration values are available since the last read.
  *
@@ -77,7 +77,9 @@ struct panic_data {
 	uint8_t arch;             /* Architecture (PANIC_ARCH_*) */
 	uint8_t struct_version;   /* Structure version (currently 2) */
 	uint8_t flags;            /* Flags (PANIC_DATA_FLAG_*) */
-	uint8_t reserved;         /* Reserved; set 0 */
+	uint8_t stack_task;       /* Task which overflowed its stack, if
+				   * PANIC_DATA_FLAG_STACK_TASK; else 0
+				   */
 
 	/* core specific panic data */
 	union {
@@ -115,6 +117,8 @@ enum panic_arch {
 #define PANIC_DATA_FLAG_OLD_HOSTCMD    BIT(2)
 /* Already reported via host event */
 #define PANIC_DATA_FLAG_OLD_HOSTEVENT  BIT(3)
+/* panic_data.stack_task is valid */
+#define PANIC_DATA_FLAG_STACK_TASK     BIT(4)
 
 /**
  * Write a string to the panic reporting device
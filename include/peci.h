@@ -68,4 +68,80 @@ int peci_transaction(struct peci_data *peci);
  */
 __override_proto int stop_read_peci_temp(void);
 
+/**
+ * Completion callback of a queued PECI transaction. Called from the PECI
+ * task, so it must not wait on other PECI transactions.
+ *
+ * @param rv		Result of the transaction.
+ * @param r_buf		Read data (r_len bytes), only valid during the call.
+ * @param priv		Private data passed to peci_queue_submit().
+ */
+typedef void (*peci_done_cb)(int rv, const uint8_t *r_buf, void *priv);
+
+/**
+ * Queue a PECI transaction and return without waiting for it.
+ *
+ * The write data is copied, so peci->w_buf and peci->r_buf need not outlive
+ * the call. Without CONFIG_PECI_QUEUE the transaction runs right away.
+ *
+ * @param peci		Transaction data.
+ * @param retries	Number of times to retry on failure.
+ * @param done		Completion callback, or NULL.
+ * @param priv		Private data for the callback.
+ *
+ * @return EC_SUCCESS if queued, EC_ERROR_BUSY if the queue is full.
+ */
+int peci_queue_submit(const struct peci_data *peci, int retries,
+		      peci_done_cb done, void *priv);
+
+/**
+ * Run a PECI transaction through the queue and wait for it to complete.
+ *
+ * @param peci		Transaction data. peci->r_buf receives the read data.
+ * @param retries	Number of times to retry on failure.
+ *
+ * @return zero if successful, non-zero if error
+ */
+int peci_queue_transaction(struct peci_data *peci, int retries);
+
+/* Command classes PECI statistics are kept for */
+enum peci_stat_class {
+	PECI_STAT_GET_TEMP = 0,
+	PECI_STAT_RD_PKG_CFG,
+	PECI_STAT_WR_PKG_CFG,
+	PECI_STAT_OTHER,
+	PECI_STAT_COUNT
+};
+
+struct peci_cmd_stats {
+	uint32_t count;		/* Transactions, retries not included */
+	uint32_t errors;	/* Transactions which failed all retries */
+	uint32_t retries;
+	uint32_t cache_hits;	/* Reads answered from the cache */
+	uint32_t total_us;	/* Sum of latencies, retries included */
+	uint32_t max_us;
+};
+
+struct peci_stats {
+	struct peci_cmd_stats cmd[PECI_STAT_COUNT];
+	uint32_t queue_full;	/* Requests rejected on a full queue */
+	uint32_t max_depth;	/* Most requests ever queued at once */
+	uint32_t max_wait_us;	/* Longest time a request waited to start */
+};
+
+/**
+ * Get a snapshot of the PECI statistics.
+ */
+void peci_get_stats(struct peci_stats *out);
+
+/**
+ * Clear the PECI statistics.
+ */
+void peci_clear_stats(void);
+
+/**
+ * PECI task. Services the PECI queue.
+ */
+void peci_task(void *u);
+
 #endif  /* __CROS_EC_PECI_H */
@@ -0,0 +1,51 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Statistical PC-sampling profiler */
+
+#ifndef __CROS_EC_PROFILER_H
+#define __CROS_EC_PROFILER_H
+
+#include "common.h"
+
+/* Default and minimum sampling periods */
+#define PROFILER_DEFAULT_PERIOD_US 1000
+#define PROFILER_MIN_PERIOD_US 100
+
+/**
+ * Start sampling, keeping the samples already in the histogram.
+ *
+ * @param period_us	Sampling period, at least PROFILER_MIN_PERIOD_US.
+ * @return		EC_SUCCESS, or EC_ERROR_INVAL if the period is too short.
+ */
+int profiler_start(uint32_t period_us);
+
+/* Stop sampling */
+void profiler_stop(void);
+
+/* Clear the histogram. Sampling continues if it was running. */
+void profiler_clear(void);
+
+/**
+ * Count one sample. Called from the sampling timer interrupt (or signal
+ * handler on the emulator), so it must not block.
+ *
+ * @param pc		Interrupted program counter.
+ * @param task		Interrupted task, or EC_PROFILER_TASK_IRQ if an
+ *			interrupt was interrupted.
+ */
+void profiler_sample(uintptr_t pc, int task);
+
+/*
+ * Core-specific sampling timer, which calls profiler_sample() every period_us
+ * microseconds until stopped.
+ */
+int profiler_timer_start(uint32_t period_us);
+void profiler_timer_stop(void);
+
+/* Base to add to the sampled PCs, which are relative on the emulator */
+uintptr_t profiler_pc_base(void);
+
+#endif  /* __CROS_EC_PROFILER_H */
@@ -63,6 +63,50 @@ int rsa_verify(const struct rsa_public_key *key,
 	       const uint8_t *sha,
 	       uint32_t *workbuf32);
 
+/*
+ * Limbs of the Montgomery arithmetic: 64-bit where the compiler has 128-bit
+ * products (the emulator on 64-bit hosts), 32-bit otherwise.
+ */
+#ifdef __SIZEOF_INT128__
+#define RSA_LIMB_BITS 64
+typedef uint64_t rsa_limb_t;
+#else
+#define RSA_LIMB_BITS 32
+typedef uint32_t rsa_limb_t;
+#endif
+
+#define RSANUMLIMBS (RSANUMBYTES / sizeof(rsa_limb_t))
+
+/*
+ * Key with its Montgomery constants laid out in limbs, in RAM, for verifying
+ * with one key many times, or from a key in slow flash.
+ */
+struct rsa_key_ctx {
+	rsa_limb_t n[RSANUMLIMBS];  /* modulus */
+	rsa_limb_t rr[RSANUMLIMBS]; /* R^2 mod n */
+	rsa_limb_t n0inv;           /* -1 / n[0] mod 2^RSA_LIMB_BITS */
+};
+
+/**
+ * Fill a key context from a public key.
+ *
+ * @param ctx		Context to fill
+ * @param key		RSA public key
+ * @return EC_SUCCESS, or EC_ERROR_INVAL if n0inv of the key doesn't match n.
+ */
+int rsa_key_ctx_init(struct rsa_key_ctx *ctx,
+		     const struct rsa_public_key *key);
+
+/**
+ * Same as rsa_verify(), with a key context from rsa_key_ctx_init().
+ *
+ * @return 0 on failure, 1 on success.
+ */
+int rsa_verify_ctx(const struct rsa_key_ctx *ctx,
+		   const uint8_t *signature,
+		   const uint8_t *sha,
+		   uint32_t *workbuf32);
+
 #endif /* !__ASSEMBLER__ */
 
 #endif /* __CROS_EC_RSA_H */
@@ -57,6 +57,50 @@ int shared_mem_acquire(int size, char **dest_ptr);
  */
 void shared_mem_release(void *ptr);
 
+#ifdef CONFIG_SHAREDMEM_SLAB
+
+/**
+ * Acquires a buffer from the smallest pool which fits the size and has one
+ * free, see CONFIG_SHAREDMEM_SLAB. Called by shared_mem_acquire() first.
+ *
+ * @param size		Number of bytes requested
+ * @param dest_ptr	If successful, set on return to the buffer.
+ *
+ * @return EC_SUCCESS if successful, EC_ERROR_BUSY if the pools which fit are
+ * all in use, EC_ERROR_OVERFLOW if none fits, or EC_ERROR_INVAL.
+ */
+int shared_mem_slab_acquire(int size, char **dest_ptr);
+
+/**
+ * Releases a buffer if it is from one of the pools. Unlike acquiring, this
+ * may be called from interrupt context.
+ *
+ * @return 1 if it is, so it isn't shared memory to release, else 0.
+ */
+int shared_mem_slab_release(void *ptr);
+
+struct shared_mem_slab_stats {
+	int size;		/* Buffer size */
+	int count;		/* Buffers */
+	int in_use;
+	int high_water;		/* Most in use at once */
+	int failures;		/* Requests this pool fit but couldn't serve */
+};
+
+/**
+ * Get the statistics of a pool.
+ *
+ * @param pool		Index in CONFIG_SHAREDMEM_SLAB_CLASSES
+ *
+ * @return EC_SUCCESS, or EC_ERROR_INVAL past the last pool.
+ */
+int shared_mem_slab_get_stats(int pool, struct shared_mem_slab_stats *stats);
+
+/* Print the pools' statistics, for the shmem console command */
+void shared_mem_slab_print(void);
+
+#endif /* CONFIG_SHAREDMEM_SLAB */
+
 /*
  * This structure is allocated at the base of the free memory chunk and every
  * allocated buffer.
@@ -67,7 +111,7 @@ struct shm_buffer {
 	size_t buffer_size;
 };
 
-#ifdef TEST_SHMALLOC
+#if defined(TEST_SHMALLOC) || defined(TEST_SHMALLOC_SLAB)
 
 /*
  * When in test mode, all possible paths in the allocation/free functions set
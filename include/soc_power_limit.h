@@ -0,0 +1,154 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Table-driven SoC power limit (PL1/PL2/PL4/PsysPL2) policy */
+
+#ifndef __CROS_EC_SOC_POWER_LIMIT_H
+#define __CROS_EC_SOC_POWER_LIMIT_H
+
+#include "common.h"
+#include "timer.h"
+
+/* SoC power limits, in the order they are written */
+enum soc_pl {
+	SOC_PL1 = 0,
+	SOC_PL2,
+	SOC_PL4,
+	SOC_PSYS_PL2,
+	SOC_PL_COUNT
+};
+
+/*
+ * What a limit curve is computed from. A curve may also be based on another
+ * limit (enum soc_pl), as long as that limit's curve isn't itself based on a
+ * limit.
+ */
+enum soc_pl_base {
+	SOC_PL_BASE_NONE = -2,		/* Constant (offset_w only) */
+	SOC_PL_BASE_ADAPTER = -1,	/* Adapter power */
+};
+
+/*
+ * One limit of a rule, in watts:
+ *
+ *   limit = base * pct / 100 + offset_w [- PPS power budget]
+ *
+ * clamped to [min_w, max_w] (max_w = 0 for no upper clamp).
+ */
+struct soc_pl_curve {
+	int8_t base;
+	uint8_t pct;
+	int16_t offset_w;
+	uint8_t minus_pps;
+	int16_t min_w;
+	int16_t max_w;
+};
+
+/*
+ * A rule applies when adapter power is in [adapter_min_w, adapter_max_w) and
+ * battery charge is in [battery_min_pct, battery_max_pct). A max of 0 means
+ * no upper bound. Rules are evaluated in order and the first match is used.
+ */
+struct soc_pl_rule {
+	int16_t adapter_min_w;
+	int16_t adapter_max_w;
+	int8_t battery_min_pct;
+	int8_t battery_max_pct;
+	struct soc_pl_curve limit[SOC_PL_COUNT];
+};
+
+struct soc_pl_policy {
+	const struct soc_pl_rule *rules;
+	int rule_count;
+	/*
+	 * A new rule is only selected once it would still be selected with
+	 * the inputs moved by this much in either direction.
+	 */
+	int adapter_hyst_w;
+	int battery_hyst_pct;
+	/* Max increase of a limit per write batch (W), 0 for no limit */
+	int max_rise_w;
+	/*
+	 * Minimum time between write batches (us). Decreases are never
+	 * delayed; increases wait for the interval to expire.
+	 */
+	int min_interval_us;
+};
+
+/* Board policy */
+extern const struct soc_pl_policy soc_pl_policy;
+
+/* Inputs to the policy */
+struct soc_pl_inputs {
+	int adapter_w;		/* Adapter power, 0 when not on AC */
+	int battery_pct;	/* Battery state of charge */
+	int pps_budget_w;	/* Power budgeted to PPS sinks */
+};
+
+/* Record of one write batch */
+struct soc_pl_history {
+	timestamp_t time;
+	int8_t rule;
+	uint8_t written;	/* Bitmask of written limits */
+	uint8_t failed;		/* Bitmask of limits which failed to write */
+	int16_t limit[SOC_PL_COUNT];
+};
+
+/**
+ * Evaluate the policy and write the limits which changed.
+ *
+ * @param in		Policy inputs. They are kept for later re-evaluation
+ *			(slew and rate limiting).
+ * @param force		Write all limits, even if unchanged, right away.
+ */
+void soc_pl_update(const struct soc_pl_inputs *in, int force);
+
+/**
+ * Take the limits out of policy control.
+ *
+ * @param limits	Limits to write (W), or NULL to return to policy
+ *			control.
+ */
+void soc_pl_set_manual(const int *limits);
+
+/**
+ * Get the limits last written to the SoC.
+ *
+ * @param limits	Filled with SOC_PL_COUNT limits (W), -1 if unknown.
+ * @return		Index of the rule in effect, -1 if none or manual.
+ */
+int soc_pl_get_applied(int *limits);
+
+/**
+ * Get a write batch record.
+ *
+ * @param age		0 for the most recent batch, 1 for the previous...
+ * @param entry		Filled with the record.
+ * @return		EC_SUCCESS, or EC_ERROR_UNKNOWN if there is no such
+ *			record.
+ */
+int soc_pl_get_history(int age, struct soc_pl_history *entry);
+
+/**
+ * Report that a write which board_soc_pl_write() accepted later failed. The
+ * limit is written again on the next update.
+ *
+ * @param pl		Limit which failed to write.
+ */
+void soc_pl_write_failed(enum soc_pl pl);
+
+/**
+ * Write a power limit to the SoC. Provided by the board.
+ *
+ * The write may complete asynchronously, in which case a late failure is
+ * reported with soc_pl_write_failed().
+ *
+ * @param pl		Limit to write.
+ * @param watts		Value (W).
+ * @return		EC_SUCCESS, or error.
+ */
+int board_soc_pl_write(enum soc_pl pl, int watts);
+
+#endif  /* __CROS_EC_SOC_POWER_LIMIT_H */
@@ -0,0 +1,44 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Task stack high-water tracker */
+
+#ifndef __CROS_EC_STACK_WATCH_H
+#define __CROS_EC_STACK_WATCH_H
+
+#include "common.h"
+#include "task_id.h"
+
+#ifdef CONFIG_STACK_WATCH
+
+/**
+ * Scan a few more words of the task stacks.
+ *
+ * Called by the idle task on each pass, it checks CONFIG_STACK_WATCH_WORDS
+ * words, so a full round over all the stacks is spread over many passes.
+ */
+void stack_watch_idle(void);
+
+/**
+ * Finish scanning all the stacks now.
+ *
+ * This takes as long as "taskinfo"; the idle task doesn't need it.
+ */
+void stack_watch_scan(void);
+
+/**
+ * Get the peak stack usage of a task seen so far.
+ *
+ * @param tskid		Task
+ * @param size		Set to the size of its stack in bytes
+ * @param peak		Set to the most bytes of it ever used
+ *
+ * @return EC_SUCCESS, or EC_ERROR_INVAL if the task doesn't exist.
+ */
+int stack_watch_get(task_id_t tskid, int *size, int *peak);
+
+#endif /* CONFIG_STACK_WATCH */
+
+#endif /* __CROS_EC_STACK_WATCH_H */
@@ -477,6 +477,7 @@ enum {
 	SLEEP_MASK_ADC        = BIT(13), /* ADC conversion ongoing */
 	SLEEP_MASK_EMMC       = BIT(14), /* eMMC emulation ongoing */
 	SLEEP_MASK_FORCE_NO_DSLEEP    = BIT(15), /* Force disable. */
+	SLEEP_MASK_PROFILER   = BIT(18), /* Profiler sampling timer on */
 
 
 	/*
@@ -79,6 +79,12 @@ void interrupt_disable(void);
  */
 void interrupt_enable(void);
 
+/**
+ * Return true if the CPU interrupt bit is enabled, i.e. interrupts aren't
+ * disabled with interrupt_disable().
+ */
+int is_interrupt_enabled(void);
+
 /**
  * Return true if we are in interrupt context.
  */
@@ -183,7 +189,32 @@ void task_print_list(void);
  */
 const char *task_get_name(task_id_t tskid);
 
-#ifdef CONFIG_TASK_PROFILING
+/* Value the cores fill unused stack words with */
+#define STACK_UNUSED_VALUE 0xdeadd00d
+
+#ifdef CONFIG_STACK_WATCH
+/**
+ * Get the stack of a task, for the stack high-water tracker.
+ *
+ * The words of it the task has never used still hold STACK_UNUSED_VALUE.
+ *
+ * @param tskid		Task
+ * @param size		Set to the size of the stack in bytes
+ *
+ * @return the lowest word of the stack, or NULL if the task has none yet.
+ */
+uint32_t *task_get_stack(task_id_t tskid, int *size);
+#endif
+
+/**
+ * Find a task whose stack has overflowed, that is whose lowest stack word no
+ * longer holds STACK_UNUSED_VALUE. May be called from a panic.
+ *
+ * @return the task id, or -1 if no stack has overflowed.
+ */
+int task_find_stack_overflow(void);
+
+#if defined(CONFIG_TASK_PROFILING) || defined(CONFIG_TASK_TRACE)
 /**
  * Start tracking an interrupt.
  *
@@ -325,9 +356,37 @@ int task_reset(task_id_t id, int wait);
  */
 void task_clear_pending_irq(int irq);
 
+#ifdef CONFIG_MUTEX_STATS
+/*
+ * Contention statistics of a mutex, printed by the "taskinfo" command.
+ * Mutexes are listed for printing the first time they are locked, and stay
+ * listed, so mutexes on a task stack or in freed memory are not supported.
+ */
+struct mutex_stats {
+	uint32_t listed;	/* Zero until first locked */
+	uint32_t locks;		/* Times locked */
+	uint32_t contended;	/* Times the locker had to wait */
+	uint32_t wait_us_total;
+	uint32_t wait_us_max;
+	uint32_t hold_us_total;
+	uint32_t hold_us_max;
+	uint32_t hold_start;	/* Time the owner locked it */
+};
+#endif
+
 struct mutex {
 	uint32_t lock;
 	uint32_t waiters;
+	/*
+	 * BIT(task id) of the task which holds the lock, 0 if unlocked. While
+	 * a task waits on the mutex, the scheduler runs the owner in its place
+	 * if the owner is runnable and nothing of higher priority is, so that
+	 * the owner inherits the priority of its highest waiter.
+	 */
+	uint32_t owner;
+#ifdef CONFIG_MUTEX_STATS
+	struct mutex_stats stats;
+#endif
 };
 
 /**
@@ -345,6 +404,32 @@ void mutex_lock(struct mutex *mtx);
  */
 void mutex_unlock(struct mutex *mtx);
 
+#ifdef CONFIG_MUTEX_STATS
+/**
+ * Account for a mutex the current task just locked.
+ *
+ * Called by the core's mutex_lock().
+ *
+ * @param mtx		Mutex which was locked
+ * @param wait_start	Time the task started waiting on it
+ * @param contended	Non-zero if the task had to wait for the owner
+ */
+void mutex_stats_locked(struct mutex *mtx, uint32_t wait_start,
+			int contended);
+
+/**
+ * Account for a mutex the current task is about to unlock.
+ *
+ * Called by the core's mutex_unlock().
+ */
+void mutex_stats_unlocked(struct mutex *mtx);
+
+/**
+ * Print the statistics of all the mutexes locked so far.
+ */
+void mutex_stats_print(void);
+#endif
+
 struct irq_priority {
 	uint8_t irq;
 	uint8_t priority;
@@ -0,0 +1,57 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Task switch and interrupt trace */
+
+#ifndef __CROS_EC_TASK_TRACE_H
+#define __CROS_EC_TASK_TRACE_H
+
+#include "common.h"
+#include "ec_commands.h"
+
+#ifdef CONFIG_TASK_TRACE
+
+/**
+ * Record an event, timestamped with the hardware clock.
+ *
+ * Called by the scheduler and the interrupt entry and exit paths, from any
+ * context, so it must stay short and lock-free.
+ *
+ * @param event		enum ec_task_trace_event
+ * @param id		Task switched to, or IRQ number.
+ */
+void task_trace_record(uint8_t event, uint16_t id);
+
+/* Start or stop recording. Recording starts at boot. */
+void task_trace_start(void);
+void task_trace_stop(void);
+
+/* Drop all records */
+void task_trace_clear(void);
+
+/**
+ * Copy records out of the ring buffer, oldest first.
+ *
+ * @param offset	First record to copy, 0 being the oldest one kept.
+ * @param out		Buffer for the records.
+ * @param max		Size of out, in records.
+ * @return		Number of records copied.
+ */
+int task_trace_read(int offset, struct ec_task_trace_entry *out, int max);
+
+/* Number of records in the ring buffer */
+int task_trace_kept(void);
+
+/* Number of records since the trace was cleared, including overwritten ones */
+uint32_t task_trace_total(void);
+
+/* Name of an event, as printed by the console command */
+const char *task_trace_event_name(uint8_t event);
+
+#else
+static inline void task_trace_record(uint8_t event, uint16_t id) { }
+#endif
+
+#endif  /* __CROS_EC_TASK_TRACE_H */
@@ -19,6 +19,16 @@ extern struct ec_thermal_config thermal_params[];
 /* Helper function to compute percent cooling */
 int thermal_fan_percent(int low, int high, int cur);
 
+/* Filtering of the temperatures fan demand is based on */
+struct thermal_filter_params {
+	uint8_t median;		/* Reject single-sample spikes */
+	uint8_t ema_shift;	/* A new sample weighs 1/2^ema_shift */
+	uint8_t predict_sec;	/* Look-ahead along a rising slope */
+};
+
+void thermal_get_filter_params(struct thermal_filter_params *p);
+void thermal_set_filter_params(const struct thermal_filter_params *p);
+
 /* Allow board custom fan control. Called after reading temperature sensors.
  *
  * @param fan Fan ID to control (0 to CONFIG_FANS)
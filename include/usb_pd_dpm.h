@@ -33,6 +33,13 @@ void dpm_set_mode_entry_done(int port);
  */
 void dpm_set_mode_exit_request(int port);
 
+/*
+ * Returns true when the DPM has no mode entry or exit left to attempt
+ *
+ * @param port USB-C port number
+ */
+bool dpm_is_idle(int port);
+
 /*
  * Informs the DPM that a VDM ACK was received.
  *
@@ -0,0 +1,78 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* USB-PD message latency probes, see CONFIG_USB_PD_TIMING */
+
+#ifndef __CROS_EC_USB_PD_TIMING_H
+#define __CROS_EC_USB_PD_TIMING_H
+
+#include "common.h"
+#include "ec_commands.h"
+
+#ifdef CONFIG_USB_PD_TIMING
+
+/**
+ * A TCPC alert was raised. Called from interrupt context; the latest alert
+ * before a message is read is the one it is timed from.
+ *
+ * @param port USB-C port number
+ */
+void pd_timing_alert(int port);
+
+/**
+ * The Protocol Layer read a message from the TCPC
+ *
+ * @param port USB-C port number
+ * @param header PD header of the message
+ */
+void pd_timing_rx(int port, uint16_t header);
+
+/**
+ * The Policy Engine is about to act on the last message received
+ *
+ * @param port USB-C port number
+ */
+void pd_timing_pe(int port);
+
+/**
+ * The Protocol Layer handed a message to the TCPC to transmit
+ *
+ * @param port USB-C port number
+ * @param header PD header of the message
+ */
+void pd_timing_tx(int port, uint16_t header);
+
+/**
+ * The TCPC finished transmitting. May be called from interrupt context.
+ *
+ * @param port USB-C port number
+ * @param status TCPC_TX_COMPLETE_*, success when a GoodCRC was received
+ */
+void pd_timing_tx_done(int port, int status);
+
+/* Clear all the histograms */
+void pd_timing_clear(void);
+
+/**
+ * Copy histograms in use
+ *
+ * @param offset First histogram to copy, counting only those in use
+ * @param out Where to copy them
+ * @param max Most histograms to copy
+ * @return Number of histograms copied
+ */
+int pd_timing_read(int offset, struct ec_pd_timing_entry *out, int max);
+
+#else
+
+static inline void pd_timing_alert(int port) {}
+static inline void pd_timing_rx(int port, uint16_t header) {}
+static inline void pd_timing_pe(int port) {}
+static inline void pd_timing_tx(int port, uint16_t header) {}
+static inline void pd_timing_tx_done(int port, int status) {}
+
+#endif /* CONFIG_USB_PD_TIMING */
+
+#endif /* __CROS_EC_USB_PD_TIMING_H */
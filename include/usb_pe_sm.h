@@ -158,6 +158,27 @@ bool pe_in_local_ams(int port);
  */
 const char *pe_get_current_state(int port);
 
+#ifdef CONFIG_USB_SM_STATS
+/**
+ * Returns the transition statistics of the PE state machine
+ *
+ * @param port USB-C port number
+ */
+const struct sm_stats *pe_get_sm_stats(int port);
+#endif
+
+#ifdef CONFIG_USB_PD_TICKLESS
+/**
+ * Returns the time the PE state machine next needs to run, if no event wakes
+ * the PD task before then
+ *
+ * @param port USB-C port number
+ * @param en 1 if PD is enabled, as passed to pe_run()
+ * @return deadline, USB_SM_POLL or USB_SM_NO_DEADLINE
+ */
+uint64_t pe_get_next_deadline(int port, int en);
+#endif
+
 /**
  * Returns the flag mask of the PE state machine
  *
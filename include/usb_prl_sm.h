@@ -30,6 +30,28 @@ int prl_is_running(int port);
  */
 bool prl_is_busy(int port);
 
+/**
+ * Returns the number of message bytes the Protocol Layer copied between its
+ * buffers. Messages which fit in one chunk are transmitted in place; received
+ * messages, and the chunks of chunked messages, are copied.
+ *
+ * @param port USB-C port number
+ * @return bytes copied since the EC started
+ */
+uint32_t prl_get_copy_bytes(int port);
+
+#ifdef CONFIG_USB_PD_TICKLESS
+/**
+ * Returns the time the Protocol Layer state machines next need to run, if no
+ * event wakes the PD task before then
+ *
+ * @param port USB-C port number
+ * @param en 1 if PD is enabled, as passed to prl_run()
+ * @return deadline, USB_SM_POLL or USB_SM_NO_DEADLINE
+ */
+uint64_t prl_get_next_deadline(int port, int en);
+#endif
+
 /**
  * Sets the debug level for the PRL layer
  *
@@ -35,12 +35,35 @@ struct usb_state {
 
 typedef const struct usb_state *usb_state_ptr;
 
+/*
+ * Maximum number of levels of a state hierarchy, counting the state itself and
+ * all its parents. set_state() walks the states to enter in a local array of
+ * this size rather than recursing.
+ */
+#define USB_SM_MAX_DEPTH 8
+
+#ifdef CONFIG_USB_SM_STATS
+/* Transition statistics of a state machine */
+struct sm_stats {
+	/* Number of set_state() calls */
+	uint32_t transitions;
+	/* Time the current state was entered */
+	uint32_t entered_us;
+	/* Longest time spent in a state, and that state */
+	uint32_t longest_us;
+	usb_state_ptr longest;
+};
+#endif
+
 /* Defines the current context of the usb statemachine. */
 struct sm_ctx {
 	usb_state_ptr current;
 	usb_state_ptr previous;
 	/* We use intptr_t type to accommodate host tests ptr size variance */
 	intptr_t internal[2];
+#ifdef CONFIG_USB_SM_STATS
+	struct sm_stats stats;
+#endif
 };
 
 /* Local state machine states */
@@ -88,6 +111,16 @@ void set_state(int port, struct sm_ctx *ctx, usb_state_ptr new_state);
  */
 void run_state(int port, struct sm_ctx *ctx);
 
+#ifdef CONFIG_USB_SM_STATS
+/**
+ * Returns how long a state machine has been in its current state
+ *
+ * @param stats Statistics of the state machine
+ * @return time since the current state was entered, in us
+ */
+uint32_t sm_get_time_in_state(const struct sm_stats *stats);
+#endif
+
 #ifdef TEST_BUILD
 /*
  * Struct for test builds that allow unit tests to easily iterate through
@@ -105,6 +138,14 @@ struct test_sm_data {
 };
 #endif
 
+/*
+ * Deadlines the state machines report to the PD task, see
+ * CONFIG_USB_PD_TICKLESS. A deadline which has already passed, such as
+ * USB_SM_POLL, asks to be run again after the regular polling interval.
+ */
+#define USB_SM_POLL 0
+#define USB_SM_NO_DEADLINE UINT64_MAX
+
 /* Creates a state machine state that will never link. Useful with IS_ENABLED */
 #define GEN_NOT_SUPPORTED(state) extern typeof(state) state ## _NOT_SUPPORTED
 
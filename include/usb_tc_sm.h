@@ -331,6 +331,14 @@ void tc_start_event_loop(int port);
  */
 void tc_pause_event_loop(int port);
 
+/**
+ * Returns the number of times the state machine event loop woke up
+ *
+ * @param port USB-C port number
+ * @return wake ups since the EC started
+ */
+uint32_t tc_get_event_loop_wakeups(int port);
+
 /**
  * Allow system to override the control of TrySrc
  *
@@ -357,6 +365,26 @@ enum try_src_override_t tc_get_try_src_override(void);
  */
 const char *tc_get_current_state(int port);
 
+#ifdef CONFIG_USB_SM_STATS
+/**
+ * Returns the transition statistics of the typeC state machine
+ *
+ * @param port USB-C port number
+ */
+const struct sm_stats *tc_get_sm_stats(int port);
+#endif
+
+#ifdef CONFIG_USB_PD_TICKLESS
+/**
+ * Returns the time the TypeC state machine next needs to run, if no event
+ * wakes the PD task before then
+ *
+ * @param port USB-C port number
+ * @return deadline, USB_SM_POLL or USB_SM_NO_DEADLINE
+ */
+uint64_t tc_get_next_deadline(int port);
+#endif
+
 /**
  * Returns the flag mask of the typeC state machine
  *
@@ -0,0 +1,310 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the ACPI EC port statistics and burst mode read prefetch, through
+ * the emulator's ACPI EC0 port.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "host_test.h"
+#include "memmap.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* ACPI address of a memmap offset */
+#define ACPI_MEMMAP(offset) (EC_ACPI_MEM_MAPPED_BEGIN + (offset))
+
+/* Battery voltage, rate and capacity, as the AP reads them together */
+#define BATT_FIELDS_SIZE 12
+
+static struct {
+	struct ec_response_acpi_stats r;
+	struct ec_acpi_stats_entry entry[0x100];
+} resp;
+
+static int stats_cmd(enum ec_acpi_stats_cmd cmd, uint16_t addr, int entries)
+{
+	struct ec_params_acpi_stats p = { .cmd = cmd, .addr = addr };
+
+	return test_send_host_command(EC_CMD_ACPI_STATS, 0, &p, sizeof(p),
+				      &resp, sizeof(resp.r) +
+				      entries * sizeof(resp.entry[0]));
+}
+
+static uint8_t acpi_cmd(uint8_t cmd)
+{
+	uint8_t value = 0;
+
+	lpc_acpi_host_write(1, cmd);
+	lpc_acpi_host_read(&value);
+	return value;
+}
+
+static uint8_t acpi_read(uint8_t addr)
+{
+	uint8_t value = 0xff;
+
+	lpc_acpi_host_write(1, EC_CMD_ACPI_READ);
+	lpc_acpi_host_write(0, addr);
+	lpc_acpi_host_read(&value);
+	return value;
+}
+
+static void acpi_write(uint8_t addr, uint8_t value)
+{
+	lpc_acpi_host_write(1, EC_CMD_ACPI_WRITE);
+	lpc_acpi_host_write(0, addr);
+	lpc_acpi_host_write(0, value);
+}
+
+/* Read the battery fields, bracketed by the generation, in a burst */
+static int read_batt_burst(uint8_t *data, uint8_t *gen_after)
+{
+	uint8_t gen;
+	int i;
+
+	acpi_cmd(EC_CMD_ACPI_BURST_ENABLE);
+	gen = acpi_read(ACPI_MEMMAP(EC_MEMMAP_BATTERY_GEN));
+	for (i = 0; i < BATT_FIELDS_SIZE; i++)
+		data[i] = acpi_read(ACPI_MEMMAP(EC_MEMMAP_BATT_VOLT + i));
+	*gen_after = acpi_read(ACPI_MEMMAP(EC_MEMMAP_BATTERY_GEN));
+	acpi_cmd(EC_CMD_ACPI_BURST_DISABLE);
+
+	return gen;
+}
+
+static void publish_batt(int n)
+{
+	struct memmap_battery b;
+
+	memmap_stage_battery(&b);
+	b.volt = n;
+	b.rate = n;
+	b.cap = n;
+	memmap_publish_battery(&b, b.flag);
+}
+
+/* Whether voltage, rate and capacity are from one update */
+static int consistent(const uint8_t *data)
+{
+	return !memcmp(data, data + 4, 4) && !memcmp(data, data + 8, 4);
+}
+
+static int test_port(void)
+{
+	TEST_EQ(acpi_read(EC_ACPI_MEM_VERSION), EC_ACPI_MEM_VERSION_CURRENT,
+		"%d");
+
+	acpi_write(EC_ACPI_MEM_TEST, 0x5a);
+	TEST_EQ(acpi_read(EC_ACPI_MEM_TEST), 0x5a, "%d");
+	TEST_EQ(acpi_read(EC_ACPI_MEM_TEST_COMPLIMENT), 0xa5, "%d");
+	TEST_EQ(lpc_acpi_host_status() & EC_LPC_STATUS_TO_HOST, 0, "%d");
+
+	TEST_EQ(acpi_cmd(EC_CMD_ACPI_BURST_ENABLE), 0x90, "%d");
+	TEST_ASSERT(lpc_acpi_host_status() & EC_LPC_STATUS_BURST_MODE);
+	acpi_cmd(EC_CMD_ACPI_BURST_DISABLE);
+	TEST_EQ(lpc_acpi_host_status() & EC_LPC_STATUS_BURST_MODE, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_stats(void)
+{
+	int i;
+
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_CLEAR, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.reads, 0, "%u");
+
+	for (i = 0; i < 5; i++)
+		acpi_read(EC_ACPI_MEM_VERSION);
+	for (i = 0; i < 3; i++)
+		acpi_write(EC_ACPI_MEM_TEST, i);
+	acpi_read(EC_ACPI_MEM_TEST);
+	acpi_read(ACPI_MEMMAP(EC_MEMMAP_ID));
+
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_READ, 0, 0x100), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.reads, 7, "%u");
+	TEST_EQ(resp.r.writes, 3, "%u");
+	TEST_ASSERT(resp.r.read_max_us > 0);
+	TEST_ASSERT(resp.r.read_total_us >= resp.r.read_max_us);
+	TEST_ASSERT(resp.r.write_total_us >= resp.r.write_max_us);
+	TEST_ASSERT(resp.r.handler_max_us > 0);
+	TEST_EQ(resp.r.count, 3, "%d");
+	TEST_EQ(resp.r.next, 0x100, "%d");
+
+	TEST_EQ(resp.entry[0].addr, EC_ACPI_MEM_VERSION, "%d");
+	TEST_EQ(resp.entry[0].reads, 5, "%d");
+	TEST_EQ(resp.entry[0].writes, 0, "%d");
+	TEST_EQ(resp.entry[1].addr, EC_ACPI_MEM_TEST, "%d");
+	TEST_EQ(resp.entry[1].reads, 1, "%d");
+	TEST_EQ(resp.entry[1].writes, 3, "%d");
+	TEST_EQ(resp.entry[2].addr, ACPI_MEMMAP(EC_MEMMAP_ID), "%d");
+
+	/* A page at a time */
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_READ, 0, 2), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.count, 2, "%d");
+	TEST_EQ(resp.r.next, EC_ACPI_MEM_TEST + 1, "%d");
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_READ, resp.r.next, 2), EC_RES_SUCCESS,
+		"%d");
+	TEST_EQ(resp.r.count, 1, "%d");
+	TEST_EQ(resp.entry[0].addr, ACPI_MEMMAP(EC_MEMMAP_ID), "%d");
+	TEST_EQ(resp.r.next, 0x100, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_prefetch(void)
+{
+	uint8_t data[BATT_FIELDS_SIZE];
+	uint8_t gen, gen_after;
+
+	publish_batt(0x01020304);
+
+	/* The first burst learns which fields are read together */
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_CLEAR, 0, 0), EC_RES_SUCCESS, "%d");
+	gen = read_batt_burst(data, &gen_after);
+	TEST_EQ(gen, gen_after, "%d");
+	TEST_ASSERT(consistent(data));
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_READ, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.bursts, 1, "%u");
+	TEST_EQ(resp.r.cache_fills, BATT_FIELDS_SIZE / 4, "%u");
+
+	/* The next copies them in one go */
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_CLEAR, 0, 0), EC_RES_SUCCESS, "%d");
+	read_batt_burst(data, &gen_after);
+	TEST_ASSERT(consistent(data));
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_READ, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.cache_fills, 1, "%u");
+	TEST_EQ(resp.r.cache_bytes, BATT_FIELDS_SIZE, "%u");
+	TEST_EQ(resp.r.cache_hits, BATT_FIELDS_SIZE - 1, "%u");
+	/* The generation is read directly, twice */
+	TEST_EQ(resp.r.reads, BATT_FIELDS_SIZE + 2, "%u");
+
+	/* A generation read flushes the cache: new data is seen */
+	acpi_cmd(EC_CMD_ACPI_BURST_ENABLE);
+	acpi_read(ACPI_MEMMAP(EC_MEMMAP_BATT_VOLT));
+	publish_batt(0x05060708);
+	TEST_EQ(acpi_read(ACPI_MEMMAP(EC_MEMMAP_BATT_VOLT)), 0x04, "%d");
+	acpi_read(ACPI_MEMMAP(EC_MEMMAP_BATTERY_GEN));
+	TEST_EQ(acpi_read(ACPI_MEMMAP(EC_MEMMAP_BATT_VOLT)), 0x08, "%d");
+	acpi_cmd(EC_CMD_ACPI_BURST_DISABLE);
+
+	return EC_SUCCESS;
+}
+
+/*
+ * The interrupt generator plays the AP, one byte per interrupt as the ACPI
+ * port's IBF interrupt handles them: a burst reading the generation, the
+ * battery fields and the generation again.
+ */
+static volatile int ap_running;
+static int ap_reads;
+static int ap_accepted;
+static int ap_torn;
+static int ap_torn_accepted;
+
+static void ap_isr(void)
+{
+	static int step;
+	static uint8_t gen, gen_after, data[BATT_FIELDS_SIZE];
+	/* Burst enable, the generation, the fields, the generation again */
+	const int steps = 1 + 2 * (1 + BATT_FIELDS_SIZE + 1) + 1;
+	/* Each read is a command byte then an address byte */
+	int field = (step - 1) / 2 - 1;
+	uint8_t value = 0;
+
+	if (!ap_running && !step)
+		return;
+
+	if (!step) {
+		lpc_acpi_host_write(1, EC_CMD_ACPI_BURST_ENABLE);
+		lpc_acpi_host_read(&value);
+	} else if (step == steps - 1) {
+		lpc_acpi_host_write(1, EC_CMD_ACPI_BURST_DISABLE);
+	} else if (step & 1) {
+		lpc_acpi_host_write(1, EC_CMD_ACPI_READ);
+	} else if (field < 0 || field == BATT_FIELDS_SIZE) {
+		lpc_acpi_host_write(0, ACPI_MEMMAP(EC_MEMMAP_BATTERY_GEN));
+		lpc_acpi_host_read(field < 0 ? &gen : &gen_after);
+	} else {
+		lpc_acpi_host_write(0,
+				    ACPI_MEMMAP(EC_MEMMAP_BATT_VOLT + field));
+		lpc_acpi_host_read(&data[field]);
+	}
+
+	if (++step < steps)
+		return;
+
+	step = 0;
+	ap_reads++;
+	if (gen == gen_after && !(gen & 1))
+		ap_accepted++;
+	if (!consistent(data)) {
+		ap_torn++;
+		if (gen == gen_after)
+			ap_torn_accepted++;
+	}
+}
+
+void interrupt_generator(void)
+{
+	while (1) {
+		udelay(20 + prng_no_seed() % 64);
+		task_trigger_test_interrupt(ap_isr);
+	}
+}
+
+static int test_interrupts(void)
+{
+	uint8_t data[BATT_FIELDS_SIZE], gen_after;
+	timestamp_t deadline;
+	volatile int spin;
+	int n = 0;
+
+	/* The fields read together were learned from a quiet burst */
+	read_batt_burst(data, &gen_after);
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_CLEAR, 0, 0), EC_RES_SUCCESS, "%d");
+
+	ap_running = 1;
+	deadline.val = get_time().val + SECOND / 2;
+	while (!timestamp_expired(deadline, NULL)) {
+		publish_batt(n++);
+		/* Let the interrupts in, a burst taking 30 of them */
+		for (spin = prng_no_seed() % 10000000; spin; spin--)
+			;
+	}
+	ap_running = 0;
+
+	TEST_EQ(stats_cmd(EC_ACPI_STATS_READ, 0, 0), EC_RES_SUCCESS, "%d");
+	ccprintf("%d updates, %d AP reads, %d accepted, %d fills, %d hits\n",
+		 n, ap_reads, ap_accepted, resp.r.cache_fills,
+		 resp.r.cache_hits);
+	TEST_ASSERT(ap_reads > 0);
+	TEST_EQ(ap_torn_accepted, 0, "%d");
+	/* The fields are copied in one go, so are never torn even unchecked */
+	TEST_EQ(ap_torn, 0, "%d");
+	/* One fill per burst, but the last one may not have finished */
+	TEST_ASSERT(resp.r.cache_fills >= ap_reads);
+	TEST_ASSERT(resp.r.cache_fills <= ap_reads + 1);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_port);
+	RUN_TEST(test_stats);
+	RUN_TEST(test_prefetch);
+	RUN_TEST(test_interrupts);
+
+	test_print_result();
+}
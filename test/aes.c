@@ -16,8 +16,10 @@
 
 #include "aes.h"
 #include "aes-gcm.h"
+#include "benchmark.h"
 #include "console.h"
 #include "common.h"
+#include "ec_commands.h"
 #include "test_util.h"
 #include "timer.h"
 #include "util.h"
@@ -26,6 +28,17 @@
 /* Temporary buffer, to avoid using too much stack space. */
 static uint8_t tmp[512];
 
+/*
+ * What fingerprint MCUs encrypt for each template: FP_ALGORITHM_TEMPLATE_SIZE
+ * of the FPC1025 library, and the positive match salt.
+ */
+#define FP_TEMPLATE_SIZE (5088 + 0 + 4 + FP_POSITIVE_MATCH_SALT_BYTES)
+
+/* One more byte than needed, for unaligned buffers */
+static uint8_t template_in[FP_TEMPLATE_SIZE + 1];
+static uint8_t template_out[FP_TEMPLATE_SIZE + 1];
+static uint8_t template_ref[FP_TEMPLATE_SIZE];
+
 /*
  * Do encryption, put result in |result|, and compare with |ciphertext|.
  */
@@ -165,6 +178,43 @@ static int test_aes_gcm_raw_non_inplace(const uint8_t *key,
 	return EC_SUCCESS;
 }
 
+/*
+ * Do encryption and in-place decryption through the multi-block CTR routine,
+ * and compare with |ciphertext| and |plaintext|.
+ */
+static int test_aes_gcm_ctr32(const uint8_t *key,
+			      int key_size,
+			      const uint8_t *plaintext,
+			      const uint8_t *ciphertext,
+			      int plaintext_size,
+			      const uint8_t *nonce,
+			      int nonce_size,
+			      const uint8_t *tag,
+			      int tag_size)
+{
+	static AES_KEY aes_key;
+	static GCM128_CONTEXT ctx;
+	const ctr128_f stream = (ctr128_f)AES_ctr32_encrypt_blocks;
+
+	TEST_ASSERT(AES_set_encrypt_key(key, 8 * key_size, &aes_key) == 0);
+
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f) AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
+	TEST_ASSERT(CRYPTO_gcm128_encrypt_ctr32(&ctx, &aes_key, plaintext, tmp,
+						plaintext_size, stream));
+	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag, tag_size));
+	TEST_ASSERT_ARRAY_EQ(ciphertext, tmp, plaintext_size);
+
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f) AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
+	TEST_ASSERT(CRYPTO_gcm128_decrypt_ctr32(&ctx, &aes_key, tmp, tmp,
+						plaintext_size, stream));
+	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag, tag_size));
+	TEST_ASSERT_ARRAY_EQ(plaintext, tmp, plaintext_size);
+
+	return EC_SUCCESS;
+}
+
 static int test_aes_gcm_raw(const uint8_t *key,
 			    int key_size,
 			    const uint8_t *plaintext,
@@ -195,6 +245,15 @@ static int test_aes_gcm_raw(const uint8_t *key,
 					     nonce_size,
 					     tag,
 					     tag_size) == EC_SUCCESS);
+	TEST_ASSERT(test_aes_gcm_ctr32(key,
+				       key_size,
+				       plaintext,
+				       ciphertext,
+				       plaintext_size,
+				       nonce,
+				       nonce_size,
+				       tag,
+				       tag_size) == EC_SUCCESS);
 
 	return EC_SUCCESS;
 }
@@ -494,6 +553,120 @@ static int test_aes_gcm(void)
 	return EC_SUCCESS;
 }
 
+/*
+ * Encrypt and decrypt a template in uneven pieces, from and to unaligned
+ * buffers, through the multi-block CTR routine, and compare with encrypting
+ * it in one go one block at a time.
+ */
+static int test_aes_gcm_ctr32_template(void)
+{
+	static const uint8_t key[16] = {
+		0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+		0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+	};
+	static const uint8_t nonce[12] = {
+		0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+		0xde, 0xca, 0xf8, 0x88,
+	};
+	static const int pieces[] = { 1, 15, 17, 48, 3 * 1024 + 5 };
+	const ctr128_f stream = (ctr128_f)AES_ctr32_encrypt_blocks;
+	static AES_KEY aes_key;
+	static GCM128_CONTEXT ctx;
+	uint8_t tag[16];
+	int i, pos, len;
+
+	for (i = 0; i < FP_TEMPLATE_SIZE; i++)
+		template_in[i + 1] = i ^ (i >> 8);
+
+	TEST_ASSERT(AES_set_encrypt_key(key, 8 * sizeof(key), &aes_key) == 0);
+
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	TEST_ASSERT(CRYPTO_gcm128_encrypt(&ctx, &aes_key, template_in + 1,
+					  template_ref, FP_TEMPLATE_SIZE));
+	CRYPTO_gcm128_tag(&ctx, tag, sizeof(tag));
+
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	for (i = 0, pos = 0; pos < FP_TEMPLATE_SIZE; i++, pos += len) {
+		len = i < ARRAY_SIZE(pieces) ? pieces[i] : FP_TEMPLATE_SIZE;
+		len = MIN(len, FP_TEMPLATE_SIZE - pos);
+		TEST_ASSERT(CRYPTO_gcm128_encrypt_ctr32(&ctx, &aes_key,
+							template_in + 1 + pos,
+							template_out + 1 + pos,
+							len, stream));
+	}
+	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag, sizeof(tag)));
+	TEST_ASSERT_ARRAY_EQ(template_ref, template_out + 1, FP_TEMPLATE_SIZE);
+
+	/* Back in place, in the same pieces */
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	for (i = 0, pos = 0; pos < FP_TEMPLATE_SIZE; i++, pos += len) {
+		len = i < ARRAY_SIZE(pieces) ? pieces[i] : FP_TEMPLATE_SIZE;
+		len = MIN(len, FP_TEMPLATE_SIZE - pos);
+		TEST_ASSERT(CRYPTO_gcm128_decrypt_ctr32(&ctx, &aes_key,
+							template_out + 1 + pos,
+							template_out + 1 + pos,
+							len, stream));
+	}
+	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag, sizeof(tag)));
+	TEST_ASSERT_ARRAY_EQ(template_in + 1, template_out + 1,
+			     FP_TEMPLATE_SIZE);
+
+	/* A flipped bit is caught */
+	template_ref[FP_TEMPLATE_SIZE / 2] ^= 0x10;
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	TEST_ASSERT(CRYPTO_gcm128_decrypt_ctr32(&ctx, &aes_key, template_ref,
+						template_out, FP_TEMPLATE_SIZE,
+						stream));
+	TEST_ASSERT(!CRYPTO_gcm128_finish(&ctx, tag, sizeof(tag)));
+
+	return EC_SUCCESS;
+}
+
+static AES_KEY template_key;
+static GCM128_CONTEXT template_ctx;
+
+static void bench_aes_gcm_template(void *arg)
+{
+	static const uint8_t nonce[12] = { 0 };
+	uint8_t tag[16];
+
+	CRYPTO_gcm128_init(&template_ctx, &template_key,
+			   (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&template_ctx, &template_key, nonce,
+			    sizeof(nonce));
+	if (arg)
+		CRYPTO_gcm128_encrypt_ctr32(&template_ctx, &template_key,
+					    template_in, template_out,
+					    FP_TEMPLATE_SIZE,
+					    (ctr128_f)AES_ctr32_encrypt_blocks);
+	else
+		CRYPTO_gcm128_encrypt(&template_ctx, &template_key,
+				      template_in, template_out,
+				      FP_TEMPLATE_SIZE);
+	CRYPTO_gcm128_tag(&template_ctx, tag, sizeof(tag));
+}
+
+static void test_aes_gcm_template_speed(void)
+{
+	static const uint8_t key[16] = { 0 };
+	const struct benchmark_options opts = {
+		.warmup = 5, .runs = 50, .batch = 1 };
+	struct benchmark_result r;
+
+	AES_set_encrypt_key(key, 8 * sizeof(key), &template_key);
+
+	if (!benchmark_run("aes128_gcm_fp_template", bench_aes_gcm_template,
+			   NULL, &opts, &r))
+		benchmark_print(&r);
+	if (!benchmark_run("aes128_gcm_ctr32_fp_template",
+			   bench_aes_gcm_template, (void *)1, &opts, &r))
+		benchmark_print(&r);
+}
+
 static void test_aes_gcm_speed(void)
 {
 	int i;
@@ -565,6 +738,130 @@ static int test_aes_raw(const uint8_t *key, int key_size,
 	return EC_SUCCESS;
 }
 
+/*
+ * Encrypt |blocks| blocks through the multi-block CTR routine, and compare with
+ * AES_encrypt() of each counter block.
+ */
+static int test_aes_ctr32_raw(const uint8_t *key, int key_size,
+			      const uint8_t *ivec, const uint8_t *in,
+			      int blocks)
+{
+	AES_KEY aes_key;
+	uint8_t counter[AES_BLOCK_SIZE];
+	uint8_t *expected = tmp + sizeof(tmp) / 2;
+	uint32_t ctr;
+	int i, j;
+
+	TEST_ASSERT(blocks * AES_BLOCK_SIZE < sizeof(tmp) / 2);
+	TEST_ASSERT(AES_set_encrypt_key(key, 8 * key_size, &aes_key) == 0);
+
+	memcpy(counter, ivec, sizeof(counter));
+	for (i = 0; i < blocks; i++) {
+		AES_encrypt(counter, expected + i * AES_BLOCK_SIZE, &aes_key);
+		for (j = 0; j < AES_BLOCK_SIZE; j++)
+			expected[i * AES_BLOCK_SIZE + j] ^=
+				in[i * AES_BLOCK_SIZE + j];
+
+		/* Only the last 32 bits count, and wrap around */
+		ctr = be32toh(*(uint32_t *)(counter + 12)) + 1;
+		*(uint32_t *)(counter + 12) = htobe32(ctr);
+	}
+
+	/* Unaligned, to check the loads and stores too */
+	AES_ctr32_encrypt_blocks(in, tmp + 1, blocks, &aes_key, ivec);
+	TEST_ASSERT_ARRAY_EQ(expected, tmp + 1, blocks * AES_BLOCK_SIZE);
+
+	/* In place */
+	memcpy(tmp, in, blocks * AES_BLOCK_SIZE);
+	AES_ctr32_encrypt_blocks(tmp, tmp, blocks, &aes_key, ivec);
+	TEST_ASSERT_ARRAY_EQ(expected, tmp, blocks * AES_BLOCK_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_aes_ctr32(void)
+{
+	/* Test vectors from NIST SP 800-38A, F.5.1 and F.5.5. */
+	static const uint8_t key128[] = {
+		0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+		0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+	};
+	static const uint8_t key256[] = {
+		0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+		0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+		0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+		0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4,
+	};
+	static const uint8_t ivec[] = {
+		0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+		0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+	};
+	static const uint8_t plain[] = {
+		0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+		0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+		0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+		0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+		0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+		0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+		0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+		0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+	};
+	static const uint8_t cipher128[] = {
+		0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+		0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+		0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff,
+		0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+		0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e,
+		0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+		0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1,
+		0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee,
+	};
+	static const uint8_t cipher256[] = {
+		0x60, 0x1e, 0xc3, 0x13, 0x77, 0x57, 0x89, 0xa5,
+		0xb7, 0xa7, 0xf5, 0x04, 0xbb, 0xf3, 0xd2, 0x28,
+		0xf4, 0x43, 0xe3, 0xca, 0x4d, 0x62, 0xb5, 0x9a,
+		0xca, 0x84, 0xe9, 0x90, 0xca, 0xca, 0xf5, 0xc5,
+		0x2b, 0x09, 0x30, 0xda, 0xa2, 0x3d, 0xe9, 0x4c,
+		0xe8, 0x70, 0x17, 0xba, 0x2d, 0x84, 0x98, 0x8d,
+		0xdf, 0xc9, 0xc5, 0x8d, 0xb6, 0x7a, 0xad, 0xa6,
+		0x13, 0xc2, 0xdd, 0x08, 0x45, 0x79, 0x41, 0xa6,
+	};
+	/* The counter wraps around within its last 32 bits */
+	static const uint8_t ivec_wrap[] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xfe,
+	};
+	static const uint8_t key192[] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+		0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	};
+	static const int blocks = sizeof(plain) / AES_BLOCK_SIZE;
+	AES_KEY aes_key;
+
+	TEST_ASSERT(AES_set_encrypt_key(key128, 128, &aes_key) == 0);
+	AES_ctr32_encrypt_blocks(plain, tmp, blocks, &aes_key, ivec);
+	TEST_ASSERT_ARRAY_EQ(cipher128, tmp, sizeof(cipher128));
+
+	TEST_ASSERT(AES_set_encrypt_key(key256, 256, &aes_key) == 0);
+	AES_ctr32_encrypt_blocks(plain, tmp, blocks, &aes_key, ivec);
+	TEST_ASSERT_ARRAY_EQ(cipher256, tmp, sizeof(cipher256));
+
+	/* Nothing to do */
+	tmp[0] = 0x5a;
+	AES_ctr32_encrypt_blocks(plain, tmp, 0, &aes_key, ivec);
+	TEST_EQ(tmp[0], 0x5a, "0x%02x");
+
+	TEST_ASSERT(!test_aes_ctr32_raw(key128, sizeof(key128), ivec_wrap,
+					plain, blocks));
+	TEST_ASSERT(!test_aes_ctr32_raw(key192, sizeof(key192), ivec_wrap,
+					plain, blocks));
+	TEST_ASSERT(!test_aes_ctr32_raw(key256, sizeof(key256), ivec_wrap,
+					plain, blocks));
+
+	return EC_SUCCESS;
+}
+
 static int test_aes(void)
 {
 	/* Test vectors from FIPS-197, Appendix C. */
@@ -654,11 +951,20 @@ void run_test(int argc, char **argv)
 	watchdog_reload();
 	RUN_TEST(test_aes);
 
+	watchdog_reload();
+	RUN_TEST(test_aes_ctr32);
+
 	/* do not check result, just as a benchmark */
 	test_aes_gcm_speed();
 
 	watchdog_reload();
 	RUN_TEST(test_aes_gcm);
 
+	/* do not check result, just as a benchmark */
+	test_aes_gcm_template_speed();
+
+	watchdog_reload();
+	RUN_TEST(test_aes_gcm_ctr32_template);
+
 	test_print_result();
 }
@@ -0,0 +1,128 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Benchmarks of crypto code: SHA-256, RSA verification and AES-GCM.
+ */
+
+#include "aes.h"
+#include "aes-gcm.h"
+#include "benchmark.h"
+#include "common.h"
+#include "console.h"
+#include "rsa.h"
+#include "sha256.h"
+#include "test_util.h"
+#include "util.h"
+
+#include "rsa2048-F4.h"
+
+static uint8_t data[4096];
+static uint8_t out[4096];
+
+/*****************************************************************************/
+/* SHA-256 */
+
+static struct sha256_ctx sha_ctx;
+
+static void bench_sha256(void *arg)
+{
+	int len = (intptr_t)arg;
+
+	SHA256_init(&sha_ctx);
+	SHA256_update(&sha_ctx, data, len);
+	SHA256_final(&sha_ctx);
+}
+
+static int test_sha256(void)
+{
+	TEST_BENCHMARK("sha256_64", bench_sha256, (void *)64, NULL);
+	TEST_BENCHMARK("sha256_4k", bench_sha256, (void *)sizeof(data), NULL);
+
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* RSA */
+
+static uint32_t rsa_workbuf[3 * RSANUMBYTES / 4];
+
+static void bench_rsa_verify(void *arg)
+{
+	*(int *)arg = rsa_verify(rsa_key, sig, hash, rsa_workbuf);
+}
+
+static int test_rsa(void)
+{
+	const struct benchmark_options opts = {
+		.warmup = 2, .runs = 20, .batch = 1 };
+	int good = 0;
+
+	TEST_BENCHMARK("rsa2048_f4_verify", bench_rsa_verify, &good, &opts);
+	TEST_ASSERT(good);
+
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* AES-GCM */
+
+static const uint8_t aes_key_bytes[16] = {
+	0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+};
+static const uint8_t nonce[12] = {
+	0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	0xde, 0xca, 0xf8, 0x88,
+};
+static AES_KEY aes_key;
+static GCM128_CONTEXT gcm_ctx;
+
+static void bench_aes_gcm_encrypt(void *arg)
+{
+	int len = (intptr_t)arg;
+	uint8_t tag[16];
+
+	CRYPTO_gcm128_init(&gcm_ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&gcm_ctx, &aes_key, nonce, sizeof(nonce));
+	CRYPTO_gcm128_encrypt(&gcm_ctx, &aes_key, data, out, len);
+	CRYPTO_gcm128_tag(&gcm_ctx, tag, sizeof(tag));
+}
+
+static void bench_aes_encrypt_block(void *arg)
+{
+	AES_encrypt(data, out, &aes_key);
+}
+
+static int test_aes_gcm(void)
+{
+	const struct benchmark_options block_opts = {
+		.warmup = 100, .runs = 200, .batch = 16 };
+
+	TEST_ASSERT(AES_set_encrypt_key(aes_key_bytes, 128, &aes_key) == 0);
+
+	TEST_BENCHMARK("aes128_block", bench_aes_encrypt_block, NULL,
+		       &block_opts);
+	TEST_BENCHMARK("aes128_gcm_64", bench_aes_gcm_encrypt, (void *)64,
+		       NULL);
+	TEST_BENCHMARK("aes128_gcm_4k", bench_aes_gcm_encrypt,
+		       (void *)sizeof(data), NULL);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i ^ (i >> 8);
+
+	test_reset();
+
+	RUN_TEST(test_sha256);
+	RUN_TEST(test_rsa);
+	RUN_TEST(test_aes_gcm);
+
+	test_print_result();
+}
@@ -0,0 +1,243 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Benchmarks of library code: printf, CRC, queues and fixed-point math, one
+ * sample at a time and in batches.
+ */
+
+#include "benchmark.h"
+#include "common.h"
+#include "console.h"
+#include "crc.h"
+#include "kasa.h"
+#include "math_util.h"
+#include "printf.h"
+#include "queue.h"
+#include "test_util.h"
+#include "util.h"
+
+/*****************************************************************************/
+/* printf */
+
+static char print_buf[128];
+
+static void bench_snprintf(void *arg)
+{
+	snprintf(print_buf, sizeof(print_buf), "%s %d 0x%08x %-8s|%5d",
+		 "charger", -12345, 0xdeadbeef, "pd", 42);
+}
+
+static void bench_snprintf_timestamp(void *arg)
+{
+	uint64_t t = 123456789012ULL;
+
+	snprintf(print_buf, sizeof(print_buf), "[%pT %ph]", &t,
+		 HEX_BUF(print_buf + 64, 16));
+}
+
+static int test_printf(void)
+{
+	const struct benchmark_options opts = {
+		.warmup = 100, .runs = 200, .batch = 10 };
+
+	TEST_BENCHMARK("snprintf", bench_snprintf, NULL, &opts);
+	TEST_BENCHMARK("snprintf_timestamp_hex", bench_snprintf_timestamp, NULL,
+		       &opts);
+
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* CRC */
+
+static uint8_t crc_data[1024];
+
+static void bench_crc32_8(void *arg)
+{
+	uint32_t ctx;
+	int i;
+
+	crc32_ctx_init(&ctx);
+	for (i = 0; i < sizeof(crc_data); i++)
+		crc32_ctx_hash8(&ctx, crc_data[i]);
+	*(uint32_t *)arg = crc32_ctx_result(&ctx);
+}
+
+static void bench_crc32_32(void *arg)
+{
+	uint32_t ctx;
+	int i;
+
+	crc32_ctx_init(&ctx);
+	for (i = 0; i < sizeof(crc_data); i += 4)
+		crc32_ctx_hash32(&ctx, *(uint32_t *)&crc_data[i]);
+	*(uint32_t *)arg = crc32_ctx_result(&ctx);
+}
+
+static int test_crc32(void)
+{
+	uint32_t crc;
+	int i;
+
+	for (i = 0; i < sizeof(crc_data); i++)
+		crc_data[i] = i * 7;
+
+	TEST_BENCHMARK("crc32_1k_bytes", bench_crc32_8, &crc, NULL);
+	TEST_BENCHMARK("crc32_1k_words", bench_crc32_32, &crc, NULL);
+
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* Queues */
+
+static struct queue const bench_queue = QUEUE_NULL(256, uint8_t);
+static uint8_t queue_data[64];
+static uint8_t queue_out[3 * sizeof(queue_data)];
+
+static void bench_queue_add_remove(void *arg)
+{
+	int i;
+
+	/* Wraps around, as 64 doesn't divide the 256 byte buffer evenly */
+	for (i = 0; i < 3; i++)
+		queue_add_units(&bench_queue, queue_data, sizeof(queue_data));
+	queue_remove_units(&bench_queue, queue_out, sizeof(queue_out) - 1);
+}
+
+static int test_queue(void)
+{
+	const struct benchmark_options opts = {
+		.warmup = 10, .runs = 200, .batch = 10 };
+
+	queue_init(&bench_queue);
+	TEST_BENCHMARK("queue_add_units_192", bench_queue_add_remove, NULL,
+		       &opts);
+
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* Fixed-point math */
+
+static const mat33_fp_t rot = {
+	{ FLOAT_TO_FP(0.8f), FLOAT_TO_FP(-0.6f), 0 },
+	{ FLOAT_TO_FP(0.6f), FLOAT_TO_FP(0.8f), 0 },
+	{ 0, 0, FLOAT_TO_FP(1) },
+};
+
+static void bench_arc_cos(void *arg)
+{
+	fp_t x;
+
+	for (x = FLOAT_TO_FP(-1); x <= FLOAT_TO_FP(1); x += FLOAT_TO_FP(0.125))
+		*(fp_t *)arg += arc_cos(x);
+}
+
+static void bench_fp_sqrtf(void *arg)
+{
+	int i;
+
+	for (i = 1; i <= 16; i++)
+		*(fp_t *)arg += fp_sqrtf(INT_TO_FP(i * 37));
+}
+
+static void bench_rotate(void *arg)
+{
+	intv3_t v = { 1000, -2000, 9800 };
+	intv3_t res;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		rotate(v, rot, res);
+		v[0] = res[0];
+		v[1] = res[1];
+	}
+	*(fp_t *)arg += v[0];
+}
+
+/* A FIFO's worth of samples, in structure-of-arrays layout */
+#define BATCH 16
+static fp_t batch_fx[BATCH], batch_fy[BATCH], batch_fz[BATCH];
+
+static void bench_kasa_each(void *arg)
+{
+	int i;
+
+	for (i = 0; i < BATCH; i++)
+		kasa_accumulate(arg, batch_fx[i], batch_fy[i], batch_fz[i]);
+}
+
+static void bench_kasa_batch(void *arg)
+{
+	kasa_accumulate_batch(arg, batch_fx, batch_fy, batch_fz, BATCH);
+}
+
+static int test_math_util(void)
+{
+	struct kasa_fit kasa;
+	fp_t sink = 0;
+	int i;
+
+	TEST_BENCHMARK("arc_cos_x17", bench_arc_cos, &sink, NULL);
+	TEST_BENCHMARK("fp_sqrtf_x16", bench_fp_sqrtf, &sink, NULL);
+	TEST_BENCHMARK("rotate_x16", bench_rotate, &sink, NULL);
+
+	for (i = 0; i < BATCH; i++) {
+		batch_fx[i] = FLOAT_TO_FP(0.1f) * i;
+		batch_fy[i] = FLOAT_TO_FP(-0.05f) * i;
+		batch_fz[i] = FLOAT_TO_FP(1.0f) - FLOAT_TO_FP(0.01f) * i;
+	}
+
+	kasa_reset(&kasa);
+	TEST_BENCHMARK("kasa_accumulate_each_x16", bench_kasa_each, &kasa,
+		       NULL);
+	kasa_reset(&kasa);
+	TEST_BENCHMARK("kasa_accumulate_batch_x16", bench_kasa_batch, &kasa,
+		       NULL);
+
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+
+static int test_options(void)
+{
+	struct benchmark_options opts = BENCHMARK_DEFAULT_OPTIONS;
+	struct benchmark_result r;
+	fp_t sink = 0;
+
+	opts.runs = 0;
+	TEST_EQ(benchmark_run("bad", bench_fp_sqrtf, &sink, &opts, &r),
+		EC_ERROR_INVAL, "%d");
+	opts.runs = BENCHMARK_MAX_RUNS + 1;
+	TEST_EQ(benchmark_run("bad", bench_fp_sqrtf, &sink, &opts, &r),
+		EC_ERROR_INVAL, "%d");
+	opts.runs = 1;
+	opts.batch = 0;
+	TEST_EQ(benchmark_run("bad", bench_fp_sqrtf, &sink, &opts, &r),
+		EC_ERROR_INVAL, "%d");
+
+	/* A single run is the min, median, p99 and max */
+	opts.batch = 1;
+	TEST_EQ(benchmark_run("one", bench_fp_sqrtf, &sink, &opts, &r),
+		EC_SUCCESS, "%d");
+	TEST_EQ(r.min_ns, r.max_ns, "%u");
+	TEST_EQ(r.p99_ns, r.max_ns, "%u");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_options);
+	RUN_TEST(test_printf);
+	RUN_TEST(test_crc32);
+	RUN_TEST(test_queue);
+	RUN_TEST(test_math_util);
+
+	test_print_result();
+}
@@ -0,0 +1,290 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for draining the BMI260 FIFO, with the chip mocked on I2C.
+ */
+
+#include "accelgyro.h"
+#include "common.h"
+#include "driver/accelgyro_bmi_common.h"
+#include "driver/accelgyro_bmi260.h"
+#include "i2c.h"
+#include "motion_sense.h"
+#include "motion_sense_fifo.h"
+#include "task.h"
+#include "test_util.h"
+#include "util.h"
+
+static struct mutex g_base_mutex;
+static struct bmi_drv_data_t g_bmi260_data;
+
+struct motion_sensor_t motion_sensors[] = {
+	[BASE_ACCEL] = {
+		.name = "Base Accel",
+		.chip = MOTIONSENSE_CHIP_BMI260,
+		.type = MOTIONSENSE_TYPE_ACCEL,
+		.drv = &bmi260_drv,
+		.mutex = &g_base_mutex,
+		.drv_data = &g_bmi260_data,
+		.port = I2C_PORT_ACCEL,
+		.i2c_spi_addr_flags = BMI260_ADDR0_FLAGS,
+		.oversampling_ratio = 1,
+	},
+	[BASE_GYRO] = {
+		.name = "Base Gyro",
+		.chip = MOTIONSENSE_CHIP_BMI260,
+		.type = MOTIONSENSE_TYPE_GYRO,
+		.drv = &bmi260_drv,
+		.mutex = &g_base_mutex,
+		.drv_data = &g_bmi260_data,
+		.port = I2C_PORT_ACCEL,
+		.i2c_spi_addr_flags = BMI260_ADDR0_FLAGS,
+		.oversampling_ratio = 1,
+	},
+};
+
+const unsigned int motion_sensor_count = ARRAY_SIZE(motion_sensors);
+
+uint32_t mkbp_last_event_time;
+
+/*****************************************************************************/
+/* Mock chip */
+
+static uint8_t fifo[1024];
+/* Where each frame starts, so a frame cut by a read is sent again */
+static uint8_t frame_start[ARRAY_SIZE(fifo) + 1];
+static int fifo_len, fifo_pos;
+
+static int reg_addr;
+static int data_reads, max_read, flushes;
+
+static int bmi260_i2c_xfer(int port, uint16_t addr_flags,
+			   const uint8_t *out, int out_size,
+			   uint8_t *in, int in_size, int flags)
+{
+	int i, end;
+
+	if (port != I2C_PORT_ACCEL || addr_flags != BMI260_ADDR0_FLAGS)
+		return EC_ERROR_INVAL;
+
+	if (out_size == 1 && (flags & I2C_XFER_START)) {
+		reg_addr = *out;
+	} else if (out_size == 2) {
+		if (out[0] == BMI260_CMD_REG && out[1] == BMI_CMD_FIFO_FLUSH) {
+			fifo_pos = fifo_len;
+			flushes++;
+		}
+		return EC_SUCCESS;
+	}
+
+	if (!in)
+		return EC_SUCCESS;
+
+	switch (reg_addr) {
+	case BMI260_FIFO_LENGTH_0:
+		in[0] = (fifo_len - fifo_pos) & 0xff;
+		if (in_size > 1)
+			in[1] = (fifo_len - fifo_pos) >> 8;
+		break;
+	case BMI260_FIFO_DATA:
+		data_reads++;
+		max_read = MAX(max_read, in_size);
+		/* Past the end, the chip sends empty frames */
+		for (i = 0; i < in_size; i++)
+			in[i] = fifo_pos + i < fifo_len ?
+				fifo[fifo_pos + i] : BMI_FH_EMPTY;
+		end = MIN(fifo_pos + in_size, fifo_len);
+		while (end > fifo_pos && !frame_start[end])
+			end--;
+		fifo_pos = end;
+		break;
+	default:
+		memset(in, 0, in_size);
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(bmi260_i2c_xfer);
+
+static void fifo_add(const uint8_t *frame, int size)
+{
+	memcpy(&fifo[fifo_len], frame, size);
+	fifo_len += size;
+	frame_start[fifo_len] = 1;
+}
+
+/* An accel and gyro frame, with values from n */
+static void fifo_add_data(int n)
+{
+	uint8_t frame[13];
+	int i;
+
+	frame[0] = BMI_FH_EMPTY | (3 << BMI_FH_PARM_OFFSET);
+	for (i = 0; i < 6; i++) {
+		/* Gyro first */
+		frame[1 + i * 2] = n + 10 + i;
+		frame[2 + i * 2] = 0;
+	}
+	fifo_add(frame, sizeof(frame));
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static struct ec_response_motion_sensor_data data[CONFIG_ACCEL_FIFO_SIZE];
+static uint16_t data_bytes_read;
+
+/* Commit the data staged, read it back, and drop the timestamps */
+static int read_samples(void)
+{
+	int i, count, samples = 0;
+
+	motion_sense_fifo_commit_data();
+	count = motion_sense_fifo_read(sizeof(data), CONFIG_ACCEL_FIFO_SIZE,
+				       data, &data_bytes_read);
+	for (i = 0; i < count; i++)
+		if (!(data[i].flags & MOTIONSENSE_SENSOR_FLAG_TIMESTAMP))
+			data[samples++] = data[i];
+	return samples;
+}
+
+static int load_fifo(void)
+{
+	return bmi_load_fifo(&motion_sensors[0], 100);
+}
+
+static int test_drain_bursts(void)
+{
+	struct motion_sense_fifo_drain_stats *stats =
+		&motion_sensors[0].drain_stats[0];
+	int i, n = 30;
+
+	for (i = 0; i < n; i++)
+		fifo_add_data(i * 4);
+
+	/* All of it in one call, in reads as large as the buffer */
+	TEST_EQ(load_fifo(), EC_SUCCESS, "%d");
+	TEST_EQ(fifo_pos, fifo_len, "%d");
+	TEST_EQ(max_read, CONFIG_ACCEL_FIFO_DRAIN_SIZE, "%d");
+	TEST_LE(data_reads, fifo_len / (CONFIG_ACCEL_FIFO_DRAIN_SIZE - 12) + 1,
+		"%d");
+
+	TEST_EQ(read_samples(), 2 * n, "%d");
+	for (i = 0; i < n; i++) {
+		TEST_EQ(data[2 * i].sensor_num, 1, "%d");
+		TEST_EQ(data[2 * i].data[X], i * 4 + 10, "%d");
+		TEST_EQ(data[2 * i + 1].sensor_num, 0, "%d");
+		TEST_EQ(data[2 * i + 1].data[Z], i * 4 + 15, "%d");
+	}
+
+	TEST_EQ(stats->drains, 1, "%u");
+	TEST_EQ(stats->bursts, data_reads, "%u");
+	TEST_EQ(stats->frames, n, "%u");
+	TEST_ASSERT(stats->bytes > fifo_len);
+
+	return EC_SUCCESS;
+}
+
+static int test_control_frames(void)
+{
+	const uint8_t skip[] = { BMI_FH_SKIP, 3 };
+	const uint8_t time[] = { BMI_FH_TIME, 1, 2, 3 };
+	const uint8_t config[] = { BMI_FH_CONFIG, 1, 1, 2, 3 };
+
+	fifo_add(skip, sizeof(skip));
+	fifo_add_data(0);
+	fifo_add(config, sizeof(config));
+	fifo_add_data(1);
+	fifo_add(time, sizeof(time));
+
+	TEST_EQ(load_fifo(), EC_SUCCESS, "%d");
+	TEST_EQ(read_samples(), 4, "%d");
+	TEST_EQ(data[2].data[X], 11, "%d");
+	TEST_EQ(flushes, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_unknown_header(void)
+{
+	const uint8_t bad[] = { 0x0c, 0x0c, 0x0c, 0x0c };
+
+	fifo_add_data(0);
+	fifo_add(bad, sizeof(bad));
+	fifo_add_data(1);
+
+	/* The frames before it are kept, then the FIFO is flushed */
+	TEST_EQ(load_fifo(), EC_ERROR_NOT_HANDLED, "%d");
+	TEST_EQ(read_samples(), 2, "%d");
+	TEST_EQ(flushes, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_suspended(void)
+{
+	const uint8_t suspended[] = { 0x84, 0x84, 0x84, 0x84, 0x84, 0x84 };
+
+	fifo_add(suspended, sizeof(suspended));
+
+	TEST_EQ(load_fifo(), EC_SUCCESS, "%d");
+	TEST_EQ(read_samples(), 0, "%d");
+	TEST_EQ(data_reads, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_disabled(void)
+{
+	fifo_add_data(0);
+	g_bmi260_data.flags = 0;
+
+	TEST_EQ(load_fifo(), EC_SUCCESS, "%d");
+	TEST_EQ(data_reads, 0, "%d");
+	TEST_EQ(flushes, 1, "%d");
+	TEST_EQ(read_samples(), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void before_test(void)
+{
+	int i;
+
+	fifo_len = fifo_pos = 0;
+	memset(frame_start, 0, sizeof(frame_start));
+	data_reads = max_read = flushes = 0;
+
+	memset(&g_bmi260_data, 0, sizeof(g_bmi260_data));
+	g_bmi260_data.flags = (BIT(MOTIONSENSE_TYPE_ACCEL) |
+			       BIT(MOTIONSENSE_TYPE_GYRO)) <<
+			      BMI_FIFO_FLAG_OFFSET;
+	for (i = 0; i < ARRAY_SIZE(g_bmi260_data.saved_data); i++) {
+		g_bmi260_data.saved_data[i].scale[X] =
+			MOTION_SENSE_DEFAULT_SCALE;
+		g_bmi260_data.saved_data[i].scale[Y] =
+			MOTION_SENSE_DEFAULT_SCALE;
+		g_bmi260_data.saved_data[i].scale[Z] =
+			MOTION_SENSE_DEFAULT_SCALE;
+	}
+	memset(motion_sensors[0].drain_stats, 0,
+	       sizeof(motion_sensors[0].drain_stats));
+
+	read_samples();
+	motion_sense_fifo_reset();
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	motion_sense_fifo_init();
+
+	RUN_TEST(test_drain_bursts);
+	RUN_TEST(test_control_frames);
+	RUN_TEST(test_unknown_header);
+	RUN_TEST(test_suspended);
+	RUN_TEST(test_disabled);
+
+	test_print_result();
+}
@@ -6,6 +6,7 @@
  */
 
 #include "accelgyro.h"
+#include "benchmark.h"
 #include "body_detection.h"
 #include "body_detection_test_data.h"
 #include "common.h"
@@ -16,6 +17,8 @@
 
 static struct motion_sensor_t *sensor = &motion_sensors[BASE];
 static const int window_size = 50; /* sensor data rate (Hz) */
+/* Largest power of two within a second of samples at that rate */
+#define VAR_WINDOW 32
 
 static int filler(const struct motion_sensor_t *s, const float v)
 {
@@ -70,6 +73,83 @@ static int get_trigger_time(const struct body_detect_test_data *data,
 	return target_index - action_index;
 }
 
+/*
+ * Like get_trigger_time(), but feed the data to body_detect_batch() in chunks,
+ * and return when the state is first seen at the end of a chunk.
+ */
+static int get_trigger_time_batch(const struct body_detect_test_data *data,
+				  const size_t size,
+				  const enum body_detect_states target_state,
+				  int chunk)
+{
+	int x[BODY_DETECTION_BATCH_SIZE], y[BODY_DETECTION_BATCH_SIZE];
+	int i, j, n, end, action_index = -1;
+
+	body_detect_reset();
+	body_detect_change_state(BODY_DETECTION_OFF_BODY);
+	for (i = 0; i < size; i += n) {
+		n = MIN(chunk, size - i);
+		for (j = 0; j < n; j++) {
+			x[j] = filler(sensor, data[i + j].x);
+			y[j] = filler(sensor, data[i + j].y);
+			if (data[i + j].action == 1 && action_index == -1)
+				action_index = i + j;
+		}
+		body_detect_batch(x, y, n);
+
+		end = i + n - 1;
+		if (action_index != -1 &&
+		    body_detect_get_state() == target_state)
+			return end - action_index;
+	}
+	return -1;
+}
+
+/* The index a scalar trigger time is seen at, with chunks */
+static int chunk_end(const struct body_detect_test_data *data, int trigger,
+		     int chunk)
+{
+	int action_index = 0;
+
+	while (data[action_index].action != 1)
+		action_index++;
+	return ((action_index + trigger) / chunk + 1) * chunk - 1 -
+		action_index;
+}
+
+static int test_body_detect_batch(void)
+{
+	const int chunk = 8;
+	int ret, scalar, batch;
+
+	ret = sensor->drv->set_data_rate(sensor, window_size * 1000, 0);
+	TEST_ASSERT(ret == EC_SUCCESS);
+	body_detect_set_enable(true);
+
+	/* The batches change state on the same sample as one at a time */
+	scalar = get_trigger_time(kBodyDetectOffOnTestData,
+				  kBodyDetectOffOnTestDataLength,
+				  BODY_DETECTION_ON_BODY);
+	batch = get_trigger_time_batch(kBodyDetectOffOnTestData,
+				       kBodyDetectOffOnTestDataLength,
+				       BODY_DETECTION_ON_BODY, chunk);
+	TEST_ASSERT(scalar >= 0);
+	TEST_EQ(batch, chunk_end(kBodyDetectOffOnTestData, scalar, chunk),
+		"%d");
+
+	scalar = get_trigger_time(kBodyDetectOnOffTestData,
+				  kBodyDetectOnOffTestDataLength,
+				  BODY_DETECTION_OFF_BODY);
+	batch = get_trigger_time_batch(kBodyDetectOnOffTestData,
+				       kBodyDetectOnOffTestDataLength,
+				       BODY_DETECTION_OFF_BODY, chunk);
+	TEST_ASSERT(scalar >= 0);
+	TEST_EQ(batch, chunk_end(kBodyDetectOnOffTestData, scalar, chunk),
+		"%d");
+
+	return EC_SUCCESS;
+}
+
 static int test_body_detect(void)
 {
 	int ret, trigger_time;
@@ -106,12 +186,153 @@ static int test_body_detect(void)
 	return EC_SUCCESS;
 }
 
+/* Var(X) + Var(Y) over the window ending at a sample, computed directly */
+static uint64_t window_variance(const int *x, const int *y, int end)
+{
+	int64_t sx = 0, sy = 0, qx = 0, qy = 0;
+	int i;
+
+	for (i = end - VAR_WINDOW + 1; i <= end; i++) {
+		sx += x[i];
+		sy += y[i];
+		qx += (int64_t)x[i] * x[i];
+		qy += (int64_t)y[i] * y[i];
+	}
+	return (VAR_WINDOW * (qx + qy) - sx * sx - sy * sy) /
+		(VAR_WINDOW * VAR_WINDOW);
+}
+
+/* Samples of the longest test data, as the sensor gives them */
+static int xs[4096], ys[4096];
+
+static int check_variance(const struct body_detect_test_data *data,
+			  const size_t size)
+{
+	int i, mismatches = 0;
+
+	TEST_ASSERT(size <= ARRAY_SIZE(xs));
+	body_detect_reset();
+	for (i = 0; i < size; i++) {
+		xs[i] = filler(sensor, data[i].x);
+		ys[i] = filler(sensor, data[i].y);
+		body_detect_batch(&xs[i], &ys[i], 1);
+		if (i >= VAR_WINDOW - 1 &&
+		    body_detect_get_variance() != window_variance(xs, ys, i))
+			mismatches++;
+	}
+	TEST_EQ(mismatches, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_body_detect_variance(void)
+{
+	int ret;
+
+	ret = sensor->drv->set_data_rate(sensor, window_size * 1000, 0);
+	TEST_ASSERT(ret == EC_SUCCESS);
+	body_detect_set_enable(true);
+
+	/* The streaming variance is exact on every sample */
+	TEST_EQ(check_variance(kBodyDetectOnBodyTestData,
+			       kBodyDetectOnBodyTestDataLength),
+		EC_SUCCESS, "%d");
+	TEST_EQ(check_variance(kBodyDetectOffOnTestData,
+			       kBodyDetectOffOnTestDataLength),
+		EC_SUCCESS, "%d");
+	TEST_EQ(check_variance(kBodyDetectOnOffTestData,
+			       kBodyDetectOnOffTestDataLength),
+		EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_body_detect_params(void)
+{
+	struct body_detect_params defaults, p;
+	int ret, trigger_time;
+
+	ret = sensor->drv->set_data_rate(sensor, window_size * 1000, 0);
+	TEST_ASSERT(ret == EC_SUCCESS);
+	body_detect_set_enable(true);
+	body_detect_get_params(&defaults);
+	TEST_EQ(defaults.var_threshold, CONFIG_BODY_DETECTION_VAR_THRESHOLD,
+		"%d");
+
+	/* Out of range */
+	p = defaults;
+	p.confidence_delta = 0;
+	TEST_EQ(body_detect_set_params(&p), EC_ERROR_INVAL, "%d");
+	p = defaults;
+	p.on_body_con = 101;
+	TEST_EQ(body_detect_set_params(&p), EC_ERROR_INVAL, "%d");
+
+	/* A confidence which can't be passed */
+	p = defaults;
+	p.on_body_con = 100;
+	TEST_EQ(body_detect_set_params(&p), EC_SUCCESS, "%d");
+	trigger_time = get_trigger_time(kBodyDetectOffOnTestData,
+					kBodyDetectOffOnTestDataLength,
+					BODY_DETECTION_ON_BODY);
+	TEST_EQ(trigger_time, -1, "%d");
+
+	/* Back to the defaults */
+	TEST_EQ(body_detect_set_params(&defaults), EC_SUCCESS, "%d");
+	trigger_time = get_trigger_time(kBodyDetectOffOnTestData,
+					kBodyDetectOffOnTestDataLength,
+					BODY_DETECTION_ON_BODY);
+	TEST_ASSERT(trigger_time >= 0 && trigger_time < 3 * window_size);
+
+	return EC_SUCCESS;
+}
+
+static int bench_pos;
+
+static void bench_body_detect_batch(void *arg)
+{
+	int n = kBodyDetectOnOffTestDataLength;
+
+	body_detect_batch(&xs[bench_pos], &ys[bench_pos],
+			  BODY_DETECTION_BATCH_SIZE);
+	bench_pos += BODY_DETECTION_BATCH_SIZE;
+	if (bench_pos + BODY_DETECTION_BATCH_SIZE > n)
+		bench_pos = 0;
+}
+
+static int test_body_detect_benchmark(void)
+{
+	const struct benchmark_options opts = {
+		.warmup = 10, .runs = 200, .batch = 10 };
+	struct benchmark_result r;
+	int i, ret;
+
+	TEST_ASSERT(kBodyDetectOnOffTestDataLength <= ARRAY_SIZE(xs));
+	ret = sensor->drv->set_data_rate(sensor, window_size * 1000, 0);
+	TEST_ASSERT(ret == EC_SUCCESS);
+	body_detect_set_enable(true);
+	body_detect_reset();
+	for (i = 0; i < kBodyDetectOnOffTestDataLength; i++) {
+		xs[i] = filler(sensor, kBodyDetectOnOffTestData[i].x);
+		ys[i] = filler(sensor, kBodyDetectOnOffTestData[i].y);
+	}
+
+	TEST_EQ(benchmark_run("body_detect_batch_32", bench_body_detect_batch,
+			      NULL, &opts, &r), EC_SUCCESS, "%d");
+	benchmark_print(&r);
+	TEST_ASSERT(r.min_ns <= r.median_ns);
+
+	return EC_SUCCESS;
+}
 
 void run_test(int argc, char **argv)
 {
 	test_reset();
 
 	RUN_TEST(test_body_detect);
+	RUN_TEST(test_body_detect_batch);
+	RUN_TEST(test_body_detect_variance);
+	RUN_TEST(test_body_detect_params);
+	RUN_TEST(test_body_detect_benchmark);
 
 	test_print_result();
 }
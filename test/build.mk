@@ -12,9 +12,14 @@ ifneq ($(TEST_LIST_HOST),)
 test-list-host=$(TEST_LIST_HOST)
 else
 test-list-host = accel_cal
+test-list-host += acpi
 test-list-host += aes
+test-list-host += aes_ghash8
 test-list-host += base32
+test-list-host += bmi260
 test-list-host += battery_get_params_smart
+test-list-host += benchmark_crypto
+test-list-host += benchmark_lib
 test-list-host += bklight_lid
 test-list-host += bklight_passthru
 test-list-host += body_detection
@@ -40,6 +45,7 @@ test-list-host += gyro_cal
 test-list-host += hooks
 test-list-host += host_command
 test-list-host += i2c_bitbang
+test-list-host += icm426xx
 test-list-host += inductive_charging
 test-list-host += interrupt
 test-list-host += is_enabled
@@ -50,8 +56,10 @@ test-list-host += kb_mkbp
 #test-list-host += kb_scan	# crbug.com/976974
 test-list-host += lid_sw
 test-list-host += lightbar
+test-list-host += lsm6dsm
 test-list-host += mag_cal
 test-list-host += math_util
+test-list-host += memmap
 test-list-host += motion_angle
 test-list-host += motion_angle_tablet
 test-list-host += motion_lid
@@ -59,9 +67,11 @@ test-list-host += motion_sense_fifo
 test-list-host += mutex
 test-list-host += newton_fit
 test-list-host += online_calibration
+test-list-host += peci
 test-list-host += pingpong
 test-list-host += power_button
 test-list-host += printf
+test-list-host += profiler
 test-list-host += queue
 test-list-host += rsa
 test-list-host += rsa3
@@ -70,9 +80,13 @@ test-list-host += sbs_charging_v2
 test-list-host += sha256
 test-list-host += sha256_unrolled
 test-list-host += shmalloc
+test-list-host += shmalloc_slab
+test-list-host += soc_power_limit
+test-list-host += stack_watch
 test-list-host += static_if
 test-list-host += static_if_error
 test-list-host += system
+test-list-host += task_trace
 test-list-host += thermal
 test-list-host += timer_dos
 test-list-host += uptime
@@ -100,6 +114,7 @@ test-list-host += usb_pe_drp_noextended
 test-list-host += utils
 test-list-host += utils_str
 test-list-host += vboot
+test-list-host += vboot_hash
 test-list-host += x25519
 test-list-host += stillness_detector
 endif
@@ -120,9 +135,14 @@ cov-dont-test += fpsensor_state
 cov-test-list-host = $(filter-out $(cov-dont-test), $(test-list-host))
 
 accel_cal-y=accel_cal.o
+acpi-y=acpi.o
 aes-y=aes.o
+aes_ghash8-y=aes.o
 base32-y=base32.o
+bmi260-y=bmi260.o
 battery_get_params_smart-y=battery_get_params_smart.o
+benchmark_crypto-y=benchmark_crypto.o
+benchmark_lib-y=benchmark_lib.o
 bklight_lid-y=bklight_lid.o
 bklight_passthru-y=bklight_passthru.o
 body_detection-y=body_detection.o body_detection_data_literals.o motion_common.o
@@ -148,6 +168,7 @@ gyro_cal-y=gyro_cal.o
 hooks-y=hooks.o
 host_command-y=host_command.o
 i2c_bitbang-y=i2c_bitbang.o
+icm426xx-y=icm426xx.o
 inductive_charging-y=inductive_charging.o
 interrupt-y=interrupt.o
 is_enabled-y=is_enabled.o
@@ -156,8 +177,10 @@ kb_mkbp-y=kb_mkbp.o
 kb_scan-y=kb_scan.o
 lid_sw-y=lid_sw.o
 lightbar-y=lightbar.o
+lsm6dsm-y=lsm6dsm.o
 mag_cal-y=mag_cal.o
 math_util-y=math_util.o
+memmap-y=memmap.o
 motion_angle-y=motion_angle.o motion_angle_data_literals.o motion_common.o
 motion_angle_tablet-y=motion_angle_tablet.o motion_angle_data_literals_tablet.o motion_common.o
 motion_lid-y=motion_lid.o
@@ -167,10 +190,12 @@ kasa-y=kasa.o
 mpu-y=mpu.o
 mutex-y=mutex.o
 newton_fit-y=newton_fit.o
+peci-y=peci.o
 pingpong-y=pingpong.o
 power_button-y=power_button.o
 powerdemo-y=powerdemo.o
 printf-y=printf.o
+profiler-y=profiler.o
 queue-y=queue.o
 rollback-y=rollback.o
 rollback_entropy-y=rollback_entropy.o
@@ -183,10 +208,14 @@ sbs_charging_v2-y=sbs_charging_v2.o
 sha256-y=sha256.o
 sha256_unrolled-y=sha256.o
 shmalloc-y=shmalloc.o
+shmalloc_slab-y=shmalloc.o
+soc_power_limit-y=soc_power_limit.o
+stack_watch-y=stack_watch.o
 static_if-y=static_if.o
 stm32f_rtc-y=stm32f_rtc.o
 stress-y=stress.o
 system-y=system.o
+task_trace-y=task_trace.o
 thermal-y=thermal.o
 timer_calib-y=timer_calib.o
 timer_dos-y=timer_dos.o
@@ -216,6 +245,7 @@ usb_tcpmv2_tcpci-y=usb_tcpmv2_tcpci.o vpd_api.o usb_sm_checks.o
 utils-y=utils.o
 utils_str-y=utils_str.o
 vboot-y=vboot.o
+vboot_hash-y=vboot_hash.o
 float-y=fp.o
 fp-y=fp.o
 x25519-y=x25519.o
@@ -787,6 +787,72 @@ static int test_unknown_dualrole_capability(void)
 	return EC_SUCCESS;
 }
 
+static int test_refresh_coalescing(void)
+{
+	struct charge_manager_stats before, after;
+	struct charge_port_info charge;
+	int ports = board_get_usb_pd_port_count();
+	int i, j;
+
+	/* Initialize table to no charge. */
+	initialize_charge_table(0, 5000, 5000);
+	TEST_ASSERT(active_charge_port == CHARGE_PORT_NONE);
+
+	/*
+	 * Report a charge on every supplier of every port in one burst, and
+	 * verify that the whole burst is handled by a single refresh.
+	 */
+	charge_manager_get_stats(&before);
+	charge.voltage = 5000;
+	for (i = 0; i < ports; ++i)
+		for (j = 0; j < CHARGE_SUPPLIER_COUNT; ++j) {
+			charge.current = 100 * (i + 1) + 10 * j;
+			charge_manager_update_charge(j, i, &charge);
+		}
+	wait_for_charge_manager_refresh();
+	charge_manager_get_stats(&after);
+	TEST_ASSERT(after.updates - before.updates ==
+		    ports * CHARGE_SUPPLIER_COUNT);
+	TEST_ASSERT(after.refresh_requests - before.refresh_requests ==
+		    ports * CHARGE_SUPPLIER_COUNT);
+	TEST_ASSERT(after.refreshes - before.refreshes == 1);
+
+	/* Highest priority supplier wins, with the most power on the last. */
+	TEST_ASSERT(active_charge_port == ports - 1);
+	TEST_ASSERT(active_charge_limit == 100 * ports);
+
+	/* Remove the top supplier of the active port. */
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST1, ports - 1, NULL);
+	wait_for_charge_manager_refresh();
+	TEST_ASSERT(active_charge_port == ports - 2);
+	TEST_ASSERT(active_charge_limit == 100 * (ports - 1));
+
+	/*
+	 * Remove the top supplier everywhere. The most powerful of the next
+	 * priority level, on the last port, must take over.
+	 */
+	charge_manager_get_stats(&before);
+	for (i = 0; i < ports; ++i)
+		charge_manager_update_charge(CHARGE_SUPPLIER_TEST1, i, NULL);
+	wait_for_charge_manager_refresh();
+	charge_manager_get_stats(&after);
+	TEST_ASSERT(after.refreshes - before.refreshes == 1);
+	TEST_ASSERT(active_charge_port == ports - 1);
+	TEST_ASSERT(active_charge_limit ==
+		    100 * ports + 10 * CHARGE_SUPPLIER_TEST4);
+
+	/* Lower the power of that supplier, its peer on the port wins. */
+	charge.current = 100;
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST4, ports - 1,
+				     &charge);
+	wait_for_charge_manager_refresh();
+	TEST_ASSERT(active_charge_port == ports - 1);
+	TEST_ASSERT(active_charge_limit ==
+		    100 * ports + 10 * CHARGE_SUPPLIER_TEST3);
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -800,6 +866,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_dual_role);
 	RUN_TEST(test_rejected_port);
 	RUN_TEST(test_unknown_dualrole_capability);
+	RUN_TEST(test_refresh_coalescing);
 
 	test_print_result();
 }
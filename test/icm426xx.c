@@ -0,0 +1,286 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for draining the ICM-426xx FIFO, with the chip mocked on I2C.
+ */
+
+#include "accelgyro.h"
+#include "common.h"
+#include "driver/accelgyro_icm_common.h"
+#include "driver/accelgyro_icm426xx.h"
+#include "i2c.h"
+#include "motion_sense.h"
+#include "motion_sense_fifo.h"
+#include "task.h"
+#include "test_util.h"
+#include "util.h"
+
+static struct mutex g_base_mutex;
+static struct icm_drv_data_t g_icm426xx_data;
+
+struct motion_sensor_t motion_sensors[] = {
+	[BASE_ACCEL] = {
+		.name = "Base Accel",
+		.chip = MOTIONSENSE_CHIP_ICM426XX,
+		.type = MOTIONSENSE_TYPE_ACCEL,
+		.drv = &icm426xx_drv,
+		.mutex = &g_base_mutex,
+		.drv_data = &g_icm426xx_data,
+		.port = I2C_PORT_ACCEL,
+		.i2c_spi_addr_flags = ICM426XX_ADDR0_FLAGS,
+		.oversampling_ratio = 1,
+	},
+	[BASE_GYRO] = {
+		.name = "Base Gyro",
+		.chip = MOTIONSENSE_CHIP_ICM426XX,
+		.type = MOTIONSENSE_TYPE_GYRO,
+		.drv = &icm426xx_drv,
+		.mutex = &g_base_mutex,
+		.drv_data = &g_icm426xx_data,
+		.port = I2C_PORT_ACCEL,
+		.i2c_spi_addr_flags = ICM426XX_ADDR0_FLAGS,
+		.oversampling_ratio = 1,
+	},
+};
+
+const unsigned int motion_sensor_count = ARRAY_SIZE(motion_sensors);
+
+uint32_t mkbp_last_event_time;
+
+/*****************************************************************************/
+/* Mock chip */
+
+/* FIFO packet headers */
+#define HEADER_EMPTY	0x80
+#define HEADER_ACCEL	0x40
+#define HEADER_GYRO	0x20
+
+static uint8_t fifo[1024];
+static int fifo_len, fifo_pos;
+
+static int reg_addr;
+static int int_status;
+static int data_reads, max_read;
+
+static int icm426xx_i2c_xfer(int port, uint16_t addr_flags,
+			     const uint8_t *out, int out_size,
+			     uint8_t *in, int in_size, int flags)
+{
+	int i;
+
+	if (port != I2C_PORT_ACCEL || addr_flags != ICM426XX_ADDR0_FLAGS)
+		return EC_ERROR_INVAL;
+
+	/* Register writes are ignored */
+	if (out_size != 1 || !in)
+		return EC_SUCCESS;
+
+	reg_addr = *out;
+	switch (reg_addr) {
+	case ICM426XX_REG_INT_STATUS:
+		in[0] = int_status;
+		break;
+	case ICM426XX_REG_FIFO_COUNT:
+		in[0] = (fifo_len - fifo_pos) & 0xff;
+		if (in_size > 1)
+			in[1] = (fifo_len - fifo_pos) >> 8;
+		break;
+	case ICM426XX_REG_FIFO_DATA:
+		data_reads++;
+		max_read = MAX(max_read, in_size);
+		/* Partial read mode: a cut packet continues on the next read */
+		for (i = 0; i < in_size; i++)
+			in[i] = fifo_pos + i < fifo_len ?
+				fifo[fifo_pos + i] : HEADER_EMPTY;
+		fifo_pos = MIN(fifo_pos + in_size, fifo_len);
+		break;
+	default:
+		memset(in, 0, in_size);
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(icm426xx_i2c_xfer);
+
+static void put_xyz(uint8_t *p, int x, int y, int z)
+{
+	p[0] = x & 0xff;
+	p[1] = (x >> 8) & 0xff;
+	p[2] = y & 0xff;
+	p[3] = (y >> 8) & 0xff;
+	p[4] = z & 0xff;
+	p[5] = (z >> 8) & 0xff;
+}
+
+/* An accel only packet, with values from n */
+static void fifo_add_accel(int n)
+{
+	uint8_t *p = &fifo[fifo_len];
+
+	memset(p, 0, 8);
+	p[0] = HEADER_ACCEL;
+	put_xyz(&p[1], n, n + 1, n + 2);
+	fifo_len += 8;
+}
+
+/* An accel and gyro packet, with values from n */
+static void fifo_add_both(int n)
+{
+	uint8_t *p = &fifo[fifo_len];
+
+	memset(p, 0, 16);
+	p[0] = HEADER_ACCEL | HEADER_GYRO;
+	put_xyz(&p[1], n, n + 1, n + 2);
+	put_xyz(&p[7], n + 10, n + 11, n + 12);
+	fifo_len += 16;
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static struct ec_response_motion_sensor_data data[CONFIG_ACCEL_FIFO_SIZE];
+static uint16_t data_bytes_read;
+
+/* Commit the data staged, read it back, and drop the timestamps */
+static int read_samples(void)
+{
+	int i, count, samples = 0;
+
+	motion_sense_fifo_commit_data();
+	count = motion_sense_fifo_read(sizeof(data), CONFIG_ACCEL_FIFO_SIZE,
+				       data, &data_bytes_read);
+	for (i = 0; i < count; i++)
+		if (!(data[i].flags & MOTIONSENSE_SENSOR_FLAG_TIMESTAMP))
+			data[samples++] = data[i];
+	return samples;
+}
+
+static int fifo_interrupt(void)
+{
+	uint32_t event = CONFIG_ACCELGYRO_ICM426XX_INT_EVENT;
+
+	return motion_sensors[0].drv->irq_handler(&motion_sensors[0], &event);
+}
+
+static int test_drain_bursts(void)
+{
+	struct motion_sense_fifo_drain_stats *stats =
+		&motion_sensors[0].drain_stats[0];
+	int i, n = 10;
+
+	/* Packets of 8 and 16 bytes, so reads end in the middle of one */
+	fifo_add_accel(0);
+	for (i = 0; i < n; i++)
+		fifo_add_both(i * 100);
+
+	/* All of it in one call, in reads as large as the buffer */
+	TEST_EQ(fifo_interrupt(), EC_SUCCESS, "%d");
+	TEST_EQ(fifo_pos, fifo_len, "%d");
+	TEST_EQ(max_read, CONFIG_ACCEL_FIFO_DRAIN_SIZE, "%d");
+	TEST_EQ(data_reads, DIV_ROUND_UP(fifo_len,
+					 CONFIG_ACCEL_FIFO_DRAIN_SIZE), "%d");
+
+	TEST_EQ(read_samples(), 1 + 2 * n, "%d");
+	TEST_EQ(data[0].sensor_num, 0, "%d");
+	TEST_EQ(data[0].data[Z], 2, "%d");
+	for (i = 0; i < n; i++) {
+		TEST_EQ(data[1 + 2 * i].sensor_num, 0, "%d");
+		TEST_EQ(data[1 + 2 * i].data[X], i * 100, "%d");
+		TEST_EQ(data[2 + 2 * i].sensor_num, 1, "%d");
+		TEST_EQ(data[2 + 2 * i].data[Z], i * 100 + 12, "%d");
+	}
+
+	TEST_EQ(stats->drains, 1, "%u");
+	TEST_EQ(stats->bursts, data_reads, "%u");
+	TEST_EQ(stats->frames, 1 + n, "%u");
+	TEST_EQ(stats->bytes, fifo_len, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_invalid_data(void)
+{
+	fifo_add_both(0);
+	/* The accel has no data yet, the gyro has */
+	put_xyz(&fifo[fifo_len - 15], ICM426XX_INVALID_DATA,
+		ICM426XX_INVALID_DATA, ICM426XX_INVALID_DATA);
+	fifo_add_both(100);
+
+	TEST_EQ(fifo_interrupt(), EC_SUCCESS, "%d");
+	TEST_EQ(read_samples(), 3, "%d");
+	TEST_EQ(data[0].sensor_num, 1, "%d");
+	TEST_EQ(data[0].data[X], 10, "%d");
+	TEST_EQ(data[1].sensor_num, 0, "%d");
+	TEST_EQ(data[1].data[X], 100, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_bad_header(void)
+{
+	const uint8_t bad[8] = { 0 };
+
+	fifo_add_both(0);
+	memcpy(&fifo[fifo_len], bad, sizeof(bad));
+	fifo_len += sizeof(bad);
+	fifo_add_both(100);
+
+	/* Reported, and the packets before it are kept */
+	TEST_EQ(fifo_interrupt(), EC_ERROR_INVAL, "%d");
+	TEST_EQ(read_samples(), 2, "%d");
+	TEST_EQ(data[1].data[Z], 12, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_no_fifo_interrupt(void)
+{
+	fifo_add_both(0);
+	int_status = 0;
+
+	TEST_EQ(fifo_interrupt(), EC_SUCCESS, "%d");
+	TEST_EQ(data_reads, 0, "%d");
+	TEST_EQ(read_samples(), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void before_test(void)
+{
+	int i;
+
+	fifo_len = fifo_pos = 0;
+	int_status = ICM426XX_FIFO_THS_INT;
+	data_reads = max_read = 0;
+
+	memset(&g_icm426xx_data, 0, sizeof(g_icm426xx_data));
+	g_icm426xx_data.accel = &motion_sensors[BASE_ACCEL];
+	g_icm426xx_data.gyro = &motion_sensors[BASE_GYRO];
+	for (i = 0; i < ARRAY_SIZE(g_icm426xx_data.saved_data); i++) {
+		g_icm426xx_data.saved_data[i].scale[X] =
+			MOTION_SENSE_DEFAULT_SCALE;
+		g_icm426xx_data.saved_data[i].scale[Y] =
+			MOTION_SENSE_DEFAULT_SCALE;
+		g_icm426xx_data.saved_data[i].scale[Z] =
+			MOTION_SENSE_DEFAULT_SCALE;
+	}
+	memset(motion_sensors[0].drain_stats, 0,
+	       sizeof(motion_sensors[0].drain_stats));
+
+	read_samples();
+	motion_sense_fifo_reset();
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	motion_sense_fifo_init();
+
+	RUN_TEST(test_drain_bursts);
+	RUN_TEST(test_invalid_data);
+	RUN_TEST(test_bad_header);
+	RUN_TEST(test_no_fifo_interrupt);
+
+	test_print_result();
+}
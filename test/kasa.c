@@ -62,12 +62,40 @@ static int test_kasa_calculate(void)
 	return EC_SUCCESS;
 }
 
+static int test_kasa_accumulate_batch(void)
+{
+	struct kasa_fit scalar, batch;
+	fp_t x[37], y[37], z[37];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(x); i++) {
+		x[i] = 0.01f + (i % 5) * 0.37f - 0.8f;
+		y[i] = -0.5f + (i % 7) * 0.21f;
+		z[i] = 0.99f - (i % 3) * 0.66f;
+	}
+
+	kasa_reset(&scalar);
+	for (i = 0; i < ARRAY_SIZE(x); i++)
+		kasa_accumulate(&scalar, x[i], y[i], z[i]);
+
+	/* In uneven chunks, it sums the same, bit for bit */
+	kasa_reset(&batch);
+	kasa_accumulate_batch(&batch, x, y, z, 10);
+	kasa_accumulate_batch(&batch, x + 10, y + 10, z + 10, 0);
+	kasa_accumulate_batch(&batch, x + 10, y + 10, z + 10, 27);
+	TEST_ASSERT_ARRAY_EQ((uint8_t *)&batch, (uint8_t *)&scalar,
+			     sizeof(scalar));
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
 
 	RUN_TEST(test_kasa_reset);
 	RUN_TEST(test_kasa_calculate);
+	RUN_TEST(test_kasa_accumulate_batch);
 
 	test_print_result();
 }
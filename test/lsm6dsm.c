@@ -0,0 +1,270 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for draining the LSM6DSM FIFO, with the chip mocked on I2C.
+ */
+
+#include "accelgyro.h"
+#include "common.h"
+#include "driver/accelgyro_lsm6dsm.h"
+#include "i2c.h"
+#include "motion_sense.h"
+#include "motion_sense_fifo.h"
+#include "task.h"
+#include "test_util.h"
+#include "util.h"
+
+static struct mutex g_base_mutex;
+static struct lsm6dsm_data g_lsm6dsm_data = LSM6DSM_DATA;
+
+struct motion_sensor_t motion_sensors[] = {
+	[BASE_ACCEL] = {
+		.name = "Base Accel",
+		.chip = MOTIONSENSE_CHIP_LSM6DSM,
+		.type = MOTIONSENSE_TYPE_ACCEL,
+		.drv = &lsm6dsm_drv,
+		.mutex = &g_base_mutex,
+		.drv_data = LSM6DSM_ST_DATA(g_lsm6dsm_data,
+					    MOTIONSENSE_TYPE_ACCEL),
+		.port = I2C_PORT_ACCEL,
+		.i2c_spi_addr_flags = LSM6DSM_ADDR0_FLAGS,
+		.oversampling_ratio = 1,
+	},
+	[BASE_GYRO] = {
+		.name = "Base Gyro",
+		.chip = MOTIONSENSE_CHIP_LSM6DSM,
+		.type = MOTIONSENSE_TYPE_GYRO,
+		.drv = &lsm6dsm_drv,
+		.mutex = &g_base_mutex,
+		.drv_data = LSM6DSM_ST_DATA(g_lsm6dsm_data,
+					    MOTIONSENSE_TYPE_GYRO),
+		.port = I2C_PORT_ACCEL,
+		.i2c_spi_addr_flags = LSM6DSM_ADDR0_FLAGS,
+		.oversampling_ratio = 1,
+	},
+};
+
+const unsigned int motion_sensor_count = ARRAY_SIZE(motion_sensors);
+
+uint32_t mkbp_last_event_time;
+
+/*****************************************************************************/
+/* Mock chip */
+
+static uint8_t fifo[1024];
+static int fifo_len, fifo_pos;
+/* Extra bytes the FIFO status reports, beyond the samples */
+static int fifo_len_extra;
+
+static int data_reads, max_read;
+
+static int lsm6dsm_i2c_xfer(int port, uint16_t addr_flags,
+			    const uint8_t *out, int out_size,
+			    uint8_t *in, int in_size, int flags)
+{
+	int i, words;
+
+	if (port != I2C_PORT_ACCEL || addr_flags != LSM6DSM_ADDR0_FLAGS)
+		return EC_ERROR_INVAL;
+
+	/* Register writes are ignored */
+	if (out_size != 1 || !in)
+		return EC_SUCCESS;
+
+	memset(in, 0, in_size);
+	switch (*out) {
+	case LSM6DSM_FIFO_STS1_ADDR:
+		/* Unread 16-bit words, then the pattern */
+		words = (fifo_len - fifo_pos + fifo_len_extra) / 2;
+		if (!words)
+			words = LSM6DSM_FIFO_EMPTY;
+		in[0] = words & 0xff;
+		if (in_size > 1)
+			in[1] = words >> 8;
+		break;
+	case LSM6DSM_FIFO_DATA_ADDR:
+		data_reads++;
+		max_read = MAX(max_read, in_size);
+		for (i = 0; i < in_size && fifo_pos + i < fifo_len; i++)
+			in[i] = fifo[fifo_pos + i];
+		fifo_pos = MIN(fifo_pos + in_size, fifo_len);
+		break;
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(lsm6dsm_i2c_xfer);
+
+/* A sample of 3 axes, with values from n */
+static void fifo_add_sample(int n)
+{
+	uint8_t *p = &fifo[fifo_len];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		p[2 * i] = n + i;
+		p[2 * i + 1] = 0;
+	}
+	fifo_len += OUT_XYZ_SIZE;
+}
+
+/* Samples of each sensor in the FIFO pattern */
+static void set_pattern(int accel, int gyro)
+{
+	struct lsm6dsm_fifo_data *config =
+		&g_lsm6dsm_data.accel_fifo_state->config;
+
+	config->samples_in_pattern[FIFO_DEV_ACCEL] = accel;
+	config->samples_in_pattern[FIFO_DEV_GYRO] = gyro;
+	config->total_samples_in_pattern = accel + gyro;
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static struct ec_response_motion_sensor_data data[CONFIG_ACCEL_FIFO_SIZE];
+static uint16_t data_bytes_read;
+
+/* Read back the data committed, and drop the timestamps */
+static int read_samples(void)
+{
+	int i, count, samples = 0;
+
+	count = motion_sense_fifo_read(sizeof(data), CONFIG_ACCEL_FIFO_SIZE,
+				       data, &data_bytes_read);
+	for (i = 0; i < count; i++)
+		if (!(data[i].flags & MOTIONSENSE_SENSOR_FLAG_TIMESTAMP))
+			data[samples++] = data[i];
+	return samples;
+}
+
+static int fifo_interrupt(void)
+{
+	uint32_t event = CONFIG_ACCEL_LSM6DSM_INT_EVENT;
+
+	return motion_sensors[0].drv->irq_handler(&motion_sensors[0], &event);
+}
+
+static int test_pattern(void)
+{
+	struct motion_sense_fifo_drain_stats *stats =
+		&motion_sensors[0].drain_stats[0];
+	int i, n = 4;
+
+	/* Accel at twice the gyro rate: gyro, accel, accel */
+	set_pattern(2, 1);
+	for (i = 0; i < 3 * n; i++)
+		fifo_add_sample(i * 8);
+
+	/* All of it in one call, in reads of whole samples */
+	TEST_EQ(fifo_interrupt(), EC_SUCCESS, "%d");
+	TEST_EQ(fifo_pos, fifo_len, "%d");
+	TEST_EQ(max_read % OUT_XYZ_SIZE, 0, "%d");
+	TEST_GT(max_read, CONFIG_ACCEL_FIFO_DRAIN_SIZE - OUT_XYZ_SIZE, "%d");
+	TEST_EQ(data_reads, DIV_ROUND_UP(fifo_len, max_read), "%d");
+
+	TEST_EQ(read_samples(), 3 * n, "%d");
+	for (i = 0; i < 3 * n; i++) {
+		TEST_EQ(data[i].sensor_num, i % 3 ? BASE_ACCEL : BASE_GYRO,
+			"%d");
+		TEST_EQ(data[i].data[X], i * 8, "%d");
+		TEST_EQ(data[i].data[Z], i * 8 + 2, "%d");
+	}
+
+	TEST_EQ(stats->drains, 1, "%u");
+	TEST_EQ(stats->bursts, data_reads, "%u");
+	TEST_EQ(stats->frames, 3 * n, "%u");
+	TEST_EQ(stats->bytes, fifo_len, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_discard(void)
+{
+	struct lsm6dsm_accel_fifo_state *state =
+		g_lsm6dsm_data.accel_fifo_state;
+	int i;
+
+	/* The first accel sample after an ODR change is dropped */
+	set_pattern(1, 1);
+	state->samples_to_discard[MOTIONSENSE_TYPE_ACCEL] = 1;
+	for (i = 0; i < 4; i++)
+		fifo_add_sample(i * 8);
+
+	TEST_EQ(fifo_interrupt(), EC_SUCCESS, "%d");
+	TEST_EQ(read_samples(), 3, "%d");
+	TEST_EQ(data[0].sensor_num, BASE_GYRO, "%d");
+	TEST_EQ(data[1].sensor_num, BASE_GYRO, "%d");
+	TEST_EQ(data[1].data[X], 16, "%d");
+	TEST_EQ(data[2].sensor_num, BASE_ACCEL, "%d");
+	TEST_EQ(data[2].data[X], 24, "%d");
+	TEST_EQ(state->samples_to_discard[MOTIONSENSE_TYPE_ACCEL], 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_partial_sample(void)
+{
+	/* A sample being written isn't read yet */
+	set_pattern(1, 1);
+	fifo_add_sample(0);
+	fifo_add_sample(8);
+	fifo_len_extra = 4;
+
+	TEST_EQ(fifo_interrupt(), EC_SUCCESS, "%d");
+	TEST_EQ(fifo_pos, fifo_len, "%d");
+	TEST_EQ(max_read, 2 * OUT_XYZ_SIZE, "%d");
+	TEST_EQ(read_samples(), 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_empty_pattern(void)
+{
+	int i;
+
+	/* No sensor in the pattern: the samples are dropped, not left */
+	set_pattern(0, 0);
+	for (i = 0; i < 20; i++)
+		fifo_add_sample(i * 8);
+
+	TEST_EQ(fifo_interrupt(), EC_SUCCESS, "%d");
+	TEST_EQ(fifo_pos, fifo_len, "%d");
+	TEST_EQ(read_samples(), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void before_test(void)
+{
+	int i;
+
+	fifo_len = fifo_pos = fifo_len_extra = 0;
+	data_reads = max_read = 0;
+
+	memset(g_lsm6dsm_data.accel_fifo_state, 0,
+	       sizeof(*g_lsm6dsm_data.accel_fifo_state));
+	for (i = 0; i < ARRAY_SIZE(g_lsm6dsm_data.st_data); i++) {
+		g_lsm6dsm_data.st_data[i].resol = 16;
+		g_lsm6dsm_data.st_data[i].base.range = 4;
+	}
+	memset(motion_sensors[0].drain_stats, 0,
+	       sizeof(motion_sensors[0].drain_stats));
+
+	read_samples();
+	motion_sense_fifo_reset();
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	motion_sense_fifo_init();
+
+	RUN_TEST(test_pattern);
+	RUN_TEST(test_discard);
+	RUN_TEST(test_partial_sample);
+	RUN_TEST(test_empty_pattern);
+
+	test_print_result();
+}
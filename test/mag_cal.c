@@ -81,11 +81,53 @@ static int test_mag_cal_computes_bias(void)
 	return EC_SUCCESS;
 }
 
+static int test_mag_cal_update_batch(void)
+{
+	struct mag_cal_t scalar, batch;
+	int x[ARRAY_SIZE(samples) * 2];
+	int y[ARRAY_SIZE(samples) * 2];
+	int z[ARRAY_SIZE(samples) * 2];
+	int i, n = ARRAY_SIZE(x);
+
+	for (i = 0; i < n; i++) {
+		x[i] = samples[i % ARRAY_SIZE(samples)][X];
+		y[i] = samples[i % ARRAY_SIZE(samples)][Y];
+		z[i] = samples[i % ARRAY_SIZE(samples)][Z];
+	}
+
+	/* Not on a batch boundary, so the first call ends one */
+	memset(&scalar, 0, sizeof(scalar));
+	init_mag_cal(&scalar);
+	scalar.batch_size = ARRAY_SIZE(samples) - 3;
+	batch = scalar;
+	for (i = 0; i < n; i++) {
+		intv3_t v = { x[i], y[i], z[i] };
+
+		mag_cal_update(&scalar, v);
+	}
+
+	TEST_EQ(1, mag_cal_update_batch(&batch, x, y, z, 30), "%d");
+	TEST_EQ(0, mag_cal_update_batch(&batch, x + 30, y + 30, z + 30, 10),
+		"%d");
+	mag_cal_update_batch(&batch, x + 40, y + 40, z + 40, n - 40);
+
+	/* Bit-exact with the scalar path */
+	TEST_ASSERT_ARRAY_EQ((uint8_t *)&batch.kasa_fit,
+			     (uint8_t *)&scalar.kasa_fit,
+			     sizeof(scalar.kasa_fit));
+	TEST_ASSERT(batch.radius == scalar.radius);
+	TEST_ASSERT_ARRAY_EQ(batch.bias, scalar.bias, ARRAY_SIZE(scalar.bias));
+	TEST_EQ(batch.kasa_fit.nsamples, n % scalar.batch_size, "%d");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
 
 	RUN_TEST(test_mag_cal_computes_bias);
+	RUN_TEST(test_mag_cal_update_batch);
 
 	test_print_result();
 }
@@ -0,0 +1,261 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for publishing data in the host memory map.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "memmap.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Stage a battery block with every field derived from n */
+static void stage(struct memmap_battery *b, int n)
+{
+	memmap_stage_battery(b);
+	b->volt = n;
+	b->rate = n;
+	b->cap = n;
+	b->flag = n;
+	b->dcap = n;
+	b->dvlt = n;
+	b->lfcc = n;
+	b->ccnt = n;
+	memset(b->mfgr, 'A' + n % 26, EC_MEMMAP_TEXT_MAX);
+	memset(b->model, 'A' + n % 26, EC_MEMMAP_TEXT_MAX);
+	memset(b->serial, 'A' + n % 26, EC_MEMMAP_TEXT_MAX);
+	memset(b->type, 'A' + n % 26, EC_MEMMAP_TEXT_MAX);
+}
+
+/* Publish a block staged by stage(), with no other update in between */
+static void publish(const struct memmap_battery *b)
+{
+	memmap_publish_battery(b, *host_get_memmap(EC_MEMMAP_BATT_FLAG));
+}
+
+/* Whether a battery block read is all from one update */
+static int consistent(const struct memmap_battery *b)
+{
+	struct memmap_battery want;
+
+	stage(&want, b->volt);
+	want.count = b->count;
+	want.index = b->index;
+	want.reserved = b->reserved;
+
+	return !memcmp(b, &want, sizeof(want));
+}
+
+static int test_generation(void)
+{
+	struct memmap_battery b;
+	uint8_t gen = memmap_generation(MEMMAP_BLOCK_BATTERY);
+	uint8_t thermal = memmap_generation(MEMMAP_BLOCK_THERMAL);
+
+	TEST_EQ(*host_get_memmap(EC_MEMMAP_ID_VERSION), 2, "%d");
+	TEST_EQ(gen & 1, 0, "%d");
+	TEST_EQ(*host_get_memmap(EC_MEMMAP_BATTERY_GEN), gen, "%d");
+
+	memmap_write_begin(MEMMAP_BLOCK_BATTERY);
+	TEST_EQ(memmap_generation(MEMMAP_BLOCK_BATTERY), (uint8_t)(gen + 1),
+		"%d");
+	memmap_write_end(MEMMAP_BLOCK_BATTERY);
+	TEST_EQ(memmap_generation(MEMMAP_BLOCK_BATTERY), (uint8_t)(gen + 2),
+		"%d");
+
+	stage(&b, 1234);
+	publish(&b);
+	TEST_EQ(memmap_generation(MEMMAP_BLOCK_BATTERY), (uint8_t)(gen + 4),
+		"%d");
+	TEST_EQ(*(int *)host_get_memmap(EC_MEMMAP_BATT_CAP), 1234, "%d");
+
+	/* Other blocks are unchanged */
+	TEST_EQ(memmap_generation(MEMMAP_BLOCK_THERMAL), thermal, "%d");
+
+	return EC_SUCCESS;
+}
+
+/*
+ * The interrupt generator either reads the battery block directly, as the
+ * ACPI port does, or publishes it, at any point in the test runner's reads
+ * or updates.
+ */
+static void (*volatile isr)(void);
+static int isr_count;
+static int isr_odd;
+static int isr_torn;
+
+static void read_isr(void)
+{
+	struct memmap_battery b;
+
+	memcpy(&b, host_get_memmap(EC_MEMMAP_BATT_VOLT), sizeof(b));
+	if (memmap_generation(MEMMAP_BLOCK_BATTERY) & 1)
+		isr_odd++;
+	if (!consistent(&b))
+		isr_torn++;
+	isr_count++;
+}
+
+static void publish_isr(void)
+{
+	struct memmap_battery b;
+
+	stage(&b, isr_count++);
+	publish(&b);
+}
+
+static void run_isr(void)
+{
+	if (isr)
+		isr();
+}
+
+void interrupt_generator(void)
+{
+	while (1) {
+		udelay(20 + prng_no_seed() % 64);
+		task_trigger_test_interrupt(run_isr);
+	}
+}
+
+static int test_interrupt_reader(void)
+{
+	struct memmap_battery b;
+	timestamp_t deadline;
+	volatile int spin;
+	int n = 0;
+
+	isr_count = 0;
+	isr = read_isr;
+	deadline.val = get_time().val + SECOND / 2;
+	while (!timestamp_expired(deadline, NULL)) {
+		stage(&b, n++);
+		publish(&b);
+		/* Let the interrupts in between updates, too */
+		for (spin = prng_no_seed() % 4096; spin; spin--)
+			;
+	}
+	isr = NULL;
+
+	ccprintf("%d updates, %d reads in interrupts\n", n, isr_count);
+	TEST_ASSERT(isr_count > 0);
+	TEST_EQ(isr_odd, 0, "%d");
+	TEST_EQ(isr_torn, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_interrupt_writer(void)
+{
+	struct memmap_battery b;
+	timestamp_t deadline;
+	int reads = 0, retries = 0, torn = 0;
+
+	isr_count = 0;
+	isr = publish_isr;
+	deadline.val = get_time().val + SECOND / 2;
+	while (!timestamp_expired(deadline, NULL)) {
+		retries += memmap_read(EC_MEMMAP_BATT_VOLT, &b, sizeof(b));
+		if (!consistent(&b))
+			torn++;
+		reads++;
+	}
+	isr = NULL;
+
+	ccprintf("%d updates in interrupts, %d reads, %d retried\n",
+		 isr_count, reads, retries);
+	TEST_ASSERT(isr_count > 0);
+	TEST_EQ(torn, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_others_fields(void)
+{
+	struct memmap_battery b;
+	uint8_t staged_flag;
+
+	/* extpower and battery.c update the block between stage and publish */
+	memmap_stage_battery(&b);
+	staged_flag = b.flag;
+	b.cap = 77;
+	b.flag = EC_BATT_FLAG_BATT_PRESENT | EC_BATT_FLAG_CHARGING;
+
+	memmap_write_begin(MEMMAP_BLOCK_BATTERY);
+	*host_get_memmap(EC_MEMMAP_BATT_FLAG) = staged_flag ^
+						EC_BATT_FLAG_AC_PRESENT;
+	*host_get_memmap(EC_MEMMAP_BATT_INDEX) = 1;
+	*host_get_memmap(EC_MEMMAP_BATT_COUNT) = 2;
+	memmap_write_end(MEMMAP_BLOCK_BATTERY);
+
+	memmap_publish_battery(&b, staged_flag);
+	TEST_EQ(*(int *)host_get_memmap(EC_MEMMAP_BATT_CAP), 77, "%d");
+	TEST_EQ(*host_get_memmap(EC_MEMMAP_BATT_FLAG),
+		((staged_flag ^ EC_BATT_FLAG_AC_PRESENT) &
+		 EC_BATT_FLAG_AC_PRESENT) |
+		EC_BATT_FLAG_BATT_PRESENT | EC_BATT_FLAG_CHARGING, "0x%x");
+	TEST_EQ(*host_get_memmap(EC_MEMMAP_BATT_INDEX), 1, "%d");
+	TEST_EQ(*host_get_memmap(EC_MEMMAP_BATT_COUNT), 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_irq_state(void)
+{
+	/* Interrupts stay disabled if they were before the update */
+	interrupt_disable();
+	memmap_write_begin(MEMMAP_BLOCK_THERMAL);
+	memmap_write_end(MEMMAP_BLOCK_THERMAL);
+	TEST_ASSERT(!is_interrupt_enabled());
+	interrupt_enable();
+
+	memmap_write_begin(MEMMAP_BLOCK_THERMAL);
+	TEST_ASSERT(!is_interrupt_enabled());
+	memmap_write_end(MEMMAP_BLOCK_THERMAL);
+	TEST_ASSERT(is_interrupt_enabled());
+
+	return EC_SUCCESS;
+}
+
+static int test_host_command(void)
+{
+	struct ec_params_read_memmap p = {
+		.offset = EC_MEMMAP_BATT_VOLT,
+		.size = sizeof(struct memmap_battery),
+	};
+	struct memmap_battery b;
+
+	stage(&b, 42);
+	publish(&b);
+	memset(&b, 0, sizeof(b));
+
+	TEST_EQ(test_send_host_command(EC_CMD_READ_MEMMAP, 0, &p, sizeof(p),
+				       &b, sizeof(b)),
+		EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(consistent(&b));
+	TEST_EQ(b.cap, 42, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_generation);
+	RUN_TEST(test_interrupt_reader);
+	RUN_TEST(test_interrupt_writer);
+	RUN_TEST(test_others_fields);
+	RUN_TEST(test_irq_state);
+	RUN_TEST(test_host_command);
+
+	test_print_result();
+}
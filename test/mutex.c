@@ -59,6 +59,101 @@ int mutex_second_task(void *unused)
 	return EC_SUCCESS;
 }
 
+/* Priority inversion: MTXL holds pi_mtx, MTXH waits, MTXM hogs the CPU */
+static struct mutex pi_mtx;
+#define PI_EVENT_YIELD TASK_EVENT_CUSTOM_BIT(0)
+/* Milliseconds of work of the medium priority task */
+#define MEDIUM_WORK_MS 50
+static volatile int medium_work;
+static volatile int medium_work_at_lock;
+
+int mutex_low_task(void *unused)
+{
+	while (1) {
+		task_wait_event(0);
+		mutex_lock(&pi_mtx);
+		ccprintf("MTXL: locked, waiting for a slow transfer\n");
+		task_wait_event(10 * MSEC);
+		ccprintf("MTXL: unlocking\n");
+		mutex_unlock(&pi_mtx);
+	}
+
+	return EC_SUCCESS;
+}
+
+int mutex_medium_task(void *unused)
+{
+	while (1) {
+		task_wait_event(0);
+		for (medium_work = 0; medium_work < MEDIUM_WORK_MS;
+		     medium_work++) {
+			udelay(MSEC);
+			/*
+			 * Stay ready, but let the scheduler run a higher
+			 * priority task; tasks aren't preempted on the
+			 * emulator.
+			 */
+			task_set_event(TASK_ID_MTXM, PI_EVENT_YIELD, 0);
+			task_wait_event_mask(PI_EVENT_YIELD, 0);
+		}
+		ccprintf("MTXM: done\n");
+	}
+
+	return EC_SUCCESS;
+}
+
+int mutex_high_task(void *unused)
+{
+	while (1) {
+		task_wait_event(0);
+		ccprintf("MTXH: locking...\n");
+		mutex_lock(&pi_mtx);
+		medium_work_at_lock = medium_work;
+		ccprintf("MTXH: got lock after %d ms of MTXM work\n",
+			 medium_work_at_lock);
+		mutex_unlock(&pi_mtx);
+		task_wake(TASK_ID_MTX1);
+	}
+
+	return EC_SUCCESS;
+}
+
+static int priority_inversion(void)
+{
+	/* MTXL locks the mutex, then MTXH waits on it while MTXM runs */
+	task_wake(TASK_ID_MTXL);
+	task_wait_event(MSEC);
+	medium_work_at_lock = -1;
+	task_wake(TASK_ID_MTXM);
+	task_wake(TASK_ID_MTXH);
+	task_wait_event(SECOND);
+
+	/*
+	 * MTXL inherits the priority of MTXH, so it releases the mutex as soon
+	 * as its transfer is done, not after MTXM is done.
+	 */
+	if (medium_work_at_lock < 0 || medium_work_at_lock >= MEDIUM_WORK_MS)
+		return EC_ERROR_UNKNOWN;
+
+#ifdef CONFIG_MUTEX_STATS
+	mutex_stats_print();
+	if (pi_mtx.stats.locks != 2 || pi_mtx.stats.contended != 1 ||
+	    pi_mtx.stats.hold_us_max < 10 * MSEC ||
+	    pi_mtx.stats.wait_us_max < 5 * MSEC)
+		return EC_ERROR_UNKNOWN;
+
+	/* A re-initialized mutex starts over, and is still listed once */
+	memset(&pi_mtx, 0, sizeof(pi_mtx));
+	mutex_lock(&pi_mtx);
+	mutex_unlock(&pi_mtx);
+	mutex_stats_print();
+	if (pi_mtx.stats.locks != 1 || pi_mtx.stats.contended != 0)
+		return EC_ERROR_UNKNOWN;
+#endif
+
+	return EC_SUCCESS;
+}
+
 int mutex_main_task(void *unused)
 {
 	task_id_t id = task_get_current();
@@ -103,7 +198,14 @@ int mutex_main_task(void *unused)
 		rdelay = prng(rdelay);
 	}
 
-	test_pass();
+	/* --- Priority inheritance --- */
+	ccprintf("Priority inversion :\n");
+	if (priority_inversion() == EC_SUCCESS) {
+		test_pass();
+	} else {
+		ccprintf("MTXH waited for MTXM\n");
+		test_fail();
+	}
 	task_wait_event(0);
 
 	return EC_SUCCESS;
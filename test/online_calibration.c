@@ -245,6 +245,33 @@ int test_mag_reading_updated_cal(void)
 	return EC_SUCCESS;
 }
 
+int test_mag_batch_updated_cal(void)
+{
+	struct mag_cal_t expected_results;
+	int x[] = { 207, -12, 3 };
+	int y[] = { -17, 198, -40 };
+	int z[] = { -37, 21, 220 };
+	uint32_t timestamps[3];
+	int i, rc;
+
+	init_mag_cal(&expected_results);
+	for (i = 0; i < ARRAY_SIZE(x); i++) {
+		intv3_t v = { x[i], y[i], z[i] };
+
+		mag_cal_update(&expected_results, v);
+		timestamps[i] = __hw_clock_source_read() + i * 10000;
+	}
+
+	rc = online_calibration_process_batch(&motion_sensors[LID], x, y, z,
+					      timestamps, ARRAY_SIZE(x));
+	TEST_EQ(rc, EC_SUCCESS, "%d");
+	TEST_ASSERT_ARRAY_EQ((uint8_t *)&expected_results.kasa_fit,
+			     (uint8_t *)&lid_mag_cal_data.kasa_fit,
+			     sizeof(expected_results.kasa_fit));
+
+	return EC_SUCCESS;
+}
+
 void before_test(void)
 {
 	mock_read_temp_results = NULL;
@@ -260,6 +287,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_read_temp_twice_after_cache_stale);
 	RUN_TEST(test_new_calibration_value);
 	RUN_TEST(test_mag_reading_updated_cal);
+	RUN_TEST(test_mag_batch_updated_cal);
 
 	test_print_result();
 }
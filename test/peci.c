@@ -0,0 +1,269 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test PECI transaction queue.
+ */
+
+#include "common.h"
+#include "mock/peci_mock.h"
+#include "peci.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define BUS_LATENCY_US 1000
+
+#define INDEX_PL1 0x1a
+#define INDEX_PL2 0x1b
+#define INDEX_PL4 0x3c
+
+static int done_count;
+static int done_rv[CONFIG_PECI_QUEUE_DEPTH + 1];
+static int done_order[CONFIG_PECI_QUEUE_DEPTH + 1];
+static int done_wrong_task;
+
+/* There's no chipset task; the CPU is always up. */
+__override int stop_read_peci_temp(void)
+{
+	return EC_SUCCESS;
+}
+
+static void write_done(int rv, const uint8_t *r_buf, void *priv)
+{
+	if (task_get_current() != TASK_ID_PECI)
+		done_wrong_task++;
+
+	if (done_count < ARRAY_SIZE(done_rv)) {
+		done_rv[done_count] = rv;
+		done_order[done_count] = (uintptr_t)priv;
+	}
+	done_count++;
+}
+
+static int submit_write(uint8_t index, uint32_t data, int retries)
+{
+	uint8_t w_buf[9] = { 0x00, index, 0x00, 0x00 };
+	struct peci_data peci = {
+		.cmd_code = PECI_CMD_WR_PKG_CFG,
+		.addr = PECI_TARGET_ADDRESS,
+		.w_len = sizeof(w_buf),
+		.r_len = 1,
+		.w_buf = w_buf,
+		.timeout_us = 200,
+	};
+	int i;
+
+	for (i = 0; i < 4; i++)
+		w_buf[4 + i] = data >> (i * 8);
+
+	return peci_queue_submit(&peci, retries, write_done,
+				 (void *)(uintptr_t)index);
+}
+
+static int read_pkg_config(uint8_t index, uint32_t *data)
+{
+	uint8_t w_buf[4] = { 0x00, index, 0x00, 0x00 };
+	uint8_t r_buf[5] = { 0 };
+	struct peci_data peci = {
+		.cmd_code = PECI_CMD_RD_PKG_CFG,
+		.addr = PECI_TARGET_ADDRESS,
+		.w_len = sizeof(w_buf),
+		.r_len = sizeof(r_buf),
+		.w_buf = w_buf,
+		.r_buf = r_buf,
+		.timeout_us = 200,
+	};
+	int rv;
+
+	rv = peci_queue_transaction(&peci, 0);
+	*data = r_buf[1] | r_buf[2] << 8 | r_buf[3] << 16 | r_buf[4] << 24;
+	return rv;
+}
+
+static void reset(void)
+{
+	mock_peci_reset();
+	mock_peci.latency_us = BUS_LATENCY_US;
+	peci_clear_stats();
+	done_count = 0;
+	/* Let the cached temperature expire */
+	msleep(CONFIG_PECI_TEMP_CACHE_US / MSEC + 1);
+}
+
+static int test_sync_transaction(void)
+{
+	struct peci_stats s;
+	uint32_t data;
+
+	reset();
+	mock_peci.pkg_config[0x10] = 0x00640000;
+
+	TEST_EQ(read_pkg_config(0x10, &data), EC_SUCCESS, "%d");
+	TEST_EQ(data, 0x00640000, "0x%08x");
+	TEST_EQ(mock_peci.transactions[PECI_CMD_RD_PKG_CFG], 1, "%d");
+
+	peci_get_stats(&s);
+	TEST_EQ(s.cmd[PECI_STAT_RD_PKG_CFG].count, 1, "%d");
+	TEST_EQ(s.cmd[PECI_STAT_RD_PKG_CFG].errors, 0, "%d");
+	TEST_ASSERT(s.cmd[PECI_STAT_RD_PKG_CFG].max_us >= BUS_LATENCY_US);
+
+	return EC_SUCCESS;
+}
+
+static int test_async_submit(void)
+{
+	timestamp_t start;
+	struct peci_stats s;
+
+	reset();
+
+	/* Submitting doesn't wait for the bus */
+	start = get_time();
+	TEST_EQ(submit_write(INDEX_PL1, 28 << 3, 0), EC_SUCCESS, "%d");
+	TEST_EQ(submit_write(INDEX_PL2, 64 << 3, 0), EC_SUCCESS, "%d");
+	TEST_EQ(submit_write(INDEX_PL4, 121 << 3, 0), EC_SUCCESS, "%d");
+	TEST_ASSERT(time_since32(start) < BUS_LATENCY_US);
+	TEST_EQ(done_count, 0, "%d");
+
+	msleep(10);
+	TEST_EQ(done_count, 3, "%d");
+	TEST_EQ(done_order[0], INDEX_PL1, "0x%x");
+	TEST_EQ(done_order[1], INDEX_PL2, "0x%x");
+	TEST_EQ(done_order[2], INDEX_PL4, "0x%x");
+	TEST_EQ(done_rv[2], EC_SUCCESS, "%d");
+	TEST_EQ(mock_peci.pkg_config[INDEX_PL4], 121 << 3, "%d");
+	TEST_EQ(mock_peci.max_busy, 1, "%d");
+	TEST_EQ(done_wrong_task, 0, "%d");
+
+	peci_get_stats(&s);
+	TEST_EQ(s.cmd[PECI_STAT_WR_PKG_CFG].count, 3, "%d");
+	TEST_EQ(s.max_depth, 3, "%d");
+	/* The last write queued behind the other two */
+	TEST_ASSERT(s.max_wait_us >= 2 * BUS_LATENCY_US);
+
+	return EC_SUCCESS;
+}
+
+static int test_ordering(void)
+{
+	uint32_t data;
+
+	reset();
+
+	/* A blocking read completes after the writes queued before it */
+	TEST_EQ(submit_write(INDEX_PL1, 15 << 3, 0), EC_SUCCESS, "%d");
+	TEST_EQ(submit_write(INDEX_PL2, 20 << 3, 0), EC_SUCCESS, "%d");
+	TEST_EQ(read_pkg_config(INDEX_PL2, &data), EC_SUCCESS, "%d");
+	TEST_EQ(done_count, 2, "%d");
+	TEST_EQ(mock_peci.wr_log_count, 2, "%d");
+	TEST_EQ(mock_peci.wr_log[0], INDEX_PL1, "0x%x");
+	TEST_EQ(data, 20 << 3, "%d");
+	TEST_EQ(mock_peci.max_busy, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_retry(void)
+{
+	struct peci_stats s;
+
+	reset();
+
+	/* One failure, one retry: succeeds without bothering the caller */
+	mock_peci.fail_count = 1;
+	TEST_EQ(submit_write(INDEX_PL1, 28 << 3, 1), EC_SUCCESS, "%d");
+	msleep(10);
+	TEST_EQ(done_count, 1, "%d");
+	TEST_EQ(done_rv[0], EC_SUCCESS, "%d");
+	TEST_EQ(mock_peci.transactions[PECI_CMD_WR_PKG_CFG], 2, "%d");
+
+	/* Out of retries: the failure is reported to the callback */
+	mock_peci.fail_count = 3;
+	TEST_EQ(submit_write(INDEX_PL1, 28 << 3, 1), EC_SUCCESS, "%d");
+	msleep(10);
+	TEST_EQ(done_count, 2, "%d");
+	TEST_NE(done_rv[1], EC_SUCCESS, "%d");
+
+	peci_get_stats(&s);
+	TEST_EQ(s.cmd[PECI_STAT_WR_PKG_CFG].count, 2, "%d");
+	TEST_EQ(s.cmd[PECI_STAT_WR_PKG_CFG].retries, 2, "%d");
+	TEST_EQ(s.cmd[PECI_STAT_WR_PKG_CFG].errors, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_queue_full(void)
+{
+	struct peci_stats s;
+	int i, rejected = 0;
+
+	reset();
+
+	for (i = 0; i < CONFIG_PECI_QUEUE_DEPTH + 1; i++)
+		if (submit_write(INDEX_PL1, i, 0) == EC_ERROR_BUSY)
+			rejected++;
+	TEST_EQ(rejected, 1, "%d");
+
+	peci_get_stats(&s);
+	TEST_EQ(s.queue_full, 1, "%d");
+	TEST_EQ(s.max_depth, CONFIG_PECI_QUEUE_DEPTH, "%d");
+
+	msleep(CONFIG_PECI_QUEUE_DEPTH * BUS_LATENCY_US / MSEC + 10);
+	TEST_EQ(done_count, CONFIG_PECI_QUEUE_DEPTH, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_temp_cache(void)
+{
+	struct peci_stats s;
+	int t;
+
+	reset();
+
+	mock_peci.cpu_temp_c = 60;
+	TEST_EQ(peci_temp_sensor_get_val(0, &t), EC_SUCCESS, "%d");
+	TEST_EQ(t, C_TO_K(60), "%d");
+	TEST_EQ(mock_peci.transactions[PECI_CMD_GET_TEMP], 1, "%d");
+
+	/* Within the freshness window: no bus traffic */
+	mock_peci.cpu_temp_c = 70;
+	TEST_EQ(peci_temp_sensor_get_val(0, &t), EC_SUCCESS, "%d");
+	TEST_EQ(t, C_TO_K(60), "%d");
+	TEST_EQ(mock_peci.transactions[PECI_CMD_GET_TEMP], 1, "%d");
+
+	/* Stale: read again */
+	msleep(CONFIG_PECI_TEMP_CACHE_US / MSEC + 1);
+	TEST_EQ(peci_temp_sensor_get_val(0, &t), EC_SUCCESS, "%d");
+	TEST_EQ(t, C_TO_K(70), "%d");
+	TEST_EQ(mock_peci.transactions[PECI_CMD_GET_TEMP], 2, "%d");
+
+	peci_get_stats(&s);
+	TEST_EQ(s.cmd[PECI_STAT_GET_TEMP].count, 2, "%d");
+	TEST_EQ(s.cmd[PECI_STAT_GET_TEMP].cache_hits, 1, "%d");
+
+	/* A failed read isn't cached */
+	msleep(CONFIG_PECI_TEMP_CACHE_US / MSEC + 1);
+	mock_peci.fail_count = 2;
+	TEST_NE(peci_temp_sensor_get_val(0, &t), EC_SUCCESS, "%d");
+	TEST_EQ(peci_temp_sensor_get_val(0, &t), EC_SUCCESS, "%d");
+	TEST_EQ(mock_peci.transactions[PECI_CMD_GET_TEMP], 5, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_sync_transaction);
+	RUN_TEST(test_async_submit);
+	RUN_TEST(test_ordering);
+	RUN_TEST(test_retry);
+	RUN_TEST(test_queue_full);
+	RUN_TEST(test_temp_cache);
+
+	test_print_result();
+}
@@ -0,0 +1,159 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the PC-sampling profiler.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "profiler.h"
+#include "system.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+static struct {
+	struct ec_response_profiler r;
+	struct ec_profiler_entry entry[CONFIG_PROFILER_ENTRIES];
+} resp;
+
+static int profiler_cmd(enum ec_profiler_cmd cmd, uint16_t offset,
+			uint32_t period_us)
+{
+	struct ec_params_profiler p = {
+		.cmd = cmd, .offset = offset, .period_us = period_us };
+
+	return test_send_host_command(EC_CMD_PROFILER, 0, &p, sizeof(p),
+				      &resp, sizeof(resp));
+}
+
+static volatile uint32_t sink;
+
+/* Spin on the CPU without calling anything, so samples land in here */
+static void __attribute__((noinline)) burn(int n)
+{
+	uint32_t x = sink;
+	int i;
+
+	for (i = 0; i < n; i++)
+		x = x * 1103515245 + 12345;
+	sink = x;
+}
+
+static int burn_until_sampled(uint32_t min_samples)
+{
+	int i;
+
+	/* Give up after a few seconds of CPU time */
+	for (i = 0; i < 200; i++) {
+		burn(10000000);
+		TEST_EQ(profiler_cmd(EC_PROFILER_READ, 0, 0), EC_RES_SUCCESS,
+			"%d");
+		if (resp.r.samples >= min_samples)
+			break;
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_start_stop(void)
+{
+	TEST_EQ(profiler_cmd(EC_PROFILER_START, 0, PROFILER_MIN_PERIOD_US - 1),
+		EC_RES_INVALID_PARAM, "%d");
+	TEST_EQ(profiler_cmd(EC_PROFILER_CLEAR, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.samples, 0, "%u");
+	TEST_EQ(resp.r.entries, 0, "%u");
+	TEST_EQ(resp.r.flags & EC_PROFILER_FLAG_RUNNING, 0, "%d");
+
+	TEST_EQ(profiler_cmd(EC_PROFILER_START, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.period_us, PROFILER_DEFAULT_PERIOD_US, "%u");
+	TEST_ASSERT(resp.r.flags & EC_PROFILER_FLAG_RUNNING);
+	TEST_ASSERT(resp.r.flags & EC_PROFILER_FLAG_RELATIVE_PC);
+
+	TEST_EQ(profiler_cmd(EC_PROFILER_STOP, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.flags & EC_PROFILER_FLAG_RUNNING, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_hot_function(void)
+{
+	const struct ec_profiler_entry *hot = NULL;
+	uintptr_t pc;
+	uint32_t total = 0;
+	int i;
+
+	TEST_EQ(profiler_cmd(EC_PROFILER_CLEAR, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(profiler_cmd(EC_PROFILER_START, 0, 1000), EC_RES_SUCCESS,
+		"%d");
+	TEST_EQ(burn_until_sampled(50), EC_SUCCESS, "%d");
+	TEST_EQ(profiler_cmd(EC_PROFILER_STOP, 0, 0), EC_RES_SUCCESS, "%d");
+
+	TEST_EQ(profiler_cmd(EC_PROFILER_READ, 0, 0), EC_RES_SUCCESS, "%d");
+	ccprintf("%u samples, %u entries\n", resp.r.samples, resp.r.entries);
+	TEST_ASSERT(resp.r.samples >= 50);
+	TEST_EQ(resp.r.count, resp.r.entries, "%u");
+
+	for (i = 0; i < resp.r.count; i++) {
+		total += resp.entry[i].count;
+		if (!hot || resp.entry[i].count > hot->count)
+			hot = &resp.entry[i];
+	}
+	TEST_EQ(total + resp.r.dropped, resp.r.samples, "%u");
+
+	/* The hottest PC is in burn(), on this task */
+	pc = hot->pc + profiler_pc_base();
+	ccprintf("hottest pc 0x%x task %d count %u, burn() at 0x%x\n",
+		 hot->pc, hot->task, hot->count,
+		 (uint32_t)((uintptr_t)burn - profiler_pc_base()));
+	TEST_EQ(hot->task, task_get_current(), "%d");
+	TEST_ASSERT(pc >= (uintptr_t)burn && pc < (uintptr_t)burn + 256);
+
+	/* Reading from an offset returns the following entries */
+	TEST_EQ(profiler_cmd(EC_PROFILER_READ, 1, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.count, resp.r.entries - 1, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_console(void)
+{
+	UART_INJECT("profile start 2000\n");
+	msleep(100);
+	TEST_EQ(profiler_cmd(EC_PROFILER_READ, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(resp.r.flags & EC_PROFILER_FLAG_RUNNING);
+	TEST_EQ(resp.r.period_us, 2000, "%u");
+	TEST_ASSERT(sleep_mask & SLEEP_MASK_PROFILER);
+
+	/* Too short a period is rejected, and sampling carries on */
+	UART_INJECT("profile start 50\n");
+	msleep(100);
+	TEST_EQ(profiler_cmd(EC_PROFILER_READ, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(resp.r.flags & EC_PROFILER_FLAG_RUNNING);
+	TEST_EQ(resp.r.period_us, 2000, "%u");
+
+	UART_INJECT("profile stop\n");
+	msleep(100);
+	UART_INJECT("profile\n");
+	msleep(100);
+	TEST_EQ(profiler_cmd(EC_PROFILER_READ, 0, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.flags & EC_PROFILER_FLAG_RUNNING, 0, "%d");
+	TEST_EQ(sleep_mask & SLEEP_MASK_PROFILER, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_start_stop);
+	RUN_TEST(test_hot_function);
+	RUN_TEST(test_console);
+
+	test_print_result();
+}
@@ -5,6 +5,7 @@
  * Tests RSA implementation.
  */
 
+#include "benchmark.h"
 #include "console.h"
 #include "common.h"
 #include "rsa.h"
@@ -13,11 +14,49 @@
 
 #ifdef TEST_RSA3
 #include "rsa2048-3.h"
+#define BENCH_NAME(name) "rsa2048_e3_" name
 #else
 #include "rsa2048-F4.h"
+#define BENCH_NAME(name) "rsa2048_f4_" name
 #endif
 
 static uint32_t rsa_workbuf[3 * RSANUMBYTES/4];
+/* One word more, for a work buffer which is only 4-byte aligned */
+static uint32_t rsa_workbuf_odd[3 * RSANUMBYTES/4 + 1];
+static struct rsa_key_ctx rsa_ctx;
+static struct rsa_public_key bad_key;
+
+static void bench_rsa_verify(void *arg)
+{
+	*(int *)arg = rsa_verify(rsa_key, sig, hash, rsa_workbuf);
+}
+
+static void bench_rsa_verify_ctx(void *arg)
+{
+	*(int *)arg = rsa_verify_ctx(&rsa_ctx, sig, hash, rsa_workbuf);
+}
+
+/* Report the verify time, with the key as it is and with a context. */
+static int benchmark_verify(void)
+{
+	const struct benchmark_options opts = {
+		.warmup = 2, .runs = 20, .batch = 1 };
+	struct benchmark_result r;
+	int good = 0;
+
+	if (benchmark_run(BENCH_NAME("verify"), bench_rsa_verify, &good,
+			  &opts, &r) || !good)
+		return EC_ERROR_UNKNOWN;
+	benchmark_print(&r);
+
+	good = 0;
+	if (benchmark_run(BENCH_NAME("verify_ctx"), bench_rsa_verify_ctx,
+			  &good, &opts, &r) || !good)
+		return EC_ERROR_UNKNOWN;
+	benchmark_print(&r);
+
+	return EC_SUCCESS;
+}
 
 void run_test(int argc, char **argv)
 {
@@ -49,6 +88,51 @@ void run_test(int argc, char **argv)
 	}
 	ccprintf("RSA verify FAILED (as expected)\n");
 
+	/* Same with a key context */
+	if (rsa_key_ctx_init(&rsa_ctx, rsa_key) != EC_SUCCESS ||
+	    !rsa_verify_ctx(&rsa_ctx, sig, hash, rsa_workbuf) ||
+	    rsa_verify_ctx(&rsa_ctx, sig, hash_wrong, rsa_workbuf) ||
+	    rsa_verify_ctx(&rsa_ctx, sig+1, hash, rsa_workbuf)) {
+		ccprintf("RSA verify with context FAILED\n");
+		test_fail();
+		return;
+	}
+	ccprintf("RSA verify with context OK\n");
+
+	/* The work buffer only needs to be aligned for 32-bit words */
+	good = rsa_verify(rsa_key, sig, hash, rsa_workbuf_odd +
+			  !((uintptr_t)rsa_workbuf_odd & 4));
+	if (!good) {
+		ccprintf("RSA verify with odd work buffer FAILED\n");
+		test_fail();
+		return;
+	}
+	ccprintf("RSA verify with odd work buffer OK\n");
+
+	/* A key whose n0inv doesn't go with n */
+	memcpy(&bad_key, rsa_key, sizeof(bad_key));
+	bad_key.n0inv ^= 2;
+	if (rsa_key_ctx_init(&rsa_ctx, &bad_key) != EC_ERROR_INVAL) {
+		ccprintf("RSA bad key context OK (expected fail)\n");
+		test_fail();
+		return;
+	}
+	ccprintf("RSA bad key context FAILED (as expected)\n");
+
+	if (rsa_verify(&bad_key, sig, hash, rsa_workbuf)) {
+		ccprintf("RSA verify with bad key OK (expected fail)\n");
+		test_fail();
+		return;
+	}
+	ccprintf("RSA verify with bad key FAILED (as expected)\n");
+
+	rsa_key_ctx_init(&rsa_ctx, rsa_key);
+	if (benchmark_verify() != EC_SUCCESS) {
+		ccprintf("RSA benchmark FAILED\n");
+		test_fail();
+		return;
+	}
+
 	test_pass();
 }
 
@@ -712,6 +712,85 @@ static int test_low_battery_hostevents(void)
 }
 
 
+static int test_charger_writes(void)
+{
+	struct ec_params_current_limit cl_params;
+	int writes, reads;
+	int state;
+
+	/* On AC, charging with a steady battery request */
+	test_setup(1);
+	state = wait_charging_state();
+	TEST_ASSERT(state == PWR_STATE_CHARGE);
+
+	/*
+	 * Nothing changes, so the charger shouldn't be written to, but it is
+	 * still polled
+	 */
+	writes = charger_mock_get_write_count();
+	reads = charger_mock_get_status_reads();
+	sleep(10);
+	TEST_ASSERT(charger_mock_get_write_count() == writes);
+	TEST_ASSERT(charger_mock_get_status_reads() > reads);
+
+	/* ...until the settings are due for a refresh */
+	sleep(CHARGE_REWRITE_PERIOD_USEC / SECOND);
+	TEST_ASSERT(charger_mock_get_write_count() > writes);
+	TEST_ASSERT(charger_mock_get_write_count() <= writes + 3);
+
+	/* A new input current limit is picked up without waiting for a poll */
+	reads = charger_mock_get_status_reads();
+	TEST_ASSERT(charge_set_input_current_limit(2000, 5000) == EC_SUCCESS);
+	msleep(10);
+	TEST_ASSERT(charger_mock_get_status_reads() > reads);
+
+	/* Battery asks for less current: only the current is written */
+	writes = charger_mock_get_write_count();
+	sb_write(SB_CHARGING_CURRENT, 2000);
+	wait_charging_state();
+	TEST_ASSERT(charger_mock_get_write_count() == writes + 1);
+
+	/* Throttled by the host: one more update */
+	writes = charger_mock_get_write_count();
+	cl_params.limit = 1024;
+	TEST_ASSERT(test_send_host_command(EC_CMD_CHARGE_CURRENT_LIMIT, 0,
+					   &cl_params, sizeof(cl_params),
+					   0, 0) == EC_RES_SUCCESS);
+	wait_charging_state();
+	TEST_ASSERT(charger_mock_get_write_count() == writes + 1);
+
+	/* Setting the same limit again changes nothing */
+	writes = charger_mock_get_write_count();
+	TEST_ASSERT(test_send_host_command(EC_CMD_CHARGE_CURRENT_LIMIT, 0,
+					   &cl_params, sizeof(cl_params),
+					   0, 0) == EC_RES_SUCCESS);
+	wait_charging_state();
+	TEST_ASSERT(charger_mock_get_write_count() == writes);
+
+	/* AC comes back: the whole charger is set up again */
+	gpio_set_level(GPIO_AC_PRESENT, 0);
+	sb_write(SB_CURRENT, -1000);
+	state = wait_charging_state();
+	TEST_ASSERT(state == PWR_STATE_DISCHARGE);
+	writes = charger_mock_get_write_count();
+	gpio_set_level(GPIO_AC_PRESENT, 1);
+	sb_write(SB_CURRENT, 1000);
+	state = wait_charging_state();
+	TEST_ASSERT(state == PWR_STATE_CHARGE);
+	TEST_ASSERT(charger_mock_get_write_count() >= writes + 4);
+
+	/* And then stays quiet again */
+	writes = charger_mock_get_write_count();
+	sleep(10);
+	TEST_ASSERT(charger_mock_get_write_count() == writes);
+
+	cl_params.limit = -1U;
+	TEST_ASSERT(test_send_host_command(EC_CMD_CHARGE_CURRENT_LIMIT, 0,
+					   &cl_params, sizeof(cl_params),
+					   0, 0) == EC_RES_SUCCESS);
+
+	return EC_SUCCESS;
+}
 
 void run_test(int argc, char **argv)
 {
@@ -724,6 +803,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_hc_charge_state);
 	RUN_TEST(test_hc_current_limit);
 	RUN_TEST(test_low_battery_hostevents);
+	RUN_TEST(test_charger_writes);
 
 	test_print_result();
 }
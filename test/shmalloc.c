@@ -14,7 +14,10 @@
 #include "console.h"
 #include "link_defs.h"
 #include "shared_mem.h"
+#include "system.h"
+#include "task.h"
 #include "test_util.h"
+#include "util.h"
 
 /*
  * Total size of memory in the malloc pool (shared between free and allocated
@@ -45,6 +48,15 @@ static struct {
 	size_t buffer_size;
 } allocations[12];  /* Up to 12 buffers could be allocated concurrently. */
 
+#ifdef CONFIG_SHAREDMEM_SLAB
+/* Whether a buffer is from the pools, which are outside shared memory */
+static int is_pooled(const void *buf)
+{
+	return (uintptr_t)buf < (uintptr_t)__shared_mem_buf ||
+		(uintptr_t)buf >= system_usable_ram_end();
+}
+#endif
+
 /*
  * Verify that allocated and free buffers do not overlap, and that our and
  * malloc's ideas of the number of allocated buffers match.
@@ -207,7 +219,8 @@ static int shmem_is_ok(int line)
  */
 static uint32_t test_map;
 
-void run_test(int argc, char **argv)
+#ifndef CONFIG_SHAREDMEM_SLAB
+static int test_shmalloc_paths(void)
 {
 	int index;
 	const int shmem_size = shared_mem_size();
@@ -231,12 +244,10 @@ void run_test(int argc, char **argv)
 					 ", counter %d\n",
 					 test_map & ~ALL_PATHS_MASK,
 					 counter);
-				test_fail();
-				return;
+				return EC_ERROR_UNKNOWN;
 			}
 			ccprintf("Done testing, counter at %d\n", counter);
-			test_pass();
-			return;
+			break;
 		}
 
 		/* Pick a random allocation entry. */
@@ -248,10 +259,8 @@ void run_test(int argc, char **argv)
 			 */
 			shared_mem_release(allocations[index].buf);
 			allocations[index].buf = 0;
-			if (!shmem_is_ok(__LINE__)) {
-				test_fail();
-				return;
-			}
+			if (!shmem_is_ok(__LINE__))
+				return EC_ERROR_UNKNOWN;
 		} else {
 			size_t alloc_size = r_data % (shmem_size);
 
@@ -272,10 +281,8 @@ void run_test(int argc, char **argv)
 					shptr[alloc_size] =
 					shptr[alloc_size] ^ 0xff;
 
-				if (!shmem_is_ok(__LINE__)) {
-					test_fail();
-					return;
-				}
+				if (!shmem_is_ok(__LINE__))
+					return EC_ERROR_UNKNOWN;
 			}
 		}
 	}
@@ -288,15 +295,212 @@ void run_test(int argc, char **argv)
 		if (allocations[index].buf) {
 			shared_mem_release(allocations[index].buf);
 			allocations[index].buf = NULL;
-			if (!shmem_is_ok(__LINE__)) {
-				test_fail();
-				return;
-			}
+			if (!shmem_is_ok(__LINE__))
+				return EC_ERROR_UNKNOWN;
 		}
 
-	ccprintf("Did not pass all paths, map %x != %x\n",
-		 test_map, ALL_PATHS_MASK);
-	test_fail();
+	if ((test_map & ALL_PATHS_MASK) != ALL_PATHS_MASK) {
+		ccprintf("Did not pass all paths, map %x != %x\n",
+			 test_map, ALL_PATHS_MASK);
+		return EC_ERROR_UNKNOWN;
+	}
+
+	return EC_SUCCESS;
+}
+#endif
+
+#ifdef CONFIG_SHAREDMEM_SLAB
+static int slab_pools(struct shared_mem_slab_stats *stats, int max)
+{
+	int n = 0;
+
+	while (n < max && shared_mem_slab_get_stats(n, &stats[n]) == EC_SUCCESS)
+		n++;
+
+	return n;
+}
+
+static int slab_in_use(void)
+{
+	struct shared_mem_slab_stats stats[8];
+	int i, n = slab_pools(stats, ARRAY_SIZE(stats));
+	int in_use = 0;
+
+	for (i = 0; i < n; i++)
+		in_use += stats[i].in_use;
+
+	return in_use;
+}
+
+static int test_slab_pools(void)
+{
+	struct shared_mem_slab_stats stats[8], after;
+	char *bufs[32 + 1];
+	int n = slab_pools(stats, ARRAY_SIZE(stats));
+	int i;
+
+	TEST_ASSERT(n >= 2);
+	TEST_ASSERT(stats[0].size < stats[1].size);
+	TEST_EQ(slab_in_use(), 0, "%d");
+
+	/* The smallest pool serves its size, in the pools' memory */
+	for (i = 0; i < stats[0].count; i++) {
+		TEST_EQ(shared_mem_acquire(stats[0].size, &bufs[i]),
+			EC_SUCCESS, "%d");
+		TEST_ASSERT(is_pooled(bufs[i]));
+	}
+	shared_mem_slab_get_stats(0, &after);
+	TEST_EQ(after.in_use, stats[0].count, "%d");
+	TEST_EQ(after.high_water, stats[0].count, "%d");
+
+	/* Then the next one up, which isn't a failure */
+	TEST_EQ(shared_mem_acquire(1, &bufs[i]), EC_SUCCESS, "%d");
+	TEST_ASSERT(is_pooled(bufs[i]));
+	shared_mem_slab_get_stats(0, &after);
+	TEST_EQ(after.failures, 0, "%d");
+	shared_mem_slab_get_stats(1, &after);
+	TEST_EQ(after.in_use, 1, "%d");
+	shared_mem_release(bufs[i]);
+
+	/* Larger than every pool, from shared memory */
+	TEST_EQ(shared_mem_acquire(stats[n - 1].size + 1, &bufs[i]),
+		EC_SUCCESS, "%d");
+	TEST_ASSERT(!is_pooled(bufs[i]));
+	shared_mem_release(bufs[i]);
+
+	/* Releasing twice, or inside a buffer, is ignored */
+	shared_mem_release(bufs[0]);
+	shared_mem_release(bufs[0]);
+	shared_mem_release(bufs[1] + 4);
+	shared_mem_slab_get_stats(0, &after);
+	TEST_EQ(after.in_use, stats[0].count - 1, "%d");
+
+	for (i = 1; i < stats[0].count; i++)
+		shared_mem_release(bufs[i]);
+	TEST_EQ(slab_in_use(), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static char *isr_buf;
+
+static void release_isr(void)
+{
+	shared_mem_release(isr_buf);
+}
+
+static int test_slab_release_from_isr(void)
+{
+	TEST_EQ(shared_mem_acquire(1, &isr_buf), EC_SUCCESS, "%d");
+	TEST_EQ(slab_in_use(), 1, "%d");
+
+	task_trigger_test_interrupt(release_isr);
+	TEST_EQ(slab_in_use(), 0, "%d");
+
+	/* The buffer is free to acquire again */
+	TEST_EQ(shared_mem_acquire(1, &isr_buf), EC_SUCCESS, "%d");
+	shared_mem_release(isr_buf);
+	TEST_EQ(slab_in_use(), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+/* Buffers held by the stress test, each filled with its index + 1 */
+static struct {
+	char *buf;
+	int size;
+} held[32];
+
+static int check_held(int i)
+{
+	int j;
+
+	for (j = 0; j < held[i].size; j++)
+		if (held[i].buf[j] != (char)(i + 1)) {
+			ccprintf("buffer %d overwritten at %d\n", i, j);
+			return 0;
+		}
+
+	return 1;
+}
+
+static int test_slab_stress(void)
+{
+	struct shared_mem_slab_stats stats[8];
+	int n = slab_pools(stats, ARRAY_SIZE(stats));
+	int largest = stats[n - 1].size;
+	int i, j, iter, pooled, failures = 0;
+
+	for (iter = 0; iter < 100000; iter++) {
+		i = myrand() % ARRAY_SIZE(held);
+
+		if (held[i].buf) {
+			if (!check_held(i))
+				return EC_ERROR_UNKNOWN;
+			shared_mem_release(held[i].buf);
+			held[i].buf = NULL;
+		} else {
+			/* Mostly sizes the pools serve, some larger */
+			held[i].size = 1 + myrand() % (largest + largest / 8);
+			if (shared_mem_acquire(held[i].size, &held[i].buf))
+				continue;
+			memset(held[i].buf, i + 1, held[i].size);
+		}
+
+		/*
+		 * The pools account for every pooled buffer held, and shared
+		 * memory is intact with the rest.
+		 */
+		pooled = 0;
+		for (j = 0; j < ARRAY_SIZE(held); j++)
+			if (held[j].buf && is_pooled(held[j].buf))
+				pooled++;
+		if (slab_in_use() != pooled) {
+			ccprintf("%d pooled buffers held, %d in use\n", pooled,
+				 slab_in_use());
+			return EC_ERROR_UNKNOWN;
+		}
+		if (!shmem_is_ok(__LINE__))
+			return EC_ERROR_UNKNOWN;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(held); i++) {
+		if (!held[i].buf)
+			continue;
+		TEST_ASSERT(check_held(i));
+		shared_mem_release(held[i].buf);
+		held[i].buf = NULL;
+	}
+	TEST_EQ(slab_in_use(), 0, "%d");
+
+	slab_pools(stats, ARRAY_SIZE(stats));
+	for (i = 0; i < n; i++) {
+		ccprintf("pool %d: %d bytes, max %d of %d, %d failures\n", i,
+			 stats[i].size, stats[i].high_water, stats[i].count,
+			 stats[i].failures);
+		TEST_ASSERT(stats[i].high_water <= stats[i].count);
+		failures += stats[i].failures;
+	}
+	/* The pools ran out, and shared memory took over */
+	TEST_ASSERT(failures > 0);
+
+	return EC_SUCCESS;
+}
+#endif /* CONFIG_SHAREDMEM_SLAB */
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+#ifdef CONFIG_SHAREDMEM_SLAB
+	RUN_TEST(test_slab_pools);
+	RUN_TEST(test_slab_release_from_isr);
+	RUN_TEST(test_slab_stress);
+#else
+	RUN_TEST(test_shmalloc_paths);
+#endif
+
+	test_print_result();
 }
 
 void set_map_bit(uint32_t mask)
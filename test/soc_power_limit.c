@@ -0,0 +1,332 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test SoC power limit policy.
+ */
+
+#include "common.h"
+#include "soc_power_limit.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define MAX_RISE_W 20
+
+/* Same shape as the hx20 policy, with slew limiting on top */
+static const struct soc_pl_rule rules[] = {
+	{
+		.adapter_max_w = 55,
+		.limit = {
+			[SOC_PL1] = { .base = SOC_PL_BASE_NONE, .offset_w = 28 },
+			[SOC_PL2] = { .base = SOC_PL_BASE_NONE, .offset_w = 28 },
+			[SOC_PL4] = { .base = SOC_PL_BASE_NONE, .offset_w = 70,
+				      .minus_pps = 1 },
+			[SOC_PSYS_PL2] = { .base = SOC_PL_BASE_NONE,
+					   .offset_w = 52, .minus_pps = 1 },
+		},
+	},
+	{
+		.adapter_min_w = 55,
+		.battery_max_pct = 30,
+		.limit = {
+			[SOC_PL1] = { .base = SOC_PL_BASE_NONE, .offset_w = 28 },
+			[SOC_PL2] = { .base = SOC_PL4, .pct = 90, .max_w = 64 },
+			[SOC_PL4] = { .base = SOC_PL_BASE_ADAPTER, .pct = 100,
+				      .offset_w = -15, .minus_pps = 1 },
+			[SOC_PSYS_PL2] = { .base = SOC_PL_BASE_ADAPTER,
+					   .pct = 95, .minus_pps = 1 },
+		},
+	},
+	{
+		.adapter_min_w = 55,
+		.limit = {
+			[SOC_PL1] = { .base = SOC_PL_BASE_NONE, .offset_w = 28 },
+			[SOC_PL2] = { .base = SOC_PL_BASE_NONE, .offset_w = 64 },
+			[SOC_PL4] = { .base = SOC_PL_BASE_NONE,
+				      .offset_w = 121 },
+			[SOC_PSYS_PL2] = { .base = SOC_PL_BASE_ADAPTER,
+					   .pct = 95, .offset_w = 39,
+					   .minus_pps = 1 },
+		},
+	},
+};
+
+const struct soc_pl_policy soc_pl_policy = {
+	.rules = rules,
+	.rule_count = ARRAY_SIZE(rules),
+	.battery_hyst_pct = 2,
+	.max_rise_w = MAX_RISE_W,
+	.min_interval_us = SECOND,
+};
+
+/* Mock PECI */
+static int mock_limit[SOC_PL_COUNT];
+static int mock_writes[SOC_PL_COUNT];
+static uint8_t mock_fail;
+
+int board_soc_pl_write(enum soc_pl pl, int watts)
+{
+	if (mock_fail & BIT(pl))
+		return EC_ERROR_TIMEOUT;
+	mock_limit[pl] = watts;
+	mock_writes[pl]++;
+	return EC_SUCCESS;
+}
+
+static int total_writes(void)
+{
+	int i, n = 0;
+
+	for (i = 0; i < SOC_PL_COUNT; i++)
+		n += mock_writes[i];
+	return n;
+}
+
+static void clear_writes(void)
+{
+	memset(mock_writes, 0, sizeof(mock_writes));
+}
+
+static void update(int adapter_w, int battery_pct, int pps_budget_w,
+		   int force)
+{
+	struct soc_pl_inputs in = {
+		.adapter_w = adapter_w,
+		.battery_pct = battery_pct,
+		.pps_budget_w = pps_budget_w,
+	};
+
+	clear_writes();
+	soc_pl_update(&in, force);
+}
+
+static int check_limits(int pl1, int pl2, int pl4, int psys)
+{
+	int applied[SOC_PL_COUNT];
+
+	TEST_EQ(mock_limit[SOC_PL1], pl1, "%d");
+	TEST_EQ(mock_limit[SOC_PL2], pl2, "%d");
+	TEST_EQ(mock_limit[SOC_PL4], pl4, "%d");
+	TEST_EQ(mock_limit[SOC_PSYS_PL2], psys, "%d");
+
+	soc_pl_get_applied(applied);
+	TEST_ASSERT_ARRAY_EQ(applied, mock_limit, SOC_PL_COUNT);
+
+	return EC_SUCCESS;
+}
+
+/* Let rate limiting and slewing run to completion */
+static void settle(void)
+{
+	msleep(10 * SECOND / MSEC);
+}
+
+static int test_battery_only(void)
+{
+	int applied[SOC_PL_COUNT];
+
+	update(0, 50, 0, 1);
+	TEST_EQ(total_writes(), SOC_PL_COUNT, "%d");
+	TEST_ASSERT(check_limits(28, 28, 70, 52) == EC_SUCCESS);
+	TEST_EQ(soc_pl_get_applied(applied), 0, "%d");
+
+	/* Nothing changed, nothing written */
+	update(0, 50, 0, 0);
+	TEST_EQ(total_writes(), 0, "%d");
+
+	/* A forced update rewrites everything */
+	update(0, 50, 0, 1);
+	TEST_EQ(total_writes(), SOC_PL_COUNT, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_only_changed_written(void)
+{
+	settle();
+
+	/* PPS budget only affects PL4 and Psys; decreases apply right away */
+	update(0, 50, 15, 0);
+	TEST_EQ(mock_writes[SOC_PL1], 0, "%d");
+	TEST_EQ(mock_writes[SOC_PL2], 0, "%d");
+	TEST_EQ(mock_writes[SOC_PL4], 1, "%d");
+	TEST_EQ(mock_writes[SOC_PSYS_PL2], 1, "%d");
+	TEST_ASSERT(check_limits(28, 28, 55, 37) == EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+static int test_rate_limit(void)
+{
+	/* Increases within the interval wait for it to expire */
+	update(0, 50, 0, 0);
+	TEST_EQ(total_writes(), 0, "%d");
+	TEST_ASSERT(check_limits(28, 28, 55, 37) == EC_SUCCESS);
+
+	msleep(SECOND / MSEC + 100);
+	TEST_EQ(total_writes(), 2, "%d");
+	TEST_ASSERT(check_limits(28, 28, 70, 52) == EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+static int test_slew(void)
+{
+	settle();
+
+	/* Plug in a 100W adapter: every increase is capped per batch */
+	update(100, 50, 0, 0);
+	TEST_ASSERT(check_limits(28, 28 + MAX_RISE_W, 70 + MAX_RISE_W,
+				 52 + MAX_RISE_W) == EC_SUCCESS);
+
+	msleep(SECOND / MSEC + 100);
+	TEST_ASSERT(check_limits(28, 64, 70 + 2 * MAX_RISE_W,
+				 52 + 2 * MAX_RISE_W) == EC_SUCCESS);
+
+	settle();
+	TEST_ASSERT(check_limits(28, 64, 121, 134) == EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+static int test_hysteresis(void)
+{
+	int applied[SOC_PL_COUNT];
+
+	/* Within the hysteresis band of the 30% threshold: no change */
+	update(100, 29, 0, 0);
+	TEST_EQ(total_writes(), 0, "%d");
+	TEST_EQ(soc_pl_get_applied(applied), 2, "%d");
+
+	/* Clearly below: low battery rule, decreases apply right away */
+	update(100, 27, 0, 0);
+	TEST_EQ(soc_pl_get_applied(applied), 1, "%d");
+	TEST_ASSERT(check_limits(28, 64, 85, 95) == EC_SUCCESS);
+
+	/* Back inside the band: stays on the low battery rule */
+	update(100, 30, 0, 0);
+	update(100, 31, 0, 0);
+	TEST_EQ(total_writes(), 0, "%d");
+	TEST_EQ(soc_pl_get_applied(applied), 1, "%d");
+
+	/* Clearly above */
+	update(100, 32, 0, 0);
+	TEST_EQ(soc_pl_get_applied(applied), 2, "%d");
+	settle();
+	TEST_ASSERT(check_limits(28, 64, 121, 134) == EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+static int test_adapter_removal(void)
+{
+	struct soc_pl_history h;
+
+	/* Back-to-back with the previous batch, still written right away */
+	update(100, 50, 5, 0);
+	update(0, 50, 0, 0);
+	TEST_ASSERT(check_limits(28, 28, 70, 52) == EC_SUCCESS);
+
+	TEST_ASSERT(soc_pl_get_history(0, &h) == EC_SUCCESS);
+	TEST_EQ(h.rule, 0, "%d");
+	TEST_EQ(h.written, BIT(SOC_PL2) | BIT(SOC_PL4) | BIT(SOC_PSYS_PL2),
+		"0x%x");
+	TEST_EQ(h.failed, 0, "0x%x");
+	TEST_EQ(h.limit[SOC_PL4], 70, "%d");
+
+	TEST_ASSERT(soc_pl_get_history(1, &h) == EC_SUCCESS);
+	TEST_EQ(h.written, BIT(SOC_PSYS_PL2), "0x%x");
+	TEST_EQ(h.limit[SOC_PSYS_PL2], 129, "%d");
+
+	TEST_ASSERT(soc_pl_get_history(CONFIG_SOC_POWER_LIMIT_HISTORY, &h)
+		    != EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+static int test_write_failure(void)
+{
+	struct soc_pl_history h;
+
+	settle();
+
+	mock_fail = BIT(SOC_PL4);
+	update(0, 50, 10, 0);
+	TEST_EQ(mock_writes[SOC_PSYS_PL2], 1, "%d");
+	TEST_ASSERT(soc_pl_get_history(0, &h) == EC_SUCCESS);
+	TEST_EQ(h.failed, BIT(SOC_PL4), "0x%x");
+
+	/* The failed limit is retried on the next update */
+	mock_fail = 0;
+	update(0, 50, 10, 0);
+	TEST_EQ(total_writes(), 1, "%d");
+	TEST_ASSERT(check_limits(28, 28, 60, 42) == EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+static int test_manual(void)
+{
+	const int manual[SOC_PL_COUNT] = { 15, 20, 40, 30 };
+	int applied[SOC_PL_COUNT];
+
+	soc_pl_set_manual(manual);
+	TEST_ASSERT(check_limits(15, 20, 40, 30) == EC_SUCCESS);
+	TEST_EQ(soc_pl_get_applied(applied), -1, "%d");
+
+	/* Policy changes are held off */
+	update(100, 50, 0, 1);
+	TEST_EQ(total_writes(), 0, "%d");
+	settle();
+	TEST_EQ(total_writes(), 0, "%d");
+
+	/* Back to auto: the policy is written out, slewing up from manual */
+	clear_writes();
+	soc_pl_set_manual(NULL);
+	TEST_EQ(total_writes(), SOC_PL_COUNT, "%d");
+	TEST_ASSERT(check_limits(28, 20 + MAX_RISE_W, 40 + MAX_RISE_W,
+				 30 + MAX_RISE_W) == EC_SUCCESS);
+	settle();
+	TEST_ASSERT(check_limits(28, 64, 121, 134) == EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+static int test_ac_plug_in(void)
+{
+	int applied[SOC_PL_COUNT];
+	int pct;
+
+	/*
+	 * Plugging in next to the low battery threshold: the battery only
+	 * rule doesn't match anywhere in the hysteresis band, so it must be
+	 * left even though the new rule doesn't win in all of the band.
+	 */
+	for (pct = 28; pct <= 31; pct++) {
+		update(0, pct, 0, 0);
+		TEST_EQ(soc_pl_get_applied(applied), 0, "%d");
+
+		update(100, pct, 0, 0);
+		TEST_EQ(soc_pl_get_applied(applied), pct < 30 ? 1 : 2, "%d");
+	}
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_battery_only);
+	RUN_TEST(test_only_changed_written);
+	RUN_TEST(test_rate_limit);
+	RUN_TEST(test_slew);
+	RUN_TEST(test_hysteresis);
+	RUN_TEST(test_adapter_removal);
+	RUN_TEST(test_write_failure);
+	RUN_TEST(test_manual);
+	RUN_TEST(test_ac_plug_in);
+
+	test_print_result();
+}
@@ -0,0 +1,184 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the task stack high-water tracker.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "stack_watch.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Stack the hog task uses on request */
+#define HOG_BYTES (16 * 1024)
+
+/* What a task needs beyond that for itself; the budget it is tested with */
+#define HOG_OVERHEAD (16 * 1024)
+
+/* Write a buffer on the stack; return where it was */
+static uintptr_t __attribute__((noinline)) use_stack(int bytes)
+{
+	volatile uint8_t buf[bytes];
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		buf[i] = i;
+
+	return (uintptr_t)buf;
+}
+
+void stack_hog_task(void *unused)
+{
+	while (1) {
+		task_wait_event(-1);
+		use_stack(HOG_BYTES);
+		task_wake(TASK_ID_TEST_RUNNER);
+	}
+}
+
+/* Make the hog task use its stack, and wait for it to be done */
+static void hog(void)
+{
+	task_wake(TASK_ID_STACKHOG);
+	task_wait_event(-1);
+}
+
+static int get_peak(task_id_t id)
+{
+	int size, peak;
+
+	if (stack_watch_get(id, &size, &peak))
+		return -1;
+	return peak;
+}
+
+static int test_scan(void)
+{
+	int id, size, peak;
+
+	stack_watch_scan();
+	for (id = 0; id < TASK_ID_COUNT; id++) {
+		TEST_EQ(stack_watch_get(id, &size, &peak), EC_SUCCESS, "%d");
+		TEST_ASSERT(peak > 0);
+		TEST_ASSERT(peak <= size);
+	}
+	TEST_EQ(stack_watch_get(TASK_ID_COUNT, &size, &peak), EC_ERROR_INVAL,
+		"%d");
+
+	/* The budget the hog is allowed */
+	hog();
+	stack_watch_scan();
+	TEST_ASSERT(get_peak(TASK_ID_STACKHOG) >= HOG_BYTES);
+	TEST_ASSERT(get_peak(TASK_ID_STACKHOG) <= HOG_BYTES + HOG_OVERHEAD);
+
+	return EC_SUCCESS;
+}
+
+static int test_idle(void)
+{
+	int size, used, words, passes = 0;
+	uint32_t *stack;
+
+	stack = task_get_stack(TASK_ID_TEST_RUNNER, &size);
+	TEST_ASSERT(stack != NULL);
+
+	/* Use the runner's stack further down than before */
+	used = (uintptr_t)stack + size - use_stack(HOG_BYTES * 2);
+	TEST_ASSERT(used > get_peak(TASK_ID_TEST_RUNNER));
+
+	/* The idle passes find it, a few words at a time */
+	while (get_peak(TASK_ID_TEST_RUNNER) < used) {
+		stack_watch_idle();
+		if (++passes > 10000000)
+			break;
+	}
+	TEST_ASSERT(get_peak(TASK_ID_TEST_RUNNER) >= used);
+
+	/* Each pass checked at most CONFIG_STACK_WATCH_WORDS words */
+	words = (size - get_peak(TASK_ID_TEST_RUNNER)) / sizeof(uint32_t);
+	ccprintf("%d passes to find it, %d words below\n", passes, words);
+	TEST_ASSERT((int64_t)passes * CONFIG_STACK_WATCH_WORDS >= words);
+
+	/* Nothing used the stacks further since */
+	used = get_peak(TASK_ID_TEST_RUNNER);
+	for (passes = 0; passes < 1000000; passes++)
+		stack_watch_idle();
+	TEST_EQ(get_peak(TASK_ID_TEST_RUNNER), used, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_host_command(void)
+{
+	struct ec_params_stack_info p;
+	struct {
+		struct ec_response_stack_info r;
+		struct ec_stack_info_entry entry[3];
+	} resp;
+	int size, peak, i;
+
+	stack_watch_scan();
+
+	/* As many as fit */
+	p.first = 0;
+	TEST_EQ(test_send_host_command(EC_CMD_STACK_INFO, 0, &p, sizeof(p),
+				       &resp, sizeof(resp)), EC_RES_SUCCESS,
+		"%d");
+	TEST_EQ(resp.r.tasks, TASK_ID_COUNT, "%d");
+	TEST_EQ(resp.r.count, 3, "%d");
+	for (i = 0; i < 3; i++) {
+		stack_watch_get(i, &size, &peak);
+		TEST_EQ(resp.r.entry[i].size, size, "%d");
+		TEST_EQ(resp.r.entry[i].peak, peak, "%d");
+	}
+
+	/* The last page */
+	p.first = TASK_ID_STACKHOG;
+	TEST_EQ(test_send_host_command(EC_CMD_STACK_INFO, 0, &p, sizeof(p),
+				       &resp, sizeof(resp)), EC_RES_SUCCESS,
+		"%d");
+	TEST_EQ(resp.r.count, TASK_ID_COUNT - TASK_ID_STACKHOG, "%d");
+	TEST_EQ(resp.r.entry[0].peak, get_peak(TASK_ID_STACKHOG), "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_overflow(void)
+{
+	uint32_t *stack;
+	uint32_t saved;
+	int size;
+
+	TEST_EQ(task_find_stack_overflow(), -1, "%d");
+
+	/* The hog is waiting; clobber the bottom of its stack */
+	stack = task_get_stack(TASK_ID_STACKHOG, &size);
+	saved = *stack;
+	*stack = 0;
+	TEST_EQ(task_find_stack_overflow(), TASK_ID_STACKHOG, "%d");
+	*stack = saved;
+	TEST_EQ(task_find_stack_overflow(), -1, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	/* Let the hog task start waiting */
+	msleep(1);
+
+	RUN_TEST(test_scan);
+	RUN_TEST(test_idle);
+	RUN_TEST(test_host_command);
+	RUN_TEST(test_overflow);
+
+	test_print_result();
+}
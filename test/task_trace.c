@@ -0,0 +1,232 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the task switch and interrupt trace.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "task.h"
+#include "task_trace.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define EVENT_PING TASK_EVENT_CUSTOM_BIT(0)
+#define EVENT_PONG TASK_EVENT_CUSTOM_BIT(1)
+
+/* Pings answered by the PONG task */
+static volatile int pongs_sent;
+
+static struct {
+	struct ec_response_task_trace r;
+	struct ec_task_trace_entry entry[CONFIG_TASK_TRACE_SIZE];
+} resp;
+
+static int trace_cmd(enum ec_task_trace_cmd cmd, uint16_t offset)
+{
+	struct ec_params_task_trace p = { .cmd = cmd, .offset = offset };
+
+	return test_send_host_command(EC_CMD_TASK_TRACE, 0, &p, sizeof(p),
+				      &resp, sizeof(resp));
+}
+
+/* Read the whole trace into resp.entry, a chunk at a time */
+static int read_trace(void)
+{
+	struct ec_task_trace_entry *all = resp.entry;
+	static struct ec_task_trace_entry copy[CONFIG_TASK_TRACE_SIZE];
+	int n = 0;
+
+	do {
+		TEST_EQ(trace_cmd(EC_TASK_TRACE_READ, n), EC_RES_SUCCESS, "%d");
+		memcpy(copy + n, all, resp.r.count * sizeof(all[0]));
+		n += resp.r.count;
+	} while (resp.r.count && n < resp.r.kept);
+
+	TEST_EQ(n, resp.r.kept, "%d");
+	memcpy(all, copy, n * sizeof(all[0]));
+
+	return EC_SUCCESS;
+}
+
+void pong_task(void *u)
+{
+	while (1) {
+		task_wait_event_mask(EVENT_PING, -1);
+		pongs_sent++;
+		task_set_event(TASK_ID_TEST_RUNNER, EVENT_PONG, 0);
+	}
+}
+
+/*
+ * Ping the PONG task n times, waiting for each answer. The answers are
+ * counted rather than taken from the event, which a stale timer event can
+ * make task_wait_event_mask() return without.
+ */
+static int ping_pong(int n)
+{
+	timestamp_t deadline;
+	int want;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		want = pongs_sent + 1;
+		deadline.val = get_time().val + SECOND;
+		task_set_event(TASK_ID_PONG, EVENT_PING, 0);
+		while (pongs_sent < want) {
+			TEST_ASSERT(!timestamp_expired(deadline, NULL));
+			task_wait_event_mask(EVENT_PONG, 10 * MSEC);
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+/* The generator interrupts until count_isr() ran irqs_wanted times */
+static volatile int irqs_wanted;
+static volatile int irq_count;
+
+static void count_isr(void)
+{
+	irq_count++;
+}
+
+void interrupt_generator(void)
+{
+	while (1) {
+		udelay(500);
+		/* Dropped while interrupts are disabled, so retry until run */
+		if (irq_count < irqs_wanted)
+			task_trigger_test_interrupt(count_isr);
+	}
+}
+
+static int test_switches(void)
+{
+	int pongs = 0, runner = 0;
+	int i;
+
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_CLEAR, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.kept, 0, "%d");
+	TEST_ASSERT(resp.r.flags & EC_TASK_TRACE_FLAG_RUNNING);
+
+	TEST_EQ(ping_pong(10), EC_SUCCESS, "%d");
+
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_STOP, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.flags & EC_TASK_TRACE_FLAG_RUNNING, 0, "%d");
+	TEST_EQ(read_trace(), EC_SUCCESS, "%d");
+
+	for (i = 0; i < resp.r.kept; i++) {
+		const struct ec_task_trace_entry *e = &resp.entry[i];
+
+		if (i)
+			TEST_ASSERT(e->time_us >= resp.entry[i - 1].time_us);
+		if (e->event != EC_TASK_TRACE_SWITCH)
+			continue;
+		TEST_ASSERT(e->id < TASK_ID_COUNT);
+		if (e->id == TASK_ID_PONG)
+			pongs++;
+		else if (e->id == TASK_ID_TEST_RUNNER)
+			runner++;
+	}
+	ccprintf("%d records: %d to PONG, %d to the test runner\n",
+		 resp.r.kept, pongs, runner);
+	TEST_ASSERT(pongs >= 10);
+	TEST_ASSERT(runner >= 10);
+
+	/* Nothing is recorded while stopped */
+	TEST_EQ(ping_pong(2), EC_SUCCESS, "%d");
+	i = resp.r.total;
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_START, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.total, i, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_irqs(void)
+{
+	timestamp_t deadline;
+	int enters = 0, exits = 0, depth = 0;
+	int i;
+
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_CLEAR, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_START, 0), EC_RES_SUCCESS, "%d");
+	irq_count = 0;
+	irqs_wanted = 3;
+
+	deadline.val = get_time().val + SECOND;
+	while (irq_count < 3 && !timestamp_expired(deadline, NULL))
+		msleep(1);
+	irqs_wanted = 0;
+	TEST_EQ(irq_count, 3, "%d");
+
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_STOP, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(read_trace(), EC_SUCCESS, "%d");
+
+	/* Every entry has an exit, after it */
+	for (i = 0; i < resp.r.kept; i++) {
+		if (resp.entry[i].event == EC_TASK_TRACE_IRQ_ENTER) {
+			enters++;
+			depth++;
+		} else if (resp.entry[i].event == EC_TASK_TRACE_IRQ_EXIT) {
+			exits++;
+			depth--;
+			TEST_ASSERT(depth >= 0);
+		}
+	}
+	/* The emulator's own interrupts may be traced too */
+	TEST_ASSERT(enters >= 3);
+	TEST_EQ(exits, enters, "%d");
+
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_START, 0), EC_RES_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_wrap(void)
+{
+	uint32_t total;
+
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_CLEAR, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_START, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(ping_pong(CONFIG_TASK_TRACE_SIZE), EC_SUCCESS, "%d");
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_STOP, 0), EC_RES_SUCCESS, "%d");
+
+	total = resp.r.total;
+	TEST_ASSERT(total > CONFIG_TASK_TRACE_SIZE);
+	TEST_EQ(resp.r.kept, CONFIG_TASK_TRACE_SIZE, "%d");
+	TEST_EQ(resp.r.size, CONFIG_TASK_TRACE_SIZE, "%d");
+
+	/* Only the newest records are kept, still oldest first */
+	TEST_EQ(read_trace(), EC_SUCCESS, "%d");
+	TEST_ASSERT(resp.entry[0].time_us <=
+		    resp.entry[CONFIG_TASK_TRACE_SIZE - 1].time_us);
+
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_READ, CONFIG_TASK_TRACE_SIZE - 1),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.count, 1, "%d");
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_READ, CONFIG_TASK_TRACE_SIZE),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.count, 0, "%d");
+	TEST_EQ(resp.r.total, total, "%u");
+
+	TEST_EQ(trace_cmd(EC_TASK_TRACE_START, 0), EC_RES_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_switches);
+	RUN_TEST(test_irqs);
+	RUN_TEST(test_wrap);
+
+	test_print_result();
+}
@@ -22,15 +22,46 @@
 #undef CONFIG_VBOOT_HASH
 #undef CONFIG_USB_PD_LOGGING
 
+#ifdef TEST_ACPI
+#define CONFIG_ACPI_PREFETCH
+#define CONFIG_ACPI_STATS
+#define CONFIG_HOSTCMD_LPC
+#define CONFIG_HOSTCMD_X86
+#endif
+
 #ifdef TEST_AES
 #define CONFIG_AES
 #define CONFIG_AES_GCM
 #endif
 
+#ifdef TEST_AES_GHASH8
+#define CONFIG_AES
+#define CONFIG_AES_GCM
+#define CONFIG_AES_GCM_CTR32
+#define CONFIG_AES_GCM_GHASH_8BIT
+#endif
+
 #ifdef TEST_BASE32
 #define CONFIG_BASE32
 #endif
 
+#ifdef TEST_BENCHMARK_CRYPTO
+#define CONFIG_AES
+#define CONFIG_AES_GCM
+#define CONFIG_RSA
+#undef CONFIG_RSA_KEY_SIZE
+#define CONFIG_RSA_KEY_SIZE 2048
+#undef CONFIG_RSA_EXPONENT_3
+#define CONFIG_RWSIG_TYPE_RWSIG
+#define CONFIG_SHA256
+#endif
+
+#ifdef TEST_BENCHMARK_LIB
+#define CONFIG_MAG_CALIBRATE
+#define CONFIG_MATH_UTIL
+#define CONFIG_SW_CRC
+#endif
+
 #ifdef TEST_BKLIGHT_LID
 #define CONFIG_BACKLIGHT_LID
 #endif
@@ -73,6 +104,14 @@
 #define CONFIG_MAG_CALIBRATE
 #endif
 
+#ifdef TEST_MUTEX
+#define CONFIG_MUTEX_STATS
+#endif
+
+#ifdef TEST_STACK_WATCH
+#define CONFIG_STACK_WATCH
+#endif
+
 #ifdef TEST_STILLNESS_DETECTOR
 #define CONFIG_FPU
 #define CONFIG_ONLINE_CALIB
@@ -99,6 +138,63 @@
 #define CONFIG_SHA256
 #endif
 
+#ifdef TEST_BMI260
+#define CONFIG_ACCELGYRO_BMI260
+#define CONFIG_ACCEL_FIFO
+#define CONFIG_ACCEL_FIFO_SIZE 256
+#define CONFIG_ACCEL_FIFO_THRES 10
+#undef CONFIG_ACCEL_FIFO_DRAIN_SIZE
+#define CONFIG_ACCEL_FIFO_DRAIN_SIZE 64
+#define CONFIG_ACCEL_FIFO_DRAIN_STATS
+#define I2C_PORT_ACCEL 0
+
+enum sensor_id {
+	BASE_ACCEL,
+	BASE_GYRO,
+	SENSOR_COUNT,
+};
+#endif
+
+#ifdef TEST_ICM426XX
+#define CONFIG_ACCELGYRO_ICM426XX
+#define CONFIG_ACCELGYRO_ICM426XX_INT_EVENT \
+	TASK_EVENT_MOTION_SENSOR_INTERRUPT(BASE_ACCEL)
+#define CONFIG_ACCEL_FIFO
+#define CONFIG_ACCEL_FIFO_SIZE 256
+#define CONFIG_ACCEL_FIFO_THRES 10
+#undef CONFIG_ACCEL_FIFO_DRAIN_SIZE
+#define CONFIG_ACCEL_FIFO_DRAIN_SIZE 64
+#define CONFIG_ACCEL_FIFO_DRAIN_STATS
+#define CONFIG_ACCEL_INTERRUPTS
+#define I2C_PORT_ACCEL 0
+
+enum sensor_id {
+	BASE_ACCEL,
+	BASE_GYRO,
+	SENSOR_COUNT,
+};
+#endif
+
+#ifdef TEST_LSM6DSM
+#define CONFIG_ACCELGYRO_LSM6DSM
+#define CONFIG_ACCEL_LSM6DSM_INT_EVENT \
+	TASK_EVENT_MOTION_SENSOR_INTERRUPT(BASE_ACCEL)
+#define CONFIG_ACCEL_FIFO
+#define CONFIG_ACCEL_FIFO_SIZE 256
+#define CONFIG_ACCEL_FIFO_THRES 10
+#undef CONFIG_ACCEL_FIFO_DRAIN_SIZE
+#define CONFIG_ACCEL_FIFO_DRAIN_SIZE 64
+#define CONFIG_ACCEL_FIFO_DRAIN_STATS
+#define CONFIG_ACCEL_INTERRUPTS
+#define I2C_PORT_ACCEL 0
+
+enum sensor_id {
+	BASE_ACCEL,
+	BASE_GYRO,
+	SENSOR_COUNT,
+};
+#endif
+
 #ifdef TEST_MOTION_SENSE_FIFO
 #define CONFIG_ACCEL_FIFO
 #define CONFIG_ACCEL_FIFO_SIZE 256
@@ -248,10 +344,37 @@ enum sensor_id {
 #define CONFIG_SHA256_UNROLLED
 #endif
 
-#ifdef TEST_SHMALLOC
+#ifdef TEST_PROFILER
+#define CONFIG_PROFILER
+#endif
+
+#ifdef TEST_TASK_TRACE
+#define CONFIG_TASK_TRACE
+#undef CONFIG_TASK_TRACE_SIZE
+#define CONFIG_TASK_TRACE_SIZE 64
+#endif
+
+#ifdef TEST_PECI
+#define CONFIG_PECI
+#define CONFIG_PECI_COMMON
+#define CONFIG_PECI_TJMAX 100
+#define CONFIG_PECI_QUEUE
+#undef CONFIG_PECI_TEMP_CACHE_US
+#define CONFIG_PECI_TEMP_CACHE_US (100 * MSEC)
+#endif
+
+#ifdef TEST_SOC_POWER_LIMIT
+#define CONFIG_SOC_POWER_LIMIT
+#endif
+
+#if defined(TEST_SHMALLOC) || defined(TEST_SHMALLOC_SLAB)
 #define CONFIG_MALLOC
 #endif
 
+#ifdef TEST_SHMALLOC_SLAB
+#define CONFIG_SHAREDMEM_SLAB
+#endif
+
 #ifdef TEST_SBS_CHARGING_V2
 #define CONFIG_BATTERY
 #define CONFIG_BATTERY_MOCK
@@ -279,6 +402,8 @@ int board_discharge_on_ac(int enabled);
 #define CONFIG_THERMISTOR
 #define CONFIG_THERMISTOR_NCP15WB
 #define I2C_PORT_THERMAL 0
+#undef CONFIG_THERMAL_TRACE_SIZE
+#define CONFIG_THERMAL_TRACE_SIZE 16
 int ncp15wb_calculate_temp(uint16_t adc);
 #endif
 
@@ -330,6 +455,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 	defined(TEST_USB_SM_FRAMEWORK_H1) || \
 	defined(TEST_USB_SM_FRAMEWORK_H0)
 #define CONFIG_TEST_SM
+#define CONFIG_USB_SM_STATS
 #endif
 
 #if defined(TEST_USB_PRL_OLD) || defined(TEST_USB_PRL_NOEXTENDED)
@@ -353,6 +479,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #endif
 
 #if defined(TEST_USB_PRL)
+#define CONFIG_TASK_TRACE
 #define CONFIG_USB_PD_PORT_MAX_COUNT 1
 #define CONFIG_USB_PD_REV30
 #define CONFIG_USB_PD_EXTENDED_MESSAGES
@@ -389,6 +516,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #endif
 
 #if defined(TEST_USB_PE_DRP) || defined(TEST_USB_PE_DRP_NOEXTENDED)
+#define CONFIG_TASK_TRACE
 #define CONFIG_TEST_USB_PE_SM
 #define CONFIG_USB_PD_PORT_MAX_COUNT 1
 #define CONFIG_USB_PE_SM
@@ -399,6 +527,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 
 #if defined(TEST_USB_PE_DRP)
 #define CONFIG_USB_PD_EXTENDED_MESSAGES
+#define CONFIG_USB_PD_TIMING
 #endif
 
 #define CONFIG_USB_PD_TCPMV2
@@ -489,6 +618,8 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_USB_PD_DEBUG_LEVEL 3
 #define CONFIG_USB_PD_EXTENDED_MESSAGES
 #define CONFIG_USB_PD_DECODE_SOP
+#define CONFIG_USB_SM_STATS
+#define CONFIG_USB_PD_TICKLESS
 #endif
 
 #ifdef TEST_USB_PD_INT
@@ -577,6 +708,13 @@ int ncp15wb_calculate_temp(uint16_t adc);
 					 CONFIG_RW_SIZE - CONFIG_RW_SIG_SIZE)
 #endif
 
+#ifdef TEST_VBOOT_HASH
+#define CONFIG_VBOOT_HASH
+#define CONFIG_FLASH_READ_ASYNC
+#undef CONFIG_VBOOT_HASH_CHUNK_SIZE
+#define CONFIG_VBOOT_HASH_CHUNK_SIZE 256
+#endif
+
 #ifdef TEST_X25519
 #define CONFIG_CURVE25519
 #endif /* TEST_X25519 */
@@ -11,6 +11,7 @@
 #include "fan.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "math_util.h"
 #include "printf.h"
 #include "temp_sensor.h"
 #include "test_util.h"
@@ -37,9 +38,18 @@ static int cpu_throttled;
 static int cpu_shutdown;
 static int fan_pct;
 static int no_temps_read;
+static int spike_temp;
+static int spike_reads;
 
 int mock_temp_get_val(int idx, int *temp_ptr)
 {
+	/* Sensor 2 is read twice a second: memmap update and thermal task */
+	if (idx == 2 && spike_reads) {
+		spike_reads--;
+		*temp_ptr = spike_temp;
+		return EC_SUCCESS;
+	}
+
 	if (mock_temp[idx] >= 0) {
 		*temp_ptr = mock_temp[idx];
 		return EC_SUCCESS;
@@ -91,8 +101,12 @@ static void all_temps(int t)
 
 static void reset_mocks(void)
 {
+	const struct thermal_filter_params no_filter = { 0 };
+
 	/* Ignore all sensors */
 	memset(thermal_params, 0, sizeof(thermal_params));
+	thermal_set_filter_params(&no_filter);
+	spike_reads = 0;
 
 	/* All sensors report error anyway */
 	set_temps(-1, -1 , -1, -1);
@@ -481,6 +495,237 @@ static int test_several_limits(void)
 	return EC_SUCCESS;
 }
 
+/* Make sensor 2 read t for one thermal control pass */
+static void spike(int t)
+{
+	spike_temp = t;
+	spike_reads = 2;
+}
+
+static struct {
+	struct ec_response_thermal_trace r;
+	struct ec_thermal_trace_entry entry[CONFIG_THERMAL_TRACE_SIZE];
+} trace_resp;
+
+/* Read count trace entries, oldest first */
+static int read_trace(int offset, int count, struct ec_thermal_trace_entry *e)
+{
+	struct ec_params_thermal_trace p = {
+		.offset = offset,
+		.count = count,
+	};
+	int i;
+
+	if (test_send_host_command(EC_CMD_THERMAL_TRACE, 0, &p, sizeof(p),
+				   &trace_resp, sizeof(trace_resp)))
+		return -1;
+
+	for (i = 0; i < trace_resp.r.count; i++)
+		e[i] = trace_resp.r.entry[trace_resp.r.count - 1 - i];
+
+	return trace_resp.r.count;
+}
+
+static int trace_temp(const struct ec_thermal_trace_entry *e, int sensor)
+{
+	return e->temp[sensor] + EC_TEMP_SENSOR_OFFSET;
+}
+
+static int test_filter_spike(void)
+{
+	struct thermal_filter_params p = { 0 };
+	struct ec_thermal_trace_entry e[3];
+	int i;
+
+	reset_mocks();
+	thermal_params[2].temp_fan_off = 300;
+	thermal_params[2].temp_fan_max = 400;
+
+	all_temps(350);
+	sleep(3);
+	TEST_ASSERT(fan_pct == 50);
+
+	/* Unfiltered, a single bad reading maxes out the fan */
+	spike(400);
+	sleep(3);
+	TEST_ASSERT(read_trace(0, 3, e) == 3);
+	TEST_ASSERT(e[0].fan_pct == 100 || e[1].fan_pct == 100);
+	TEST_ASSERT(fan_pct == 50);
+
+	/* With the median filter it's ignored */
+	p.median = 1;
+	thermal_set_filter_params(&p);
+	sleep(3);
+	spike(400);
+	sleep(3);
+	TEST_ASSERT(read_trace(0, 3, e) == 3);
+	for (i = 0; i < 3; i++)
+		TEST_ASSERT(e[i].fan_pct == 50);
+	/* The trace still shows the raw reading */
+	TEST_ASSERT(trace_temp(&e[0], 2) == 400 ||
+		    trace_temp(&e[1], 2) == 400);
+
+	/* A real step gets through after one more reading */
+	all_temps(400);
+	sleep(3);
+	TEST_ASSERT(fan_pct == 100);
+
+	return EC_SUCCESS;
+}
+
+static int test_filter_ema(void)
+{
+	struct thermal_filter_params p = { .ema_shift = 2 };
+	struct ec_thermal_trace_entry e[8];
+	int i, first;
+
+	reset_mocks();
+	thermal_params[2].temp_fan_off = 300;
+	thermal_params[2].temp_fan_max = 400;
+	thermal_set_filter_params(&p);
+
+	all_temps(300);
+	sleep(20);
+	TEST_ASSERT(fan_pct == 0);
+
+	all_temps(400);
+	sleep(ARRAY_SIZE(e));
+	TEST_ASSERT(read_trace(0, ARRAY_SIZE(e), e) == ARRAY_SIZE(e));
+
+	for (first = 0; first < ARRAY_SIZE(e); first++)
+		if (trace_temp(&e[first], 2) == 400)
+			break;
+	TEST_ASSERT(first < 2);
+
+	/* A quarter of the step each pass */
+	TEST_EQ(e[first].fan_pct, 25, "%d");
+	TEST_EQ(e[first + 1].fan_pct, 43, "%d");
+	for (i = first + 1; i < ARRAY_SIZE(e); i++)
+		TEST_ASSERT(e[i].fan_pct > e[i - 1].fan_pct);
+	TEST_ASSERT(fan_pct >= 85 && fan_pct < 100);
+
+	return EC_SUCCESS;
+}
+
+static int test_filter_predict(void)
+{
+	struct thermal_filter_params p = { .predict_sec = 10 };
+	struct ec_thermal_trace_entry e;
+	int t;
+
+	reset_mocks();
+	thermal_params[2].temp_fan_off = 300;
+	thermal_params[2].temp_fan_max = 400;
+	thermal_set_filter_params(&p);
+
+	all_temps(300);
+	sleep(3);
+
+	/* Rising 1 K/s: the fan runs ahead by up to 10 K worth */
+	for (t = 301; t <= 315; t++) {
+		all_temps(t);
+		sleep(1);
+	}
+	TEST_ASSERT(read_trace(0, 1, &e) == 1);
+	t = trace_temp(&e, 2);
+	TEST_ASSERT(e.ctrl_temp + EC_TEMP_SENSOR_OFFSET >= t + 8);
+	TEST_ASSERT(e.fan_pct >= t - 300 + 8 && e.fan_pct <= t - 300 + 10);
+
+	/* Once it levels off, so does the fan */
+	sleep(20);
+	TEST_EQ(fan_pct, 15, "%d");
+
+	/* Falling: no look-ahead, demand follows the temperature */
+	for (t = 314; t >= 305; t--) {
+		all_temps(t);
+		sleep(1);
+	}
+	TEST_ASSERT(read_trace(0, 1, &e) == 1);
+	TEST_EQ(e.fan_pct, trace_temp(&e, 2) - 300, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_trace(void)
+{
+	struct ec_thermal_trace_entry e[CONFIG_THERMAL_TRACE_SIZE];
+	struct ec_params_thermal_trace p = { .offset = 0, .count = 255 };
+	int n;
+
+	reset_mocks();
+	set_temps(300, 310, -1, 330);
+	sleep(CONFIG_THERMAL_TRACE_SIZE + 2);
+
+	/* Capped to the buffer, oldest first */
+	n = read_trace(0, 255, e);
+	TEST_EQ(n, CONFIG_THERMAL_TRACE_SIZE, "%d");
+	TEST_EQ(trace_resp.r.num_temps, TEMP_SENSOR_COUNT, "%d");
+	TEST_EQ(e[n - 1].time_ms - e[n - 2].time_ms, 1000, "%d");
+	TEST_EQ(trace_temp(&e[n - 1], 0), 300, "%d");
+	TEST_EQ(trace_temp(&e[n - 1], 1), 310, "%d");
+	TEST_EQ(e[n - 1].temp[2], EC_TEMP_SENSOR_ERROR, "%d");
+	TEST_EQ(e[n - 1].temp[4], EC_TEMP_SENSOR_NOT_PRESENT, "%d");
+
+	/* Offset skips the newest entries */
+	TEST_EQ(read_trace(2, 3, e), 3, "%d");
+	TEST_EQ(e[2].time_ms, trace_resp.r.entry[0].time_ms, "%d");
+	TEST_EQ(read_trace(CONFIG_THERMAL_TRACE_SIZE, 3, e), 0, "%d");
+
+	/* Small response buffers get what fits */
+	TEST_EQ(test_send_host_command(EC_CMD_THERMAL_TRACE, 0, &p, sizeof(p),
+				       &trace_resp, sizeof(trace_resp.r) +
+				       2 * sizeof(e[0])), EC_RES_SUCCESS, "%d");
+	TEST_EQ(trace_resp.r.count, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+/* Fan which settles at 55 rpm per percent of duty, half way per step */
+static int fan_model_step(int rpm, int duty)
+{
+	return rpm + (duty * 55 - rpm) / 2;
+}
+
+static int test_fan_pid(void)
+{
+	const struct fan_pid_params p = {
+		.kp = 5,
+		.ki = 10,
+		.i_max = 1000,
+	};
+	struct fan_pid_state s = { 0 };
+	int rpm = 0, duty = 0, i;
+
+	/* Feed-forward assumes 50 rpm per percent; the integral trims it */
+	for (i = 0; i < 60; i++) {
+		duty = fan_pid_update(&p, &s, 3000 / 50, 3000, rpm);
+		rpm = fan_model_step(rpm, duty);
+	}
+	TEST_ASSERT(ABS(rpm - 3000) < 100);
+	TEST_ASSERT(duty < 3000 / 50);
+
+	/* Out of reach: the output saturates, the integral doesn't wind up */
+	for (i = 0; i < 100; i++) {
+		duty = fan_pid_update(&p, &s, 100, 8000, rpm);
+		rpm = fan_model_step(rpm, duty);
+	}
+	TEST_EQ(duty, 100, "%d");
+	TEST_ASSERT(ABS(s.integral) < p.i_max);
+
+	/* So it comes right back */
+	for (i = 0; i < 20; i++) {
+		duty = fan_pid_update(&p, &s, 3000 / 50, 3000, rpm);
+		rpm = fan_model_step(rpm, duty);
+	}
+	TEST_ASSERT(ABS(rpm - 3000) < 150);
+
+	/* Target 0 resets the controller */
+	TEST_EQ(fan_pid_update(&p, &s, 0, 0, rpm), 0, "%d");
+	TEST_EQ(s.integral, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
 /* Tests for ncp15wb thermistor ADC-to-temp calculation */
 #define LOW_ADC_TEST_VALUE	887 /* 0 C */
 #define HIGH_ADC_TEST_VALUE	100 /* > 100C */
@@ -653,6 +898,12 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_one_limit);
 	RUN_TEST(test_several_limits);
 
+	RUN_TEST(test_filter_spike);
+	RUN_TEST(test_filter_ema);
+	RUN_TEST(test_filter_predict);
+	RUN_TEST(test_trace);
+	RUN_TEST(test_fan_pid);
+
 	RUN_TEST(test_ncp15wb_adc_to_temp);
 	RUN_TEST(test_thermistor_linear_interpolate);
 	test_print_result();
@@ -5,6 +5,8 @@
  * Test USB PE module.
  */
 #include "common.h"
+#include "ec_commands.h"
+#include "host_command.h"
 #include "task.h"
 #include "test_util.h"
 #include "timer.h"
@@ -133,11 +135,108 @@ test_static int test_send_caps_error(void)
 	return EC_SUCCESS;
 }
 
+static struct {
+	struct ec_response_pd_timing r;
+	struct ec_pd_timing_entry entry[CONFIG_USB_PD_TIMING_ENTRIES];
+} timing;
+
+static int pd_timing_cmd(enum ec_pd_timing_cmd cmd, uint16_t offset)
+{
+	struct ec_params_pd_timing p = { .cmd = cmd, .offset = offset };
+
+	return test_send_host_command(EC_CMD_PD_TIMING, 0, &p, sizeof(p),
+				      &timing, sizeof(timing));
+}
+
+/* Number of latencies of a stage and message, and the longest one */
+static int pd_timing_get(enum ec_pd_timing_stage stage, uint8_t msg,
+			 uint32_t *max_us)
+{
+	const struct ec_pd_timing_entry *e;
+	int i, b, n = 0;
+
+	*max_us = 0;
+	for (i = 0; i < timing.r.count; i++) {
+		e = &timing.entry[i];
+		if (e->port != PORT0 || e->stage != stage || e->msg != msg)
+			continue;
+		for (b = 0; b < EC_PD_TIMING_BUCKETS; b++)
+			n += e->count[b];
+		*max_us = e->max_us;
+	}
+
+	return n;
+}
+
+test_static int test_pd_timing(void)
+{
+	const uint8_t request = EC_PD_TIMING_MSG_DATA | PD_DATA_REQUEST;
+	uint32_t max_us;
+
+	TEST_EQ(pd_timing_cmd(EC_PD_TIMING_CLEAR, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(timing.r.entries, 0, "%d");
+
+	/* Negotiate as source, as in test_send_caps_error */
+	mock_pd_port[PORT0].power_role = PD_ROLE_SOURCE;
+	mock_tc_port[PORT0].pd_enable = 1;
+	task_wait_event(10 * MSEC);
+	TEST_EQ(fake_prl_get_last_sent_data_msg_type(PORT0),
+		PD_DATA_SOURCE_CAP, "%d");
+	fake_prl_message_sent(PORT0);
+	task_wait_event(10 * MSEC);
+
+	rx_emsg[PORT0].header = PD_HEADER(PD_DATA_REQUEST, PD_ROLE_SINK,
+			PD_ROLE_UFP, 0,
+			1, PD_REV30, 0);
+	rx_emsg[PORT0].len = 4;
+	*(uint32_t *)rx_emsg[PORT0].buf = RDO_FIXED(1, 500, 500, 0);
+	fake_prl_message_received(PORT0);
+	task_wait_event(10 * MSEC);
+	TEST_EQ(fake_prl_get_last_sent_ctrl_msg(PORT0),
+		PD_CTRL_ACCEPT, "%d");
+	fake_prl_message_sent(PORT0);
+	task_wait_event(10 * MSEC);
+
+	TEST_EQ(pd_timing_cmd(EC_PD_TIMING_READ, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(timing.r.count, timing.r.entries, "%d");
+	TEST_EQ(timing.r.dropped, 0, "%u");
+	TEST_EQ(timing.r.tx_failed, 0, "%u");
+
+	/* The Request was timed from its alert to the Accept answering it */
+	TEST_EQ(pd_timing_get(EC_PD_TIMING_ALERT_TO_RX, request, &max_us), 1,
+		"%d");
+	TEST_EQ(pd_timing_get(EC_PD_TIMING_RX_TO_PE, request, &max_us), 1,
+		"%d");
+	/*
+	 * The PRL runs after the PE, so the PE sees the message on the PD
+	 * task's next 5 ms poll
+	 */
+	TEST_LE(max_us, 10 * MSEC, "%u");
+	TEST_EQ(pd_timing_get(EC_PD_TIMING_RX_TO_TX, request, &max_us), 1,
+		"%d");
+	/* tReceiverResponse */
+	TEST_LE(max_us, 15 * MSEC, "%u");
+
+	/* Both messages sent were acknowledged */
+	TEST_EQ(pd_timing_get(EC_PD_TIMING_TX_TO_GOODCRC,
+			      EC_PD_TIMING_MSG_DATA | PD_DATA_SOURCE_CAP,
+			      &max_us), 1, "%d");
+	TEST_EQ(pd_timing_get(EC_PD_TIMING_TX_TO_GOODCRC, PD_CTRL_ACCEPT,
+			      &max_us), 1, "%d");
+
+	/* Reading from an offset returns the following histograms */
+	TEST_EQ(pd_timing_cmd(EC_PD_TIMING_READ, 1), EC_RES_SUCCESS, "%d");
+	TEST_EQ(timing.r.count, timing.r.entries - 1, "%d");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
 
 	RUN_TEST(test_send_caps_error);
+	RUN_TEST(test_pd_timing);
 
 	/* Do basic state machine validity checks last. */
 	RUN_TEST(test_pe_no_parent_cycles);
@@ -136,6 +136,152 @@ static int test_discard_queued_tx_when_rx_happens(void)
 	return EC_SUCCESS;
 }
 
+static int test_send_data_msg_in_place(void)
+{
+	int port = PORT0;
+	uint32_t copied = prl_get_copy_bytes(port);
+	const uint8_t *data;
+	int i;
+
+	/* 7 bytes, so the last data object is padded */
+	for (i = 0; i < 7; i++)
+		tx_emsg[port].buf[i] = 0xa0 + i;
+	tx_emsg[port].buf[7] = 0xff;
+	tx_emsg[port].len = 7;
+	prl_send_data_msg(port, TCPC_TX_SOP, PD_DATA_VENDOR_DEF);
+	task_wait_event(MSEC);
+	pd_transmit_complete(port, TCPC_TX_COMPLETE_SUCCESS);
+	task_wait_event(10*MSEC);
+
+	TEST_NE(mock_pe_port[port].mock_pe_message_sent, 0, "%d");
+	TEST_EQ(PD_HEADER_CNT(mock_tcpc.last.tx_header), 2, "%d");
+
+	/* Sent by reference, with the padding zeroed */
+	TEST_ASSERT(mock_tcpc.last.tx_data ==
+		    (const uint32_t *)tx_emsg[port].buf);
+	data = (const uint8_t *)mock_tcpc.last.tx_data;
+	for (i = 0; i < 7; i++)
+		TEST_EQ(data[i], 0xa0 + i, "0x%x");
+	TEST_EQ(data[7], 0, "0x%x");
+	TEST_EQ(prl_get_copy_bytes(port), copied, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_send_deferred_data_msg(void)
+{
+	int port = PORT0;
+	uint32_t copied = prl_get_copy_bytes(port);
+	const uint8_t *data;
+	int i;
+
+	/* Starting an AMS as Source holds the message for SinkTxTimer */
+	mock_pe_port[port].mock_in_local_ams = true;
+	for (i = 0; i < 7; i++)
+		tx_emsg[port].buf[i] = 0xa0 + i;
+	tx_emsg[port].len = 7;
+	prl_send_data_msg(port, TCPC_TX_SOP, PD_DATA_VENDOR_DEF);
+	task_wait_event(MSEC);
+	TEST_EQ(mock_pe_port[port].mock_pe_message_sent, 0, "%d");
+
+	/* Meanwhile the Policy Engine builds its next message */
+	for (i = 0; i < 12; i++)
+		tx_emsg[port].buf[i] = 0x50 + i;
+	tx_emsg[port].len = 12;
+
+	task_wait_event(PD_T_SINK_TX + 5*MSEC);
+	pd_transmit_complete(port, TCPC_TX_COMPLETE_SUCCESS);
+	task_wait_event(10*MSEC);
+	TEST_NE(mock_pe_port[port].mock_pe_message_sent, 0, "%d");
+
+	/* The queued message went out, from the Protocol Layer's copy */
+	TEST_EQ(PD_HEADER_CNT(mock_tcpc.last.tx_header), 2, "%d");
+	TEST_ASSERT(mock_tcpc.last.tx_data !=
+		    (const uint32_t *)tx_emsg[port].buf);
+	data = (const uint8_t *)mock_tcpc.last.tx_data;
+	for (i = 0; i < 7; i++)
+		TEST_EQ(data[i], 0xa0 + i, "0x%x");
+	TEST_EQ(data[7], 0, "0x%x");
+	TEST_EQ(prl_get_copy_bytes(port) - copied, 8, "%u");
+
+	mock_pe_port[port].mock_in_local_ams = false;
+
+	return EC_SUCCESS;
+}
+
+static int test_receive_data_msg(void)
+{
+	int port = PORT0;
+	uint32_t copied = prl_get_copy_bytes(port);
+	const uint32_t data[2] = { 0x11223344, 0x55667788 };
+	uint16_t header = PD_HEADER(PD_DATA_VENDOR_DEF,
+		pd_get_power_role(port),
+		pd_get_data_role(port),
+		mock_tc_port[port].msg_rx_id,
+		2, mock_tc_port[port].rev, 0);
+
+	mock_tcpm_rx_msg(port, header, 2, data);
+	task_wait_event(10*MSEC);
+
+	TEST_NE(mock_pe_port[port].mock_pe_message_received, 0, "%d");
+	TEST_EQ(rx_emsg[port].len, 8, "%d");
+	TEST_ASSERT(memcmp(rx_emsg[port].buf, data, sizeof(data)) == 0);
+	TEST_EQ(prl_get_copy_bytes(port) - copied, 8, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_receive_chunked_ext_msg(void)
+{
+	int port = PORT0;
+	uint32_t copied = prl_get_copy_bytes(port);
+	/* Two chunks: 26 bytes, then 4 */
+	const int len = PD_MAX_EXTENDED_MSG_CHUNK_LEN + 4;
+	uint32_t chunk[MOCK_CHK_BUF_SIZE];
+	uint8_t *payload = (uint8_t *)chunk + 2;
+	uint16_t header;
+	int i;
+
+	memset(chunk, 0, sizeof(chunk));
+	chunk[0] = PD_EXT_HEADER(0, 0, len);
+	for (i = 0; i < PD_MAX_EXTENDED_MSG_CHUNK_LEN; i++)
+		payload[i] = i;
+	header = PD_HEADER(PD_EXT_MANUFACTURER_INFO,
+		pd_get_power_role(port),
+		pd_get_data_role(port),
+		mock_tc_port[port].msg_rx_id,
+		7, mock_tc_port[port].rev, 1);
+	mock_tcpm_rx_msg(port, header, 7, chunk);
+	task_wait_event(10*MSEC);
+
+	/* The first chunk is in; the second one is requested */
+	TEST_EQ(mock_pe_port[port].mock_pe_message_received, 0, "%d");
+	pd_transmit_complete(port, TCPC_TX_COMPLETE_SUCCESS);
+	task_wait_event(10*MSEC);
+
+	memset(chunk, 0, sizeof(chunk));
+	chunk[0] = PD_EXT_HEADER(1, 0, len);
+	for (i = 0; i < 4; i++)
+		payload[i] = PD_MAX_EXTENDED_MSG_CHUNK_LEN + i;
+	header = PD_HEADER(PD_EXT_MANUFACTURER_INFO,
+		pd_get_power_role(port),
+		pd_get_data_role(port),
+		mock_tc_port[port].msg_rx_id + 1,
+		2, mock_tc_port[port].rev, 1);
+	mock_tcpm_rx_msg(port, header, 2, chunk);
+	task_wait_event(10*MSEC);
+
+	TEST_NE(mock_pe_port[port].mock_pe_message_received, 0, "%d");
+	TEST_EQ(rx_emsg[port].len, len, "%d");
+	for (i = 0; i < len; i++)
+		TEST_EQ(rx_emsg[port].buf[i], i, "%d");
+
+	/* Each chunk's payload was copied once */
+	TEST_EQ(prl_get_copy_bytes(port) - copied, len, "%u");
+
+	return EC_SUCCESS;
+}
+
 void before_test(void)
 {
 	mock_tc_port_reset();
@@ -160,6 +306,10 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_receive_control_msg);
 	RUN_TEST(test_send_control_msg);
 	RUN_TEST(test_discard_queued_tx_when_rx_happens);
+	RUN_TEST(test_send_data_msg_in_place);
+	RUN_TEST(test_send_deferred_data_msg);
+	RUN_TEST(test_receive_data_msg);
+	RUN_TEST(test_receive_chunked_ext_msg);
 	/* TODO add tests here */
 
 
@@ -52,6 +52,12 @@ test_static int test_no_parent_cycles(const struct test_sm_data * const sm_data)
 
 		if (depth > sm_data->size)
 			break;
+
+		/* set_state() can't enter deeper hierarchies */
+		if (depth > USB_SM_MAX_DEPTH) {
+			ccprintf("State %d is %d levels deep!\n", i, depth);
+			TEST_ASSERT(0);
+		}
 	}
 
 	/* Ensure all states end, otherwise the ith state has a cycle. */
@@ -963,6 +963,33 @@ static const struct usb_state states[] = {
 	},
 };
 
+test_static int test_transition_stats(void)
+{
+	int port = PORT0;
+	const struct sm_stats *stats = &sm[port].ctx.stats;
+	int i;
+
+	set_state_sm(port, SM_TEST_A4);
+	TEST_EQ(stats->transitions, 1, "%u");
+	TEST_ASSERT(stats->longest == NULL);
+
+	/* Each state runs once then moves on, around the loop back to A4 */
+	for (i = 0; i < 16; i++)
+		run_sm();
+	TEST_ASSERT(sm[port].ctx.current == &states[SM_TEST_A4]);
+	TEST_EQ(stats->transitions, 9, "%u");
+
+	/* Every state was held for two runs */
+	TEST_ASSERT(stats->longest != NULL);
+	TEST_ASSERT(stats->longest_us >= 5 * MSEC);
+
+	run_sm();
+	TEST_EQ(stats->transitions, 9, "%u");
+	TEST_ASSERT(sm_get_time_in_state(stats) >= 5 * MSEC);
+
+	return EC_SUCCESS;
+}
+
 /* Run before each RUN_TEST line */
 void before_test(void)
 {
@@ -998,5 +1025,6 @@ void run_test(int argc, char **argv)
 #else
 	RUN_TEST(test_hierarchy_0);
 #endif
+	RUN_TEST(test_transition_stats);
 	test_print_result();
 }
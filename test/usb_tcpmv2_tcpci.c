@@ -11,6 +11,7 @@
 #include "test_util.h"
 #include "timer.h"
 #include "usb_mux.h"
+#include "usb_pe_sm.h"
 #include "usb_tc_sm.h"
 #include "usb_prl_sm.h"
 
@@ -365,6 +366,58 @@ __maybe_unused static int test_pd3_source_send_soft_reset(void)
 	return EC_SUCCESS;
 }
 
+/* Wake ups of the PD task over a minute with nothing happening on the port */
+static uint32_t idle_wakeups_per_minute(void)
+{
+	uint32_t start = tc_get_event_loop_wakeups(PORT0);
+
+	usleep(60 * SECOND);
+
+	return tc_get_event_loop_wakeups(PORT0) - start;
+}
+
+static int test_detached_idle_wakeups(void)
+{
+	uint32_t wakeups;
+
+	TEST_EQ(test_startup_and_resume(), EC_SUCCESS, "%d");
+
+	wakeups = idle_wakeups_per_minute();
+	ccprints("Detached: %u wakeups/min (%s)", wakeups,
+		 tc_get_current_state(PORT0));
+	TEST_LE(wakeups, 10, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_attached_snk_idle_wakeups(void)
+{
+	uint32_t wakeups;
+
+	TEST_EQ(test_connect_as_nonpd_sink(), EC_SUCCESS, "%d");
+
+	wakeups = idle_wakeups_per_minute();
+	ccprints("Attached.SNK: %u wakeups/min (%s, %s)", wakeups,
+		 tc_get_current_state(PORT0), pe_get_current_state(PORT0));
+	TEST_LE(wakeups, 10, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_attached_src_idle_wakeups(void)
+{
+	uint32_t wakeups;
+
+	TEST_EQ(test_connect_as_pd3_source(), EC_SUCCESS, "%d");
+
+	wakeups = idle_wakeups_per_minute();
+	ccprints("Attached.SRC: %u wakeups/min (%s, %s)", wakeups,
+		 tc_get_current_state(PORT0), pe_get_current_state(PORT0));
+	TEST_LE(wakeups, 10, "%u");
+
+	return EC_SUCCESS;
+}
+
 void before_test(void)
 {
 	rx_id = 0;
@@ -387,6 +440,9 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_retry_count_sop);
 	RUN_TEST(test_retry_count_hard_reset);
 	RUN_TEST(test_pd3_source_send_soft_reset);
+	RUN_TEST(test_detached_idle_wakeups);
+	RUN_TEST(test_attached_snk_idle_wakeups);
+	RUN_TEST(test_attached_src_idle_wakeups);
 
 	test_print_result();
 }
@@ -0,0 +1,205 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the vboot hash, reading the next chunk of flash while hashing.
+ */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "flash.h"
+#include "host_command.h"
+#include "sha256.h"
+#include "shared_mem.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Not a multiple of the chunk size */
+#define HASH_OFFSET 0x1000
+#define HASH_SIZE (10 * CONFIG_VBOOT_HASH_CHUNK_SIZE + 100)
+
+static struct ec_response_vboot_hash_v1 resp;
+
+static int send_hash_command(int cmd, int version, uint32_t offset,
+			     uint32_t size, int nonce_size)
+{
+	struct ec_params_vboot_hash p = {
+		.cmd = cmd,
+		.hash_type = EC_VBOOT_HASH_TYPE_SHA256,
+		.nonce_size = nonce_size,
+		.offset = offset,
+		.size = size,
+	};
+	int i;
+
+	for (i = 0; i < nonce_size; i++)
+		p.nonce_data[i] = i;
+	memset(&resp, 0xff, sizeof(resp));
+
+	return test_send_host_command(EC_CMD_VBOOT_HASH, version, &p,
+				      sizeof(p), &resp, sizeof(resp));
+}
+
+/* Wait for the hash to be done, and get its status */
+static int wait_for_hash(void)
+{
+	int i;
+
+	for (i = 0; i < 1000; i++) {
+		send_hash_command(EC_VBOOT_HASH_GET, 1, 0, 0, 0);
+		if (resp.v0.status != EC_VBOOT_HASH_STATUS_BUSY)
+			break;
+		msleep(1);
+	}
+	return resp.v0.status;
+}
+
+/* The hash of the flash contents, computed directly */
+static const uint8_t *expected_hash(uint32_t offset, uint32_t size,
+				    int nonce_size)
+{
+	static struct sha256_ctx ctx;
+	uint8_t nonce[64];
+	int i;
+
+	for (i = 0; i < nonce_size; i++)
+		nonce[i] = i;
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, nonce, nonce_size);
+	SHA256_update(&ctx, (const uint8_t *)__host_flash + offset, size);
+	return SHA256_final(&ctx);
+}
+
+static int test_hash(void)
+{
+	TEST_EQ(send_hash_command(EC_VBOOT_HASH_START, 1, HASH_OFFSET,
+				  HASH_SIZE, 16), EC_RES_SUCCESS, "%d");
+	TEST_EQ(wait_for_hash(), EC_VBOOT_HASH_STATUS_DONE, "%d");
+
+	TEST_EQ(resp.v0.offset, HASH_OFFSET, "%d");
+	TEST_EQ(resp.v0.size, HASH_SIZE, "%d");
+	TEST_ASSERT_ARRAY_EQ(resp.v0.hash_digest,
+			     expected_hash(HASH_OFFSET, HASH_SIZE, 16),
+			     SHA256_DIGEST_SIZE);
+	TEST_ASSERT(resp.hash_time_us > 0);
+	TEST_EQ(resp.chunk_size, CONFIG_VBOOT_HASH_CHUNK_SIZE, "%d");
+
+	/* The buffers are given back */
+	TEST_EQ(shared_mem_size() >= 2 * CONFIG_VBOOT_HASH_CHUNK_SIZE, 1,
+		"%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_recalc(void)
+{
+	/* Less than a chunk, then the whole flash */
+	TEST_EQ(send_hash_command(EC_VBOOT_HASH_RECALC, 1, HASH_OFFSET, 100,
+				  0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.v0.status, EC_VBOOT_HASH_STATUS_DONE, "%d");
+	TEST_ASSERT_ARRAY_EQ(resp.v0.hash_digest,
+			     expected_hash(HASH_OFFSET, 100, 0),
+			     SHA256_DIGEST_SIZE);
+
+	TEST_EQ(send_hash_command(EC_VBOOT_HASH_RECALC, 1, 0,
+				  CONFIG_FLASH_SIZE, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.v0.status, EC_VBOOT_HASH_STATUS_DONE, "%d");
+	TEST_ASSERT_ARRAY_EQ(resp.v0.hash_digest,
+			     expected_hash(0, CONFIG_FLASH_SIZE, 0),
+			     SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_abort(void)
+{
+	char *buf;
+
+	TEST_EQ(send_hash_command(EC_VBOOT_HASH_START, 1, 0,
+				  CONFIG_FLASH_SIZE, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.v0.status, EC_VBOOT_HASH_STATUS_BUSY, "%d");
+	TEST_EQ(send_hash_command(EC_VBOOT_HASH_ABORT, 1, 0, 0, 0),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(wait_for_hash(), EC_VBOOT_HASH_STATUS_NONE, "%d");
+	TEST_EQ(resp.hash_time_us, 0, "%d");
+
+	/* The buffers are given back */
+	TEST_EQ(shared_mem_acquire(2 * CONFIG_VBOOT_HASH_CHUNK_SIZE, &buf),
+		EC_SUCCESS, "%d");
+	shared_mem_release(buf);
+
+	return EC_SUCCESS;
+}
+
+static int test_shared_mem_between_calls(void)
+{
+	char *buf;
+
+	TEST_EQ(send_hash_command(EC_VBOOT_HASH_START, 1, 0,
+				  CONFIG_FLASH_SIZE, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.v0.status, EC_VBOOT_HASH_STATUS_BUSY, "%d");
+
+	/* The chunk buffers are only held during each deferred call */
+	TEST_EQ(shared_mem_acquire(2 * CONFIG_VBOOT_HASH_CHUNK_SIZE, &buf),
+		EC_SUCCESS, "%d");
+	msleep(1);
+	shared_mem_release(buf);
+
+	TEST_EQ(wait_for_hash(), EC_VBOOT_HASH_STATUS_DONE, "%d");
+	TEST_ASSERT_ARRAY_EQ(resp.v0.hash_digest,
+			     expected_hash(0, CONFIG_FLASH_SIZE, 0),
+			     SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_version_0(void)
+{
+	struct ec_params_vboot_hash p = {
+		.cmd = EC_VBOOT_HASH_GET,
+	};
+	struct host_cmd_handler_args args = {
+		.command = EC_CMD_VBOOT_HASH,
+		.version = 0,
+		.params = &p,
+		.params_size = sizeof(p),
+		.response = &resp,
+		.response_max = sizeof(resp),
+	};
+
+	TEST_EQ(send_hash_command(EC_VBOOT_HASH_RECALC, 0, HASH_OFFSET,
+				  HASH_SIZE, 0), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.v0.status, EC_VBOOT_HASH_STATUS_DONE, "%d");
+	TEST_ASSERT_ARRAY_EQ(resp.v0.hash_digest,
+			     expected_hash(HASH_OFFSET, HASH_SIZE, 0),
+			     SHA256_DIGEST_SIZE);
+
+	/* Nothing past the version 0 response */
+	TEST_EQ(host_command_process(&args), EC_RES_SUCCESS, "%d");
+	TEST_EQ(args.response_size, (int)sizeof(resp.v0), "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	int i;
+
+	test_reset();
+
+	for (i = 0; i < CONFIG_FLASH_SIZE; i++)
+		__host_flash[i] = prng_no_seed();
+
+	/* The hash of RW started at init */
+	wait_for_hash();
+
+	RUN_TEST(test_hash);
+	RUN_TEST(test_recalc);
+	RUN_TEST(test_abort);
+	RUN_TEST(test_shared_mem_between_calls);
+	RUN_TEST(test_version_0);
+
+	test_print_result();
+}
@@ -256,6 +256,140 @@ void gcm_ghash_4bit(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
                     size_t len);
 #endif
 
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+// Shoup's method with 8-bit tables: half the lookups and shifts of the 4-bit
+// code per block, for a 4 KiB table per key instead of 256 bytes.
+static const size_t rem_8bit[256] = {
+    PACK(0x0000), PACK(0x01C2), PACK(0x0384), PACK(0x0246),
+    PACK(0x0708), PACK(0x06CA), PACK(0x048C), PACK(0x054E),
+    PACK(0x0E10), PACK(0x0FD2), PACK(0x0D94), PACK(0x0C56),
+    PACK(0x0918), PACK(0x08DA), PACK(0x0A9C), PACK(0x0B5E),
+    PACK(0x1C20), PACK(0x1DE2), PACK(0x1FA4), PACK(0x1E66),
+    PACK(0x1B28), PACK(0x1AEA), PACK(0x18AC), PACK(0x196E),
+    PACK(0x1230), PACK(0x13F2), PACK(0x11B4), PACK(0x1076),
+    PACK(0x1538), PACK(0x14FA), PACK(0x16BC), PACK(0x177E),
+    PACK(0x3840), PACK(0x3982), PACK(0x3BC4), PACK(0x3A06),
+    PACK(0x3F48), PACK(0x3E8A), PACK(0x3CCC), PACK(0x3D0E),
+    PACK(0x3650), PACK(0x3792), PACK(0x35D4), PACK(0x3416),
+    PACK(0x3158), PACK(0x309A), PACK(0x32DC), PACK(0x331E),
+    PACK(0x2460), PACK(0x25A2), PACK(0x27E4), PACK(0x2626),
+    PACK(0x2368), PACK(0x22AA), PACK(0x20EC), PACK(0x212E),
+    PACK(0x2A70), PACK(0x2BB2), PACK(0x29F4), PACK(0x2836),
+    PACK(0x2D78), PACK(0x2CBA), PACK(0x2EFC), PACK(0x2F3E),
+    PACK(0x7080), PACK(0x7142), PACK(0x7304), PACK(0x72C6),
+    PACK(0x7788), PACK(0x764A), PACK(0x740C), PACK(0x75CE),
+    PACK(0x7E90), PACK(0x7F52), PACK(0x7D14), PACK(0x7CD6),
+    PACK(0x7998), PACK(0x785A), PACK(0x7A1C), PACK(0x7BDE),
+    PACK(0x6CA0), PACK(0x6D62), PACK(0x6F24), PACK(0x6EE6),
+    PACK(0x6BA8), PACK(0x6A6A), PACK(0x682C), PACK(0x69EE),
+    PACK(0x62B0), PACK(0x6372), PACK(0x6134), PACK(0x60F6),
+    PACK(0x65B8), PACK(0x647A), PACK(0x663C), PACK(0x67FE),
+    PACK(0x48C0), PACK(0x4902), PACK(0x4B44), PACK(0x4A86),
+    PACK(0x4FC8), PACK(0x4E0A), PACK(0x4C4C), PACK(0x4D8E),
+    PACK(0x46D0), PACK(0x4712), PACK(0x4554), PACK(0x4496),
+    PACK(0x41D8), PACK(0x401A), PACK(0x425C), PACK(0x439E),
+    PACK(0x54E0), PACK(0x5522), PACK(0x5764), PACK(0x56A6),
+    PACK(0x53E8), PACK(0x522A), PACK(0x506C), PACK(0x51AE),
+    PACK(0x5AF0), PACK(0x5B32), PACK(0x5974), PACK(0x58B6),
+    PACK(0x5DF8), PACK(0x5C3A), PACK(0x5E7C), PACK(0x5FBE),
+    PACK(0xE100), PACK(0xE0C2), PACK(0xE284), PACK(0xE346),
+    PACK(0xE608), PACK(0xE7CA), PACK(0xE58C), PACK(0xE44E),
+    PACK(0xEF10), PACK(0xEED2), PACK(0xEC94), PACK(0xED56),
+    PACK(0xE818), PACK(0xE9DA), PACK(0xEB9C), PACK(0xEA5E),
+    PACK(0xFD20), PACK(0xFCE2), PACK(0xFEA4), PACK(0xFF66),
+    PACK(0xFA28), PACK(0xFBEA), PACK(0xF9AC), PACK(0xF86E),
+    PACK(0xF330), PACK(0xF2F2), PACK(0xF0B4), PACK(0xF176),
+    PACK(0xF438), PACK(0xF5FA), PACK(0xF7BC), PACK(0xF67E),
+    PACK(0xD940), PACK(0xD882), PACK(0xDAC4), PACK(0xDB06),
+    PACK(0xDE48), PACK(0xDF8A), PACK(0xDDCC), PACK(0xDC0E),
+    PACK(0xD750), PACK(0xD692), PACK(0xD4D4), PACK(0xD516),
+    PACK(0xD058), PACK(0xD19A), PACK(0xD3DC), PACK(0xD21E),
+    PACK(0xC560), PACK(0xC4A2), PACK(0xC6E4), PACK(0xC726),
+    PACK(0xC268), PACK(0xC3AA), PACK(0xC1EC), PACK(0xC02E),
+    PACK(0xCB70), PACK(0xCAB2), PACK(0xC8F4), PACK(0xC936),
+    PACK(0xCC78), PACK(0xCDBA), PACK(0xCFFC), PACK(0xCE3E),
+    PACK(0x9180), PACK(0x9042), PACK(0x9204), PACK(0x93C6),
+    PACK(0x9688), PACK(0x974A), PACK(0x950C), PACK(0x94CE),
+    PACK(0x9F90), PACK(0x9E52), PACK(0x9C14), PACK(0x9DD6),
+    PACK(0x9898), PACK(0x995A), PACK(0x9B1C), PACK(0x9ADE),
+    PACK(0x8DA0), PACK(0x8C62), PACK(0x8E24), PACK(0x8FE6),
+    PACK(0x8AA8), PACK(0x8B6A), PACK(0x892C), PACK(0x88EE),
+    PACK(0x83B0), PACK(0x8272), PACK(0x8034), PACK(0x81F6),
+    PACK(0x84B8), PACK(0x857A), PACK(0x873C), PACK(0x86FE),
+    PACK(0xA9C0), PACK(0xA802), PACK(0xAA44), PACK(0xAB86),
+    PACK(0xAEC8), PACK(0xAF0A), PACK(0xAD4C), PACK(0xAC8E),
+    PACK(0xA7D0), PACK(0xA612), PACK(0xA454), PACK(0xA596),
+    PACK(0xA0D8), PACK(0xA11A), PACK(0xA35C), PACK(0xA29E),
+    PACK(0xB5E0), PACK(0xB422), PACK(0xB664), PACK(0xB7A6),
+    PACK(0xB2E8), PACK(0xB32A), PACK(0xB16C), PACK(0xB0AE),
+    PACK(0xBBF0), PACK(0xBA32), PACK(0xB874), PACK(0xB9B6),
+    PACK(0xBCF8), PACK(0xBD3A), PACK(0xBF7C), PACK(0xBEBE)};
+
+static void gcm_init_8bit(u128 Htable[256], uint64_t H[2]) {
+  u128 V;
+
+  Htable[0].hi = 0;
+  Htable[0].lo = 0;
+  V.hi = H[0];
+  V.lo = H[1];
+
+  Htable[128] = V;
+  for (int i = 64; i > 0; i >>= 1) {
+    REDUCE1BIT(V);
+    Htable[i] = V;
+  }
+
+  for (int i = 2; i < 256; i <<= 1) {
+    u128 *Hi = Htable + i;
+    V = *Hi;
+    for (int j = 1; j < i; ++j) {
+      Hi[j].hi = V.hi ^ Htable[j].hi;
+      Hi[j].lo = V.lo ^ Htable[j].lo;
+    }
+  }
+}
+
+static void gcm_gmult_8bit(uint64_t Xi[2], const u128 Htable[256]) {
+  u128 Z = {0, 0};
+  const uint8_t *xi = (const uint8_t *)Xi + 15;
+  size_t rem, n = *xi;
+
+  while (1) {
+    Z.hi ^= Htable[n].hi;
+    Z.lo ^= Htable[n].lo;
+
+    if ((const uint8_t *)Xi == xi) {
+      break;
+    }
+
+    n = *(--xi);
+
+    rem = (size_t)Z.lo & 0xff;
+    Z.lo = (Z.hi << 56) | (Z.lo >> 8);
+    if (sizeof(size_t) == 8) {
+      Z.hi = (Z.hi >> 8) ^ rem_8bit[rem];
+    } else {
+      Z.hi = (Z.hi >> 8) ^ ((uint64_t)rem_8bit[rem] << 32);
+    }
+  }
+
+  Xi[0] = CRYPTO_bswap8(Z.hi);
+  Xi[1] = CRYPTO_bswap8(Z.lo);
+}
+
+static void gcm_ghash_8bit(uint64_t Xi[2], const u128 Htable[256],
+                           const uint8_t *inp, size_t len) {
+  uint64_t in[2];
+
+  do {
+    OPENSSL_memcpy(in, inp, 16);
+    Xi[0] ^= in[0];
+    Xi[1] ^= in[1];
+    gcm_gmult_8bit(Xi, Htable);
+  } while (inp += 16, len -= 16);
+}
+#endif
+
 #define GCM_MUL(ctx, Xi) gcm_gmult_4bit((ctx)->Xi.u, (ctx)->Htable)
 #if defined(GHASH_ASM)
 #define GHASH(ctx, in, len) gcm_ghash_4bit((ctx)->Xi.u, (ctx)->Htable, in, len)
@@ -363,6 +497,15 @@ void gcm_ghash_p8(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
 #endif
 #endif
 
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+// The 8-bit table functions are called through |ctx->gmult| and |ctx->ghash|.
+#define GCM_FUNCREF_4BIT
+#ifndef GHASH
+#define GHASH(ctx, in, len) gcm_ghash_8bit((ctx)->Xi.u, (ctx)->Htable, in, len)
+#define GHASH_CHUNK (3 * 1024)
+#endif
+#endif
+
 #ifdef GCM_FUNCREF_4BIT
 #undef GCM_MUL
 #define GCM_MUL(ctx, Xi) (*gcm_gmult_p)((ctx)->Xi.u, (ctx)->Htable)
@@ -372,14 +515,12 @@ void gcm_ghash_p8(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
 #endif
 #endif
 
-#ifdef GHASH
 // kSizeTWithoutLower4Bits is a mask that can be used to zero the lower four
 // bits of a |size_t|.
 static const size_t kSizeTWithoutLower4Bits = (size_t) -16;
-#endif
 
 static void CRYPTO_ghash_init(gmult_func *out_mult, ghash_func *out_hash,
-                              u128 *out_key, u128 out_table[16],
+                              u128 *out_key, u128 *out_table,
                               const uint8_t *gcm_key) {
 
   union {
@@ -439,6 +580,13 @@ static void CRYPTO_ghash_init(gmult_func *out_mult, ghash_func *out_hash,
   }
 #endif
 
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+  gcm_init_8bit(out_table, H.u);
+  *out_mult = gcm_gmult_8bit;
+  *out_hash = gcm_ghash_8bit;
+  return;
+#endif
+
   gcm_init_4bit(out_table, H.u);
 #if defined(GHASH_ASM_X86)
   *out_mult = gcm_gmult_4bit_mmx;
@@ -836,6 +984,189 @@ int CRYPTO_gcm128_decrypt(GCM128_CONTEXT *ctx, const void *key,
   return 1;
 }
 
+int CRYPTO_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx, const void *key,
+                                const uint8_t *in, uint8_t *out, size_t len,
+                                ctr128_f stream) {
+  unsigned int n, ctr;
+  uint64_t mlen = ctx->len.u[1];
+#ifdef GCM_FUNCREF_4BIT
+  void (*gcm_gmult_p)(uint64_t Xi[2], const u128 Htable[16]) = ctx->gmult;
+#ifdef GHASH
+  void (*gcm_ghash_p)(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
+                      size_t len) = ctx->ghash;
+#endif
+#endif
+
+  mlen += len;
+  if (mlen > ((UINT64_C(1) << 36) - 32) ||
+      (sizeof(len) == 8 && mlen < len)) {
+    return 0;
+  }
+  ctx->len.u[1] = mlen;
+
+  if (ctx->ares) {
+    // First call to encrypt finalizes GHASH(AAD)
+    GCM_MUL(ctx, Xi);
+    ctx->ares = 0;
+  }
+
+  n = ctx->mres;
+  if (n) {
+    while (n && len) {
+      ctx->Xi.c[n] ^= *(out++) = *(in++) ^ ctx->EKi.c[n];
+      --len;
+      n = (n + 1) % 16;
+    }
+    if (n == 0) {
+      GCM_MUL(ctx, Xi);
+    } else {
+      ctx->mres = n;
+      return 1;
+    }
+  }
+
+  ctr = CRYPTO_bswap4(ctx->Yi.d[3]);
+
+#if defined(GHASH)
+  while (len >= GHASH_CHUNK) {
+    (*stream)(in, out, GHASH_CHUNK / 16, key, ctx->Yi.c);
+    ctr += GHASH_CHUNK / 16;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    GHASH(ctx, out, GHASH_CHUNK);
+    out += GHASH_CHUNK;
+    in += GHASH_CHUNK;
+    len -= GHASH_CHUNK;
+  }
+#endif
+  size_t len_blocks = len & kSizeTWithoutLower4Bits;
+  if (len_blocks != 0) {
+    size_t j = len_blocks / 16;
+
+    (*stream)(in, out, j, key, ctx->Yi.c);
+    ctr += (unsigned int)j;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    in += len_blocks;
+    len -= len_blocks;
+#if defined(GHASH)
+    GHASH(ctx, out, len_blocks);
+    out += len_blocks;
+#else
+    while (j--) {
+      for (size_t i = 0; i < 16; ++i) {
+        ctx->Xi.c[i] ^= out[i];
+      }
+      GCM_MUL(ctx, Xi);
+      out += 16;
+    }
+#endif
+  }
+  if (len) {
+    (*ctx->block)(ctx->Yi.c, ctx->EKi.c, key);
+    ++ctr;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    while (len--) {
+      ctx->Xi.c[n] ^= out[n] = in[n] ^ ctx->EKi.c[n];
+      ++n;
+    }
+  }
+
+  ctx->mres = n;
+  return 1;
+}
+
+int CRYPTO_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx, const void *key,
+                                const uint8_t *in, uint8_t *out, size_t len,
+                                ctr128_f stream) {
+  unsigned int n, ctr;
+  uint64_t mlen = ctx->len.u[1];
+#ifdef GCM_FUNCREF_4BIT
+  void (*gcm_gmult_p)(uint64_t Xi[2], const u128 Htable[16]) = ctx->gmult;
+#ifdef GHASH
+  void (*gcm_ghash_p)(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
+                      size_t len) = ctx->ghash;
+#endif
+#endif
+
+  mlen += len;
+  if (mlen > ((UINT64_C(1) << 36) - 32) ||
+      (sizeof(len) == 8 && mlen < len)) {
+    return 0;
+  }
+  ctx->len.u[1] = mlen;
+
+  if (ctx->ares) {
+    // First call to decrypt finalizes GHASH(AAD)
+    GCM_MUL(ctx, Xi);
+    ctx->ares = 0;
+  }
+
+  n = ctx->mres;
+  if (n) {
+    while (n && len) {
+      uint8_t c = *(in++);
+      *(out++) = c ^ ctx->EKi.c[n];
+      ctx->Xi.c[n] ^= c;
+      --len;
+      n = (n + 1) % 16;
+    }
+    if (n == 0) {
+      GCM_MUL(ctx, Xi);
+    } else {
+      ctx->mres = n;
+      return 1;
+    }
+  }
+
+  ctr = CRYPTO_bswap4(ctx->Yi.d[3]);
+
+#if defined(GHASH)
+  while (len >= GHASH_CHUNK) {
+    GHASH(ctx, in, GHASH_CHUNK);
+    (*stream)(in, out, GHASH_CHUNK / 16, key, ctx->Yi.c);
+    ctr += GHASH_CHUNK / 16;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    out += GHASH_CHUNK;
+    in += GHASH_CHUNK;
+    len -= GHASH_CHUNK;
+  }
+#endif
+  size_t len_blocks = len & kSizeTWithoutLower4Bits;
+  if (len_blocks != 0) {
+    size_t j = len_blocks / 16;
+
+#if defined(GHASH)
+    GHASH(ctx, in, len_blocks);
+#else
+    for (size_t k = 0; k < j; k++) {
+      for (size_t i = 0; i < 16; ++i) {
+        ctx->Xi.c[i] ^= in[16 * k + i];
+      }
+      GCM_MUL(ctx, Xi);
+    }
+#endif
+    (*stream)(in, out, j, key, ctx->Yi.c);
+    ctr += (unsigned int)j;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    out += len_blocks;
+    in += len_blocks;
+    len -= len_blocks;
+  }
+  if (len) {
+    (*ctx->block)(ctx->Yi.c, ctx->EKi.c, key);
+    ++ctr;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    while (len--) {
+      uint8_t c = in[n];
+      ctx->Xi.c[n] ^= c;
+      out[n] = c ^ ctx->EKi.c[n];
+      ++n;
+    }
+  }
+
+  ctx->mres = n;
+  return 1;
+}
+
 int CRYPTO_gcm128_finish(GCM128_CONTEXT *ctx, const uint8_t *tag, size_t len) {
   uint64_t alen = ctx->len.u[0] << 3;
   uint64_t clen = ctx->len.u[1] << 3;
@@ -739,6 +739,91 @@ void aes_nohw_encrypt(const uint8_t *in, uint8_t *out,
   PUTU32(out + 12, s3);
 }
 
+// The counter block only changes in its last word from one block to the next,
+// so the first round is done once for the other three words: each word of its
+// output then only needs the one table lookup which depends on the counter.
+void aes_nohw_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+                                   size_t blocks, const AES_KEY *key,
+                                   const uint8_t ivec[16]) {
+  const uint32_t *rk;
+  uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+  uint32_t c0, c1, c2, c3, ctr;
+  int r;
+
+  rk = key->rd_key;
+
+  s0 = GETU32(ivec) ^ rk[0];
+  s1 = GETU32(ivec + 4) ^ rk[1];
+  s2 = GETU32(ivec + 8) ^ rk[2];
+  ctr = GETU32(ivec + 12);
+
+  c0 = Te0[(s0 >> 24)] ^ Te1[(s1 >> 16) & 0xff] ^ Te2[(s2 >> 8) & 0xff] ^
+       rk[4];
+  c1 = Te0[(s1 >> 24)] ^ Te1[(s2 >> 16) & 0xff] ^ Te3[(s0) & 0xff] ^ rk[5];
+  c2 = Te0[(s2 >> 24)] ^ Te2[(s0 >> 8) & 0xff] ^ Te3[(s1) & 0xff] ^ rk[6];
+  c3 = Te1[(s0 >> 16) & 0xff] ^ Te2[(s1 >> 8) & 0xff] ^ Te3[(s2) & 0xff] ^
+       rk[7];
+
+  while (blocks--) {
+    rk = key->rd_key;
+
+    // Finish the first round with the counter.
+    s3 = ctr++ ^ rk[3];
+    t0 = c0 ^ Te3[(s3) & 0xff];
+    t1 = c1 ^ Te2[(s3 >> 8) & 0xff];
+    t2 = c2 ^ Te1[(s3 >> 16) & 0xff];
+    t3 = c3 ^ Te0[(s3 >> 24)];
+    rk += 8;
+
+    // Nr - 2 full rounds:
+    for (r = (key->rounds >> 1) - 1; r > 0; r--) {
+      s0 = Te0[(t0 >> 24)] ^ Te1[(t1 >> 16) & 0xff] ^ Te2[(t2 >> 8) & 0xff] ^
+           Te3[(t3) & 0xff] ^ rk[0];
+      s1 = Te0[(t1 >> 24)] ^ Te1[(t2 >> 16) & 0xff] ^ Te2[(t3 >> 8) & 0xff] ^
+           Te3[(t0) & 0xff] ^ rk[1];
+      s2 = Te0[(t2 >> 24)] ^ Te1[(t3 >> 16) & 0xff] ^ Te2[(t0 >> 8) & 0xff] ^
+           Te3[(t1) & 0xff] ^ rk[2];
+      s3 = Te0[(t3 >> 24)] ^ Te1[(t0 >> 16) & 0xff] ^ Te2[(t1 >> 8) & 0xff] ^
+           Te3[(t2) & 0xff] ^ rk[3];
+
+      t0 = Te0[(s0 >> 24)] ^ Te1[(s1 >> 16) & 0xff] ^ Te2[(s2 >> 8) & 0xff] ^
+           Te3[(s3) & 0xff] ^ rk[4];
+      t1 = Te0[(s1 >> 24)] ^ Te1[(s2 >> 16) & 0xff] ^ Te2[(s3 >> 8) & 0xff] ^
+           Te3[(s0) & 0xff] ^ rk[5];
+      t2 = Te0[(s2 >> 24)] ^ Te1[(s3 >> 16) & 0xff] ^ Te2[(s0 >> 8) & 0xff] ^
+           Te3[(s1) & 0xff] ^ rk[6];
+      t3 = Te0[(s3 >> 24)] ^ Te1[(s0 >> 16) & 0xff] ^ Te2[(s1 >> 8) & 0xff] ^
+           Te3[(s2) & 0xff] ^ rk[7];
+      rk += 8;
+    }
+
+    // apply last round and xor the key stream into the data:
+    s0 = (Te2[(t0 >> 24)] & 0xff000000) ^
+         (Te3[(t1 >> 16) & 0xff] & 0x00ff0000) ^
+         (Te0[(t2 >> 8) & 0xff] & 0x0000ff00) ^
+         (Te1[(t3) & 0xff] & 0x000000ff) ^ rk[0];
+    PUTU32(out, GETU32(in) ^ s0);
+    s1 = (Te2[(t1 >> 24)] & 0xff000000) ^
+         (Te3[(t2 >> 16) & 0xff] & 0x00ff0000) ^
+         (Te0[(t3 >> 8) & 0xff] & 0x0000ff00) ^
+         (Te1[(t0) & 0xff] & 0x000000ff) ^ rk[1];
+    PUTU32(out + 4, GETU32(in + 4) ^ s1);
+    s2 = (Te2[(t2 >> 24)] & 0xff000000) ^
+         (Te3[(t3 >> 16) & 0xff] & 0x00ff0000) ^
+         (Te0[(t0 >> 8) & 0xff] & 0x0000ff00) ^
+         (Te1[(t1) & 0xff] & 0x000000ff) ^ rk[2];
+    PUTU32(out + 8, GETU32(in + 8) ^ s2);
+    s3 = (Te2[(t3 >> 24)] & 0xff000000) ^
+         (Te3[(t0 >> 16) & 0xff] & 0x00ff0000) ^
+         (Te0[(t1 >> 8) & 0xff] & 0x0000ff00) ^
+         (Te1[(t2) & 0xff] & 0x000000ff) ^ rk[3];
+    PUTU32(out + 12, GETU32(in + 12) ^ s3);
+
+    in += 16;
+    out += 16;
+  }
+}
+
 void aes_nohw_decrypt(const uint8_t *in, uint8_t *out,
 		      const AES_KEY *key) {
   const uint32_t *rk;
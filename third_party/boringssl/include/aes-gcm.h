@@ -57,6 +57,13 @@
 typedef void (*block128_f)(const uint8_t in[16], uint8_t out[16],
                            const void *key);
 
+// ctr128_f is the type of a function that performs CTR-mode encryption of
+// |blocks| blocks from |in| to |out|. Only the last 32 bits of the counter
+// block |ivec| are incremented, as a big-endian number, and |ivec| itself is
+// not updated.
+typedef void (*ctr128_f)(const uint8_t *in, uint8_t *out, size_t blocks,
+                         const void *key, const uint8_t ivec[16]);
+
 // GCM definitions
 typedef struct { uint64_t hi,lo; } u128;
 
@@ -85,7 +92,11 @@ struct gcm128_context {
   // Note that the order of |Xi|, |H| and |Htable| is fixed by the MOVBE-based,
   // x86-64, GHASH assembly.
   u128 H;
+#ifdef CONFIG_AES_GCM_GHASH_8BIT
+  u128 Htable[256];
+#else
   u128 Htable[16];
+#endif
   gmult_func gmult;
   ghash_func ghash;
 
@@ -133,6 +144,22 @@ int CRYPTO_gcm128_decrypt(GCM128_CONTEXT *ctx, const void *key,
                                          const uint8_t *in, uint8_t *out,
                                          size_t len);
 
+// CRYPTO_gcm128_encrypt_ctr32 encrypts |len| bytes from |in| to |out| using
+// the CTR function |stream| for all the whole blocks. The |key| must be the
+// same key that was passed to |CRYPTO_gcm128_init|. It returns one on success
+// and zero otherwise.
+int CRYPTO_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx, const void *key,
+                                const uint8_t *in, uint8_t *out, size_t len,
+                                ctr128_f stream);
+
+// CRYPTO_gcm128_decrypt_ctr32 decrypts |len| bytes from |in| to |out| using
+// the CTR function |stream| for all the whole blocks. The |key| must be the
+// same key that was passed to |CRYPTO_gcm128_init|. It returns one on success
+// and zero otherwise.
+int CRYPTO_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx, const void *key,
+                                const uint8_t *in, uint8_t *out, size_t len,
+                                ctr128_f stream);
+
 // CRYPTO_gcm128_finish calculates the authenticator and compares it against
 // |len| bytes of |tag|. It returns one on success and zero otherwise.
 int CRYPTO_gcm128_finish(GCM128_CONTEXT *ctx, const uint8_t *tag,
@@ -65,6 +65,8 @@ static int parse_panic_info_cm(const struct panic_data *pdata)
 	print_panic_reg(13, lregs, origin == ORIG_HANDLER ? 2 : 0);
 	print_panic_reg(14, sregs, 5);
 	print_panic_reg(15, sregs, 6);
+	if (pdata->flags & PANIC_DATA_FLAG_STACK_TASK)
+		printf("Stack overflow in task %d\n", pdata->stack_task);
 
 	return 0;
 }
@@ -62,6 +62,8 @@ static struct option long_opts[] = {
 
 const char help_str[] =
 	"Commands:\n"
+	"  acpistats [clear]\n"
+	"      Print or clear the ACPI EC port statistics\n"
 	"  adcread <channel>\n"
 	"      Read an ADC channel.\n"
 	"  addentropy [reset]\n"
@@ -222,12 +224,16 @@ const char help_str[] =
 	"      Get All USB-PD alternate SVIDs and modes on <port>\n"
 	"  pdsetmode <port> <svid> <opos>\n"
 	"      Set USB-PD alternate SVID and mode on <port>\n"
+	"  pdtiming [clear]\n"
+	"      Print or clear the USB-PD message latency histograms\n"
 	"  port80flood\n"
 	"      Rapidly write bytes to port 80\n"
 	"  port80read\n"
 	"      Print history of port 80 write\n"
 	"  powerinfo\n"
 	"      Prints power-related information\n"
+	"  profiler <start [period_us] | stop | clear | read>\n"
+	"      Control the PC-sampling profiler, or print its histogram\n"
 	"  protoinfo\n"
 	"       Prints EC host protocol information\n"
 	"  pse\n"
@@ -287,12 +293,16 @@ const char help_str[] =
 	"      Serial output test for COM2\n"
 	"  smartdischarge\n"
 	"      Set/Get smart discharge parameters\n"
+	"  stackinfo\n"
+	"      Prints the peak stack usage of each EC task\n"
 	"  stress [reboot] [help]\n"
 	"      Stress test the ec host command interface.\n"
 	"  sysinfo [flags|reset_flags|firmware_copy]\n"
 	"      Display system info.\n"
 	"  switches\n"
 	"      Prints current EC switch positions\n"
+	"  tasktrace <read | clear | start | stop>\n"
+	"      Print or control the task switch and IRQ trace\n"
 	"  temps <sensorid>\n"
 	"      Print temperature.\n"
 	"  tempsinfo <sensorid>\n"
@@ -442,6 +452,59 @@ static int read_mapped_string(uint8_t offset, char *buffer, int max_size)
 	return ret;
 }
 
+int cmd_acpi_stats(int argc, char *argv[])
+{
+	struct ec_params_acpi_stats p;
+	struct ec_response_acpi_stats *r = ec_inbuf;
+	const struct ec_acpi_stats_entry *e;
+	int i, rv;
+
+	memset(&p, 0, sizeof(p));
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear")) {
+			fprintf(stderr, "Usage: %s [clear]\n", argv[0]);
+			return -1;
+		}
+		p.cmd = EC_ACPI_STATS_CLEAR;
+		return ec_command(EC_CMD_ACPI_STATS, 0, &p, sizeof(p),
+				  ec_inbuf, ec_max_insize);
+	}
+
+	p.cmd = EC_ACPI_STATS_READ;
+	rv = ec_command(EC_CMD_ACPI_STATS, 0, &p, sizeof(p),
+			ec_inbuf, ec_max_insize);
+	if (rv < 0)
+		return rv;
+
+	printf("reads   %u, %u us average, %u us max\n", r->reads,
+	       r->reads ? r->read_total_us / r->reads : 0, r->read_max_us);
+	printf("writes  %u, %u us average, %u us max\n", r->writes,
+	       r->writes ? r->write_total_us / r->writes : 0,
+	       r->write_max_us);
+	printf("handler %u us max\n", r->handler_max_us);
+	printf("bursts  %u, cache %u hits, %u fills of %u bytes\n",
+	       r->bursts, r->cache_hits, r->cache_fills, r->cache_bytes);
+	printf("addr  reads writes\n");
+
+	/* Read the addresses as many at a time as fit */
+	while (1) {
+		for (i = 0; i < r->count; i++) {
+			e = &r->entry[i];
+			printf("0x%02x %6u %6u\n", e->addr, e->reads,
+			       e->writes);
+		}
+		if (!r->count || r->next > 0xff)
+			break;
+		p.addr = r->next;
+		rv = ec_command(EC_CMD_ACPI_STATS, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+	}
+
+	return 0;
+}
+
 int cmd_adc_read(int argc, char *argv[])
 {
 	char *e;
@@ -2759,6 +2822,34 @@ static void sig_quit_handler(int sig)
 	sig_quit = true;
 }
 
+int cmd_stack_info(int argc, char *argv[])
+{
+	struct ec_params_stack_info p;
+	struct ec_response_stack_info *r = ec_inbuf;
+	const struct ec_stack_info_entry *e;
+	int i, rv;
+
+	printf("Task  Peak/Size\n");
+
+	/* Read the tasks as many at a time as fit */
+	p.first = 0;
+	do {
+		rv = ec_command(EC_CMD_STACK_INFO, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		for (i = 0; i < r->count; i++) {
+			e = &r->entry[i];
+			if (e->size)
+				printf("%4d %6u/%u\n", p.first + i, e->peak,
+				       e->size);
+		}
+		p.first += r->count;
+	} while (r->count && p.first < r->tasks);
+
+	return 0;
+}
+
 int cmd_stress_test(int argc, char *argv[])
 {
 	int i;
@@ -2927,6 +3018,58 @@ int read_mapped_temperature(int id)
 }
 
 
+int cmd_task_trace(int argc, char *argv[])
+{
+	static const char * const events[] = {
+		[EC_TASK_TRACE_SWITCH] = "switch",
+		[EC_TASK_TRACE_IRQ_ENTER] = "irq_enter",
+		[EC_TASK_TRACE_IRQ_EXIT] = "irq_exit",
+	};
+	struct ec_params_task_trace p;
+	struct ec_response_task_trace *r = ec_inbuf;
+	int i, rv;
+
+	memset(&p, 0, sizeof(p));
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <read | clear | start | stop>\n",
+			argv[0]);
+		return -1;
+	}
+	if (!strcasecmp(argv[1], "read")) {
+		p.cmd = EC_TASK_TRACE_READ;
+	} else if (!strcasecmp(argv[1], "clear")) {
+		p.cmd = EC_TASK_TRACE_CLEAR;
+	} else if (!strcasecmp(argv[1], "start")) {
+		p.cmd = EC_TASK_TRACE_START;
+	} else if (!strcasecmp(argv[1], "stop")) {
+		p.cmd = EC_TASK_TRACE_STOP;
+	} else {
+		fprintf(stderr, "Unknown subcommand: %s\n", argv[1]);
+		return -1;
+	}
+
+	/* Records are read a buffer at a time, oldest first */
+	do {
+		rv = ec_command(EC_CMD_TASK_TRACE, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (!p.offset)
+			printf("%u records, %d kept%s\n", r->total, r->kept,
+			       (r->flags & EC_TASK_TRACE_FLAG_RUNNING) ?
+			       ", running" : "");
+		for (i = 0; i < r->count; i++)
+			printf("%10u %-9s %d\n", r->entry[i].time_us,
+			       r->entry[i].event < ARRAY_SIZE(events) ?
+			       events[r->entry[i].event] : "?",
+			       r->entry[i].id);
+		p.offset += r->count;
+	} while (p.cmd == EC_TASK_TRACE_READ && r->count &&
+		 p.offset < r->kept);
+
+	return 0;
+}
+
 int cmd_temperature(int argc, char *argv[])
 {
 	int rv;
@@ -9100,6 +9243,70 @@ enum port_80_event {
 	PORT_80_EVENT_RESET = 0x1002,   /* RESET transition */
 };
 
+int cmd_profiler(int argc, char *argv[])
+{
+	struct ec_params_profiler p;
+	struct ec_response_profiler *r = ec_inbuf;
+	int i, rv;
+	char *e;
+
+	memset(&p, 0, sizeof(p));
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <start [period_us] | stop | clear | "
+			"read>\n", argv[0]);
+		return -1;
+	}
+	if (!strcasecmp(argv[1], "start")) {
+		p.cmd = EC_PROFILER_START;
+		if (argc > 2) {
+			p.period_us = strtoul(argv[2], &e, 0);
+			if (*e) {
+				fprintf(stderr, "Bad period_us.\n");
+				return -1;
+			}
+		}
+	} else if (!strcasecmp(argv[1], "stop")) {
+		p.cmd = EC_PROFILER_STOP;
+	} else if (!strcasecmp(argv[1], "clear")) {
+		p.cmd = EC_PROFILER_CLEAR;
+	} else if (!strcasecmp(argv[1], "read")) {
+		p.cmd = EC_PROFILER_READ;
+	} else {
+		fprintf(stderr, "Unknown subcommand: %s\n", argv[1]);
+		return -1;
+	}
+
+	rv = ec_command(EC_CMD_PROFILER, 0, &p, sizeof(p),
+			ec_inbuf, ec_max_insize);
+	if (rv < 0)
+		return rv;
+
+	printf("%s, %u samples every %u us, %u dropped, %u entries%s\n",
+	       (r->flags & EC_PROFILER_FLAG_RUNNING) ? "Running" : "Stopped",
+	       r->samples, r->period_us, r->dropped, r->entries,
+	       (r->flags & EC_PROFILER_FLAG_RELATIVE_PC) ?
+	       ", PCs relative" : "");
+	if (p.cmd != EC_PROFILER_READ)
+		return 0;
+
+	/* Read the histogram as many entries at a time as fit */
+	printf("pc         task count\n");
+	while (p.offset < r->entries) {
+		rv = ec_command(EC_CMD_PROFILER, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (!r->count)
+			break;
+		for (i = 0; i < r->count; i++)
+			printf("0x%08x %4d %u\n", r->entry[i].pc,
+			       r->entry[i].task, r->entry[i].count);
+		p.offset += r->count;
+	}
+
+	return 0;
+}
+
 int cmd_port80_read(int argc, char *argv[])
 {
 	struct ec_params_port80_read p;
@@ -9467,6 +9674,70 @@ int cmd_pd_write_log(int argc, char *argv[])
 	return ec_command(EC_CMD_PD_WRITE_LOG_ENTRY, 0, &p, sizeof(p), NULL, 0);
 }
 
+int cmd_pd_timing(int argc, char *argv[])
+{
+	static const char * const stages[] = {
+		[EC_PD_TIMING_ALERT_TO_RX] = "alert-rx",
+		[EC_PD_TIMING_RX_TO_PE] = "rx-pe",
+		[EC_PD_TIMING_RX_TO_TX] = "rx-tx",
+		[EC_PD_TIMING_TX_TO_GOODCRC] = "tx-crc",
+	};
+	struct ec_params_pd_timing p;
+	struct ec_response_pd_timing *r = ec_inbuf;
+	const struct ec_pd_timing_entry *e;
+	int i, b, rv;
+
+	memset(&p, 0, sizeof(p));
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear")) {
+			fprintf(stderr, "Usage: %s [clear]\n", argv[0]);
+			return -1;
+		}
+		p.cmd = EC_PD_TIMING_CLEAR;
+		return ec_command(EC_CMD_PD_TIMING, 0, &p, sizeof(p),
+				  ec_inbuf, ec_max_insize);
+	}
+
+	p.cmd = EC_PD_TIMING_READ;
+	rv = ec_command(EC_CMD_PD_TIMING, 0, &p, sizeof(p),
+			ec_inbuf, ec_max_insize);
+	if (rv < 0)
+		return rv;
+
+	printf("%u histograms, %u dropped, %u tx failed\n", r->entries,
+	       r->dropped, r->tx_failed);
+	printf("port stage    message  max_us ");
+	for (b = 0; b < EC_PD_TIMING_BUCKETS - 1; b++)
+		printf(" <%u", 1 << (EC_PD_TIMING_BUCKET_SHIFT + b));
+	printf(" more\n");
+
+	/* Read the histograms as many at a time as fit */
+	while (p.offset < r->entries) {
+		rv = ec_command(EC_CMD_PD_TIMING, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (!r->count)
+			break;
+		for (i = 0; i < r->count; i++) {
+			e = &r->entry[i];
+			printf("C%-3d %-8s %s %-2d %7u:", e->port,
+			       e->stage < ARRAY_SIZE(stages) ?
+			       stages[e->stage] : "?",
+			       (e->msg & EC_PD_TIMING_MSG_EXT) ? "ext " :
+			       (e->msg & EC_PD_TIMING_MSG_DATA) ? "data" :
+			       "ctrl", e->msg & EC_PD_TIMING_MSG_TYPE,
+			       e->max_us);
+			for (b = 0; b < EC_PD_TIMING_BUCKETS; b++)
+				printf(" %u", e->count[b]);
+			printf("\n");
+		}
+		p.offset += r->count;
+	}
+
+	return 0;
+}
+
 int cmd_typec_control(int argc, char *argv[])
 {
 	struct ec_params_typec_control p;
@@ -10023,6 +10294,7 @@ int cmd_cec(int argc, char *argv[])
 
 /* NULL-terminated list of commands */
 const struct command commands[] = {
+	{"acpistats", cmd_acpi_stats},
 	{"adcread", cmd_adc_read},
 	{"addentropy", cmd_add_entropy},
 	{"apreset", cmd_apreset},
@@ -10106,8 +10378,10 @@ const struct command commands[] = {
 	{"pdlog", cmd_pd_log},
 	{"pdcontrol", cmd_pd_control},
 	{"pdchipinfo", cmd_pd_chip_info},
+	{"pdtiming", cmd_pd_timing},
 	{"pdwritelog", cmd_pd_write_log},
 	{"powerinfo", cmd_power_info},
+	{"profiler", cmd_profiler},
 	{"protoinfo", cmd_proto_info},
 	{"pse", cmd_pse},
 	{"pstoreinfo", cmd_pstore_info},
@@ -10134,10 +10408,12 @@ const struct command commands[] = {
 	{"rwsigstatus", cmd_rwsig_status},
 	{"sertest", cmd_serial_test},
 	{"smartdischarge", cmd_smart_discharge},
+	{"stackinfo", cmd_stack_info},
 	{"stress", cmd_stress_test},
 	{"sysinfo", cmd_sysinfo},
 	{"port80flood", cmd_port_80_flood},
 	{"switches", cmd_switches},
+	{"tasktrace", cmd_task_trace},
 	{"temps", cmd_temperature},
 	{"tempsinfo", cmd_temp_sensor_info},
 	{"test", cmd_test},
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# Copyright 2021 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Maps the PCs sampled by the EC profiler to functions.
+
+Reads the histogram printed by the "profile" console command or by
+"ectool profiler read", one "<pc> <task> <count>" entry per line, and prints
+the functions the EC spends its time in, using addr2line on the EC image.
+
+Example:
+  ectool profiler read > profile.txt
+  util/profiler_symbolize.py build/hx20/RW/ec.RW.elf profile.txt
+
+On the emulator, PCs are relative to the start of the executable, which the
+histogram header says with "PCs relative"; they are then made absolute with
+the ELF's __executable_start.
+"""
+
+from __future__ import print_function
+
+import argparse
+import collections
+import re
+import subprocess
+import sys
+
+ENTRY_RE = re.compile(r'^\s*(0x[0-9a-fA-F]+)\s+(\d+)\s+(\d+)\s*$')
+RELATIVE_RE = re.compile(r'PCs relative|relative PC', re.IGNORECASE)
+
+TASK_IRQ = 0xff
+
+
+def parse_histogram(lines):
+  """Returns the (pc, task, count) entries and if the PCs are relative."""
+  entries = []
+  relative = False
+  for line in lines:
+    if RELATIVE_RE.search(line):
+      relative = True
+    m = ENTRY_RE.match(line)
+    if m:
+      entries.append((int(m.group(1), 16), int(m.group(2)),
+                      int(m.group(3))))
+  return entries, relative
+
+
+def executable_start(nm, elf):
+  """Returns the link address of the start of the executable."""
+  out = subprocess.run([nm, elf], check=True, stdout=subprocess.PIPE,
+                       universal_newlines=True).stdout
+  for line in out.splitlines():
+    fields = line.split()
+    if len(fields) == 3 and fields[2] == '__executable_start':
+      return int(fields[0], 16)
+  return 0
+
+
+def symbolize(addr2line, elf, pcs):
+  """Returns {pc: (function, file:line)} for the PCs."""
+  pcs = sorted(set(pcs))
+  if not pcs:
+    return {}
+  out = subprocess.run([addr2line, '-f', '-C', '-e', elf] +
+                       ['0x%x' % pc for pc in pcs], check=True,
+                       stdout=subprocess.PIPE,
+                       universal_newlines=True).stdout.splitlines()
+  # Two lines per address: function, then file:line
+  return {pc: (out[2 * i], out[2 * i + 1]) for i, pc in enumerate(pcs)}
+
+
+def task_name(task):
+  return 'IRQ' if task == TASK_IRQ else str(task)
+
+
+def parse_options(argv):
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+  parser.add_argument('elf', help='EC image the samples were taken on.')
+  parser.add_argument('histogram', nargs='?', type=argparse.FileType('r'),
+                      default=sys.stdin,
+                      help='Profiler output (default: stdin).')
+  parser.add_argument('--relative', action='store_true',
+                      help='PCs are relative to the start of the image, '
+                      'even if the histogram doesn\'t say so.')
+  parser.add_argument('--by-task', action='store_true',
+                      help='Count each function separately for each task.')
+  parser.add_argument('--lines', action='store_true',
+                      help='Report source lines rather than functions.')
+  parser.add_argument('-n', '--top', type=int, default=30,
+                      help='Number of entries to print.')
+  parser.add_argument('--cross', default='',
+                      help='Toolchain prefix, e.g. arm-none-eabi-')
+  return parser.parse_args(argv)
+
+
+def main(argv):
+  opts = parse_options(argv)
+
+  entries, relative = parse_histogram(opts.histogram)
+  if not entries:
+    print('No profiler entries found.', file=sys.stderr)
+    return 1
+
+  base = 0
+  if relative or opts.relative:
+    base = executable_start(opts.cross + 'nm', opts.elf)
+  symbols = symbolize(opts.cross + 'addr2line', opts.elf,
+                      [pc + base for pc, _, _ in entries])
+
+  total = sum(count for _, _, count in entries)
+  hist = collections.Counter()
+  for pc, task, count in entries:
+    function, line = symbols[pc + base]
+    key = line if opts.lines else function
+    hist[(key, task) if opts.by_task else (key,)] += count
+
+  print('%d samples' % total)
+  print('%7s %7s  %s' % ('samples', '%', 'location'))
+  for key, count in hist.most_common(opts.top):
+    where = key[0]
+    if opts.by_task:
+      where += ' [task %s]' % task_name(key[1])
+    print('%7d %6.2f%%  %s' % (count, 100.0 * count / total, where))
+
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# Copyright 2021 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Converts an EC task trace to Chrome trace JSON.
+
+Reads the records printed by the "tasktrace" console command, by
+"ectool tasktrace read", or written by the emulator to $EC_TASK_TRACE, one
+"<time_us> <event> <id>" record per line, and writes a trace which
+chrome://tracing and https://ui.perfetto.dev show as a timeline: one track
+per task, with the slices where it ran, and one track with the interrupts.
+
+Examples:
+  ectool tasktrace stop
+  ectool tasktrace read > hx20.trace
+  util/task_trace_to_chrome.py --task-names HOOKS,CYPD,... hx20.trace \\
+      -o hx20.json
+
+  EC_TASK_TRACE=/tmp/usb_pe_drp.trace make run-usb_pe_drp
+  util/task_trace_to_chrome.py /tmp/usb_pe_drp.trace -o usb_pe_drp.json
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import re
+import sys
+
+RECORD_RE = re.compile(r'^\s*(\d+)\s+(switch|irq_enter|irq_exit)\s+(\d+)\s*$')
+TASK_NAME_RE = re.compile(r'^task\s+(\d+)\s+(.+?)\s*$')
+
+# Track of the interrupts, after the tasks
+IRQ_TID = 1000
+
+
+def parse_trace(lines):
+  """Returns the (time_us, event, id) records and {task id: name}."""
+  records = []
+  names = {}
+  wrap = 0
+  last = None
+  for line in lines:
+    m = TASK_NAME_RE.match(line)
+    if m:
+      names[int(m.group(1))] = m.group(2)
+      continue
+    m = RECORD_RE.match(line)
+    if not m:
+      continue
+    t = int(m.group(1))
+    # Timestamps are the low 32 bits of the EC clock. Records claimed just
+    # before an interrupt may be stamped a little after it, so only a big
+    # step back is a wrap.
+    if last is not None and t + (1 << 31) < last:
+      wrap += 1 << 32
+    last = t
+    records.append((t + wrap, m.group(2), int(m.group(3))))
+  return records, names
+
+
+def to_chrome(records, names):
+  """Returns the Chrome trace events for the records."""
+  events = []
+
+  def add_slice(name, tid, start, end):
+    events.append({'name': name, 'ph': 'X', 'pid': 0, 'tid': tid,
+                   'ts': start, 'dur': max(end - start, 0)})
+
+  task = None
+  task_start = 0
+  irqs = []
+  tids = set()
+  for t, event, i in records:
+    if event == 'switch':
+      if task is not None:
+        add_slice(names.get(task, 'task %d' % task), task, task_start, t)
+      task, task_start = i, t
+      tids.add(i)
+    elif event == 'irq_enter':
+      irqs.append((i, t))
+    elif irqs and irqs[-1][0] == i:
+      # Exits of interrupts which started before the trace are dropped
+      add_slice('irq %d' % i, IRQ_TID, irqs.pop()[1], t)
+
+  end = records[-1][0] if records else 0
+  if task is not None:
+    add_slice(names.get(task, 'task %d' % task), task, task_start, end)
+  while irqs:
+    i, start = irqs.pop()
+    add_slice('irq %d' % i, IRQ_TID, start, end)
+
+  for tid in sorted(tids):
+    events.append({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': tid,
+                   'args': {'name': names.get(tid, 'task %d' % tid)}})
+    events.append({'name': 'thread_sort_index', 'ph': 'M', 'pid': 0,
+                   'tid': tid, 'args': {'sort_index': tid}})
+  events.append({'name': 'thread_name', 'ph': 'M', 'pid': 0,
+                 'tid': IRQ_TID, 'args': {'name': 'IRQs'}})
+  events.append({'name': 'process_name', 'ph': 'M', 'pid': 0,
+                 'args': {'name': 'EC'}})
+  return events
+
+
+def parse_options(argv):
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+  parser.add_argument('trace', nargs='?', type=argparse.FileType('r'),
+                      default=sys.stdin,
+                      help='Task trace (default: stdin).')
+  parser.add_argument('-o', '--output', type=argparse.FileType('w'),
+                      default=sys.stdout,
+                      help='Chrome trace JSON (default: stdout).')
+  parser.add_argument('--task-names',
+                      help='Comma-separated task names, in task id order, '
+                      'for traces which don\'t name the tasks.')
+  return parser.parse_args(argv)
+
+
+def main(argv):
+  opts = parse_options(argv)
+
+  records, names = parse_trace(opts.trace)
+  if not records:
+    print('No task trace records found.', file=sys.stderr)
+    return 1
+  if opts.task_names:
+    names.update(enumerate(opts.task_names.split(',')))
+
+  json.dump({'traceEvents': to_chrome(records, names),
+             'displayTimeUnit': 'ms'}, opts.output, indent=1)
+  opts.output.write('\n')
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))
@@ -42,4 +42,10 @@ static inline uint32_t deprecated_atomic_read_clear(uint32_t volatile *addr)
 	return atomic_clear((atomic_t *)addr);
 }
 
+static inline uint32_t deprecated_atomic_read_add(uint32_t volatile *addr,
+						  uint32_t value)
+{
+	return atomic_add((atomic_t *)addr, value);
+}
+
 #endif  /* __CROS_EC_ATOMIC_H */